@@ -0,0 +1,1388 @@
+#include "Benchmarks.h"
+#include <Windows.h>
+#include "Vertex.h"
+#include "Mesh.h"
+#include "Material.h"
+#include "SimpleShader.h"
+#include "GeometryGenerator.h"
+#include "TransformSystem.h"
+#include "JobSystem.h"
+#include "FramePipeline.h"
+#include "FrameLimiter.h"
+#include "FrustumCuller.h"
+#include "DynamicAABBTree.h"
+#include "SpatialHashGrid.h"
+#include "SweepAndPrune.h"
+#include "RenderQueue.h"
+#include "StateCache.h"
+#include "ConstantBufferRing.h"
+#include "InstanceBatcher.h"
+#include "ObjectTable.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+// For the DirectX Math library
+using namespace DirectX;
+
+namespace
+{
+	__int64 ReadPerfCounter()
+	{
+		__int64 now;
+		QueryPerformanceCounter((LARGE_INTEGER*)&now);
+		return now;
+	}
+}
+
+Benchmarks::Benchmarks(ID3D11Device* t_device, Material* t_material, float t_aspect_ratio) :
+	device(t_device),
+	vertexShader(t_material->getVertexShader()),
+	pixelShader(t_material->getPixelShader()),
+	aspectRatio(t_aspect_ratio)
+{
+	__int64 perfFreq;
+	QueryPerformanceFrequency((LARGE_INTEGER*)&perfFreq);
+	perfCounterMilliseconds = 1000.0 / (double)perfFreq;
+	perfCounterNanoseconds = 1000000000.0 / (double)perfFreq;
+}
+
+void Benchmarks::RunAll()
+{
+	BenchmarkPrimitiveGeneration();
+	BenchmarkTransforms();
+	BenchmarkJobSystem();
+	BenchmarkFramePipeline();
+	BenchmarkFrameLimiter();
+	BenchmarkFrustumCulling();
+	BenchmarkBoundsTree();
+	BenchmarkSpatialHash();
+	BenchmarkSweepAndPrune();
+	BenchmarkRenderQueue();
+	BenchmarkStateCache();
+	BenchmarkInstancing();
+	BenchmarkConstantRing();
+	BenchmarkObjectTable();
+	BenchmarkShaderHandles();
+}
+
+// --------------------------------------------------------
+// Compares generating each primitive (and creating its buffers)
+// against loading the bundled OBJ version of it, and prints the
+// timings to the debug console.
+// --------------------------------------------------------
+void Benchmarks::BenchmarkPrimitiveGeneration()
+{
+	const PrimitiveType primitives[] = { PrimitiveType::Cube, PrimitiveType::Sphere, PrimitiveType::Cylinder, PrimitiveType::Cone, PrimitiveType::Torus };
+	const char* objFiles[] =
+	{
+		"Assets/Models/cube.obj",
+		"Assets/Models/sphere.obj",
+		"Assets/Models/cylinder.obj",
+		"Assets/Models/cone.obj",
+		"Assets/Models/torus.obj"
+	};
+
+	std::vector<Vertex> vertices;
+	std::vector<UINT> indices;
+	for (size_t i = 0; i < _countof(primitives); ++i)
+	{
+		__int64 start, generated, loaded;
+
+		start = ReadPerfCounter();
+		vertices.clear();
+		indices.clear();
+		GeometryGenerator::CreatePrimitive(primitives[i], 0, vertices, indices);
+		Mesh* generatedMesh = new Mesh(device, &vertices[0], (UINT)vertices.size(), &indices[0], (UINT)indices.size());
+		generated = ReadPerfCounter();
+
+		Mesh* loadedMesh = new Mesh(device, objFiles[i]);
+		loaded = ReadPerfCounter();
+
+		printf("\n%-28s generated %.3fms (%u indices)   OBJ %.3fms (%u indices)",
+			objFiles[i],
+			(generated - start) * perfCounterMilliseconds, generatedMesh->GetIndexCount(),
+			(loaded - generated) * perfCounterMilliseconds, loadedMesh->GetIndexCount());
+
+		delete generatedMesh;
+		delete loadedMesh;
+	}
+}
+
+// --------------------------------------------------------
+// Fills a TransformSystem with 10k, 100k and 1M random transforms
+// and times computing all of their world matrices per frame, using
+// both the SIMD batch kernel and the Entity-style scalar path.
+// --------------------------------------------------------
+void Benchmarks::BenchmarkTransforms()
+{
+	const size_t transformCounts[] = { 10000, 100000, 1000000 };
+	const int frameCount = 10;
+
+	for (size_t i = 0; i < _countof(transformCounts); ++i)
+	{
+		TransformSystem transforms;
+		transforms.Reserve(transformCounts[i]);
+		for (size_t t = 0; t < transformCounts[i]; ++t)
+		{
+			float value = (float)t;
+			transforms.Create(
+				XMFLOAT3(value, value * 0.5f, -value),
+				XMFLOAT3(value * 0.1f, value * 0.2f, value * 0.3f),
+				XMFLOAT3(1.0f, 2.0f, 3.0f));
+		}
+
+		__int64 start, batched, scalar;
+		start = ReadPerfCounter();
+		for (int frame = 0; frame < frameCount; ++frame)
+		{
+			transforms.UpdateWorldMatrices();
+		}
+		batched = ReadPerfCounter();
+		for (int frame = 0; frame < frameCount; ++frame)
+		{
+			transforms.UpdateWorldMatricesScalar();
+		}
+		scalar = ReadPerfCounter();
+
+		printf("\n%8zu transforms   batch %.3fms/frame   scalar %.3fms/frame",
+			transformCounts[i],
+			(batched - start) * perfCounterMilliseconds / frameCount,
+			(scalar - batched) * perfCounterMilliseconds / frameCount);
+	}
+}
+
+// --------------------------------------------------------
+// Runs the same workloads on JobSystems of 1, 2, 4... threads.
+// Each run checks its results, so a broken scheduler shows up as
+// a FAILED line (or a hang) rather than just a bad timing.
+// --------------------------------------------------------
+void Benchmarks::BenchmarkJobSystem()
+{
+	const size_t outerCount = 256;
+	const size_t innerCount = 4096;
+	const int chainLength = 64;
+	const int repeatCount = 10;
+
+	std::vector<float> values(outerCount * innerCount);
+	unsigned int maxThreads = (std::max)(std::thread::hardware_concurrency(), 1u);
+	double singleThreadTime = 0.0;
+
+	for (unsigned int threadCount = 1; ; threadCount = (std::min)(threadCount * 2, maxThreads))
+	{
+		JobSystem jobSystem(threadCount);
+		bool passed = true;
+		__int64 start, end;
+		start = ReadPerfCounter();
+
+		for (int repeat = 0; repeat < repeatCount; ++repeat)
+		{
+			// Nested parallel loops: every outer index waits on its own inner loop
+			std::atomic<uint64_t> sum(0);
+			auto outer = [&](size_t t_outer)
+			{
+				uint64_t localSum = 0;
+				auto inner = [&](size_t t_inner)
+				{
+					size_t index = t_outer * innerCount + t_inner;
+					values[index] = (float)index * 0.5f + (float)repeat;
+				};
+				jobSystem.ParallelFor(innerCount, 64, inner);
+				for (size_t i = 0; i < innerCount; ++i)
+				{
+					localSum += t_outer * innerCount + i;
+				}
+				sum += localSum;
+			};
+			jobSystem.ParallelFor(outerCount, 1, outer);
+
+			uint64_t total = outerCount * innerCount;
+			passed &= sum == total * (total - 1) / 2;
+
+			// A chain of batches, each only allowed to start once the previous one is done
+			struct ChainState
+			{
+				std::atomic<int> Finished;
+				std::atomic<bool> OutOfOrder;
+			} chain;
+			chain.Finished = 0;
+			chain.OutOfOrder = false;
+
+			std::vector<JobCounter> counters(chainLength);
+			for (int link = 0; link < chainLength; ++link)
+			{
+				for (size_t job = 0; job < 8; ++job)
+				{
+					jobSystem.Run([](const Job& t_job)
+					{
+						ChainState* state = (ChainState*)t_job.Data;
+						if (state->Finished++ < (int)t_job.Begin * 8)
+						{
+							state->OutOfOrder = true;
+						}
+					}, &chain, link, link + 1, &counters[link], link > 0 ? &counters[link - 1] : nullptr);
+				}
+			}
+			jobSystem.Wait(&counters[chainLength - 1]);
+			passed &= chain.Finished == chainLength * 8 && !chain.OutOfOrder;
+		}
+
+		end = ReadPerfCounter();
+		double time = (end - start) * perfCounterMilliseconds / repeatCount;
+		if (threadCount == 1)
+		{
+			singleThreadTime = time;
+		}
+
+		printf("\nJobSystem %2u threads   %.3fms/run   %.2fx   %llu jobs   %llu steals   %s",
+			threadCount,
+			time,
+			singleThreadTime / time,
+			(unsigned long long)jobSystem.GetExecutedCount() / repeatCount,
+			(unsigned long long)jobSystem.GetStealCount() / repeatCount,
+			passed ? "ok" : "FAILED");
+
+		if (threadCount == maxThreads)
+		{
+			break;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Runs a made-up frame (an Update that builds world matrices
+// and a Draw that walks them) with no window or GPU involved:
+// first back to back, then with Update on a thread of its own
+// for every latency FramePipeline supports.
+// --------------------------------------------------------
+void Benchmarks::BenchmarkFramePipeline()
+{
+	const size_t itemCount = 20000;
+	const int frameCount = 200;
+
+	// Stand-in for Update: animate every item and write it into the snapshot
+	auto simulate = [itemCount](RenderSnapshot& t_snapshot, int t_frame)
+	{
+		t_snapshot.Items.resize(itemCount);
+		XMStoreFloat4x4(&t_snapshot.ViewMatrix, XMMatrixTranspose(XMMatrixLookToLH(XMVectorSet(0.0f, 0.0f, -50.0f, 1.0f), XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f))));
+		XMStoreFloat4x4(&t_snapshot.ProjectionMatrix, XMMatrixTranspose(XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 0.1f, 100.0f)));
+		for (size_t i = 0; i < itemCount; ++i)
+		{
+			XMMATRIX world = XMMatrixRotationRollPitchYaw(0.01f * t_frame, 0.001f * i, 0.0f) * XMMatrixTranslation((float)(i % 100), (float)(i / 100), 0.0f);
+			XMStoreFloat4x4(&t_snapshot.Items[i].World, XMMatrixTranspose(world));
+			XMStoreFloat4x4(&t_snapshot.Items[i].WorldInverseTranspose, XMMatrixInverse(nullptr, world));
+		}
+	};
+
+	// Stand-in for Draw: build each item's final matrix, as a constant buffer upload would
+	float checksum = 0.0f;
+	auto render = [&checksum](const RenderSnapshot& t_snapshot)
+	{
+		XMMATRIX viewProjection = XMLoadFloat4x4(&t_snapshot.ProjectionMatrix) * XMLoadFloat4x4(&t_snapshot.ViewMatrix);
+		for (const RenderItem& item : t_snapshot.Items)
+		{
+			XMMATRIX worldViewProjection = viewProjection * XMLoadFloat4x4(&item.World);
+			XMMATRIX normalMatrix = XMMatrixTranspose(XMLoadFloat4x4(&item.WorldInverseTranspose));
+			checksum += XMVectorGetX(worldViewProjection.r[0] + normalMatrix.r[1]);
+		}
+	};
+
+	double serialTime = 0.0;
+	for (unsigned int latency = 0; latency <= FramePipeline::MaxLatency; ++latency)
+	{
+		FramePipeline pipeline;
+		pipeline.SetLatency(latency);
+
+		__int64 start, end;
+		start = ReadPerfCounter();
+		if (latency == 0)
+		{
+			for (int frame = 0; frame < frameCount; ++frame)
+			{
+				simulate(*pipeline.BeginWrite(), frame);
+				pipeline.EndWrite();
+				render(*pipeline.BeginRead());
+				pipeline.EndRead();
+			}
+		}
+		else
+		{
+			std::thread simulation([&]()
+			{
+				for (int frame = 0; frame < frameCount; ++frame)
+				{
+					simulate(*pipeline.BeginWrite(), frame);
+					pipeline.EndWrite();
+				}
+			});
+			for (int frame = 0; frame < frameCount; ++frame)
+			{
+				render(*pipeline.BeginRead());
+				pipeline.EndRead();
+			}
+			simulation.join();
+		}
+		end = ReadPerfCounter();
+
+		double time = (end - start) * perfCounterMilliseconds / frameCount;
+		if (latency == 0)
+		{
+			serialTime = time;
+		}
+
+		printf("\nFramePipeline latency %u   %.3fms/frame   %.2fx   Update waited %.1fms   Draw waited %.1fms   checksum %g",
+			latency,
+			time,
+			serialTime / time,
+			pipeline.GetWriteWaitSeconds() * 1000.0,
+			pipeline.GetReadWaitSeconds() * 1000.0,
+			checksum);
+	}
+}
+
+// --------------------------------------------------------
+// Paces a quarter of a second of empty frames at a few
+// frame rates and prints how close each frame came to its
+// target, along with the sleep overshoot it calibrated to.
+// --------------------------------------------------------
+void Benchmarks::BenchmarkFrameLimiter()
+{
+	const float frameRates[] = { 60.0f, 144.0f, 240.0f };
+
+	timeBeginPeriod(1);
+	for (float frameRate : frameRates)
+	{
+		FrameLimiter limiter;
+		limiter.SetTargetFrameRate(frameRate);
+
+		int frameTotal = (int)(frameRate / 4.0f);
+		for (int frame = 0; frame <= frameTotal; ++frame)
+		{
+			limiter.WaitForNextFrame();
+		}
+
+		printf("\nFrameLimiter %3.0f fps   %.3fms/frame   jitter %.3fms   worst %.3fms   %llu late   overshoot %.3fms",
+			frameRate,
+			limiter.GetAverageFrameMilliseconds(),
+			limiter.GetJitterMilliseconds(),
+			limiter.GetWorstDeviationMilliseconds(),
+			(unsigned long long)limiter.GetLateFrameCount(),
+			limiter.GetSleepOvershootMilliseconds());
+	}
+	timeEndPeriod(1);
+}
+
+// --------------------------------------------------------
+// Scatters 1M boxes around a camera and culls them one at a
+// time, with SIMD on one thread and with SIMD in parallel
+// chunks, checking all three agree and printing the timings.
+// --------------------------------------------------------
+void Benchmarks::BenchmarkFrustumCulling()
+{
+	const size_t boundsTotal = 1000000;
+	const int frameCount = 10;
+	const FrustumCuller::BoundsType types[] = { FrustumCuller::Spheres, FrustumCuller::Boxes };
+
+	FrustumCuller culler;
+	culler.Resize(boundsTotal);
+	srand(1);
+	for (size_t i = 0; i < boundsTotal; ++i)
+	{
+		XMFLOAT3 center(rand() % 4001 / 10.0f - 200.0f, rand() % 4001 / 10.0f - 200.0f, rand() % 4001 / 10.0f - 200.0f);
+		XMFLOAT3 extents(0.1f + rand() % 30 / 10.0f, 0.1f + rand() % 30 / 10.0f, 0.1f + rand() % 30 / 10.0f);
+		culler.SetBox(i, center, extents);
+	}
+
+	XMFLOAT4X4 view;
+	XMFLOAT4X4 projection;
+	XMStoreFloat4x4(&view, XMMatrixTranspose(XMMatrixLookToLH(XMVectorZero(), XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f))));
+	XMStoreFloat4x4(&projection, XMMatrixTranspose(XMMatrixPerspectiveFovLH(0.25f * XM_PI, aspectRatio, 0.1f, 100.0f)));
+	XMFLOAT4 planes[6];
+	FrustumCuller::ExtractPlanes(view, projection, planes);
+
+	for (FrustumCuller::BoundsType type : types)
+	{
+		std::vector<unsigned int> scalarVisible, simdVisible, parallelVisible;
+		__int64 start, scalar, simd, parallel;
+
+		start = ReadPerfCounter();
+		for (int frame = 0; frame < frameCount; ++frame)
+		{
+			culler.CullScalar(planes, type, scalarVisible);
+		}
+		scalar = ReadPerfCounter();
+		culler.SetParallel(false);
+		for (int frame = 0; frame < frameCount; ++frame)
+		{
+			culler.Cull(planes, type, simdVisible);
+		}
+		simd = ReadPerfCounter();
+		culler.SetParallel(true);
+		for (int frame = 0; frame < frameCount; ++frame)
+		{
+			culler.Cull(planes, type, parallelVisible);
+		}
+		parallel = ReadPerfCounter();
+
+		printf("\n%zu %s   %zu visible   %zu culled   scalar %.3fms   simd %.3fms   parallel %.3fms   %s",
+			boundsTotal,
+			type == FrustumCuller::Spheres ? "spheres" : "boxes",
+			culler.GetVisibleCount(),
+			culler.GetCulledCount(),
+			(scalar - start) * perfCounterMilliseconds / frameCount,
+			(simd - scalar) * perfCounterMilliseconds / frameCount,
+			(parallel - simd) * perfCounterMilliseconds / frameCount,
+			scalarVisible == simdVisible && scalarVisible == parallelVisible ? "match" : "MISMATCH");
+	}
+}
+
+// --------------------------------------------------------
+// Builds a DynamicAABBTree over 1M boxes, then times culling
+// it against flat SIMD culling of the same boxes, and moving
+// 1% of them by a little and by a lot.
+// --------------------------------------------------------
+void Benchmarks::BenchmarkBoundsTree()
+{
+	const size_t boundsTotal = 1000000;
+	const size_t movedTotal = boundsTotal / 100;
+	const int frameCount = 10;
+
+	std::vector<XMFLOAT3> centers(boundsTotal);
+	const XMFLOAT3 extents(1.0f, 1.0f, 1.0f);
+	srand(1);
+	for (size_t i = 0; i < boundsTotal; ++i)
+	{
+		centers[i] = XMFLOAT3(rand() % 4001 / 2.0f - 1000.0f, rand() % 4001 / 2.0f - 1000.0f, rand() % 4001 / 2.0f - 1000.0f);
+	}
+
+	DynamicAABBTree tree;
+	FrustumCuller culler;
+	std::vector<unsigned int> proxies(boundsTotal);
+	culler.Resize(boundsTotal);
+
+	__int64 start, built;
+	start = ReadPerfCounter();
+	for (size_t i = 0; i < boundsTotal; ++i)
+	{
+		XMFLOAT3 boxMin(centers[i].x - extents.x, centers[i].y - extents.y, centers[i].z - extents.z);
+		XMFLOAT3 boxMax(centers[i].x + extents.x, centers[i].y + extents.y, centers[i].z + extents.z);
+		proxies[i] = tree.CreateProxy(boxMin, boxMax, (unsigned int)i);
+		culler.SetBox(i, centers[i], extents);
+	}
+	built = ReadPerfCounter();
+	printf("\nBounds tree: %zu boxes built in %.1fms   height %d   area ratio %.1f",
+		boundsTotal, (built - start) * perfCounterMilliseconds, tree.GetHeight(), tree.GetAreaRatio());
+
+	XMFLOAT4X4 view;
+	XMFLOAT4X4 projection;
+	XMStoreFloat4x4(&view, XMMatrixTranspose(XMMatrixLookToLH(XMVectorZero(), XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f))));
+	XMStoreFloat4x4(&projection, XMMatrixTranspose(XMMatrixPerspectiveFovLH(0.25f * XM_PI, aspectRatio, 0.1f, 100.0f)));
+	XMFLOAT4 planes[6];
+	FrustumCuller::ExtractPlanes(view, projection, planes);
+
+	std::vector<unsigned int> treeVisible, flatVisible;
+	__int64 treeDone, flatDone;
+	start = ReadPerfCounter();
+	for (int frame = 0; frame < frameCount; ++frame)
+	{
+		treeVisible.clear();
+		tree.QueryFrustum(planes, treeVisible);
+	}
+	treeDone = ReadPerfCounter();
+	for (int frame = 0; frame < frameCount; ++frame)
+	{
+		culler.Cull(planes, FrustumCuller::Boxes, flatVisible);
+	}
+	flatDone = ReadPerfCounter();
+	printf("\nBounds tree: culling %.3fms (%zu visible)   flat %.3fms (%zu visible)",
+		(treeDone - start) * perfCounterMilliseconds / frameCount, treeVisible.size(),
+		(flatDone - treeDone) * perfCounterMilliseconds / frameCount, flatVisible.size());
+
+	// Small moves mostly stay inside the grown boxes or refit; big ones reinsert
+	const float distances[] = { 0.05f, 0.5f, 50.0f };
+	for (float distance : distances)
+	{
+		__int64 moved, optimized;
+		start = ReadPerfCounter();
+		for (size_t m = 0; m < movedTotal; ++m)
+		{
+			size_t i = m * 97 % boundsTotal;
+			centers[i].x += distance;
+			XMFLOAT3 boxMin(centers[i].x - extents.x, centers[i].y - extents.y, centers[i].z - extents.z);
+			XMFLOAT3 boxMax(centers[i].x + extents.x, centers[i].y + extents.y, centers[i].z + extents.z);
+			tree.MoveProxy(proxies[i], boxMin, boxMax);
+		}
+		moved = ReadPerfCounter();
+		tree.Optimize((unsigned int)movedTotal);
+		optimized = ReadPerfCounter();
+
+		printf("\nBounds tree: moving %zu by %.2f took %.3fms   optimize %.3fms   height %d   area ratio %.1f",
+			movedTotal, distance,
+			(moved - start) * perfCounterMilliseconds,
+			(optimized - moved) * perfCounterMilliseconds,
+			tree.GetHeight(), tree.GetAreaRatio());
+	}
+}
+
+// --------------------------------------------------------
+// Builds a SpatialHashGrid over 10k to 1M random points and
+// times batches of radius and nearest queries against brute
+// force scans of every point, checking both agree. Brute force
+// only runs the first few queries, so times are per query.
+// --------------------------------------------------------
+void Benchmarks::BenchmarkSpatialHash()
+{
+	const size_t pointTotals[] = { 10000, 100000, 1000000 };
+	const size_t queryTotal = 4096;
+	const size_t bruteTotal = 64;
+	const float radius = 4.0f;
+	const unsigned int nearestTotal = 8;
+
+	SpatialHashGrid grid;
+	for (size_t pointTotal : pointTotals)
+	{
+		// Keep the density the same, so a radius query finds about as many points at every size
+		float side = 2.0f * powf((float)pointTotal, 1.0f / 3.0f);
+		std::vector<XMFLOAT3> points(pointTotal);
+		srand(1);
+		for (size_t i = 0; i < pointTotal; ++i)
+		{
+			points[i] = XMFLOAT3(side * rand() / RAND_MAX, side * rand() / RAND_MAX, side * rand() / RAND_MAX);
+		}
+		std::vector<XMFLOAT3> centers(queryTotal);
+		for (size_t q = 0; q < queryTotal; ++q)
+		{
+			centers[q] = points[q * 7919 % pointTotal];
+		}
+
+		__int64 start, built, radiusDone, nearestDone;
+		std::vector<unsigned int> offsets, radiusResults, nearestResults;
+		start = ReadPerfCounter();
+		grid.Build(points.data(), pointTotal, radius);
+		built = ReadPerfCounter();
+		grid.QueryRadiusBatch(centers.data(), queryTotal, radius, offsets, radiusResults);
+		radiusDone = ReadPerfCounter();
+		grid.QueryNearestBatch(centers.data(), queryTotal, nearestTotal, nearestResults);
+		nearestDone = ReadPerfCounter();
+
+		// Brute force on one thread, as gameplay code would have scanned entities
+		__int64 bruteStart, bruteRadiusDone, bruteNearestDone;
+		size_t mismatches = 0;
+		std::vector<unsigned int> bruteResults;
+		std::vector<std::pair<float, unsigned int>> distances(pointTotal);
+		bruteStart = ReadPerfCounter();
+		for (size_t q = 0; q < bruteTotal; ++q)
+		{
+			bruteResults.clear();
+			for (size_t i = 0; i < pointTotal; ++i)
+			{
+				float dx = points[i].x - centers[q].x;
+				float dy = points[i].y - centers[q].y;
+				float dz = points[i].z - centers[q].z;
+				if (dx * dx + dy * dy + dz * dz <= radius * radius)
+				{
+					bruteResults.push_back((unsigned int)i);
+				}
+			}
+			std::vector<unsigned int> gridResults(radiusResults.begin() + offsets[q], radiusResults.begin() + offsets[q + 1]);
+			std::sort(gridResults.begin(), gridResults.end());
+			mismatches += gridResults != bruteResults;
+		}
+		bruteRadiusDone = ReadPerfCounter();
+		for (size_t q = 0; q < bruteTotal; ++q)
+		{
+			for (size_t i = 0; i < pointTotal; ++i)
+			{
+				float dx = points[i].x - centers[q].x;
+				float dy = points[i].y - centers[q].y;
+				float dz = points[i].z - centers[q].z;
+				distances[i] = std::make_pair(dx * dx + dy * dy + dz * dz, (unsigned int)i);
+			}
+			std::partial_sort(distances.begin(), distances.begin() + nearestTotal, distances.end());
+
+			// Compare distances rather than indices, as equally far points may come in either order
+			for (unsigned int n = 0; n < nearestTotal; ++n)
+			{
+				const XMFLOAT3& found = points[nearestResults[q * nearestTotal + n]];
+				float dx = found.x - centers[q].x;
+				float dy = found.y - centers[q].y;
+				float dz = found.z - centers[q].z;
+				mismatches += dx * dx + dy * dy + dz * dz != distances[n].first;
+			}
+		}
+		bruteNearestDone = ReadPerfCounter();
+
+		printf("\nSpatial hash: %zu points built in %.3fms   per query: radius %.4fms   brute %.4fms   nearest %.4fms   brute %.4fms   (%.1f found per radius query)   %s",
+			pointTotal,
+			(built - start) * perfCounterMilliseconds,
+			(radiusDone - built) * perfCounterMilliseconds / queryTotal,
+			(bruteRadiusDone - bruteStart) * perfCounterMilliseconds / bruteTotal,
+			(nearestDone - radiusDone) * perfCounterMilliseconds / queryTotal,
+			(bruteNearestDone - bruteRadiusDone) * perfCounterMilliseconds / bruteTotal,
+			(float)radiusResults.size() / queryTotal,
+			mismatches == 0 ? "match" : "MISMATCH");
+	}
+}
+
+// --------------------------------------------------------
+// Moves 100k boxes around for a number of frames and times
+// SweepAndPrune finding their overlaps, then does the same
+// for boxes stacked in a tall column. Each scene runs with
+// one sorted list along x and with picked axes and slabs.
+// --------------------------------------------------------
+void Benchmarks::BenchmarkSweepAndPrune()
+{
+	const int frameCount = 30;
+
+	struct Scene
+	{
+		const char* Name;
+		size_t BoxTotal;
+		XMFLOAT3 Size;
+		int Axis;
+		unsigned int MaxSlabCount;
+	};
+	const Scene scenes[] =
+	{
+		{ "spread out, one list", 100000, XMFLOAT3(2000.0f, 20.0f, 2000.0f), 0, 1 },
+		{ "spread out, slabs", 100000, XMFLOAT3(2000.0f, 20.0f, 2000.0f), -1, 256 },
+		{ "column, one list", 20000, XMFLOAT3(40.0f, 2000.0f, 40.0f), 0, 1 },
+		{ "column, slabs", 20000, XMFLOAT3(40.0f, 2000.0f, 40.0f), -1, 256 },
+	};
+
+	for (const Scene& scene : scenes)
+	{
+		std::vector<XMFLOAT3> centers(scene.BoxTotal);
+		std::vector<XMFLOAT3> velocities(scene.BoxTotal);
+		std::vector<unsigned int> proxies(scene.BoxTotal);
+		SweepAndPrune sweepAndPrune;
+		sweepAndPrune.SetAxis(scene.Axis);
+		sweepAndPrune.SetMaxSlabCount(scene.MaxSlabCount);
+
+		srand(1);
+		for (size_t i = 0; i < scene.BoxTotal; ++i)
+		{
+			centers[i] = XMFLOAT3(scene.Size.x * rand() / RAND_MAX, scene.Size.y * rand() / RAND_MAX, scene.Size.z * rand() / RAND_MAX);
+			velocities[i] = XMFLOAT3((rand() % 101 - 50) / 500.0f, (rand() % 101 - 50) / 500.0f, (rand() % 101 - 50) / 500.0f);
+			float extent = 0.5f + (i % 4) * 0.25f;
+			XMFLOAT3 boxMin(centers[i].x - extent, centers[i].y - extent, centers[i].z - extent);
+			XMFLOAT3 boxMax(centers[i].x + extent, centers[i].y + extent, centers[i].z + extent);
+			proxies[i] = sweepAndPrune.CreateProxy(boxMin, boxMax, (unsigned int)i);
+		}
+
+		// The first Update sorts everything from scratch
+		__int64 start, firstDone;
+		start = ReadPerfCounter();
+		sweepAndPrune.Update();
+		firstDone = ReadPerfCounter();
+
+		__int64 updateTicks = 0;
+		size_t pairTotal = 0;
+		size_t changeTotal = 0;
+		size_t sortWork = 0;
+		for (int frame = 0; frame < frameCount; ++frame)
+		{
+			for (size_t i = 0; i < scene.BoxTotal; ++i)
+			{
+				// Bounce off the sides of the scene
+				float* center = &centers[i].x;
+				float* velocity = &velocities[i].x;
+				const float* size = &scene.Size.x;
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					center[axis] += velocity[axis];
+					if (center[axis] < 0.0f || center[axis] > size[axis])
+					{
+						velocity[axis] = -velocity[axis];
+					}
+				}
+
+				float extent = 0.5f + (i % 4) * 0.25f;
+				XMFLOAT3 boxMin(centers[i].x - extent, centers[i].y - extent, centers[i].z - extent);
+				XMFLOAT3 boxMax(centers[i].x + extent, centers[i].y + extent, centers[i].z + extent);
+				sweepAndPrune.MoveProxy(proxies[i], boxMin, boxMax);
+			}
+
+			__int64 updateStart, updateEnd;
+			updateStart = ReadPerfCounter();
+			sweepAndPrune.Update();
+			updateEnd = ReadPerfCounter();
+			updateTicks += updateEnd - updateStart;
+
+			pairTotal += sweepAndPrune.GetPairCount();
+			changeTotal += sweepAndPrune.GetBeginPairs().size() + sweepAndPrune.GetEndPairs().size();
+			sortWork += sweepAndPrune.GetSortWork();
+		}
+
+		double updateMilliseconds = updateTicks * perfCounterMilliseconds / frameCount;
+		printf("\nSweep and prune: %zu boxes %s   first update %.3fms   update %.3fms   axis %d   %u slabs   %zu pairs (%.0f per ms)   %zu began/ended   %zu sort moves per frame",
+			scene.BoxTotal, scene.Name,
+			(firstDone - start) * perfCounterMilliseconds,
+			updateMilliseconds,
+			sweepAndPrune.GetSweepAxis(),
+			sweepAndPrune.GetSlabCount(),
+			pairTotal / frameCount,
+			pairTotal / frameCount / updateMilliseconds,
+			changeTotal / frameCount,
+			sortWork / frameCount);
+	}
+}
+
+// --------------------------------------------------------
+// Fills a RenderQueue with 1M draws spread over a few
+// shaders, many materials and meshes, and times its radix
+// sort against std::stable_sort of the same keys. Also
+// counts state changes in added and in sorted order.
+// --------------------------------------------------------
+void Benchmarks::BenchmarkRenderQueue()
+{
+	const size_t itemTotal = 1000000;
+	const int sortCount = 5;
+
+	std::vector<uint64_t> keys(itemTotal);
+	srand(1);
+	for (size_t i = 0; i < itemTotal; ++i)
+	{
+		RenderQueue::Pass pass = rand() % 10 == 0 ? RenderQueue::Transparent : RenderQueue::Opaque;
+		keys[i] = RenderQueue::MakeKey(pass, rand() % 8, rand() % 200, rand() % 50, (float)rand() / RAND_MAX);
+	}
+
+	// Sorting and submitting only ever sees what it is given, so state changes can be counted from the keys
+	auto countStateChanges = [](const std::vector<RenderQueue::Item>& t_items)
+	{
+		size_t changes = 0;
+		for (size_t i = 1; i < t_items.size(); ++i)
+		{
+			uint64_t previous = t_items[i - 1].Key;
+			uint64_t current = t_items[i].Key;
+			changes += RenderQueue::GetShader(previous) != RenderQueue::GetShader(current);
+			changes += RenderQueue::GetMaterial(previous) != RenderQueue::GetMaterial(current);
+			changes += RenderQueue::GetMesh(previous) != RenderQueue::GetMesh(current);
+		}
+		return changes;
+	};
+
+	RenderQueue queue;
+	queue.Reserve(itemTotal);
+	__int64 radixTicks = 0;
+	for (int sort = 0; sort < sortCount; ++sort)
+	{
+		queue.Clear();
+		for (size_t i = 0; i < itemTotal; ++i)
+		{
+			queue.Add(keys[i], (unsigned int)i);
+		}
+		__int64 start, end;
+		start = ReadPerfCounter();
+		queue.Sort();
+		end = ReadPerfCounter();
+		radixTicks += end - start;
+	}
+
+	std::vector<RenderQueue::Item> unsorted(itemTotal);
+	std::vector<RenderQueue::Item> compared;
+	for (size_t i = 0; i < itemTotal; ++i)
+	{
+		unsorted[i].Key = keys[i];
+		unsorted[i].Index = (unsigned int)i;
+	}
+	__int64 stdTicks = 0;
+	for (int sort = 0; sort < sortCount; ++sort)
+	{
+		compared = unsorted;
+		__int64 start, end;
+		start = ReadPerfCounter();
+		std::stable_sort(compared.begin(), compared.end(),
+			[](const RenderQueue::Item& t_a, const RenderQueue::Item& t_b) { return t_a.Key < t_b.Key; });
+		end = ReadPerfCounter();
+		stdTicks += end - start;
+	}
+
+	bool match = true;
+	for (size_t i = 0; i < itemTotal && match; ++i)
+	{
+		match = compared[i].Index == queue.GetItems()[i].Index;
+	}
+
+	double radixMilliseconds = radixTicks * perfCounterMilliseconds / sortCount;
+	double stdMilliseconds = stdTicks * perfCounterMilliseconds / sortCount;
+	printf("\nRender queue: %zu items   radix %.3fms (%.1fM items/s, %u passes)   std::stable_sort %.3fms   %s   state changes %zu unsorted, %zu sorted",
+		itemTotal,
+		radixMilliseconds, itemTotal / radixMilliseconds / 1000.0, queue.GetSortPasses(),
+		stdMilliseconds,
+		match ? "match" : "MISMATCH",
+		countStateChanges(unsorted), countStateChanges(queue.GetItems()));
+}
+
+// --------------------------------------------------------
+// Replays the bindings Draw made for every item before it
+// went through the render queue (shaders, constant buffers,
+// textures, sampler, mesh buffers) for 10k items over a few
+// shaders, materials and meshes. Each call goes once straight
+// to a RecordingTarget and once through a StateCache to
+// another, and what ends up bound is compared at every draw.
+// The objects are made up addresses that are never used.
+// --------------------------------------------------------
+void Benchmarks::BenchmarkStateCache()
+{
+	const size_t itemTotal = 10000;
+	const unsigned int shaderTotal = 4;
+	const unsigned int materialTotal = 64;
+	const unsigned int meshTotal = 32;
+
+	struct FakeMaterial
+	{
+		unsigned int Shader;
+		ID3D11ShaderResourceView* Diffuse;
+		ID3D11ShaderResourceView* Normal;
+		ID3D11SamplerState* Sampler;
+	};
+	struct FakeItem
+	{
+		unsigned int Material;
+		unsigned int Mesh;
+	};
+
+	uintptr_t nextAddress = 0x10000;
+	auto makeObject = [&nextAddress]() { nextAddress += 0x100; return nextAddress; };
+
+	ID3D11InputLayout* layout = (ID3D11InputLayout*)makeObject();
+	ID3D11DeviceChild* vertexShaders[shaderTotal];
+	ID3D11DeviceChild* pixelShaders[shaderTotal];
+	ID3D11Buffer* vertexConstants[shaderTotal];
+	ID3D11Buffer* pixelConstants[shaderTotal];
+	for (unsigned int i = 0; i < shaderTotal; ++i)
+	{
+		vertexShaders[i] = (ID3D11DeviceChild*)makeObject();
+		pixelShaders[i] = (ID3D11DeviceChild*)makeObject();
+		vertexConstants[i] = (ID3D11Buffer*)makeObject();
+		pixelConstants[i] = (ID3D11Buffer*)makeObject();
+	}
+
+	// Materials share a few textures and one sampler, like the pebbles ones in the scene
+	ID3D11ShaderResourceView* textures[16];
+	for (unsigned int i = 0; i < 16; ++i)
+	{
+		textures[i] = (ID3D11ShaderResourceView*)makeObject();
+	}
+	ID3D11SamplerState* sharedSampler = (ID3D11SamplerState*)makeObject();
+	FakeMaterial materials[materialTotal];
+	srand(1);
+	for (unsigned int i = 0; i < materialTotal; ++i)
+	{
+		materials[i].Shader = i % shaderTotal;
+		materials[i].Diffuse = textures[rand() % 12];
+		materials[i].Normal = textures[12 + rand() % 4];
+		materials[i].Sampler = sharedSampler;
+	}
+
+	ID3D11Buffer* vertexBuffers[meshTotal];
+	ID3D11Buffer* indexBuffers[meshTotal];
+	for (unsigned int i = 0; i < meshTotal; ++i)
+	{
+		vertexBuffers[i] = (ID3D11Buffer*)makeObject();
+		indexBuffers[i] = (ID3D11Buffer*)makeObject();
+	}
+
+	std::vector<FakeItem> items(itemTotal);
+	for (FakeItem& item : items)
+	{
+		item.Material = rand() % materialTotal;
+		item.Mesh = rand() % meshTotal;
+	}
+
+	// Items as they come, and grouped the way the render queue would have them
+	std::vector<FakeItem> sortedItems = items;
+	std::sort(sortedItems.begin(), sortedItems.end(), [&materials](const FakeItem& t_a, const FakeItem& t_b)
+	{
+		if (materials[t_a.Material].Shader != materials[t_b.Material].Shader)
+		{
+			return materials[t_a.Material].Shader < materials[t_b.Material].Shader;
+		}
+		return t_a.Material != t_b.Material ? t_a.Material < t_b.Material : t_a.Mesh < t_b.Mesh;
+	});
+
+	const std::vector<FakeItem>* orders[2] = { &items, &sortedItems };
+	const char* orderNames[2] = { "unsorted", "sorted" };
+	for (int order = 0; order < 2; ++order)
+	{
+		StateCache::RecordingTarget direct;
+		StateCache::RecordingTarget cached;
+		StateCache cache(&cached);
+		UINT stride = sizeof(Vertex);
+		UINT offset = 0;
+		size_t mismatches = 0;
+		__int64 cacheTicks = 0;
+		for (const FakeItem& item : *orders[order])
+		{
+			const FakeMaterial& material = materials[item.Material];
+			ID3D11Buffer* vertexBuffer = vertexBuffers[item.Mesh];
+
+			direct.SetInputLayout(layout);
+			direct.SetShader(StateCache::Vertex, vertexShaders[material.Shader]);
+			direct.SetConstantBuffers(StateCache::Vertex, 0, 1, &vertexConstants[material.Shader], nullptr, nullptr);
+			direct.SetShader(StateCache::Pixel, pixelShaders[material.Shader]);
+			direct.SetConstantBuffers(StateCache::Pixel, 0, 1, &pixelConstants[material.Shader], nullptr, nullptr);
+			direct.SetShaderResources(StateCache::Pixel, 0, 1, &material.Diffuse);
+			direct.SetShaderResources(StateCache::Pixel, 1, 1, &material.Normal);
+			direct.SetSamplers(StateCache::Pixel, 0, 1, &material.Sampler);
+			direct.SetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
+			direct.SetIndexBuffer(indexBuffers[item.Mesh], DXGI_FORMAT_R32_UINT, 0);
+
+			__int64 start, end;
+			start = ReadPerfCounter();
+			cache.SetInputLayout(layout);
+			cache.SetShader(StateCache::Vertex, vertexShaders[material.Shader]);
+			cache.SetConstantBuffer(StateCache::Vertex, 0, vertexConstants[material.Shader]);
+			cache.SetShader(StateCache::Pixel, pixelShaders[material.Shader]);
+			cache.SetConstantBuffer(StateCache::Pixel, 0, pixelConstants[material.Shader]);
+			cache.SetShaderResource(StateCache::Pixel, 0, material.Diffuse);
+			cache.SetShaderResource(StateCache::Pixel, 1, material.Normal);
+			cache.SetSampler(StateCache::Pixel, 0, material.Sampler);
+			cache.SetVertexBuffer(0, vertexBuffer, stride, offset);
+			cache.SetIndexBuffer(indexBuffers[item.Mesh], DXGI_FORMAT_R32_UINT, 0);
+			cache.Apply();
+			end = ReadPerfCounter();
+			cacheTicks += end - start;
+
+			// Both have to be drawing with the same state
+			if (memcmp(&direct.GetBindings(), &cached.GetBindings(), sizeof(StateCache::Bindings)) != 0)
+			{
+				++mismatches;
+			}
+		}
+
+		printf("\nState cache (%s): %zu items   %zu calls straight, %zu through the cache (%zu slots)   %.1fns per item   %zu mismatches",
+			orderNames[order], itemTotal,
+			direct.GetCallCount(), cached.GetCallCount(), cached.GetSlotCount(),
+			cacheTicks * perfCounterMilliseconds * 1000000.0 / itemTotal,
+			mismatches);
+	}
+}
+
+// --------------------------------------------------------
+// Batches a made up snapshot of 10k items over a few meshes
+// and materials with an InstanceBatcher, and submits it
+// through a StateCache to a RecordingTarget one draw per
+// item and one per batch. Checks both draw every item once
+// and the packed instances are the items' matrices. The
+// meshes, materials and buffers are addresses never used.
+// --------------------------------------------------------
+void Benchmarks::BenchmarkInstancing()
+{
+	const size_t itemTotal = 10000;
+	const unsigned int meshTotal = 8;
+	const unsigned int materialTotal = 16;
+	const int buildCount = 20;
+
+	RenderSnapshot fakeFrame;
+	fakeFrame.Items.resize(itemTotal);
+	fakeFrame.Queue.Reserve(itemTotal);
+	srand(1);
+	for (size_t i = 0; i < itemTotal; ++i)
+	{
+		unsigned int mesh = rand() % meshTotal;
+		unsigned int material = rand() % materialTotal;
+		RenderItem& item = fakeFrame.Items[i];
+		item.Source = (const void*)(0x10000 + i * 0x100);
+		item.MeshData = (const Mesh*)(uintptr_t)(0x1000 + mesh * 0x100);
+		item.MaterialData = (const Material*)(uintptr_t)(0x8000 + material * 0x100);
+		XMStoreFloat4x4(&item.World, XMMatrixTranspose(XMMatrixTranslation((float)(i % 100), 0.0f, (float)(i / 100))));
+		XMStoreFloat4x4(&item.WorldInverseTranspose, XMMatrixTranspose(XMMatrixTranslation(-(float)(i % 100), 0.0f, -(float)(i / 100))));
+		fakeFrame.Queue.Add(RenderQueue::MakeKey(RenderQueue::Opaque, 0, material, mesh, (float)rand() / RAND_MAX), (unsigned int)i);
+	}
+	fakeFrame.Queue.Sort();
+
+	// Slots as an ObjectTable would hand them out, in a different order from the items
+	std::vector<unsigned int> itemSlots(itemTotal);
+	for (size_t i = 0; i < itemTotal; ++i)
+	{
+		itemSlots[i] = (unsigned int)(itemTotal - 1 - i);
+	}
+
+	InstanceBatcher batcher;
+	__int64 buildTicks = 0;
+	for (int build = 0; build < buildCount; ++build)
+	{
+		__int64 start, end;
+		start = ReadPerfCounter();
+		batcher.Build(fakeFrame, itemSlots);
+		end = ReadPerfCounter();
+		buildTicks += end - start;
+	}
+
+	// Every instance has to be the slot of the item it stands for
+	const std::vector<RenderQueue::Item>& queue = fakeFrame.Queue.GetItems();
+	const std::vector<InstanceData>& instances = batcher.GetInstances();
+	size_t mismatches = 0;
+	for (const InstanceBatcher::Batch& batch : batcher.GetBatches())
+	{
+		for (size_t q = batch.Begin; q < batch.End; ++q)
+		{
+			const RenderItem& item = fakeFrame.Items[queue[q].Index];
+			const InstanceData& instance = instances[batch.FirstInstance + (q - batch.Begin)];
+			const RenderItem& first = fakeFrame.Items[queue[batch.Begin].Index];
+			if (item.MeshData != first.MeshData || item.MaterialData != first.MaterialData ||
+				instance.ObjectIndex != itemSlots[queue[q].Index])
+			{
+				++mismatches;
+			}
+		}
+	}
+
+	ID3D11Buffer* fakeInstanceBuffer = (ID3D11Buffer*)(uintptr_t)0x100000;
+	StateCache::RecordingTarget perItem;
+	StateCache::RecordingTarget perBatch;
+	StateCache perItemCache(&perItem);
+	StateCache perBatchCache(&perBatch);
+	for (const InstanceBatcher::Batch& batch : batcher.GetBatches())
+	{
+		const RenderItem& first = fakeFrame.Items[queue[batch.Begin].Index];
+		ID3D11Buffer* vertexBuffer = (ID3D11Buffer*)first.MeshData;
+		perBatchCache.SetVertexBuffer(0, vertexBuffer, sizeof(Vertex), 0);
+		perBatchCache.SetVertexBuffer(1, fakeInstanceBuffer, sizeof(InstanceData), 0);
+		perBatchCache.DrawIndexedInstanced(36, (UINT)(batch.End - batch.Begin), 0, 0, batch.FirstInstance);
+
+		for (size_t q = batch.Begin; q < batch.End; ++q)
+		{
+			perItemCache.SetVertexBuffer(0, (ID3D11Buffer*)fakeFrame.Items[queue[q].Index].MeshData, sizeof(Vertex), 0);
+			perItemCache.DrawIndexed(36, 0, 0);
+		}
+	}
+
+	printf("\nInstancing: %zu items in %zu batches   build %.3fms   %zu draws per item, %zu per batch (%zu and %zu instances)   %zu mismatches",
+		itemTotal, batcher.GetBatches().size(),
+		buildTicks * perfCounterMilliseconds / buildCount,
+		perItem.GetDrawCount(), perBatch.GetDrawCount(),
+		perItem.GetInstanceCount(), perBatch.GetInstanceCount(),
+		mismatches);
+}
+
+// --------------------------------------------------------
+// Runs the bookkeeping of a ConstantBufferRing without a device:
+// each frame hands out a range for every draw's constants, and
+// the GPU is taken to finish frames two after they end. Every
+// block of the ring notes the frame it was last handed out for,
+// so a range given out while the GPU could still be reading it
+// shows up as an overlap. A ring too small for the frames in
+// flight has to refuse instead.
+// --------------------------------------------------------
+void Benchmarks::BenchmarkConstantRing()
+{
+	const size_t ringBytes = 4 * 1024 * 1024;
+	const size_t smallRingBytes = 256 * 1024;
+	const size_t drawTotal = 2000;
+	const int frameCount = 300;
+	const uint64_t gpuLatency = 2;
+
+	const size_t ringSizes[] = { ringBytes, smallRingBytes };
+	for (size_t ringSize : ringSizes)
+	{
+		RingAllocator ring(ringSize, ConstantBufferRing::Alignment);
+		std::vector<uint64_t> blockFrames(ringSize / ConstantBufferRing::Alignment, 0);
+		uint64_t retiredFrame = 0;
+		uint64_t frame = 1;
+		size_t allocations = 0;
+		size_t failures = 0;
+		size_t wraps = 0;
+		size_t overlaps = 0;
+		__int64 allocateTicks = 0;
+
+		srand(1);
+		for (int f = 0; f < frameCount; ++f)
+		{
+			for (size_t d = 0; d < drawTotal; ++d)
+			{
+				// Mostly per object matrices, with the odd bigger buffer
+				size_t size = (d % 50 == 0) ? 256 + rand() % 1024 : 128;
+
+				__int64 start, end;
+				start = ReadPerfCounter();
+				size_t offset = ring.Allocate(size);
+				end = ReadPerfCounter();
+				allocateTicks += end - start;
+
+				if (offset == RingAllocator::InvalidOffset)
+				{
+					++failures;
+					continue;
+				}
+				++allocations;
+				wraps += ring.DidWrap() ? 1 : 0;
+
+				size_t alignedSize = (size + ConstantBufferRing::Alignment - 1) & ~(size_t)(ConstantBufferRing::Alignment - 1);
+				if (offset % ConstantBufferRing::Alignment != 0 || offset + alignedSize > ringSize)
+				{
+					++overlaps;
+					continue;
+				}
+				for (size_t block = offset / ConstantBufferRing::Alignment; block < (offset + alignedSize) / ConstantBufferRing::Alignment; ++block)
+				{
+					if (blockFrames[block] > retiredFrame)
+					{
+						++overlaps;
+					}
+					blockFrames[block] = frame;
+				}
+			}
+
+			uint64_t ended = ring.EndFrame();
+			if (ended != frame)
+			{
+				++overlaps;
+			}
+			++frame;
+			if (ended > gpuLatency)
+			{
+				retiredFrame = ended - gpuLatency;
+				ring.Retire(retiredFrame);
+			}
+		}
+
+		printf("\nConstant ring: %zu KB   %zu allocations, %zu refused, %zu wraps   %.1fns each   %zu bytes over %zu frames in flight   %zu overlaps",
+			ringSize / 1024, allocations, failures, wraps,
+			allocateTicks * perfCounterMilliseconds * 1000000.0 / (double)(allocations + failures),
+			ring.GetUsedBytes(), ring.GetFramesInFlight(), overlaps);
+	}
+}
+
+// --------------------------------------------------------
+// Times what Draw does on the CPU to submit 10k made up items,
+// without a device, for two ways of getting each item's
+// matrices to the vertex shader:
+//  - In constants: both matrices copied into the per-object
+//    buffer, a new ring range bound, and a draw, per item
+//  - By object slot: ObjectTable keeps the matrices, only
+//    patching slots that changed, and each batch of items
+//    sharing a mesh and material is one draw of slot indices
+// A tenth of the items move each frame; the rest stay put.
+// --------------------------------------------------------
+void Benchmarks::BenchmarkObjectTable()
+{
+	const size_t itemTotal = 10000;
+	const unsigned int meshTotal = 8;
+	const unsigned int materialTotal = 16;
+	const size_t movingEvery = 10;
+	const int frameCount = 60;
+
+	// The table reads each item's Material for its index, so these have to be real
+	std::vector<Material*> fakeMaterials;
+	for (unsigned int m = 0; m < materialTotal; ++m)
+	{
+		fakeMaterials.push_back(new Material(nullptr, nullptr, nullptr, nullptr, nullptr));
+	}
+
+	RenderSnapshot fakeFrame;
+	fakeFrame.Items.resize(itemTotal);
+	fakeFrame.Queue.Reserve(itemTotal);
+	srand(1);
+	for (size_t i = 0; i < itemTotal; ++i)
+	{
+		unsigned int mesh = rand() % meshTotal;
+		unsigned int material = rand() % materialTotal;
+		RenderItem& item = fakeFrame.Items[i];
+		item.Source = (const void*)(0x10000 + i * 0x100);
+		item.MeshData = (const Mesh*)(uintptr_t)(0x1000 + mesh * 0x100);
+		item.MaterialData = fakeMaterials[material];
+		XMStoreFloat4x4(&item.World, XMMatrixTranspose(XMMatrixTranslation((float)(i % 100), 0.0f, (float)(i / 100))));
+		XMStoreFloat4x4(&item.WorldInverseTranspose, XMMatrixTranspose(XMMatrixTranslation(-(float)(i % 100), 0.0f, -(float)(i / 100))));
+		fakeFrame.Queue.Add(RenderQueue::MakeKey(RenderQueue::Opaque, 0, material, mesh, (float)rand() / RAND_MAX), (unsigned int)i);
+	}
+	fakeFrame.Queue.Sort();
+	const std::vector<RenderQueue::Item>& queue = fakeFrame.Queue.GetItems();
+
+	ID3D11Buffer* fakeRingBuffer = (ID3D11Buffer*)(uintptr_t)0x100000;
+	ID3D11Buffer* fakeInstanceBuffer = (ID3D11Buffer*)(uintptr_t)0x200000;
+	StateCache::RecordingTarget constantTarget;
+	StateCache::RecordingTarget slotTarget;
+	StateCache constantCache(&constantTarget);
+	StateCache slotCache(&slotTarget);
+
+	ObjectTable table;
+	InstanceBatcher batcher;
+	table.Update(fakeFrame, fakeFrame, false, 1.0f);		// Every object is new the first time
+	size_t firstBytes = table.GetObjects().size() * sizeof(ObjectData);
+	table.ClearChanges();
+
+	unsigned char perObject[2 * sizeof(XMFLOAT4X4)] = {};
+	size_t constantBytes = 0;
+	size_t slotBytes = 0;
+	__int64 constantTicks = 0;
+	__int64 slotTicks = 0;
+	size_t mismatches = 0;
+	for (int frame = 0; frame < frameCount; ++frame)
+	{
+		for (size_t i = 0; i < itemTotal; i += movingEvery)
+		{
+			fakeFrame.Items[i].World._24 += 0.01f;
+			fakeFrame.Items[i].WorldInverseTranspose._24 -= 0.01f;
+		}
+
+		__int64 start, end;
+		start = ReadPerfCounter();
+		UINT ringConstant = 0;
+		for (size_t q = 0; q < queue.size(); ++q)
+		{
+			// What SetMatrix4x4 and CopyBufferData do with the per-object buffer
+			const RenderItem& item = fakeFrame.Items[queue[q].Index];
+			if (memcmp(perObject, &item.World, sizeof(XMFLOAT4X4)) != 0 ||
+				memcmp(perObject + sizeof(XMFLOAT4X4), &item.WorldInverseTranspose, sizeof(XMFLOAT4X4)) != 0)
+			{
+				memcpy(perObject, &item.World, sizeof(XMFLOAT4X4));
+				memcpy(perObject + sizeof(XMFLOAT4X4), &item.WorldInverseTranspose, sizeof(XMFLOAT4X4));
+				constantBytes += sizeof(perObject);
+				constantCache.SetConstantBuffer(StateCache::Vertex, 1, fakeRingBuffer, ringConstant, 16);
+				ringConstant += 16;
+			}
+			constantCache.SetVertexBuffer(0, (ID3D11Buffer*)item.MeshData, sizeof(Vertex), 0);
+			constantCache.DrawIndexed(36, 0, 0);
+		}
+		end = ReadPerfCounter();
+		constantTicks += end - start;
+
+		start = ReadPerfCounter();
+		table.Update(fakeFrame, fakeFrame, false, 1.0f);
+		for (const ObjectTable::Range& range : table.GetChanges())
+		{
+			slotBytes += (range.End - range.Begin) * sizeof(ObjectData);
+		}
+		table.ClearChanges();
+		batcher.Build(fakeFrame, table.GetItemSlots());
+		slotBytes += batcher.GetInstances().size() * sizeof(InstanceData);
+		for (const InstanceBatcher::Batch& batch : batcher.GetBatches())
+		{
+			slotCache.SetVertexBuffer(0, (ID3D11Buffer*)fakeFrame.Items[queue[batch.Begin].Index].MeshData, sizeof(Vertex), 0);
+			slotCache.SetVertexBuffer(1, fakeInstanceBuffer, sizeof(InstanceData), 0);
+			slotCache.DrawIndexedInstanced(36, (UINT)(batch.End - batch.Begin), 0, 0, batch.FirstInstance);
+		}
+		end = ReadPerfCounter();
+		slotTicks += end - start;
+	}
+
+	// Every instance's slot has to hold the matrices of the item it stands for
+	const std::vector<ObjectData>& objects = table.GetObjects();
+	const std::vector<InstanceData>& instances = batcher.GetInstances();
+	for (size_t q = 0; q < queue.size(); ++q)
+	{
+		const RenderItem& item = fakeFrame.Items[queue[q].Index];
+		const ObjectData& object = objects[instances[q].ObjectIndex];
+		if (memcmp(&object.World, &item.World, sizeof(XMFLOAT4X4)) != 0 ||
+			memcmp(&object.WorldInverseTranspose, &item.WorldInverseTranspose, sizeof(XMFLOAT4X4)) != 0 ||
+			object.MaterialIndex != item.MaterialData->getSortId())
+		{
+			++mismatches;
+		}
+	}
+
+	printf("\nObject table: %zu items, a tenth moving   in constants %.3fms, %zu bytes, %zu draws a frame   by slot %.3fms, %zu bytes (%zu the first frame), %zu draws a frame   %zu mismatches",
+		itemTotal,
+		constantTicks * perfCounterMilliseconds / frameCount, constantBytes / frameCount, constantTarget.GetDrawCount() / frameCount,
+		slotTicks * perfCounterMilliseconds / frameCount, slotBytes / frameCount, firstBytes, slotTarget.GetDrawCount() / frameCount,
+		mismatches);
+
+	for (Material* fakeMaterial : fakeMaterials)
+	{
+		delete fakeMaterial;
+	}
+}
+
+// --------------------------------------------------------
+// Times setting the loaded shaders' variables by name against
+// by handle, in nanoseconds a call, alternating two values so
+// every call copies. Also times getting a handle from a name
+// hashed at compile time and from the name itself.
+// --------------------------------------------------------
+void Benchmarks::BenchmarkShaderHandles()
+{
+	const int callCount = 1000000;
+	if (!vertexShader->IsShaderValid() || !pixelShader->IsShaderValid())
+	{
+		printf("\nShader handles: shaders not loaded");
+		return;
+	}
+
+	XMFLOAT4X4 matrices[2];
+	XMStoreFloat4x4(&matrices[0], XMMatrixIdentity());
+	XMStoreFloat4x4(&matrices[1], XMMatrixTranspose(XMMatrixTranslation(1.0f, 2.0f, 3.0f)));
+	const XMFLOAT4 tints[2] = { XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT4(0.5f, 0.5f, 0.5f, 1.0f) };
+
+	constexpr unsigned int worldName = SimpleHashName("world");
+	constexpr unsigned int colorTintName = SimpleHashName("ColorTint");
+	SimpleVariableHandle worldHandle = vertexShader->GetVariableHandle(worldName);
+	SimpleVariableHandle colorTintHandle = pixelShader->GetVariableHandle(colorTintName);
+
+	__int64 start, end;
+	start = ReadPerfCounter();
+	for (int i = 0; i < callCount; ++i)
+	{
+		vertexShader->SetMatrix4x4("world", matrices[i & 1]);
+	}
+	end = ReadPerfCounter();
+	__int64 matrixNameTicks = end - start;
+
+	// Handles write the other value last, so a set that went nowhere shows up below
+	start = ReadPerfCounter();
+	for (int i = 0; i < callCount; ++i)
+	{
+		vertexShader->SetMatrix4x4(worldHandle, matrices[(i + 1) & 1]);
+	}
+	end = ReadPerfCounter();
+	__int64 matrixHandleTicks = end - start;
+
+	start = ReadPerfCounter();
+	for (int i = 0; i < callCount; ++i)
+	{
+		pixelShader->SetFloat4("ColorTint", tints[i & 1]);
+	}
+	end = ReadPerfCounter();
+	__int64 tintNameTicks = end - start;
+
+	start = ReadPerfCounter();
+	for (int i = 0; i < callCount; ++i)
+	{
+		pixelShader->SetFloat4(colorTintHandle, tints[(i + 1) & 1]);
+	}
+	end = ReadPerfCounter();
+	__int64 tintHandleTicks = end - start;
+
+	int found = 0;
+	start = ReadPerfCounter();
+	for (int i = 0; i < callCount; ++i)
+	{
+		found += vertexShader->GetVariableHandle(worldName).IsValid();
+	}
+	end = ReadPerfCounter();
+	__int64 hashLookupTicks = end - start;
+
+	start = ReadPerfCounter();
+	for (int i = 0; i < callCount; ++i)
+	{
+		found += vertexShader->GetVariableHandle("world").IsValid();
+	}
+	end = ReadPerfCounter();
+	__int64 nameLookupTicks = end - start;
+
+	// Both variables have to hold the value their handle loop wrote last
+	size_t mismatches = (found == 2 * callCount) ? 0 : 1;
+	const SimpleShaderVariable* world = vertexShader->GetVariableInfo("world");
+	const SimpleShaderVariable* colorTint = pixelShader->GetVariableInfo("ColorTint");
+	if (world == nullptr || memcmp(vertexShader->GetBufferInfo(world->ConstantBufferIndex)->LocalDataBuffer + world->ByteOffset, &matrices[callCount & 1], sizeof(XMFLOAT4X4)) != 0)
+	{
+		++mismatches;
+	}
+	if (colorTint == nullptr || memcmp(pixelShader->GetBufferInfo(colorTint->ConstantBufferIndex)->LocalDataBuffer + colorTint->ByteOffset, &tints[callCount & 1], sizeof(XMFLOAT4)) != 0)
+	{
+		++mismatches;
+	}
+
+	printf("\nShader handles: %d calls each   world by name %.1fns, by handle %.1fns   ColorTint by name %.1fns, by handle %.1fns   handle from hash %.1fns, from name %.1fns   %zu mismatches",
+		callCount,
+		matrixNameTicks * perfCounterNanoseconds / callCount, matrixHandleTicks * perfCounterNanoseconds / callCount,
+		tintNameTicks * perfCounterNanoseconds / callCount, tintHandleTicks * perfCounterNanoseconds / callCount,
+		hashLookupTicks * perfCounterNanoseconds / callCount, nameLookupTicks * perfCounterNanoseconds / callCount,
+		mismatches);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+// Forward Declaration
+class Material;
+class SimpleVertexShader;
+class SimplePixelShader;
+struct ID3D11Device;
+
+// Timing and stress runs of the engine's systems, printed to the debug console.
+//
+// The game never starts these by itself: running with -benchmark on the
+// command line runs them all once, after Init and before the first frame.
+// What they need from the scene (the device and the material with its
+// shaders) is borrowed from the Game.
+class Benchmarks
+{
+public:
+	// Constructor for Benchmarks. t_aspect_ratio is the window's, for the cameras the culling benchmarks use.
+	Benchmarks(ID3D11Device* t_device, Material* t_material, float t_aspect_ratio);
+
+	// Run every benchmark in turn.
+	void RunAll();
+
+private:
+	// Times procedural primitive generation against loading the OBJ equivalents.
+	void BenchmarkPrimitiveGeneration();
+
+	// Times batch (SIMD) world matrix computation against the per-object path.
+	void BenchmarkTransforms();
+
+	// Stress tests the JobSystem (nesting, dependencies) and times how it scales with thread count.
+	void BenchmarkJobSystem();
+
+	// Times a synthetic Update/Draw workload run back to back and through a FramePipeline.
+	void BenchmarkFramePipeline();
+
+	// Checks how evenly a FrameLimiter paces frames with nothing else running.
+	void BenchmarkFrameLimiter();
+
+	// Times frustum culling of 1M bounds, one at a time, with SIMD and with SIMD in parallel.
+	void BenchmarkFrustumCulling();
+
+	// Times building, moving and frustum culling 1M bounds in a DynamicAABBTree.
+	void BenchmarkBoundsTree();
+
+	// Times SpatialHashGrid builds and radius/nearest queries against brute force at 10k-1M points.
+	void BenchmarkSpatialHash();
+
+	// Times SweepAndPrune updates over 100k moving boxes, and in a scene stacked along one axis.
+	void BenchmarkSweepAndPrune();
+
+	// Times RenderQueue's radix sort of 1M draw keys against std::sort.
+	void BenchmarkRenderQueue();
+
+	// Replays Draw's bindings for 10k items straight to a recording target and through a StateCache, and compares the calls.
+	void BenchmarkStateCache();
+
+	// Batches 10k made up items by mesh and material, and counts the draws against one per item without a device.
+	void BenchmarkInstancing();
+
+	// Runs a constant ring's allocations for frames the GPU finishes two late, checking no range in flight is handed out again.
+	void BenchmarkConstantRing();
+
+	// Times submitting 10k draws with matrices in constants against by object slot, moving a tenth of the objects each frame.
+	void BenchmarkObjectTable();
+
+	// Times setting shader variables by name against by handle, in nanoseconds a call, and getting handles by hash and by name.
+	void BenchmarkShaderHandles();
+
+	ID3D11Device* device = nullptr;
+	SimpleVertexShader* vertexShader = nullptr;
+	SimplePixelShader* pixelShader = nullptr;
+	float aspectRatio = 1.0f;
+
+	// Performance counter ticks to milliseconds and to nanoseconds.
+	double perfCounterMilliseconds = 0.0;
+	double perfCounterNanoseconds = 0.0;
+};
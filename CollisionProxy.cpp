@@ -0,0 +1,664 @@
+#include "CollisionProxy.h"
+#include "Mesh.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <unordered_map>
+
+using namespace DirectX;
+
+namespace
+{
+	// A triangle of the hull under construction, with the points still outside of it.
+	struct HullFace
+	{
+		unsigned int V[3];
+		XMFLOAT3 Normal;
+		float Offset;						// Plane is dot(Normal, p) = Offset
+		std::vector<unsigned int> Outside;
+		unsigned int Farthest;
+		float FarthestDistance;
+		bool Alive;
+	};
+
+	float PlaneDistance(const HullFace& t_face, const XMFLOAT3& t_point)
+	{
+		return t_face.Normal.x * t_point.x + t_face.Normal.y * t_point.y + t_face.Normal.z * t_point.z - t_face.Offset;
+	}
+
+	HullFace MakeFace(const std::vector<XMFLOAT3>& t_points, unsigned int t_a, unsigned int t_b, unsigned int t_c)
+	{
+		HullFace face;
+		face.V[0] = t_a;
+		face.V[1] = t_b;
+		face.V[2] = t_c;
+
+		// Clockwise from outside in our left-handed space means cross(b - a, c - a) points out
+		XMVECTOR a = XMLoadFloat3(&t_points[t_a]);
+		XMVECTOR normal = XMVector3Normalize(XMVector3Cross(XMLoadFloat3(&t_points[t_b]) - a, XMLoadFloat3(&t_points[t_c]) - a));
+		XMStoreFloat3(&face.Normal, normal);
+		face.Offset = XMVectorGetX(XMVector3Dot(normal, a));
+		face.Farthest = 0;
+		face.FarthestDistance = 0.0f;
+		face.Alive = true;
+		return face;
+	}
+
+	unsigned long long EdgeKey(unsigned int t_from, unsigned int t_to)
+	{
+		return (static_cast<unsigned long long>(t_from) << 32) | t_to;
+	}
+
+	// Put a point in the outside set of the first face it is in front of.
+	// Points that are in front of no face are inside the hull and get dropped.
+	void AssignToFaces(const std::vector<XMFLOAT3>& t_points, unsigned int t_point, std::vector<HullFace>& t_faces, size_t t_first_face, float t_epsilon)
+	{
+		for (size_t f = t_first_face; f < t_faces.size(); ++f)
+		{
+			HullFace& face = t_faces[f];
+			if (!face.Alive)
+			{
+				continue;
+			}
+
+			float distance = PlaneDistance(face, t_points[t_point]);
+			if (distance > t_epsilon)
+			{
+				face.Outside.push_back(t_point);
+				if (distance > face.FarthestDistance)
+				{
+					face.FarthestDistance = distance;
+					face.Farthest = t_point;
+				}
+				return;
+			}
+		}
+	}
+
+	// Hull of points that all lie in one plane: a 2D hull (monotone chain) in the
+	// plane's basis, emitted as a polygon with triangles facing both ways.
+	void BuildFlatHull(const std::vector<XMFLOAT3>& t_points, XMVECTOR t_origin, XMVECTOR t_normal, XMVECTOR t_axis, ConvexHull& t_hull)
+	{
+		XMVECTOR u = XMVector3Normalize(t_axis);
+		XMVECTOR v = XMVector3Normalize(XMVector3Cross(t_normal, u));
+
+		struct PlanarPoint
+		{
+			float X;
+			float Y;
+			unsigned int Index;
+		};
+
+		std::vector<PlanarPoint> planar(t_points.size());
+		for (unsigned int i = 0; i < t_points.size(); ++i)
+		{
+			XMVECTOR offset = XMLoadFloat3(&t_points[i]) - t_origin;
+			planar[i].X = XMVectorGetX(XMVector3Dot(offset, u));
+			planar[i].Y = XMVectorGetX(XMVector3Dot(offset, v));
+			planar[i].Index = i;
+		}
+
+		std::sort(planar.begin(), planar.end(), [](const PlanarPoint& t_lhs, const PlanarPoint& t_rhs)
+		{
+			return t_lhs.X < t_rhs.X || (t_lhs.X == t_rhs.X && t_lhs.Y < t_rhs.Y);
+		});
+
+		auto cross = [](const PlanarPoint& t_o, const PlanarPoint& t_a, const PlanarPoint& t_b)
+		{
+			return (t_a.X - t_o.X) * (t_b.Y - t_o.Y) - (t_a.Y - t_o.Y) * (t_b.X - t_o.X);
+		};
+
+		std::vector<PlanarPoint> chain(planar.size() * 2);
+		size_t count = 0;
+		for (size_t i = 0; i < planar.size(); ++i)
+		{
+			while (count >= 2 && cross(chain[count - 2], chain[count - 1], planar[i]) <= 0.0f)
+			{
+				--count;
+			}
+			chain[count++] = planar[i];
+		}
+		for (size_t i = planar.size() - 1, lower = count + 1; i-- > 0;)
+		{
+			while (count >= lower && cross(chain[count - 2], chain[count - 1], planar[i]) <= 0.0f)
+			{
+				--count;
+			}
+			chain[count++] = planar[i];
+		}
+
+		// The last point repeats the first one
+		size_t polygonSize = count > 1 ? count - 1 : count;
+		for (size_t i = 0; i < polygonSize; ++i)
+		{
+			t_hull.Vertices.push_back(t_points[chain[i].Index]);
+		}
+
+		for (unsigned int i = 1; i + 1 < polygonSize; ++i)
+		{
+			t_hull.Indices.push_back(0);
+			t_hull.Indices.push_back(i);
+			t_hull.Indices.push_back(i + 1);
+
+			t_hull.Indices.push_back(0);
+			t_hull.Indices.push_back(i + 1);
+			t_hull.Indices.push_back(i);
+		}
+	}
+
+	// Cyclic Jacobi rotations on a symmetric 3x3 matrix. On return t_matrix is
+	// (nearly) diagonal and the columns of t_vectors are its eigenvectors.
+	void JacobiEigenDecomposition(float t_matrix[3][3], float t_vectors[3][3])
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			for (int j = 0; j < 3; ++j)
+			{
+				t_vectors[i][j] = (i == j) ? 1.0f : 0.0f;
+			}
+		}
+
+		for (int sweep = 0; sweep < 32; ++sweep)
+		{
+			float offDiagonal = fabsf(t_matrix[0][1]) + fabsf(t_matrix[0][2]) + fabsf(t_matrix[1][2]);
+			if (offDiagonal < 1e-12f)
+			{
+				return;
+			}
+
+			for (int p = 0; p < 2; ++p)
+			{
+				for (int q = p + 1; q < 3; ++q)
+				{
+					if (fabsf(t_matrix[p][q]) < 1e-20f)
+					{
+						continue;
+					}
+
+					float theta = (t_matrix[q][q] - t_matrix[p][p]) / (2.0f * t_matrix[p][q]);
+					float t = (theta >= 0.0f ? 1.0f : -1.0f) / (fabsf(theta) + sqrtf(theta * theta + 1.0f));
+					float c = 1.0f / sqrtf(t * t + 1.0f);
+					float s = t * c;
+
+					for (int k = 0; k < 3; ++k)
+					{
+						float kp = t_matrix[k][p];
+						float kq = t_matrix[k][q];
+						t_matrix[k][p] = c * kp - s * kq;
+						t_matrix[k][q] = s * kp + c * kq;
+					}
+					for (int k = 0; k < 3; ++k)
+					{
+						float pk = t_matrix[p][k];
+						float qk = t_matrix[q][k];
+						t_matrix[p][k] = c * pk - s * qk;
+						t_matrix[q][k] = s * pk + c * qk;
+					}
+					for (int k = 0; k < 3; ++k)
+					{
+						float kp = t_vectors[k][p];
+						float kq = t_vectors[k][q];
+						t_vectors[k][p] = c * kp - s * kq;
+						t_vectors[k][q] = s * kp + c * kq;
+					}
+				}
+			}
+		}
+	}
+
+	const XMFLOAT3 DopAxisDirections[3] =
+	{
+		XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 1.0f)
+	};
+
+	const XMFLOAT3 DopCornerDirections[4] =
+	{
+		XMFLOAT3(1.0f, 1.0f, 1.0f), XMFLOAT3(1.0f, 1.0f, -1.0f), XMFLOAT3(1.0f, -1.0f, 1.0f), XMFLOAT3(1.0f, -1.0f, -1.0f)
+	};
+
+	const XMFLOAT3 DopEdgeDirections[6] =
+	{
+		XMFLOAT3(1.0f, 1.0f, 0.0f), XMFLOAT3(1.0f, -1.0f, 0.0f), XMFLOAT3(1.0f, 0.0f, 1.0f),
+		XMFLOAT3(1.0f, 0.0f, -1.0f), XMFLOAT3(0.0f, 1.0f, 1.0f), XMFLOAT3(0.0f, 1.0f, -1.0f)
+	};
+}
+
+void CollisionProxyBuilder::BuildConvexHull(const std::vector<DirectX::XMFLOAT3>& t_points, unsigned int t_max_vertices, ConvexHull& t_hull)
+{
+	t_hull.Vertices.clear();
+	t_hull.Indices.clear();
+	if (t_points.empty())
+	{
+		return;
+	}
+
+	// Tolerance scaled to the size of the input, as in the original quickhull paper
+	XMVECTOR minimum = XMLoadFloat3(&t_points[0]);
+	XMVECTOR maximum = minimum;
+	unsigned int extremes[6] = { 0, 0, 0, 0, 0, 0 };
+	for (unsigned int i = 1; i < t_points.size(); ++i)
+	{
+		const XMFLOAT3& p = t_points[i];
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			if ((&p.x)[axis] < (&t_points[extremes[axis * 2]].x)[axis]) extremes[axis * 2] = i;
+			if ((&p.x)[axis] > (&t_points[extremes[axis * 2 + 1]].x)[axis]) extremes[axis * 2 + 1] = i;
+		}
+		minimum = XMVectorMin(minimum, XMLoadFloat3(&p));
+		maximum = XMVectorMax(maximum, XMLoadFloat3(&p));
+	}
+
+	XMFLOAT3 magnitude;
+	XMStoreFloat3(&magnitude, XMVectorMax(XMVectorAbs(minimum), XMVectorAbs(maximum)));
+	const float epsilon = 3.0f * FLT_EPSILON * (magnitude.x + magnitude.y + magnitude.z);
+
+	// Initial simplex. Each step that fails tells us how degenerate the input is.
+	unsigned int i0 = extremes[0];
+	unsigned int i1 = extremes[1];
+	float bestDistance = -1.0f;
+	for (int a = 0; a < 6; ++a)
+	{
+		for (int b = a + 1; b < 6; ++b)
+		{
+			float distance = XMVectorGetX(XMVector3LengthSq(XMLoadFloat3(&t_points[extremes[a]]) - XMLoadFloat3(&t_points[extremes[b]])));
+			if (distance > bestDistance)
+			{
+				bestDistance = distance;
+				i0 = extremes[a];
+				i1 = extremes[b];
+			}
+		}
+	}
+
+	if (sqrtf(bestDistance) <= epsilon)
+	{
+		t_hull.Vertices.push_back(t_points[i0]);
+		return;
+	}
+
+	XMVECTOR p0 = XMLoadFloat3(&t_points[i0]);
+	XMVECTOR lineDirection = XMVector3Normalize(XMLoadFloat3(&t_points[i1]) - p0);
+	unsigned int i2 = i0;
+	bestDistance = 0.0f;
+	for (unsigned int i = 0; i < t_points.size(); ++i)
+	{
+		float distance = XMVectorGetX(XMVector3Length(XMVector3Cross(XMLoadFloat3(&t_points[i]) - p0, lineDirection)));
+		if (distance > bestDistance)
+		{
+			bestDistance = distance;
+			i2 = i;
+		}
+	}
+
+	if (bestDistance <= epsilon)
+	{
+		t_hull.Vertices.push_back(t_points[i0]);
+		t_hull.Vertices.push_back(t_points[i1]);
+		return;
+	}
+
+	XMVECTOR planeNormal = XMVector3Normalize(XMVector3Cross(XMLoadFloat3(&t_points[i1]) - p0, XMLoadFloat3(&t_points[i2]) - p0));
+	unsigned int i3 = i0;
+	float signedDistance = 0.0f;
+	for (unsigned int i = 0; i < t_points.size(); ++i)
+	{
+		float distance = XMVectorGetX(XMVector3Dot(XMLoadFloat3(&t_points[i]) - p0, planeNormal));
+		if (fabsf(distance) > fabsf(signedDistance))
+		{
+			signedDistance = distance;
+			i3 = i;
+		}
+	}
+
+	if (fabsf(signedDistance) <= epsilon)
+	{
+		BuildFlatHull(t_points, p0, planeNormal, lineDirection, t_hull);
+		return;
+	}
+
+	// Orient the base triangle so the fourth point is behind it
+	if (signedDistance > 0.0f)
+	{
+		std::swap(i1, i2);
+	}
+
+	std::vector<HullFace> faces;
+	faces.push_back(MakeFace(t_points, i0, i1, i2));
+	faces.push_back(MakeFace(t_points, i0, i3, i1));
+	faces.push_back(MakeFace(t_points, i1, i3, i2));
+	faces.push_back(MakeFace(t_points, i2, i3, i0));
+
+	std::unordered_map<unsigned long long, unsigned int> edges;
+	for (unsigned int f = 0; f < faces.size(); ++f)
+	{
+		for (int e = 0; e < 3; ++e)
+		{
+			edges[EdgeKey(faces[f].V[e], faces[f].V[(e + 1) % 3])] = f;
+		}
+	}
+
+	for (unsigned int i = 0; i < t_points.size(); ++i)
+	{
+		if (i != i0 && i != i1 && i != i2 && i != i3)
+		{
+			AssignToFaces(t_points, i, faces, 0, epsilon);
+		}
+	}
+
+	unsigned int hullVertexCount = 4;
+	std::vector<unsigned int> visibleFaces;
+	std::vector<unsigned long long> horizon;
+	std::vector<unsigned int> orphans;
+	std::vector<char> visited;
+
+	while (t_max_vertices == 0 || hullVertexCount < t_max_vertices)
+	{
+		// Always grow towards the point farthest from the current hull, so
+		// stopping early (vertex reduction) still gives the best approximation
+		unsigned int eyeFace = 0;
+		float eyeDistance = 0.0f;
+		for (unsigned int f = 0; f < faces.size(); ++f)
+		{
+			if (faces[f].Alive && !faces[f].Outside.empty() && faces[f].FarthestDistance > eyeDistance)
+			{
+				eyeDistance = faces[f].FarthestDistance;
+				eyeFace = f;
+			}
+		}
+
+		if (eyeDistance <= 0.0f)
+		{
+			break;
+		}
+
+		const unsigned int eye = faces[eyeFace].Farthest;
+		const XMFLOAT3& eyePoint = t_points[eye];
+
+		// Flood fill the faces the eye can see, collecting the horizon on the way
+		visibleFaces.clear();
+		horizon.clear();
+		visited.assign(faces.size(), 0);
+		visited[eyeFace] = 1;
+		visibleFaces.push_back(eyeFace);
+		for (size_t v = 0; v < visibleFaces.size(); ++v)
+		{
+			const HullFace& face = faces[visibleFaces[v]];
+			for (int e = 0; e < 3; ++e)
+			{
+				unsigned int from = face.V[e];
+				unsigned int to = face.V[(e + 1) % 3];
+				auto twin = edges.find(EdgeKey(to, from));
+				if (twin == edges.end())
+				{
+					continue;
+				}
+
+				unsigned int neighbor = twin->second;
+				if (visited[neighbor] == 1)
+				{
+					continue;
+				}
+
+				if (visited[neighbor] == 0 && PlaneDistance(faces[neighbor], eyePoint) > epsilon)
+				{
+					visited[neighbor] = 1;
+					visibleFaces.push_back(neighbor);
+				}
+				else
+				{
+					visited[neighbor] = 2;
+					horizon.push_back(EdgeKey(from, to));
+				}
+			}
+		}
+
+		orphans.clear();
+		for (unsigned int f : visibleFaces)
+		{
+			HullFace& face = faces[f];
+			face.Alive = false;
+			for (int e = 0; e < 3; ++e)
+			{
+				edges.erase(EdgeKey(face.V[e], face.V[(e + 1) % 3]));
+			}
+			for (unsigned int point : face.Outside)
+			{
+				if (point != eye)
+				{
+					orphans.push_back(point);
+				}
+			}
+			face.Outside.clear();
+			face.Outside.shrink_to_fit();
+		}
+
+		// Cone of new faces from the horizon to the eye point
+		size_t firstNewFace = faces.size();
+		for (unsigned long long edge : horizon)
+		{
+			unsigned int from = static_cast<unsigned int>(edge >> 32);
+			unsigned int to = static_cast<unsigned int>(edge & 0xffffffffu);
+			unsigned int newFace = static_cast<unsigned int>(faces.size());
+			faces.push_back(MakeFace(t_points, from, to, eye));
+			edges[EdgeKey(from, to)] = newFace;
+			edges[EdgeKey(to, eye)] = newFace;
+			edges[EdgeKey(eye, from)] = newFace;
+		}
+
+		for (unsigned int point : orphans)
+		{
+			AssignToFaces(t_points, point, faces, firstNewFace, epsilon);
+		}
+
+		++hullVertexCount;
+	}
+
+	// Compact the surviving faces and the vertices they reference
+	std::vector<unsigned int> remap(t_points.size(), UINT_MAX);
+	for (const HullFace& face : faces)
+	{
+		if (!face.Alive)
+		{
+			continue;
+		}
+
+		for (int v = 0; v < 3; ++v)
+		{
+			unsigned int index = face.V[v];
+			if (remap[index] == UINT_MAX)
+			{
+				remap[index] = static_cast<unsigned int>(t_hull.Vertices.size());
+				t_hull.Vertices.push_back(t_points[index]);
+			}
+			t_hull.Indices.push_back(remap[index]);
+		}
+	}
+}
+
+void CollisionProxyBuilder::BuildKDop(const std::vector<DirectX::XMFLOAT3>& t_points, KDopType t_type, KDop& t_dop)
+{
+	const unsigned int directionCount = static_cast<unsigned int>(t_type);
+	t_dop.Type = t_type;
+	for (unsigned int d = 0; d < KDop::MaxDirections; ++d)
+	{
+		t_dop.Min[d] = 0.0f;
+		t_dop.Max[d] = 0.0f;
+	}
+
+	if (t_points.empty())
+	{
+		return;
+	}
+
+	for (unsigned int d = 0; d < directionCount; ++d)
+	{
+		XMFLOAT3 direction3 = GetKDopDirection(t_type, d);
+		XMVECTOR direction = XMLoadFloat3(&direction3);
+		float minimum = FLT_MAX;
+		float maximum = -FLT_MAX;
+		for (const XMFLOAT3& point : t_points)
+		{
+			float projection = XMVectorGetX(XMVector3Dot(XMLoadFloat3(&point), direction));
+			minimum = (std::min)(minimum, projection);
+			maximum = (std::max)(maximum, projection);
+		}
+		t_dop.Min[d] = minimum;
+		t_dop.Max[d] = maximum;
+	}
+}
+
+void CollisionProxyBuilder::BuildOrientedBox(const std::vector<DirectX::XMFLOAT3>& t_points, OrientedBox& t_box)
+{
+	t_box.Center = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	t_box.Extents = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	t_box.Axes[0] = XMFLOAT3(1.0f, 0.0f, 0.0f);
+	t_box.Axes[1] = XMFLOAT3(0.0f, 1.0f, 0.0f);
+	t_box.Axes[2] = XMFLOAT3(0.0f, 0.0f, 1.0f);
+	if (t_points.empty())
+	{
+		return;
+	}
+
+	// Mean and covariance of the points
+	XMVECTOR mean = XMVectorZero();
+	for (const XMFLOAT3& point : t_points)
+	{
+		mean += XMLoadFloat3(&point);
+	}
+	mean = mean / static_cast<float>(t_points.size());
+
+	XMFLOAT3 mean3;
+	XMStoreFloat3(&mean3, mean);
+	float covariance[3][3] = {};
+	for (const XMFLOAT3& point : t_points)
+	{
+		float offset[3] = { point.x - mean3.x, point.y - mean3.y, point.z - mean3.z };
+		for (int i = 0; i < 3; ++i)
+		{
+			for (int j = 0; j < 3; ++j)
+			{
+				covariance[i][j] += offset[i] * offset[j];
+			}
+		}
+	}
+
+	// Principal axes, sorted by how much the points spread along them.
+	// Flat or linear inputs simply end up with a zero eigenvalue, which is fine.
+	float eigenvectors[3][3];
+	JacobiEigenDecomposition(covariance, eigenvectors);
+
+	int order[3] = { 0, 1, 2 };
+	std::sort(order, order + 3, [&covariance](int t_lhs, int t_rhs)
+	{
+		return covariance[t_lhs][t_lhs] > covariance[t_rhs][t_rhs];
+	});
+
+	XMVECTOR axes[3];
+	for (int a = 0; a < 2; ++a)
+	{
+		axes[a] = XMVector3Normalize(XMVectorSet(eigenvectors[0][order[a]], eigenvectors[1][order[a]], eigenvectors[2][order[a]], 0.0f));
+	}
+	axes[2] = XMVector3Normalize(XMVector3Cross(axes[0], axes[1]));
+
+	// Fit the box to the points along those axes
+	XMVECTOR center = XMVectorZero();
+	float extents[3];
+	for (int a = 0; a < 3; ++a)
+	{
+		float minimum = FLT_MAX;
+		float maximum = -FLT_MAX;
+		for (const XMFLOAT3& point : t_points)
+		{
+			float projection = XMVectorGetX(XMVector3Dot(XMLoadFloat3(&point), axes[a]));
+			minimum = (std::min)(minimum, projection);
+			maximum = (std::max)(maximum, projection);
+		}
+		center += axes[a] * ((minimum + maximum) * 0.5f);
+		extents[a] = (maximum - minimum) * 0.5f;
+		XMStoreFloat3(&t_box.Axes[a], axes[a]);
+	}
+
+	XMStoreFloat3(&t_box.Center, center);
+	t_box.Extents = XMFLOAT3(extents[0], extents[1], extents[2]);
+}
+
+CollisionProxy* CollisionProxyBuilder::Build(const Mesh* t_mesh, const CollisionProxySettings& t_settings)
+{
+	std::vector<XMFLOAT3> points;
+	GatherUniquePoints(t_mesh, points);
+
+	CollisionProxy* proxy = new CollisionProxy();
+	BuildConvexHull(points, t_settings.MaxHullVertices, proxy->Hull);
+
+	// The hull has the same extremes as the whole mesh, with far fewer points
+	// to look at. A reduced hull does not, so fall back to every point then.
+	const std::vector<XMFLOAT3>& fitPoints = (t_settings.MaxHullVertices == 0 && !proxy->Hull.Vertices.empty()) ? proxy->Hull.Vertices : points;
+	BuildKDop(fitPoints, t_settings.DopType, proxy->Dop);
+	BuildOrientedBox(proxy->Hull.Vertices.empty() ? points : proxy->Hull.Vertices, proxy->Box);
+
+	return proxy;
+}
+
+void CollisionProxyBuilder::BuildAll(const std::vector<Mesh*>& t_meshes, const CollisionProxySettings& t_settings)
+{
+	// Every mesh is independent, so hand one to each thread at a time
+	ParallelFor(t_meshes.size(), [&t_meshes, &t_settings](size_t t_index)
+	{
+		Mesh* mesh = t_meshes[t_index];
+		if (mesh != nullptr)
+		{
+			mesh->SetCollisionProxy(Build(mesh, t_settings));
+		}
+	});
+}
+
+DirectX::XMFLOAT3 CollisionProxyBuilder::GetKDopDirection(KDopType t_type, unsigned int t_index)
+{
+	if (t_index < 3)
+	{
+		return DopAxisDirections[t_index];
+	}
+	t_index -= 3;
+
+	if (t_type == KDopType::KDop14 || t_type == KDopType::KDop26)
+	{
+		if (t_index < 4)
+		{
+			return DopCornerDirections[t_index];
+		}
+		t_index -= 4;
+	}
+
+	return DopEdgeDirections[(std::min)(t_index, 5u)];
+}
+
+void CollisionProxyBuilder::GatherUniquePoints(const Mesh* t_mesh, std::vector<DirectX::XMFLOAT3>& t_points)
+{
+	// OBJ meshes repeat every position once per face that uses it, and
+	// broken exports can contain NaNs, so clean the input up first
+	const std::vector<Vertex>& vertices = t_mesh->GetVertices();
+	t_points.clear();
+	t_points.reserve(vertices.size());
+	for (const Vertex& vertex : vertices)
+	{
+		const XMFLOAT3& p = vertex.Position;
+		if (std::isfinite(p.x) && std::isfinite(p.y) && std::isfinite(p.z))
+		{
+			t_points.push_back(p);
+		}
+	}
+
+	std::sort(t_points.begin(), t_points.end(), [](const XMFLOAT3& t_lhs, const XMFLOAT3& t_rhs)
+	{
+		if (t_lhs.x != t_rhs.x) return t_lhs.x < t_rhs.x;
+		if (t_lhs.y != t_rhs.y) return t_lhs.y < t_rhs.y;
+		return t_lhs.z < t_rhs.z;
+	});
+
+	t_points.erase(std::unique(t_points.begin(), t_points.end(), [](const XMFLOAT3& t_lhs, const XMFLOAT3& t_rhs)
+	{
+		return t_lhs.x == t_rhs.x && t_lhs.y == t_rhs.y && t_lhs.z == t_rhs.z;
+	}), t_points.end());
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+
+// Forward Declaration
+class Mesh;
+
+// Closed convex triangle mesh. Triangles are clockwise when seen from outside,
+// like the rest of our geometry. Flat inputs produce a double-sided polygon and
+// collinear or single-point inputs produce vertices only.
+struct ConvexHull
+{
+	std::vector<DirectX::XMFLOAT3> Vertices;
+	std::vector<unsigned int> Indices;
+};
+
+// Which set of slab directions a k-DOP uses.
+enum class KDopType
+{
+	KDop6 = 3,		// Axes only (same as an AABB)
+	KDop14 = 7,		// Axes and corner diagonals
+	KDop18 = 9,		// Axes and edge diagonals
+	KDop26 = 13		// Axes, corner and edge diagonals
+};
+
+// Discrete oriented polytope: the extent of the shape along a fixed set of
+// directions. Directions are not normalized, see CollisionProxyBuilder::GetKDopDirection.
+// Only the first (unsigned int)Type entries of Min and Max are used.
+struct KDop
+{
+	static const unsigned int MaxDirections = 13;
+
+	KDopType Type;
+	float Min[MaxDirections];
+	float Max[MaxDirections];
+};
+
+// Box fitted to the principal axes of the shape.
+struct OrientedBox
+{
+	DirectX::XMFLOAT3 Center;
+	DirectX::XMFLOAT3 Extents;		// Half size along each axis
+	DirectX::XMFLOAT3 Axes[3];		// Orthonormal, in order of decreasing spread
+};
+
+// Simplified shapes cached alongside a Mesh for physics and cheap visibility tests.
+struct CollisionProxy
+{
+	ConvexHull Hull;
+	KDop Dop;
+	OrientedBox Box;
+};
+
+// Options used when generating CollisionProxy objects.
+struct CollisionProxySettings
+{
+	unsigned int MaxHullVertices = 0;		// Stop growing the hull at this many vertices (0 = exact hull)
+	KDopType DopType = KDopType::KDop18;
+};
+
+class CollisionProxyBuilder
+{
+public:
+	// Build the convex hull of a point cloud with quickhull.
+	static void BuildConvexHull(const std::vector<DirectX::XMFLOAT3>& t_points, unsigned int t_max_vertices, ConvexHull& t_hull);
+
+	// Fit a k-DOP around a point cloud.
+	static void BuildKDop(const std::vector<DirectX::XMFLOAT3>& t_points, KDopType t_type, KDop& t_dop);
+
+	// Fit an oriented box around a point cloud using principal component analysis.
+	static void BuildOrientedBox(const std::vector<DirectX::XMFLOAT3>& t_points, OrientedBox& t_box);
+
+	// Build every proxy for a Mesh from its CPU-side vertices.
+	static CollisionProxy* Build(const Mesh* t_mesh, const CollisionProxySettings& t_settings);
+
+	// Build proxies for all meshes in parallel and cache each one on its Mesh.
+	static void BuildAll(const std::vector<Mesh*>& t_meshes, const CollisionProxySettings& t_settings);
+
+	// Get slab direction t_index of a k-DOP of the given type.
+	static DirectX::XMFLOAT3 GetKDopDirection(KDopType t_type, unsigned int t_index);
+
+private:
+	// Clean up raw mesh positions: drop non-finite values and exact duplicates.
+	static void GatherUniquePoints(const Mesh* t_mesh, std::vector<DirectX::XMFLOAT3>& t_points);
+};
@@ -0,0 +1,155 @@
+#include "ConstantBufferRing.h"
+#include <cstring>
+
+ConstantBufferRing::ConstantBufferRing(ID3D11Device* t_device, ID3D11DeviceContext* t_context, UINT t_capacity)
+	: device(t_device), context(t_context), allocator(t_capacity, Alignment)
+{
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	if (FAILED(device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options)))
+		|| !options.ConstantBufferOffsetting || !options.MapNoOverwriteOnDynamicConstantBuffer)
+	{
+		return;
+	}
+
+	// D3D11.1 allows constant buffers bigger than a shader can see at once
+	D3D11_BUFFER_DESC desc = {};
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.ByteWidth = (UINT)allocator.GetCapacity();
+	desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	if (FAILED(device->CreateBuffer(&desc, nullptr, &buffer)))
+	{
+		buffer = nullptr;
+	}
+}
+
+ConstantBufferRing::~ConstantBufferRing()
+{
+	for (const Fence& fence : fences)
+	{
+		fence.Query->Release();
+	}
+	for (ID3D11Query* query : freeQueries)
+	{
+		query->Release();
+	}
+	if (buffer)
+	{
+		buffer->Release();
+	}
+}
+
+bool ConstantBufferRing::IsSupported() const
+{
+	return buffer != nullptr;
+}
+
+bool ConstantBufferRing::Upload(const void* t_data, UINT t_size, ID3D11Buffer*& t_buffer, UINT& t_first_constant, UINT& t_constant_count)
+{
+	if (!buffer)
+	{
+		return false;
+	}
+
+	size_t offset = allocator.Allocate(t_size);
+	if (offset == RingAllocator::InvalidOffset)
+	{
+		++stats.Failures;
+		return false;
+	}
+
+	// A range that is all that is in use needs nothing kept, so the driver may as well hand over fresh memory
+	UINT size = (t_size + Alignment - 1) & ~(Alignment - 1);
+	D3D11_MAP mapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+	if (allocator.GetUsedBytes() == size)
+	{
+		mapType = D3D11_MAP_WRITE_DISCARD;
+		++stats.Discards;
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(context->Map(buffer, 0, mapType, 0, &mapped)))
+	{
+		++stats.Failures;
+		return false;
+	}
+	memcpy(static_cast<unsigned char*>(mapped.pData) + offset, t_data, t_size);
+	context->Unmap(buffer, 0);
+
+	t_buffer = buffer;
+	t_first_constant = (UINT)(offset / 16);
+	t_constant_count = size / 16;
+	++stats.Uploads;
+	stats.Bytes += t_size;
+	return true;
+}
+
+uint64_t ConstantBufferRing::GetFrame() const
+{
+	return frame;
+}
+
+void ConstantBufferRing::EndFrame()
+{
+	if (!buffer)
+	{
+		return;
+	}
+
+	// A frame left without a query is retired along with the next one that has one
+	uint64_t ended = allocator.EndFrame();
+	++frame;
+	ID3D11Query* query = nullptr;
+	if (!freeQueries.empty())
+	{
+		query = freeQueries.back();
+		freeQueries.pop_back();
+	}
+	else
+	{
+		D3D11_QUERY_DESC desc = { D3D11_QUERY_EVENT, 0 };
+		if (FAILED(device->CreateQuery(&desc, &query)))
+		{
+			query = nullptr;
+		}
+	}
+	if (query)
+	{
+		context->End(query);
+		Fence fence = { query, ended };
+		fences.push_back(fence);
+	}
+
+	// Frames finish in order, so stop at the first that has not
+	while (!fences.empty())
+	{
+		BOOL done = FALSE;
+		if (context->GetData(fences.front().Query, &done, sizeof(done), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK || !done)
+		{
+			break;
+		}
+		allocator.Retire(fences.front().Frame);
+		freeQueries.push_back(fences.front().Query);
+		fences.pop_front();
+	}
+}
+
+size_t ConstantBufferRing::GetUsedBytes() const
+{
+	return allocator.GetUsedBytes();
+}
+
+size_t ConstantBufferRing::GetFramesInFlight() const
+{
+	return allocator.GetFramesInFlight();
+}
+
+ConstantBufferRing::Stats ConstantBufferRing::GetStats() const
+{
+	return stats;
+}
+
+void ConstantBufferRing::ResetStats()
+{
+	stats = {};
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <d3d11.h>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include "RingAllocator.h"
+
+// One large dynamic constant buffer that per-draw constants are written
+// straight into, each copy getting a range of its own that is bound with
+// ID3D11DeviceContext1's *SetConstantBuffers1. This takes the place of
+// UpdateSubresource on a small default-usage buffer per draw, which has the
+// driver copy or rename the buffer each time.
+//
+// Ranges are mapped with NO_OVERWRITE, since a RingAllocator only hands out
+// space the GPU is done with: an event query is issued at each EndFrame(),
+// and a frame's ranges are freed once its query has finished. The first map,
+// and any made while nothing else in the ring is in use, DISCARD instead.
+//
+// This needs D3D11.1's constant buffer offsets and NO_OVERWRITE maps of
+// constant buffers. Without them, or with the ring full, Upload() fails and
+// the data should go to a buffer of its own as before.
+class ConstantBufferRing
+{
+public:
+	// Ranges start and end on 16 constant boundaries, as *SetConstantBuffers1 needs.
+	static const UINT Alignment = 256;
+
+	// Calls made to Upload() and what became of them.
+	struct Stats
+	{
+		size_t Uploads;
+		size_t Bytes;
+		size_t Discards;
+		size_t Failures;
+	};
+
+	// Make a ring of t_capacity bytes, if the device supports it.
+	ConstantBufferRing(ID3D11Device* t_device, ID3D11DeviceContext* t_context, UINT t_capacity);
+	~ConstantBufferRing();
+
+	// Can the device bind ranges of a dynamic constant buffer?
+	bool IsSupported() const;
+
+	// Copy t_size bytes into the ring and get the buffer and range of constants
+	// to bind them with. False when the ring is unsupported or full.
+	bool Upload(const void* t_data, UINT t_size, ID3D11Buffer*& t_buffer, UINT& t_first_constant, UINT& t_constant_count);
+
+	// Get the frame being uploaded for. A range is only good for the frame it was handed out in.
+	uint64_t GetFrame() const;
+
+	// Fence off this frame's ranges, and free those of frames the GPU has finished. Call once a frame.
+	void EndFrame();
+
+	// Get bytes in use and frames not yet finished by the GPU.
+	size_t GetUsedBytes() const;
+	size_t GetFramesInFlight() const;
+
+	// Get uploads since the last ResetStats().
+	Stats GetStats() const;
+	void ResetStats();
+
+private:
+	// An event query issued at the end of a frame
+	struct Fence
+	{
+		ID3D11Query* Query;
+		uint64_t Frame;
+	};
+
+	ID3D11Device* device;
+	ID3D11DeviceContext* context;
+	ID3D11Buffer* buffer = nullptr;
+	RingAllocator allocator;
+
+	uint64_t frame = 1;
+	std::deque<Fence> fences;
+	std::vector<ID3D11Query*> freeQueries;
+
+	Stats stats = {};
+};
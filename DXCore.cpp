@@ -1,6 +1,10 @@
 #include "DXCore.h"
+#include "JobSystem.h"
 
 #include <WindowsX.h>
+#include <mmsystem.h>
+#include <chrono>
+#include <cmath>
 #include <sstream>
 
 // Define the static instance variable so our OS-level 
@@ -50,6 +54,16 @@ DXCore::DXCore(
 	// Initialize fields
 	fpsFrameCount = 0;
 	fpsTimeElapsed = 0.0f;
+	pipelineLatency = 0;
+	frameRateLimit = 0.0f;
+	simulationStopping = false;
+	fixedTimeStep = 0.0f;
+	maxSimulationSteps = 5;
+	interpolationAlpha = 1.0f;
+	simulationTime = 0.0;
+	simulationAccumulator = 0.0;
+	droppedSimulationTime = 0.0;
+	receivedSnapshotCount = 0;
 	
 	device = 0;
 	context = 0;
@@ -353,6 +367,24 @@ HRESULT DXCore::Run()
 	// Give subclass a chance to initialize
 	Init();
 
+	// Update gets a thread of its own when it is allowed to run ahead
+	framePipeline.SetLatency(pipelineLatency);
+	bool pipelined = framePipeline.GetLatency() > 0;
+	if (pipelined)
+	{
+		simulationStopping = false;
+		framePipeline.Restart();
+		simulationThread = std::thread(&DXCore::SimulationLoop, this);
+	}
+
+	// Draw's own clock when Update has the main timer
+	__int64 drawPreviousTime = now;
+
+	// Ask Windows for 1ms sleeps while the frame rate is capped
+	frameLimiter.SetTargetFrameRate(frameRateLimit);
+	if (frameRateLimit > 0.0f)
+		timeBeginPeriod(1);
+
 	// Our overall game and message loop
 	MSG msg = {};
 	while (msg.message != WM_QUIT)
@@ -365,7 +397,7 @@ HRESULT DXCore::Run()
 			TranslateMessage(&msg);
 			DispatchMessage(&msg);
 		}
-		else
+		else if (!pipelined)
 		{
 			// Update timer and title bar (if necessary)
 			UpdateTimer();
@@ -373,24 +405,212 @@ HRESULT DXCore::Run()
 				UpdateTitleBarStats();
 
 			// The game loop
-			Update(deltaTime, totalTime);
+			if (fixedTimeStep > 0.0f)
+			{
+				RunSimulationSteps(true);
+			}
+			else
+			{
+				Update(deltaTime, totalTime);
+				ReceiveSnapshots(false);
+			}
+			UpdateInterpolation();
 			Draw(deltaTime, totalTime);
+			frameLimiter.WaitForNextFrame();
+		}
+		else
+		{
+			// Update is running on the simulation thread; this thread
+			// only pumps messages and draws whatever it has finished
+			__int64 drawTime;
+			QueryPerformanceCounter((LARGE_INTEGER*)&drawTime);
+			float drawDeltaTime = (float)((drawTime - drawPreviousTime) * perfCounterSeconds);
+			drawPreviousTime = drawTime;
+
+			if(titleBarStats)
+				UpdateTitleBarStats();
+
+			// With a fixed step Draw keeps interpolating between the snapshots
+			// it has; otherwise every Draw waits for a new one
+			if (ReceiveSnapshots(fixedTimeStep <= 0.0f) || fixedTimeStep > 0.0f)
+			{
+				UpdateInterpolation();
+				Draw(drawDeltaTime, (float)((drawTime - startTime) * perfCounterSeconds));
+				frameLimiter.WaitForNextFrame();
+			}
 		}
 	}
 
+	if (frameRateLimit > 0.0f)
+		timeEndPeriod(1);
+
+	if (pipelined)
+	{
+		// Wake the simulation thread if it is waiting for Draw
+		simulationStopping = true;
+		framePipeline.Stop();
+		simulationThread.join();
+	}
+
 	// We'll end up here once we get a WM_QUIT message,
 	// which usually comes from the user closing the window
 	return msg.wParam;
 }
 
+// --------------------------------------------------------
+// Simulation thread of the pipelined mode: keeps calling
+// Update, which blocks in FramePipeline::BeginWrite while
+// it is as far ahead of Draw as the latency allows.
+// --------------------------------------------------------
+void DXCore::SimulationLoop()
+{
+	// Update runs its systems as jobs from here on, so this thread gets the
+	// job system's own queue rather than going through the locked one
+	JobSystem::GetInstance().AdoptCallingThread();
+
+	while (!simulationStopping)
+	{
+		UpdateTimer();
+		if (fixedTimeStep <= 0.0f)
+		{
+			Update(deltaTime, totalTime);
+		}
+		else if (RunSimulationSteps(false) == 0)
+		{
+			// Nothing due yet: give the time back until the next step is
+			float untilNextStep = fixedTimeStep - (float)simulationAccumulator;
+			std::this_thread::sleep_for(std::chrono::microseconds((long long)(untilNextStep * 1000000.0f)));
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Fixed timestep: adds this frame's time to the accumulator
+// and calls Update once for every whole step in it. After
+// maxSimulationSteps the rest is dropped, so a slow frame
+// cannot snowball into ever more steps per frame.
+//
+// t_receive - Hand each step's snapshot to Draw right away
+//             (only when both run on this thread)
+// --------------------------------------------------------
+unsigned int DXCore::RunSimulationSteps(bool t_receive)
+{
+	simulationAccumulator += deltaTime;
+
+	unsigned int steps = 0;
+	while (simulationAccumulator >= fixedTimeStep && steps < maxSimulationSteps)
+	{
+		simulationTime += fixedTimeStep;
+		simulationAccumulator -= fixedTimeStep;
+		++steps;
+
+		Update(fixedTimeStep, (float)simulationTime);
+		if (t_receive)
+		{
+			ReceiveSnapshots(false);
+		}
+	}
+
+	if (simulationAccumulator >= fixedTimeStep)
+	{
+		double kept = fmod(simulationAccumulator, (double)fixedTimeStep);
+		droppedSimulationTime = droppedSimulationTime + (simulationAccumulator - kept);
+		simulationAccumulator = kept;
+	}
+	return steps;
+}
+
+// --------------------------------------------------------
+// Moves every snapshot Update has finished into the two
+// Draw interpolates between, handing the slots back.
+//
+// t_wait - Block until at least one snapshot is available
+// Returns whether any snapshot arrived
+// --------------------------------------------------------
+bool DXCore::ReceiveSnapshots(bool t_wait)
+{
+	bool received = false;
+	RenderSnapshot* snapshot = t_wait ? framePipeline.BeginRead() : framePipeline.TryBeginRead();
+	while (snapshot != nullptr)
+	{
+		// Swapping keeps every Items vector's capacity in circulation
+		std::swap(previousSnapshot, currentSnapshot);
+		std::swap(currentSnapshot, *snapshot);
+		framePipeline.EndRead();
+
+		++receivedSnapshotCount;
+		received = true;
+		snapshot = framePipeline.TryBeginRead();
+	}
+	return received;
+}
+
+// --------------------------------------------------------
+// Works out how far between previousSnapshot and
+// currentSnapshot Draw should be. Draw shows the world one
+// step in the past, so it always has two states to blend.
+// --------------------------------------------------------
+void DXCore::UpdateInterpolation()
+{
+	interpolationAlpha = 1.0f;
+	if (fixedTimeStep <= 0.0f || receivedSnapshotCount < 2)
+	{
+		return;
+	}
+
+	float span = currentSnapshot.TotalTime - previousSnapshot.TotalTime;
+	if (span <= 0.0f)
+	{
+		return;
+	}
+
+	__int64 now;
+	QueryPerformanceCounter((LARGE_INTEGER*)&now);
+	double displayTime = (now - startTime) * perfCounterSeconds - droppedSimulationTime - fixedTimeStep;
+	float alpha = (float)(displayTime - previousSnapshot.TotalTime) / span;
+	interpolationAlpha = alpha < 0.0f ? 0.0f : (alpha > 1.0f ? 1.0f : alpha);
+}
+
 
 // --------------------------------------------------------
 // Sends an OS-level Quit message to our process, which
-// will be handled by our message processing function
+// will be handled by our message processing function.
+// Closing the window (rather than PostQuitMessage) makes
+// this safe to call from the simulation thread as well.
 // --------------------------------------------------------
 void DXCore::Quit()
 {
-	PostQuitMessage(0);
+	PostMessage(hWnd, WM_CLOSE, 0, 0);
+}
+
+
+// --------------------------------------------------------
+// Lets Update run up to this many frames ahead of Draw on
+// a simulation thread of its own (0 = back to back)
+// --------------------------------------------------------
+void DXCore::SetPipelineLatency(unsigned int latency)
+{
+	pipelineLatency = latency;
+}
+
+
+// --------------------------------------------------------
+// Calls Update in steps of exactly this many seconds and
+// interpolates between them in Draw (0 = variable step)
+// --------------------------------------------------------
+void DXCore::SetFixedTimeStep(float timeStep)
+{
+	fixedTimeStep = timeStep;
+}
+
+
+// --------------------------------------------------------
+// Caps Draw at this many frames per second, whether vsync
+// is on or not (0 = uncapped)
+// --------------------------------------------------------
+void DXCore::SetFrameRateLimit(float framesPerSecond)
+{
+	frameRateLimit = framesPerSecond;
 }
 
 
@@ -429,8 +649,13 @@ void DXCore::UpdateTitleBarStats()
 {
 	fpsFrameCount++;
 
+	// Read the clock here rather than use totalTime, which belongs
+	// to the simulation thread when Update runs on one
+	__int64 now;
+	QueryPerformanceCounter((LARGE_INTEGER*)&now);
+	float timeDiff = (float)((now - startTime) * perfCounterSeconds) - fpsTimeElapsed;
+
 	// Only calc FPS and update title bar once per second
-	float timeDiff = totalTime - fpsTimeElapsed;
 	if (timeDiff < 1.0f)
 		return;
 
@@ -446,6 +671,16 @@ void DXCore::UpdateTitleBarStats()
 		"    FPS: "			<< fpsFrameCount <<
 		"    Frame Time: "	<< mspf << "ms";
 
+	// Frame pacing while capped
+	if (frameLimiter.GetTargetFrameRate() > 0.0f)
+	{
+		output <<
+			"    Jitter: "	<< frameLimiter.GetJitterMilliseconds() << "ms" <<
+			"    Worst: "	<< frameLimiter.GetWorstDeviationMilliseconds() << "ms" <<
+			"    Late: "	<< frameLimiter.GetLateFrameCount();
+		frameLimiter.ResetStats();
+	}
+
 	// Append the version of DirectX the app is using
 	switch (dxFeatureLevel)
 	{
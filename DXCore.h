@@ -2,11 +2,16 @@
 
 #include <Windows.h>
 #include <d3d11.h>
+#include <atomic>
 #include <string>
+#include <thread>
+#include "FrameLimiter.h"
+#include "FramePipeline.h"
 
 // We can include the correct library files here
 // instead of in Visual Studio settings if we want
 #pragma comment(lib, "d3d11.lib")
+#pragma comment(lib, "winmm.lib")
 
 class DXCore
 {
@@ -37,6 +42,11 @@ public:
 	HRESULT Run();				
 	void Quit();
 	virtual void OnResize();
+
+	// Frame loop options, all off until asked for. Call them before Run().
+	void SetPipelineLatency(unsigned int latency);	// Frames Update may run ahead of Draw
+	void SetFixedTimeStep(float timeStep);			// Seconds per Update step (0 = variable)
+	void SetFrameRateLimit(float framesPerSecond);	// Draw rate cap (0 = uncapped)
 	
 	// Pure virtual methods for setup and game functionality
 	virtual void Init()										= 0;
@@ -69,6 +79,29 @@ protected:
 	ID3D11RenderTargetView* backBufferRTV;
 	ID3D11DepthStencilView* depthStencilView;
 
+	// How many frames Update may run ahead of Draw. 0 calls them back to back;
+	// anything higher runs Update on a simulation thread of its own, handing
+	// frames to Draw through framePipeline. Set it before Run().
+	unsigned int pipelineLatency;
+	FramePipeline framePipeline;
+
+	// Length of a simulation step in seconds. 0 passes each frame's own
+	// deltaTime to Update; anything else calls Update in steps of exactly this
+	// size (at most maxSimulationSteps per frame, dropping time beyond that).
+	float fixedTimeStep;
+	unsigned int maxSimulationSteps;
+
+	// The two newest snapshots from Update, for Draw to blend between.
+	// interpolationAlpha is 0 at previousSnapshot and 1 at currentSnapshot,
+	// and always 1 without a fixed step.
+	RenderSnapshot previousSnapshot;
+	RenderSnapshot currentSnapshot;
+	float interpolationAlpha;
+
+	// Frames per second Draw is capped at, vsync or not (0 = uncapped). Set it before Run().
+	float frameRateLimit;
+	FrameLimiter frameLimiter;
+
 	// Helper function for allocating a console window
 	void CreateConsoleWindow(int bufferLines, int bufferColumns, int windowLines, int windowColumns);
 
@@ -87,5 +120,19 @@ private:
 	
 	void UpdateTimer();			// Updates the timer for this frame
 	void UpdateTitleBarStats();	// Puts debug info in the title bar
+
+	// Pipelined mode: runs Update on its own thread until simulationStopping is set
+	void SimulationLoop();
+	std::thread simulationThread;
+	std::atomic<bool> simulationStopping;
+
+	// Fixed timestep and interpolation support
+	unsigned int RunSimulationSteps(bool t_receive);
+	bool ReceiveSnapshots(bool t_wait);
+	void UpdateInterpolation();
+	double simulationTime;						// Sum of all steps taken
+	double simulationAccumulator;				// Time not yet simulated
+	std::atomic<double> droppedSimulationTime;	// Time skipped by the catch-up limit
+	uint64_t receivedSnapshotCount;
 };
 
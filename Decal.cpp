@@ -0,0 +1,288 @@
+#include "Decal.h"
+#include "Entity.h"
+#include "Mesh.h"
+#include "TriangleBVH.h"
+#include <cfloat>
+#include <utility>
+
+using namespace DirectX;
+
+namespace
+{
+	// A vertex while it is being clipped: its position inside the decal's
+	// unit box, plus the attributes that get carried through to the output.
+	struct ClipVertex
+	{
+		XMVECTOR BoxPosition;
+		XMVECTOR Position;
+		XMVECTOR Normal;
+		XMVECTOR Tangent;
+	};
+
+	// Each of the six box planes adds at most one vertex to a triangle.
+	const unsigned int MaxClipVertices = 3 + 6;
+
+	ClipVertex LerpClipVertex(const ClipVertex& t_from, const ClipVertex& t_to, float t_amount)
+	{
+		ClipVertex result;
+		result.BoxPosition = XMVectorLerp(t_from.BoxPosition, t_to.BoxPosition, t_amount);
+		result.Position = XMVectorLerp(t_from.Position, t_to.Position, t_amount);
+		result.Normal = XMVectorLerp(t_from.Normal, t_to.Normal, t_amount);
+		result.Tangent = XMVectorLerp(t_from.Tangent, t_to.Tangent, t_amount);
+		return result;
+	}
+
+	// Matrix that maps the unit box [-0.5, 0.5]^3 onto the decal's box in world space.
+	XMMATRIX MakeBoxToWorld(const Decal& t_decal)
+	{
+		XMVECTOR direction = XMVector3Normalize(XMLoadFloat3(&t_decal.Direction));
+		XMVECTOR right = XMVector3Normalize(XMVector3Cross(XMLoadFloat3(&t_decal.Up), direction));
+		XMVECTOR up = XMVector3Cross(direction, right);
+		return XMMATRIX(
+			right * t_decal.Size.x,
+			up * t_decal.Size.y,
+			direction * t_decal.Size.z,
+			XMVectorSetW(XMLoadFloat3(&t_decal.Position), 1.0f));
+	}
+
+	// One Sutherland-Hodgman pass, keeping the part of the polygon where
+	// t_sign * BoxPosition[t_axis] <= 0.5. Returns the new vertex count.
+	unsigned int ClipAgainstPlane(const ClipVertex* t_input, unsigned int t_count, unsigned int t_axis, float t_sign, ClipVertex* t_output)
+	{
+		// Each vertex's distance is read once, not once per edge it is on
+		float distances[MaxClipVertices];
+		for (unsigned int i = 0; i < t_count; ++i)
+		{
+			distances[i] = 0.5f - t_sign * XMVectorGetByIndex(t_input[i].BoxPosition, t_axis);
+		}
+
+		unsigned int outputCount = 0;
+		for (unsigned int i = 0; i < t_count; ++i)
+		{
+			unsigned int nextIndex = (i + 1) % t_count;
+			const ClipVertex& current = t_input[i];
+			const ClipVertex& next = t_input[nextIndex];
+			float currentDistance = distances[i];
+			float nextDistance = distances[nextIndex];
+
+			if (currentDistance >= 0.0f)
+			{
+				t_output[outputCount++] = current;
+			}
+
+			// The edge crosses the plane, so add the intersection point
+			if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f))
+			{
+				t_output[outputCount++] = LerpClipVertex(current, next, currentDistance / (currentDistance - nextDistance));
+			}
+		}
+		return outputCount;
+	}
+}
+
+const float DecalBuilder::MinFacing = 0.1f;
+
+DecalMeshPool::~DecalMeshPool()
+{
+	for (DecalMesh* mesh : allMeshes)
+	{
+		delete mesh;
+	}
+	allMeshes.clear();
+	freeMeshes.clear();
+}
+
+DecalMesh* DecalMeshPool::Acquire()
+{
+	if (freeMeshes.empty())
+	{
+		DecalMesh* mesh = new DecalMesh();
+		allMeshes.push_back(mesh);
+		return mesh;
+	}
+
+	// Clearing keeps the capacity, which is the whole point of the pool
+	DecalMesh* mesh = freeMeshes.back();
+	freeMeshes.pop_back();
+	mesh->Vertices.clear();
+	mesh->Indices.clear();
+	return mesh;
+}
+
+void DecalMeshPool::Release(DecalMesh* t_mesh)
+{
+	if (t_mesh != nullptr)
+	{
+		freeMeshes.push_back(t_mesh);
+	}
+}
+
+DecalBuilder::DecalBuilder(DecalMeshPool* t_pool) :
+	pool(t_pool)
+{
+}
+
+void DecalBuilder::GetWorldBounds(const Decal& t_decal, XMFLOAT3& t_min, XMFLOAT3& t_max)
+{
+	// Every box axis adds its absolute reach along each world axis
+	XMMATRIX boxToWorld = MakeBoxToWorld(t_decal);
+	XMVECTOR extents = (XMVectorAbs(boxToWorld.r[0]) + XMVectorAbs(boxToWorld.r[1]) + XMVectorAbs(boxToWorld.r[2])) * 0.5f;
+	XMStoreFloat3(&t_min, boxToWorld.r[3] - extents);
+	XMStoreFloat3(&t_max, boxToWorld.r[3] + extents);
+}
+
+DecalMesh* DecalBuilder::Build(Entity* t_entity, const Decal& t_decal)
+{
+	Mesh* mesh = t_entity->GetEntityMesh();
+	if (mesh == nullptr || mesh->GetIndices().empty())
+	{
+		return nullptr;
+	}
+
+	if (t_decal.Size.x <= 0.0f || t_decal.Size.y <= 0.0f || t_decal.Size.z <= 0.0f)
+	{
+		return nullptr;
+	}
+
+	XMMATRIX boxToWorld = MakeBoxToWorld(t_decal);
+
+	// Entity's world matrix is stored transposed for HLSL, so undo that first
+	XMFLOAT4X4 world4x4 = t_entity->GetWorldMatrix();
+	XMMATRIX localToWorld = XMMatrixTranspose(XMLoadFloat4x4(&world4x4));
+	XMMATRIX boxToLocal = boxToWorld * XMMatrixInverse(nullptr, localToWorld);
+	XMMATRIX localToBox = XMMatrixInverse(nullptr, boxToLocal);
+
+	// Bounds of the decal's box in the Mesh's local space, to gather candidates
+	XMVECTOR queryMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR queryMax = XMVectorReplicate(-FLT_MAX);
+	for (unsigned int corner = 0; corner < 8; ++corner)
+	{
+		XMVECTOR boxCorner = XMVectorSet(
+			(corner & 1) ? 0.5f : -0.5f,
+			(corner & 2) ? 0.5f : -0.5f,
+			(corner & 4) ? 0.5f : -0.5f,
+			1.0f);
+		XMVECTOR localCorner = XMVector3Transform(boxCorner, boxToLocal);
+		queryMin = XMVectorMin(queryMin, localCorner);
+		queryMax = XMVectorMax(queryMax, localCorner);
+	}
+
+	XMFLOAT3 queryMin3, queryMax3;
+	XMStoreFloat3(&queryMin3, queryMin);
+	XMStoreFloat3(&queryMax3, queryMax);
+
+	candidates.clear();
+	mesh->GetTriangleBVH()->Query(queryMin3, queryMax3, candidates);
+	if (candidates.empty())
+	{
+		return nullptr;
+	}
+
+	const std::vector<Vertex>& vertices = mesh->GetVertices();
+	const std::vector<UINT>& indices = mesh->GetIndices();
+	const XMVECTOR halfExtent = XMVectorReplicate(0.5f);
+	const XMVECTOR negativeHalfExtent = XMVectorReplicate(-0.5f);
+
+	DecalMesh* output = pool->Acquire();
+	ClipVertex polygonA[MaxClipVertices];
+	ClipVertex polygonB[MaxClipVertices];
+
+	for (unsigned int triangle : candidates)
+	{
+		for (unsigned int corner = 0; corner < 3; ++corner)
+		{
+			const Vertex& vertex = vertices[indices[triangle * 3 + corner]];
+			polygonA[corner].Position = XMLoadFloat3(&vertex.Position);
+			polygonA[corner].BoxPosition = XMVector3Transform(polygonA[corner].Position, localToBox);
+			polygonA[corner].Normal = XMLoadFloat3(&vertex.Normal);
+			polygonA[corner].Tangent = XMLoadFloat3(&vertex.Tangent);
+		}
+
+		XMVECTOR a = polygonA[0].BoxPosition;
+		XMVECTOR b = polygonA[1].BoxPosition;
+		XMVECTOR c = polygonA[2].BoxPosition;
+
+		// Trivially reject triangles with all three corners beyond the same face of the box,
+		// testing all six faces at once
+		XMVECTOR aBeyondMax = XMVectorGreater(a, halfExtent);
+		XMVECTOR bBeyondMax = XMVectorGreater(b, halfExtent);
+		XMVECTOR cBeyondMax = XMVectorGreater(c, halfExtent);
+		XMVECTOR aBeyondMin = XMVectorLess(a, negativeHalfExtent);
+		XMVECTOR bBeyondMin = XMVectorLess(b, negativeHalfExtent);
+		XMVECTOR cBeyondMin = XMVectorLess(c, negativeHalfExtent);
+		XMVECTOR beyondMax = XMVectorAndInt(XMVectorAndInt(aBeyondMax, bBeyondMax), cBeyondMax);
+		XMVECTOR beyondMin = XMVectorAndInt(XMVectorAndInt(aBeyondMin, bBeyondMin), cBeyondMin);
+		if (!XMVector3EqualInt(XMVectorOrInt(beyondMax, beyondMin), XMVectorFalseInt()))
+		{
+			continue;
+		}
+
+		// The decal projects along +Z of its box, so faces towards it have a negative Z normal
+		XMVECTOR faceNormal = XMVector3Normalize(XMVector3Cross(b - a, c - a));
+		if (-XMVectorGetZ(faceNormal) < MinFacing)
+		{
+			continue;
+		}
+
+		// Only the faces some corner pokes out of need a clipping pass, and which
+		// those are comes from the same six-face tests: one bit per face, with
+		// plane 2 * axis the max face and 2 * axis + 1 the min face
+		XMUINT4 outsideMax, outsideMin;
+		XMStoreUInt4(&outsideMax, XMVectorOrInt(XMVectorOrInt(aBeyondMax, bBeyondMax), cBeyondMax));
+		XMStoreUInt4(&outsideMin, XMVectorOrInt(XMVectorOrInt(aBeyondMin, bBeyondMin), cBeyondMin));
+		unsigned int clipPlanes =
+			(outsideMax.x & 1) | (outsideMin.x & 2) |
+			(outsideMax.y & 4) | (outsideMin.y & 8) |
+			(outsideMax.z & 16) | (outsideMin.z & 32);
+
+		ClipVertex* polygon = polygonA;
+		unsigned int vertexCount = 3;
+		if (clipPlanes != 0)
+		{
+			ClipVertex* scratch = polygonB;
+			for (unsigned int plane = 0; plane < 6 && vertexCount >= 3; ++plane)
+			{
+				if ((clipPlanes & (1u << plane)) == 0)
+				{
+					continue;
+				}
+				vertexCount = ClipAgainstPlane(polygon, vertexCount, plane / 2, (plane & 1) ? -1.0f : 1.0f, scratch);
+				std::swap(polygon, scratch);
+			}
+
+			if (vertexCount < 3)
+			{
+				continue;
+			}
+		}
+
+		// Clipping keeps the polygon convex and its winding intact, so a fan will do
+		UINT baseVertex = static_cast<UINT>(output->Vertices.size());
+		for (unsigned int i = 0; i < vertexCount; ++i)
+		{
+			Vertex decalVertex;
+			XMStoreFloat3(&decalVertex.Position, polygon[i].Position);
+			XMStoreFloat3(&decalVertex.Normal, XMVector3Normalize(polygon[i].Normal));
+			XMStoreFloat3(&decalVertex.Tangent, XMVector3Normalize(polygon[i].Tangent));
+			decalVertex.UV = XMFLOAT2(
+				XMVectorGetX(polygon[i].BoxPosition) + 0.5f,
+				0.5f - XMVectorGetY(polygon[i].BoxPosition));
+			output->Vertices.push_back(decalVertex);
+		}
+
+		for (unsigned int i = 1; i + 1 < vertexCount; ++i)
+		{
+			output->Indices.push_back(baseVertex);
+			output->Indices.push_back(baseVertex + i);
+			output->Indices.push_back(baseVertex + i + 1);
+		}
+	}
+
+	if (output->Indices.empty())
+	{
+		pool->Release(output);
+		return nullptr;
+	}
+
+	return output;
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include "Vertex.h"
+
+// Forward Declaration
+class Entity;
+
+// An oriented box that gets projected onto whatever geometry it overlaps.
+struct Decal
+{
+	DirectX::XMFLOAT3 Position;		// Center of the box in world space
+	DirectX::XMFLOAT3 Direction;	// Direction the decal is projected along
+	DirectX::XMFLOAT3 Up;			// Orientation of the decal around Direction
+	DirectX::XMFLOAT3 Size;			// Width, height and projection depth of the box
+};
+
+// Geometry produced by stamping a Decal onto an Entity. Vertices are in the
+// Entity's local space, so the decal is drawn with the Entity's world matrix.
+struct DecalMesh
+{
+	std::vector<Vertex> Vertices;
+	std::vector<unsigned int> Indices;
+};
+
+// Recycles DecalMesh objects (and the capacity of their buffers), so
+// stamping decals every frame does not keep hitting the heap.
+class DecalMeshPool
+{
+public:
+	// Default Constructor for DecalMeshPool
+	DecalMeshPool() = default;
+
+	// Destructor for DecalMeshPool. Deletes every mesh it ever handed out.
+	~DecalMeshPool();
+
+	// Get an empty DecalMesh, reusing a released one when possible.
+	DecalMesh* Acquire();
+
+	// Hand a DecalMesh back to the pool.
+	void Release(DecalMesh* t_mesh);
+
+private:
+	DecalMeshPool(const DecalMeshPool&) = delete;
+	DecalMeshPool& operator=(const DecalMeshPool&) = delete;
+
+	std::vector<DecalMesh*> allMeshes;
+	std::vector<DecalMesh*> freeMeshes;
+};
+
+// Clips the triangles of an Entity's Mesh against a Decal's box and builds
+// the decal geometry with UVs projected from the box.
+class DecalBuilder
+{
+public:
+	// Constructor for DecalBuilder. Output meshes come from t_pool.
+	explicit DecalBuilder(DecalMeshPool* t_pool);
+
+	// Get the world space box around t_decal's oriented box, to find what it may touch.
+	static void GetWorldBounds(const Decal& t_decal, DirectX::XMFLOAT3& t_min, DirectX::XMFLOAT3& t_max);
+
+	// Project t_decal onto t_entity. Returns nullptr if the decal does not touch
+	// any triangle facing it, otherwise a pooled mesh the caller has to Release().
+	DecalMesh* Build(Entity* t_entity, const Decal& t_decal);
+
+private:
+	// Triangles facing further away from the projector than this (cosine) are skipped.
+	static const float MinFacing;
+
+	DecalMeshPool* pool = nullptr;
+
+	// Scratch list of candidate triangles, kept around to avoid reallocations.
+	std::vector<unsigned int> candidates;
+};
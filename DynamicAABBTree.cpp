@@ -0,0 +1,648 @@
+#include "DynamicAABBTree.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+using namespace DirectX;
+
+namespace
+{
+	// Depth the traversal stacks are sized for up front
+	const size_t InitialStackSize = 64;
+
+	float SurfaceArea(const XMFLOAT3& t_min, const XMFLOAT3& t_max)
+	{
+		float x = t_max.x - t_min.x;
+		float y = t_max.y - t_min.y;
+		float z = t_max.z - t_min.z;
+		return 2.0f * (x * y + y * z + z * x);
+	}
+
+	void Combine(const XMFLOAT3& t_min_a, const XMFLOAT3& t_max_a, const XMFLOAT3& t_min_b, const XMFLOAT3& t_max_b, XMFLOAT3& t_min, XMFLOAT3& t_max)
+	{
+		t_min = XMFLOAT3((std::min)(t_min_a.x, t_min_b.x), (std::min)(t_min_a.y, t_min_b.y), (std::min)(t_min_a.z, t_min_b.z));
+		t_max = XMFLOAT3((std::max)(t_max_a.x, t_max_b.x), (std::max)(t_max_a.y, t_max_b.y), (std::max)(t_max_a.z, t_max_b.z));
+	}
+
+	float CombinedArea(const XMFLOAT3& t_min_a, const XMFLOAT3& t_max_a, const XMFLOAT3& t_min_b, const XMFLOAT3& t_max_b)
+	{
+		XMFLOAT3 combinedMin, combinedMax;
+		Combine(t_min_a, t_max_a, t_min_b, t_max_b, combinedMin, combinedMax);
+		return SurfaceArea(combinedMin, combinedMax);
+	}
+
+	// Does box a lie entirely within box b?
+	bool Contains(const XMFLOAT3& t_min_b, const XMFLOAT3& t_max_b, const XMFLOAT3& t_min_a, const XMFLOAT3& t_max_a)
+	{
+		return t_min_a.x >= t_min_b.x && t_min_a.y >= t_min_b.y && t_min_a.z >= t_min_b.z &&
+			t_max_a.x <= t_max_b.x && t_max_a.y <= t_max_b.y && t_max_a.z <= t_max_b.z;
+	}
+
+	bool Overlaps(const XMFLOAT3& t_min_a, const XMFLOAT3& t_max_a, const XMFLOAT3& t_min_b, const XMFLOAT3& t_max_b)
+	{
+		return t_min_a.x <= t_max_b.x && t_max_a.x >= t_min_b.x &&
+			t_min_a.y <= t_max_b.y && t_max_a.y >= t_min_b.y &&
+			t_min_a.z <= t_max_b.z && t_max_a.z >= t_min_b.z;
+	}
+
+	bool Equals(const XMFLOAT3& t_a, const XMFLOAT3& t_b)
+	{
+		return t_a.x == t_b.x && t_a.y == t_b.y && t_a.z == t_b.z;
+	}
+
+	// Distance along the ray to where it enters the box, or a negative value if it misses
+	float RayEntry(const XMFLOAT3& t_min, const XMFLOAT3& t_max, const XMFLOAT3& t_origin, const XMFLOAT3& t_inverse_direction, float t_max_distance)
+	{
+		float near1 = (t_min.x - t_origin.x) * t_inverse_direction.x;
+		float far1 = (t_max.x - t_origin.x) * t_inverse_direction.x;
+		float near2 = (t_min.y - t_origin.y) * t_inverse_direction.y;
+		float far2 = (t_max.y - t_origin.y) * t_inverse_direction.y;
+		float near3 = (t_min.z - t_origin.z) * t_inverse_direction.z;
+		float far3 = (t_max.z - t_origin.z) * t_inverse_direction.z;
+
+		float entry = (std::max)((std::max)((std::min)(near1, far1), (std::min)(near2, far2)), (std::max)((std::min)(near3, far3), 0.0f));
+		float exit = (std::min)((std::min)((std::max)(near1, far1), (std::max)(near2, far2)), (std::min)((std::max)(near3, far3), t_max_distance));
+		return entry <= exit ? entry : -1.0f;
+	}
+}
+
+void DynamicAABBTree::SetMargin(float t_margin)
+{
+	margin = t_margin;
+}
+
+float DynamicAABBTree::GetMargin() const
+{
+	return margin;
+}
+
+unsigned int DynamicAABBTree::CreateProxy(const XMFLOAT3& t_min, const XMFLOAT3& t_max, unsigned int t_user_data)
+{
+	unsigned int proxy = AllocateNode();
+	Node& node = nodes[proxy];
+	node.Min = XMFLOAT3(t_min.x - margin, t_min.y - margin, t_min.z - margin);
+	node.Max = XMFLOAT3(t_max.x + margin, t_max.y + margin, t_max.z + margin);
+	node.UserData = t_user_data;
+	node.Height = 0;
+
+	InsertLeaf(proxy);
+	++proxyCount;
+	return proxy;
+}
+
+void DynamicAABBTree::DestroyProxy(unsigned int t_proxy)
+{
+	RemoveLeaf(t_proxy);
+	FreeNode(t_proxy);
+	--proxyCount;
+}
+
+bool DynamicAABBTree::MoveProxy(unsigned int t_proxy, const XMFLOAT3& t_min, const XMFLOAT3& t_max)
+{
+	Node& leaf = nodes[t_proxy];
+	if (Contains(leaf.Min, leaf.Max, t_min, t_max))
+	{
+		return false;
+	}
+
+	XMFLOAT3 fatMin(t_min.x - margin, t_min.y - margin, t_min.z - margin);
+	XMFLOAT3 fatMax(t_max.x + margin, t_max.y + margin, t_max.z + margin);
+
+	// Something that jumped clear of where it was would stretch every box
+	// up to the root, so find it a new place instead
+	if (!Overlaps(leaf.Min, leaf.Max, fatMin, fatMax))
+	{
+		RemoveLeaf(t_proxy);
+		nodes[t_proxy].Min = fatMin;
+		nodes[t_proxy].Max = fatMax;
+		InsertLeaf(t_proxy);
+		return true;
+	}
+
+	leaf.Min = fatMin;
+	leaf.Max = fatMax;
+	Refit(leaf.Parent);
+	return true;
+}
+
+unsigned int DynamicAABBTree::GetUserData(unsigned int t_proxy) const
+{
+	return nodes[t_proxy].UserData;
+}
+
+void DynamicAABBTree::GetFatBounds(unsigned int t_proxy, XMFLOAT3& t_min, XMFLOAT3& t_max) const
+{
+	t_min = nodes[t_proxy].Min;
+	t_max = nodes[t_proxy].Max;
+}
+
+void DynamicAABBTree::Optimize(unsigned int t_node_count)
+{
+	if (nodes.empty())
+	{
+		return;
+	}
+
+	for (unsigned int i = 0; i < t_node_count; ++i)
+	{
+		if (optimizeCursor >= nodes.size())
+		{
+			optimizeCursor = 0;
+		}
+
+		unsigned int index = optimizeCursor++;
+		if (nodes[index].Height > 0 && Rotate(index))
+		{
+			// Only heights above can have changed; the boxes hold the same leaves
+			for (unsigned int parent = nodes[index].Parent; parent != NullProxy; parent = nodes[parent].Parent)
+			{
+				int height = 1 + (std::max)(nodes[nodes[parent].Child1].Height, nodes[nodes[parent].Child2].Height);
+				if (height == nodes[parent].Height)
+				{
+					break;
+				}
+				nodes[parent].Height = height;
+			}
+		}
+	}
+}
+
+void DynamicAABBTree::QueryFrustum(const XMFLOAT4 t_planes[6], std::vector<unsigned int>& t_results) const
+{
+	if (root == NullProxy)
+	{
+		return;
+	}
+
+	// Each entry carries the planes its parent was not yet fully inside of,
+	// so a subtree never retests a plane an ancestor has cleared
+	const unsigned int allPlanes = (1u << 6) - 1u;
+	std::vector<std::pair<unsigned int, unsigned int>> stack;
+	stack.reserve(InitialStackSize);
+	stack.push_back(std::make_pair(root, allPlanes));
+
+	while (!stack.empty())
+	{
+		unsigned int index = stack.back().first;
+		unsigned int planeMask = stack.back().second;
+		stack.pop_back();
+
+		const Node& node = nodes[index];
+		XMFLOAT3 center(0.5f * (node.Min.x + node.Max.x), 0.5f * (node.Min.y + node.Max.y), 0.5f * (node.Min.z + node.Max.z));
+		XMFLOAT3 extents(0.5f * (node.Max.x - node.Min.x), 0.5f * (node.Max.y - node.Min.y), 0.5f * (node.Max.z - node.Min.z));
+
+		bool outside = false;
+		for (int p = 0; p < 6 && !outside; ++p)
+		{
+			if ((planeMask & (1u << p)) == 0)
+			{
+				continue;
+			}
+
+			const XMFLOAT4& plane = t_planes[p];
+			float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+			float reach = fabsf(plane.x) * extents.x + fabsf(plane.y) * extents.y + fabsf(plane.z) * extents.z;
+			if (distance + reach < 0.0f)
+			{
+				outside = true;
+			}
+			else if (distance - reach >= 0.0f)
+			{
+				planeMask &= ~(1u << p);
+			}
+		}
+
+		if (outside)
+		{
+			continue;
+		}
+
+		if (planeMask == 0 || node.Height == 0)
+		{
+			AddSubtree(index, t_results);
+		}
+		else
+		{
+			stack.push_back(std::make_pair(node.Child1, planeMask));
+			stack.push_back(std::make_pair(node.Child2, planeMask));
+		}
+	}
+}
+
+void DynamicAABBTree::QuerySphere(const XMFLOAT3& t_center, float t_radius, std::vector<unsigned int>& t_results) const
+{
+	if (root == NullProxy)
+	{
+		return;
+	}
+
+	float radiusSquared = t_radius * t_radius;
+	std::vector<unsigned int> stack;
+	stack.reserve(InitialStackSize);
+	stack.push_back(root);
+
+	while (!stack.empty())
+	{
+		unsigned int index = stack.back();
+		stack.pop_back();
+		const Node& node = nodes[index];
+
+		// Nearest and furthest points of the box from the center
+		float nearX = (std::max)((std::max)(node.Min.x - t_center.x, t_center.x - node.Max.x), 0.0f);
+		float nearY = (std::max)((std::max)(node.Min.y - t_center.y, t_center.y - node.Max.y), 0.0f);
+		float nearZ = (std::max)((std::max)(node.Min.z - t_center.z, t_center.z - node.Max.z), 0.0f);
+		if (nearX * nearX + nearY * nearY + nearZ * nearZ > radiusSquared)
+		{
+			continue;
+		}
+
+		float farX = (std::max)(fabsf(node.Min.x - t_center.x), fabsf(node.Max.x - t_center.x));
+		float farY = (std::max)(fabsf(node.Min.y - t_center.y), fabsf(node.Max.y - t_center.y));
+		float farZ = (std::max)(fabsf(node.Min.z - t_center.z), fabsf(node.Max.z - t_center.z));
+		if (node.Height == 0 || farX * farX + farY * farY + farZ * farZ <= radiusSquared)
+		{
+			AddSubtree(index, t_results);
+		}
+		else
+		{
+			stack.push_back(node.Child1);
+			stack.push_back(node.Child2);
+		}
+	}
+}
+
+void DynamicAABBTree::QueryAABB(const XMFLOAT3& t_min, const XMFLOAT3& t_max, std::vector<unsigned int>& t_results) const
+{
+	if (root == NullProxy)
+	{
+		return;
+	}
+
+	std::vector<unsigned int> stack;
+	stack.reserve(InitialStackSize);
+	stack.push_back(root);
+
+	while (!stack.empty())
+	{
+		unsigned int index = stack.back();
+		stack.pop_back();
+		const Node& node = nodes[index];
+
+		if (!Overlaps(node.Min, node.Max, t_min, t_max))
+		{
+			continue;
+		}
+
+		if (node.Height == 0 || Contains(t_min, t_max, node.Min, node.Max))
+		{
+			AddSubtree(index, t_results);
+		}
+		else
+		{
+			stack.push_back(node.Child1);
+			stack.push_back(node.Child2);
+		}
+	}
+}
+
+void DynamicAABBTree::QueryRay(const XMFLOAT3& t_origin, const XMFLOAT3& t_direction, float t_max_distance, std::vector<unsigned int>& t_results) const
+{
+	if (root == NullProxy)
+	{
+		return;
+	}
+
+	// Division by zero gives infinities, which the slab test handles
+	XMFLOAT3 inverseDirection(1.0f / t_direction.x, 1.0f / t_direction.y, 1.0f / t_direction.z);
+
+	std::vector<unsigned int> stack;
+	stack.reserve(InitialStackSize);
+	if (RayEntry(nodes[root].Min, nodes[root].Max, t_origin, inverseDirection, t_max_distance) >= 0.0f)
+	{
+		stack.push_back(root);
+	}
+
+	while (!stack.empty())
+	{
+		unsigned int index = stack.back();
+		stack.pop_back();
+		const Node& node = nodes[index];
+
+		if (node.Height == 0)
+		{
+			t_results.push_back(node.UserData);
+			continue;
+		}
+
+		// Push the further child first so the nearer one is visited next
+		float entry1 = RayEntry(nodes[node.Child1].Min, nodes[node.Child1].Max, t_origin, inverseDirection, t_max_distance);
+		float entry2 = RayEntry(nodes[node.Child2].Min, nodes[node.Child2].Max, t_origin, inverseDirection, t_max_distance);
+		bool firstIsNearer = entry2 < 0.0f || (entry1 >= 0.0f && entry1 <= entry2);
+		unsigned int nearChild = firstIsNearer ? node.Child1 : node.Child2;
+		unsigned int farChild = firstIsNearer ? node.Child2 : node.Child1;
+		float nearEntry = firstIsNearer ? entry1 : entry2;
+		float farEntry = firstIsNearer ? entry2 : entry1;
+
+		if (farEntry >= 0.0f)
+		{
+			stack.push_back(farChild);
+		}
+		if (nearEntry >= 0.0f)
+		{
+			stack.push_back(nearChild);
+		}
+	}
+}
+
+size_t DynamicAABBTree::GetProxyCount() const
+{
+	return proxyCount;
+}
+
+int DynamicAABBTree::GetHeight() const
+{
+	return root == NullProxy ? 0 : nodes[root].Height + 1;
+}
+
+float DynamicAABBTree::GetAreaRatio() const
+{
+	if (root == NullProxy)
+	{
+		return 0.0f;
+	}
+
+	float rootArea = SurfaceArea(nodes[root].Min, nodes[root].Max);
+	float totalArea = 0.0f;
+	for (const Node& node : nodes)
+	{
+		if (node.Height > 0)
+		{
+			totalArea += SurfaceArea(node.Min, node.Max);
+		}
+	}
+	return rootArea > 0.0f ? totalArea / rootArea : 0.0f;
+}
+
+unsigned int DynamicAABBTree::AllocateNode()
+{
+	unsigned int index;
+	if (freeList == NullProxy)
+	{
+		index = (unsigned int)nodes.size();
+		nodes.push_back(Node());
+	}
+	else
+	{
+		index = freeList;
+		freeList = nodes[index].Parent;
+	}
+
+	Node& node = nodes[index];
+	node.Parent = NullProxy;
+	node.Child1 = NullProxy;
+	node.Child2 = NullProxy;
+	node.Height = 0;
+	node.UserData = 0;
+	return index;
+}
+
+void DynamicAABBTree::FreeNode(unsigned int t_node)
+{
+	nodes[t_node].Parent = freeList;
+	nodes[t_node].Height = -1;
+	freeList = t_node;
+}
+
+void DynamicAABBTree::InsertLeaf(unsigned int t_leaf)
+{
+	if (root == NullProxy)
+	{
+		root = t_leaf;
+		nodes[root].Parent = NullProxy;
+		return;
+	}
+
+	// Walk down towards the sibling that makes the tree grow the least. Every
+	// node passed on the way grows too, which is the inherited cost.
+	XMFLOAT3 leafMin = nodes[t_leaf].Min;
+	XMFLOAT3 leafMax = nodes[t_leaf].Max;
+	unsigned int index = root;
+	while (nodes[index].Height > 0)
+	{
+		const Node& node = nodes[index];
+		float area = SurfaceArea(node.Min, node.Max);
+		float combinedArea = CombinedArea(node.Min, node.Max, leafMin, leafMax);
+
+		// Cost of pairing the leaf with this node
+		float cost = 2.0f * combinedArea;
+		float inheritedCost = 2.0f * (combinedArea - area);
+
+		// Cost of going further down either side
+		float childCosts[2];
+		unsigned int children[2] = { node.Child1, node.Child2 };
+		for (int c = 0; c < 2; ++c)
+		{
+			const Node& child = nodes[children[c]];
+			float childCombined = CombinedArea(child.Min, child.Max, leafMin, leafMax);
+			childCosts[c] = (child.Height == 0 ? childCombined : childCombined - SurfaceArea(child.Min, child.Max)) + inheritedCost;
+		}
+
+		if (cost < childCosts[0] && cost < childCosts[1])
+		{
+			break;
+		}
+		index = childCosts[0] < childCosts[1] ? children[0] : children[1];
+	}
+
+	unsigned int sibling = index;
+	unsigned int oldParent = nodes[sibling].Parent;
+	unsigned int newParent = AllocateNode();
+
+	Node& parentNode = nodes[newParent];
+	parentNode.Parent = oldParent;
+	parentNode.Child1 = sibling;
+	parentNode.Child2 = t_leaf;
+	Combine(leafMin, leafMax, nodes[sibling].Min, nodes[sibling].Max, parentNode.Min, parentNode.Max);
+	parentNode.Height = nodes[sibling].Height + 1;
+
+	if (oldParent == NullProxy)
+	{
+		root = newParent;
+	}
+	else if (nodes[oldParent].Child1 == sibling)
+	{
+		nodes[oldParent].Child1 = newParent;
+	}
+	else
+	{
+		nodes[oldParent].Child2 = newParent;
+	}
+	nodes[sibling].Parent = newParent;
+	nodes[t_leaf].Parent = newParent;
+
+	Refit(oldParent);
+}
+
+void DynamicAABBTree::RemoveLeaf(unsigned int t_leaf)
+{
+	if (t_leaf == root)
+	{
+		root = NullProxy;
+		return;
+	}
+
+	// The leaf's parent goes too, and the sibling takes its place
+	unsigned int parent = nodes[t_leaf].Parent;
+	unsigned int grandParent = nodes[parent].Parent;
+	unsigned int sibling = nodes[parent].Child1 == t_leaf ? nodes[parent].Child2 : nodes[parent].Child1;
+
+	nodes[sibling].Parent = grandParent;
+	if (grandParent == NullProxy)
+	{
+		root = sibling;
+	}
+	else
+	{
+		if (nodes[grandParent].Child1 == parent)
+		{
+			nodes[grandParent].Child1 = sibling;
+		}
+		else
+		{
+			nodes[grandParent].Child2 = sibling;
+		}
+	}
+
+	FreeNode(parent);
+	nodes[t_leaf].Parent = NullProxy;
+	Refit(grandParent);
+}
+
+void DynamicAABBTree::Refit(unsigned int t_node)
+{
+	unsigned int index = t_node;
+	while (index != NullProxy)
+	{
+		Node& node = nodes[index];
+		XMFLOAT3 oldMin = node.Min;
+		XMFLOAT3 oldMax = node.Max;
+		int oldHeight = node.Height;
+
+		UpdateNode(index);
+		Rotate(index);
+
+		// Nothing above can change if this node did not
+		if (Equals(oldMin, node.Min) && Equals(oldMax, node.Max) && oldHeight == node.Height)
+		{
+			break;
+		}
+		index = node.Parent;
+	}
+}
+
+void DynamicAABBTree::UpdateNode(unsigned int t_node)
+{
+	Node& node = nodes[t_node];
+	const Node& child1 = nodes[node.Child1];
+	const Node& child2 = nodes[node.Child2];
+	Combine(child1.Min, child1.Max, child2.Min, child2.Max, node.Min, node.Max);
+	node.Height = 1 + (std::max)(child1.Height, child2.Height);
+}
+
+bool DynamicAABBTree::Rotate(unsigned int t_node)
+{
+	// A node's own box holds the same leaves whatever is swapped below it,
+	// so only the area of the child that changes matters
+	Node& node = nodes[t_node];
+	unsigned int children[2] = { node.Child1, node.Child2 };
+
+	float bestGain = 0.0f;
+	int bestChild = -1;				// Child that moves down
+	unsigned int bestGrandChild = NullProxy;
+
+	for (int c = 0; c < 2; ++c)
+	{
+		unsigned int moving = children[c];
+		const Node& other = nodes[children[1 - c]];
+		if (other.Height == 0)
+		{
+			continue;
+		}
+
+		const Node& movingNode = nodes[moving];
+		float otherArea = SurfaceArea(other.Min, other.Max);
+		unsigned int grandChildren[2] = { other.Child1, other.Child2 };
+		for (int g = 0; g < 2; ++g)
+		{
+			// Swapping moving with grandChildren[g] leaves the other pairing with grandChildren[1 - g]
+			const Node& staying = nodes[grandChildren[1 - g]];
+			float gain = otherArea - CombinedArea(movingNode.Min, movingNode.Max, staying.Min, staying.Max);
+			if (gain > bestGain)
+			{
+				bestGain = gain;
+				bestChild = c;
+				bestGrandChild = grandChildren[g];
+			}
+		}
+	}
+
+	if (bestChild < 0)
+	{
+		return false;
+	}
+
+	unsigned int moving = children[bestChild];
+	unsigned int other = children[1 - bestChild];
+
+	if (bestChild == 0)
+	{
+		node.Child1 = bestGrandChild;
+	}
+	else
+	{
+		node.Child2 = bestGrandChild;
+	}
+	nodes[bestGrandChild].Parent = t_node;
+
+	if (nodes[other].Child1 == bestGrandChild)
+	{
+		nodes[other].Child1 = moving;
+	}
+	else
+	{
+		nodes[other].Child2 = moving;
+	}
+	nodes[moving].Parent = other;
+
+	UpdateNode(other);
+	node.Height = 1 + (std::max)(nodes[node.Child1].Height, nodes[node.Child2].Height);
+	return true;
+}
+
+void DynamicAABBTree::AddSubtree(unsigned int t_node, std::vector<unsigned int>& t_results) const
+{
+	if (nodes[t_node].Height == 0)
+	{
+		t_results.push_back(nodes[t_node].UserData);
+		return;
+	}
+
+	std::vector<unsigned int> stack;
+	stack.reserve(InitialStackSize);
+	stack.push_back(t_node);
+	while (!stack.empty())
+	{
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+
+		if (node.Height == 0)
+		{
+			t_results.push_back(node.UserData);
+		}
+		else
+		{
+			stack.push_back(node.Child1);
+			stack.push_back(node.Child2);
+		}
+	}
+}
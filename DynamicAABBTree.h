@@ -0,0 +1,106 @@
+#pragma once
+#include <DirectXMath.h>
+#include <climits>
+#include <vector>
+
+// Bounding volume hierarchy over objects that move, add and remove themselves
+// at any time, such as the world bounds of every Entity in a scene.
+//
+// Each object is a proxy: a leaf holding its box grown by a margin, so small
+// movements cost nothing. A move that leaves the grown box refits the leaf's
+// ancestors instead of rebuilding anything, and every refitted node tries a
+// tree rotation that lowers the total surface area, so the tree stays good
+// while objects drift. Optimize() applies the same rotations to a few nodes
+// at a time to tidy up after many moves.
+//
+// Queries test whole subtrees at once: anything outside a node's box is
+// skipped, and everything inside a box that lies fully within the query is
+// reported without testing it further.
+class DynamicAABBTree
+{
+public:
+	static const unsigned int NullProxy = UINT_MAX;
+
+	// Set how far boxes are grown on each side, so short moves need no update.
+	void SetMargin(float t_margin);
+	float GetMargin() const;
+
+	// Add an object and get the proxy to refer to it by. t_user_data is what queries report for it.
+	unsigned int CreateProxy(const DirectX::XMFLOAT3& t_min, const DirectX::XMFLOAT3& t_max, unsigned int t_user_data);
+
+	// Remove an object.
+	void DestroyProxy(unsigned int t_proxy);
+
+	// Give an object new bounds. Returns false if they still fit its grown box, so nothing changed.
+	bool MoveProxy(unsigned int t_proxy, const DirectX::XMFLOAT3& t_min, const DirectX::XMFLOAT3& t_max);
+
+	// Get what was passed to CreateProxy for an object, and its grown box.
+	unsigned int GetUserData(unsigned int t_proxy) const;
+	void GetFatBounds(unsigned int t_proxy, DirectX::XMFLOAT3& t_min, DirectX::XMFLOAT3& t_max) const;
+
+	// Try rotations at up to t_node_count nodes, continuing where the last call stopped.
+	void Optimize(unsigned int t_node_count);
+
+	// Append the user data of every object whose grown box touches the frustum.
+	// Planes are as FrustumCuller::ExtractPlanes makes them.
+	void QueryFrustum(const DirectX::XMFLOAT4 t_planes[6], std::vector<unsigned int>& t_results) const;
+
+	// Append the user data of every object whose grown box touches the sphere.
+	void QuerySphere(const DirectX::XMFLOAT3& t_center, float t_radius, std::vector<unsigned int>& t_results) const;
+
+	// Append the user data of every object whose grown box overlaps the box.
+	void QueryAABB(const DirectX::XMFLOAT3& t_min, const DirectX::XMFLOAT3& t_max, std::vector<unsigned int>& t_results) const;
+
+	// Append the user data of every object whose grown box the ray hits within t_max_distance,
+	// nearer subtrees first. t_direction need not be normalized; distances are in its units.
+	void QueryRay(const DirectX::XMFLOAT3& t_origin, const DirectX::XMFLOAT3& t_direction, float t_max_distance, std::vector<unsigned int>& t_results) const;
+
+	// Get number of objects.
+	size_t GetProxyCount() const;
+
+	// Get number of levels (0 if empty).
+	int GetHeight() const;
+
+	// Get summed surface area of all interior nodes over that of the root.
+	// Lower is better; queries get slower as it grows.
+	float GetAreaRatio() const;
+
+private:
+	struct Node
+	{
+		DirectX::XMFLOAT3 Min;
+		unsigned int Parent;		// Next free node while on the free list
+		DirectX::XMFLOAT3 Max;
+		unsigned int Child1;		// NullProxy for leaves
+		unsigned int Child2;
+		int Height;					// 0 for leaves, -1 while free
+		unsigned int UserData;
+	};
+
+	unsigned int AllocateNode();
+	void FreeNode(unsigned int t_node);
+
+	// Link a leaf in next to the sibling that adds the least surface area.
+	void InsertLeaf(unsigned int t_leaf);
+	void RemoveLeaf(unsigned int t_leaf);
+
+	// Recompute boxes from t_node up to the root, rotating on the way,
+	// until a node comes out the same as it was.
+	void Refit(unsigned int t_node);
+
+	// Recompute a node's box and height from its children.
+	void UpdateNode(unsigned int t_node);
+
+	// Swap a child of t_node with a grandchild if that shrinks the tree. Returns true if it did.
+	bool Rotate(unsigned int t_node);
+
+	// Append the user data of every leaf under t_node.
+	void AddSubtree(unsigned int t_node, std::vector<unsigned int>& t_results) const;
+
+	std::vector<Node> nodes;
+	unsigned int root = NullProxy;
+	unsigned int freeList = NullProxy;
+	unsigned int optimizeCursor = 0;
+	size_t proxyCount = 0;
+	float margin = 0.1f;
+};
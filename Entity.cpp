@@ -1,11 +1,26 @@
 #include "Entity.h"
 #include "Material.h"
+#include "Mesh.h"
 #include "SimpleShader.h"
+#include <cassert>
 
 struct ID3D11SamplerState;
 struct ID3D11ShaderResourceView;
 using namespace DirectX;
 
+namespace
+{
+	// Shader variable names, hashed at compile time for the shaders' handle lookups
+	constexpr unsigned int world_name = SimpleHashName("world");
+	constexpr unsigned int world_inverse_transpose_name = SimpleHashName("worldInverseTranspose");
+	constexpr unsigned int view_name = SimpleHashName("view");
+	constexpr unsigned int projection_name = SimpleHashName("projection");
+	constexpr unsigned int color_tint_name = SimpleHashName("ColorTint");
+}
+
+std::atomic<unsigned int> Entity::world_matrix_requests(0);
+std::atomic<unsigned int> Entity::world_matrix_recomputes(0);
+
 Entity::Entity(Mesh* t_mesh, Material* t_material) : 
 	entity_mesh(t_mesh),
 	entity_material(t_material),
@@ -13,6 +28,7 @@ Entity::Entity(Mesh* t_mesh, Material* t_material) :
 	scale(XMFLOAT3(1.0f, 1.0f, 1.0f)),
 	rotation(XMFLOAT4())
 {
+	XMStoreFloat4x4(&parent_world_matrix, XMMatrixIdentity());
 }
 
 Entity::Entity(const Entity& t_rhs)
@@ -21,19 +37,29 @@ Entity::Entity(const Entity& t_rhs)
 	scale = t_rhs.scale;
 	rotation = t_rhs.rotation;
 	entity_mesh = t_rhs.entity_mesh;
+	entity_material = t_rhs.entity_material;
+	occluder = t_rhs.occluder;
+
+	// Copies start outside of any SceneGraph
+	XMStoreFloat4x4(&parent_world_matrix, XMMatrixIdentity());
+
+	// The copy is new as far as the renderer is concerned
+	SetChangeList(t_rhs.change_list);
 }
 
 void Entity::MoveRelative(const float& t_X, const float& t_Y, const float& t_Z)
 {
 	XMVECTOR direction = XMVector3Rotate(XMVectorSet(t_X, t_Y, t_Z, 0), XMLoadFloat4(&rotation));
 	XMStoreFloat3(&position, XMLoadFloat3(&position) + direction);
+	MarkDirty();
 }
 
 void Entity::MoveAbsolute(const float& t_X, const float& t_Y, const float& t_Z)
 {
 	position.x += t_X;
 	position.y += t_Y;
-	position.z += t_Y;
+	position.z += t_Z;
+	MarkDirty();
 }
 
 Mesh* Entity::GetEntityMesh() const
@@ -55,12 +81,14 @@ void Entity::SetPosition(const float& t_X, const float& t_Y, const float& t_Z)
 {
 	position.x = t_X;
 	position.y = t_Y;
-	position.z = t_Y;
+	position.z = t_Z;
+	MarkDirty();
 }
 
 void Entity::SetPosition(const DirectX::XMFLOAT3& t_position)
 {
 	position = t_position;
+	MarkDirty();
 }
 
 const DirectX::XMFLOAT3& Entity::GetScale() const
@@ -73,6 +101,7 @@ void Entity::SetScale(const float& t_X, const float& t_Y, const float& t_Z)
 	scale.x = t_X;
 	scale.y = t_Y;
 	scale.z = t_Z;
+	MarkDirty();
 }
 
 const DirectX::XMFLOAT4& Entity::GetRotation() const
@@ -83,18 +112,127 @@ const DirectX::XMFLOAT4& Entity::GetRotation() const
 void Entity::SetRotation(const DirectX::XMFLOAT4& t_rotation)
 {
 	rotation = t_rotation;
+	MarkDirty();
 }
 
-DirectX::XMFLOAT4X4 Entity::GetWorldMatrix()
+Entity* Entity::GetParent() const
 {
-	XMMATRIX scaleMatrix = XMMatrixScaling(scale.x, scale.y, scale.z);
-	XMMATRIX rotationMatrix = XMMatrixRotationRollPitchYaw(rotation.x, rotation.y, rotation.z);
-	XMMATRIX positionMatrix = XMMatrixTranslation(position.x, position.y, position.z);
+	return parent;
+}
+
+const DirectX::XMFLOAT4X4& Entity::GetWorldMatrix()
+{
+	UpdateWorldMatrix();
+	return world_matrix;
+}
+
+const DirectX::XMFLOAT4X4& Entity::GetWorldInverseTransposeMatrix()
+{
+	UpdateWorldMatrix();
+	return world_inverse_transpose_matrix;
+}
+
+void Entity::GetWorldBounds(XMFLOAT3& t_min, XMFLOAT3& t_max)
+{
+	UpdateWorldMatrix();
+	GetCachedWorldBounds(t_min, t_max);
+}
+
+const DirectX::XMFLOAT4X4& Entity::GetCachedWorldMatrix() const
+{
+	assert(!world_dirty);
+	return world_matrix;
+}
+
+const DirectX::XMFLOAT4X4& Entity::GetCachedWorldInverseTransposeMatrix() const
+{
+	assert(!world_dirty);
+	return world_inverse_transpose_matrix;
+}
+
+void Entity::GetCachedWorldBounds(XMFLOAT3& t_min, XMFLOAT3& t_max) const
+{
+	assert(!world_dirty);
 
-	XMMATRIX world_matrix = scaleMatrix * rotationMatrix * positionMatrix;
-	XMFLOAT4X4 world4x4;
-	XMStoreFloat4x4(&world4x4, XMMatrixTranspose(world_matrix));
-	return world4x4;
+	XMVECTOR localMin = XMLoadFloat3(&entity_mesh->GetBoundsMin());
+	XMVECTOR localMax = XMLoadFloat3(&entity_mesh->GetBoundsMax());
+	XMVECTOR center = (localMin + localMax) * 0.5f;
+	XMVECTOR extents = (localMax - localMin) * 0.5f;
+
+	// Every local axis adds its absolute reach along each world axis
+	XMMATRIX world = XMMatrixTranspose(XMLoadFloat4x4(&world_matrix));
+	XMVECTOR worldCenter = XMVector3Transform(center, world);
+	XMVECTOR worldExtents = XMVectorAbs(world.r[0]) * XMVectorSplatX(extents)
+		+ XMVectorAbs(world.r[1]) * XMVectorSplatY(extents)
+		+ XMVectorAbs(world.r[2]) * XMVectorSplatZ(extents);
+
+	XMStoreFloat3(&t_min, worldCenter - worldExtents);
+	XMStoreFloat3(&t_max, worldCenter + worldExtents);
+}
+
+unsigned int Entity::GetBoundsProxy() const
+{
+	return bounds_proxy;
+}
+
+void Entity::SetBoundsProxy(unsigned int t_proxy)
+{
+	bounds_proxy = t_proxy;
+}
+
+unsigned int Entity::GetOverlapProxy() const
+{
+	return overlap_proxy;
+}
+
+void Entity::SetOverlapProxy(unsigned int t_proxy)
+{
+	overlap_proxy = t_proxy;
+}
+
+bool Entity::IsOccluder() const
+{
+	return occluder;
+}
+
+void Entity::SetOccluder(bool t_occluder)
+{
+	occluder = t_occluder;
+}
+
+void Entity::SetChangeList(std::vector<Entity*>* t_change_list)
+{
+	change_list = t_change_list;
+	if (changed && change_list != nullptr)
+	{
+		change_list->push_back(this);
+	}
+}
+
+bool Entity::HasChanged() const
+{
+	return changed;
+}
+
+void Entity::ClearChanged()
+{
+	changed = false;
+}
+
+unsigned int Entity::GetWorldMatrixRequestCount()
+{
+	return world_matrix_requests.load(std::memory_order_relaxed);
+}
+
+unsigned int Entity::GetWorldMatrixRecomputeCount()
+{
+	return world_matrix_recomputes.load(std::memory_order_relaxed);
+}
+
+void Entity::ResetWorldMatrixCounters()
+{
+	world_matrix_requests.store(0, std::memory_order_relaxed);
+	world_matrix_recomputes.store(0, std::memory_order_relaxed);
 }
 
 void Entity::prepareMaterial(const DirectX::XMFLOAT4X4& t_view_matrix, const DirectX::XMFLOAT4X4& t_projection_matrix)
@@ -102,9 +240,11 @@ void Entity::prepareMaterial(const DirectX::XMFLOAT4X4& t_view_matrix, const Dir
 	SimpleVertexShader* vertex_shader = entity_material->getVertexShader();
 	SimplePixelShader* pixel_shader = entity_material->getPixelShader();
 
-	vertex_shader->SetMatrix4x4("world", GetWorldMatrix());
-	vertex_shader->SetMatrix4x4("view", t_view_matrix);
-	vertex_shader->SetMatrix4x4("projection", t_projection_matrix);
+	vertex_shader->SetMatrix4x4(vertex_shader->GetVariableHandle(world_name), GetWorldMatrix());
+	vertex_shader->SetMatrix4x4(vertex_shader->GetVariableHandle(world_inverse_transpose_name), GetWorldInverseTransposeMatrix());
+	vertex_shader->SetMatrix4x4(vertex_shader->GetVariableHandle(view_name), t_view_matrix);
+	vertex_shader->SetMatrix4x4(vertex_shader->GetVariableHandle(projection_name), t_projection_matrix);
+	pixel_shader->SetFloat4(pixel_shader->GetVariableHandle(color_tint_name), entity_material->getColorTint());
 
 	vertex_shader->SetShader();
 	vertex_shader->CopyAllBufferData();
@@ -112,6 +252,56 @@ void Entity::prepareMaterial(const DirectX::XMFLOAT4X4& t_view_matrix, const Dir
 	pixel_shader->CopyAllBufferData();
 }
 
+void Entity::MarkDirty()
+{
+	world_dirty = true;
+	graph_dirty = true;
+	MarkChanged();
+}
+
+void Entity::MarkChanged()
+{
+	// Only join the change list once per round of changes
+	if (!changed)
+	{
+		changed = true;
+		if (change_list != nullptr)
+		{
+			change_list->push_back(this);
+		}
+	}
+}
+
+void Entity::UpdateWorldMatrix()
+{
+	world_matrix_requests.fetch_add(1, std::memory_order_relaxed);
+	if (!world_dirty)
+	{
+		return;
+	}
+
+	world_matrix_recomputes.fetch_add(1, std::memory_order_relaxed);
+	ComputeWorldMatrix();
+}
+
+void Entity::ComputeWorldMatrix()
+{
+	world_dirty = false;
+
+	XMMATRIX scaleMatrix = XMMatrixScaling(scale.x, scale.y, scale.z);
+	XMMATRIX rotationMatrix = XMMatrixRotationRollPitchYaw(rotation.x, rotation.y, rotation.z);
+	XMMATRIX positionMatrix = XMMatrixTranslation(position.x, position.y, position.z);
+	XMMATRIX worldMatrix = scaleMatrix * rotationMatrix * positionMatrix;
+	if (parent != nullptr)
+	{
+		worldMatrix = worldMatrix * XMLoadFloat4x4(&parent_world_matrix);
+	}
+	XMStoreFloat4x4(&world_matrix, XMMatrixTranspose(worldMatrix));
+
+	// transpose(transpose(inverse(World))) is just inverse(World)
+	XMStoreFloat4x4(&world_inverse_transpose_matrix, XMMatrixInverse(nullptr, worldMatrix));
+}
+
 Entity::~Entity()
 {
 	entity_mesh = nullptr;
@@ -1,5 +1,8 @@
 #pragma once
 #include <DirectXMath.h>
+#include <atomic>
+#include <climits>
+#include <vector>
 
 // Forward Declaration of Mesh Class.
 class Mesh;
@@ -47,16 +50,77 @@ public:
 	// Set this Entity's current Rotation.
 	void SetRotation(const DirectX::XMFLOAT4& t_rotation);
 
-	// Get World matrix for this Entity;
-	DirectX::XMFLOAT4X4 GetWorldMatrix();
+	// Get this Entity's parent in its SceneGraph (nullptr for roots).
+	Entity* GetParent() const;
+
+	// Get World matrix for this Entity (transposed for HLSL). Only recomputed after the transform changes.
+	// For children this uses the parent's World matrix from the last SceneGraph update.
+	const DirectX::XMFLOAT4X4& GetWorldMatrix();
+
+	// Get inverse-transpose of the World matrix for transforming normals (also transposed for HLSL).
+	const DirectX::XMFLOAT4X4& GetWorldInverseTransposeMatrix();
+
+	// Get the World space box around this Entity's Mesh.
+	void GetWorldBounds(DirectX::XMFLOAT3& t_min, DirectX::XMFLOAT3& t_max);
+
+	// Const versions of the three above, which read the cached matrices without
+	// recomputing them, so several threads can call them at once. The cache
+	// must already be up to date, e.g. from SceneGraph::UpdateWorldMatrices().
+	const DirectX::XMFLOAT4X4& GetCachedWorldMatrix() const;
+	const DirectX::XMFLOAT4X4& GetCachedWorldInverseTransposeMatrix() const;
+	void GetCachedWorldBounds(DirectX::XMFLOAT3& t_min, DirectX::XMFLOAT3& t_max) const;
+
+	// Get/Set this Entity's proxy in a DynamicAABBTree (UINT_MAX if it has none).
+	unsigned int GetBoundsProxy() const;
+	void SetBoundsProxy(unsigned int t_proxy);
+
+	// Get/Set this Entity's proxy in a SweepAndPrune (UINT_MAX if it has none).
+	unsigned int GetOverlapProxy() const;
+	void SetOverlapProxy(unsigned int t_proxy);
+
+	// Get/Set whether this Entity hides what is behind it well enough to be drawn into the occlusion buffer.
+	bool IsOccluder() const;
+	void SetOccluder(bool t_occluder);
+
+	// Give this Entity a list to add itself to whenever its transform first changes.
+	void SetChangeList(std::vector<Entity*>* t_change_list);
+
+	// Has the transform changed since the last call to ClearChanged()?
+	bool HasChanged() const;
+
+	// Mark this Entity's changes as handled, so it can be added to the change list again.
+	void ClearChanged();
+
+	// Get how many times a World matrix was asked for, and how many of those had to recompute it.
+	static unsigned int GetWorldMatrixRequestCount();
+	static unsigned int GetWorldMatrixRecomputeCount();
+
+	// Reset both World matrix counters to zero.
+	static void ResetWorldMatrixCounters();
 
 	// Prepare Materials and Shaders for upcoming draw() call.
 	void prepareMaterial(const DirectX::XMFLOAT4X4& t_view_matrix, const DirectX::XMFLOAT4X4& t_projection_matrix);
 	
-	// Destructor for Entity (Virtual)
-	virtual ~Entity();
+	// Destructor for Entity
+	~Entity();
 
 private:
+	// SceneGraph owns the hierarchy and pushes parent matrices down.
+	friend class SceneGraph;
+
+	// Flag the cached matrices as stale and report the change.
+	void MarkDirty();
+
+	// Report a change without touching the cached matrices.
+	void MarkChanged();
+
+	// Recompute the cached matrices if they are stale.
+	void UpdateWorldMatrix();
+
+	// Recompute the cached matrices unconditionally. Touches nothing shared,
+	// so different entities can be computed on different threads.
+	void ComputeWorldMatrix();
+
 	// Pointer to Entity's Mesh Object.
 	Mesh* entity_mesh = nullptr;
 
@@ -71,4 +135,40 @@ private:
 
 	// Current Rotation of this Entity.
 	DirectX::XMFLOAT4 rotation;
+
+	// Cached World and inverse-transpose World matrices.
+	DirectX::XMFLOAT4X4 world_matrix;
+	DirectX::XMFLOAT4X4 world_inverse_transpose_matrix;
+
+	// Parent in the SceneGraph, its World matrix (not transposed) and our node there.
+	Entity* parent = nullptr;
+	DirectX::XMFLOAT4X4 parent_world_matrix;
+	unsigned int scene_node = UINT_MAX;
+
+	// Proxy in the scene's DynamicAABBTree (not copied).
+	unsigned int bounds_proxy = UINT_MAX;
+
+	// Proxy in the scene's SweepAndPrune (not copied).
+	unsigned int overlap_proxy = UINT_MAX;
+
+	// Is this Entity drawn into the occlusion buffer?
+	bool occluder = false;
+
+	// Do the cached matrices need recomputing?
+	bool world_dirty = true;
+
+	// Has the transform changed since the SceneGraph last pushed it to the children?
+	bool graph_dirty = true;
+
+	// Has this Entity changed since the last ClearChanged()?
+	bool changed = true;
+
+	// List this Entity adds itself to when it changes (not owned).
+	std::vector<Entity*>* change_list = nullptr;
+
+	// World matrix cache counters, shared by all entities. Atomic, since
+	// entities are updated from the job system's threads; relaxed, since
+	// they are only statistics.
+	static std::atomic<unsigned int> world_matrix_requests;
+	static std::atomic<unsigned int> world_matrix_recomputes;
 };
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "FrameLimiter.h"
+#include <cmath>
+#include <thread>
+
+namespace
+{
+	// Weight of the newest sample in the overshoot estimate
+	const double OvershootWeight = 0.1;
+
+	// Overshoot assumed before anything has been measured
+	const double InitialOvershoot = 0.001;
+
+	// Standard deviations of margin on top of the mean overshoot
+	const double OvershootMargin = 2.0;
+
+	double SecondsBetween(FrameLimiter::Clock::time_point t_start, FrameLimiter::Clock::time_point t_end)
+	{
+		return std::chrono::duration<double>(t_end - t_start).count();
+	}
+}
+
+FrameLimiter::FrameLimiter() :
+	targetPeriod(0.0),
+	started(false),
+	overshootMean(InitialOvershoot),
+	overshootVariance(0.0)
+{
+	ResetStats();
+}
+
+void FrameLimiter::SetTargetFrameRate(float t_frames_per_second)
+{
+	targetPeriod = t_frames_per_second > 0.0f ? 1.0 / t_frames_per_second : 0.0;
+	started = false;
+}
+
+float FrameLimiter::GetTargetFrameRate() const
+{
+	return targetPeriod > 0.0 ? (float)(1.0 / targetPeriod) : 0.0f;
+}
+
+void FrameLimiter::WaitForNextFrame()
+{
+	if (targetPeriod <= 0.0)
+	{
+		return;
+	}
+
+	Clock::time_point now = Clock::now();
+	if (!started)
+	{
+		// First frame: nothing to wait for yet
+		started = true;
+		lastFrameEnd = now;
+		deadline = now + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(targetPeriod));
+		return;
+	}
+
+	if (now >= deadline)
+	{
+		++lateFrameCount;
+	}
+
+	// Sleep while there is clearly enough time left for the sleep to come back late
+	double sleepMargin = overshootMean + OvershootMargin * sqrt(overshootVariance);
+	double remaining = SecondsBetween(now, deadline);
+	while (remaining > sleepMargin)
+	{
+		double requested = remaining - sleepMargin;
+		std::this_thread::sleep_for(std::chrono::duration<double>(requested));
+
+		Clock::time_point woke = Clock::now();
+		AddOvershootSample(SecondsBetween(now, woke) - requested);
+		sleepMargin = overshootMean + OvershootMargin * sqrt(overshootVariance);
+		now = woke;
+		remaining = SecondsBetween(now, deadline);
+	}
+
+	// Spin off the last bit
+	while (Clock::now() < deadline)
+	{
+		std::this_thread::yield();
+	}
+
+	now = Clock::now();
+	double frameTime = SecondsBetween(lastFrameEnd, now);
+	lastFrameEnd = now;
+
+	++frameCount;
+	frameTimeSum += frameTime;
+	frameTimeSquaredSum += frameTime * frameTime;
+	worstDeviation = fmax(worstDeviation, fabs(frameTime - targetPeriod));
+
+	// Next deadline is one period on, unless this frame ran so late that
+	// catching up would mean a burst of unlimited frames
+	Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(targetPeriod));
+	deadline += period;
+	if (deadline <= now)
+	{
+		deadline = now + period;
+	}
+}
+
+float FrameLimiter::GetSleepOvershootMilliseconds() const
+{
+	return (float)(overshootMean * 1000.0);
+}
+
+uint64_t FrameLimiter::GetFrameCount() const
+{
+	return frameCount;
+}
+
+float FrameLimiter::GetAverageFrameMilliseconds() const
+{
+	return frameCount > 0 ? (float)(frameTimeSum / frameCount * 1000.0) : 0.0f;
+}
+
+float FrameLimiter::GetJitterMilliseconds() const
+{
+	if (frameCount < 2)
+	{
+		return 0.0f;
+	}
+
+	double mean = frameTimeSum / frameCount;
+	double variance = fmax(frameTimeSquaredSum / frameCount - mean * mean, 0.0);
+	return (float)(sqrt(variance) * 1000.0);
+}
+
+float FrameLimiter::GetWorstDeviationMilliseconds() const
+{
+	return (float)(worstDeviation * 1000.0);
+}
+
+uint64_t FrameLimiter::GetLateFrameCount() const
+{
+	return lateFrameCount;
+}
+
+void FrameLimiter::ResetStats()
+{
+	frameCount = 0;
+	lateFrameCount = 0;
+	frameTimeSum = 0.0;
+	frameTimeSquaredSum = 0.0;
+	worstDeviation = 0.0;
+}
+
+void FrameLimiter::AddOvershootSample(double t_seconds)
+{
+	double difference = t_seconds - overshootMean;
+	overshootMean += OvershootWeight * difference;
+	overshootVariance = (1.0 - OvershootWeight) * (overshootVariance + OvershootWeight * difference * difference);
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+// Caps the frame rate without burning a core.
+//
+// Waiting sleeps for most of the remaining time and spins for the rest. How
+// early to stop sleeping is learned from how late past sleeps have woken up,
+// so the spin stays short on systems with a fine timer and grows on coarse
+// ones. Only std::chrono is used, so it behaves the same with or without a
+// window, vsync or Windows.
+class FrameLimiter
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	FrameLimiter();
+
+	// Set frames per second to cap at (0 = uncapped, WaitForNextFrame returns at once).
+	void SetTargetFrameRate(float t_frames_per_second);
+
+	// Get frames per second capped at (0 = uncapped).
+	float GetTargetFrameRate() const;
+
+	// Block until the current frame has used up its share of time, then start the next one.
+	// Deadlines are spaced evenly, so one late frame does not shift every frame after it.
+	void WaitForNextFrame();
+
+	// Get how long sleeps are currently expected to overshoot, in milliseconds.
+	float GetSleepOvershootMilliseconds() const;
+
+	// Get statistics of the frame times seen since the last ResetStats().
+	uint64_t GetFrameCount() const;
+	float GetAverageFrameMilliseconds() const;
+	float GetJitterMilliseconds() const;			// Standard deviation of the frame time
+	float GetWorstDeviationMilliseconds() const;	// Largest distance from the target frame time
+	uint64_t GetLateFrameCount() const;				// Frames that were already late when they started waiting
+	void ResetStats();
+
+private:
+	// Feed one observed oversleep into the overshoot estimate.
+	void AddOvershootSample(double t_seconds);
+
+	double targetPeriod;				// Seconds per frame, 0 if uncapped
+	Clock::time_point deadline;			// When the current frame is allowed to end
+	Clock::time_point lastFrameEnd;
+	bool started;
+
+	// Running mean and variance of how late sleeps wake up, in seconds
+	double overshootMean;
+	double overshootVariance;
+
+	// Frame time statistics
+	uint64_t frameCount;
+	uint64_t lateFrameCount;
+	double frameTimeSum;
+	double frameTimeSquaredSum;
+	double worstDeviation;
+};
@@ -0,0 +1,145 @@
+#include "FramePipeline.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace
+{
+	// Spins before a waiting side starts yielding its time slice
+	const int SpinsBeforeYield = 256;
+
+	double SecondsSince(std::chrono::high_resolution_clock::time_point t_start)
+	{
+		return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - t_start).count();
+	}
+}
+
+FramePipeline::FramePipeline() :
+	writtenCount(0),
+	readCount(0),
+	stopping(false)
+{
+}
+
+void FramePipeline::SetLatency(unsigned int t_latency)
+{
+	latency = (std::min)(t_latency, MaxLatency);
+}
+
+unsigned int FramePipeline::GetLatency() const
+{
+	return latency;
+}
+
+RenderSnapshot* FramePipeline::BeginWrite()
+{
+	// Frame n reuses the snapshot of frame n - latency - 1, so that one has to be read first
+	uint64_t frame = writtenCount.load(std::memory_order_relaxed);
+	if (frame - readCount.load(std::memory_order_acquire) > latency)
+	{
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		for (int spin = 0; frame - readCount.load(std::memory_order_acquire) > latency; ++spin)
+		{
+			if (stopping.load(std::memory_order_relaxed))
+			{
+				return nullptr;
+			}
+			if (spin >= SpinsBeforeYield)
+			{
+				std::this_thread::yield();
+			}
+		}
+		writeWaitSeconds += SecondsSince(start);
+	}
+
+	if (stopping.load(std::memory_order_relaxed))
+	{
+		return nullptr;
+	}
+
+	RenderSnapshot& snapshot = GetSnapshot(frame);
+	snapshot.Frame = frame;
+	return &snapshot;
+}
+
+void FramePipeline::EndWrite()
+{
+	writtenCount.store(writtenCount.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+RenderSnapshot* FramePipeline::BeginRead()
+{
+	uint64_t frame = readCount.load(std::memory_order_relaxed);
+	if (writtenCount.load(std::memory_order_acquire) <= frame)
+	{
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		for (int spin = 0; writtenCount.load(std::memory_order_acquire) <= frame; ++spin)
+		{
+			if (stopping.load(std::memory_order_relaxed))
+			{
+				return nullptr;
+			}
+			if (spin >= SpinsBeforeYield)
+			{
+				std::this_thread::yield();
+			}
+		}
+		readWaitSeconds += SecondsSince(start);
+	}
+
+	if (stopping.load(std::memory_order_relaxed))
+	{
+		return nullptr;
+	}
+	return &GetSnapshot(frame);
+}
+
+RenderSnapshot* FramePipeline::TryBeginRead()
+{
+	uint64_t frame = readCount.load(std::memory_order_relaxed);
+	if (stopping.load(std::memory_order_relaxed) || writtenCount.load(std::memory_order_acquire) <= frame)
+	{
+		return nullptr;
+	}
+	return &GetSnapshot(frame);
+}
+
+void FramePipeline::EndRead()
+{
+	readCount.store(readCount.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void FramePipeline::Stop()
+{
+	stopping = true;
+}
+
+void FramePipeline::Restart()
+{
+	stopping = false;
+}
+
+uint64_t FramePipeline::GetWrittenCount() const
+{
+	return writtenCount.load();
+}
+
+uint64_t FramePipeline::GetReadCount() const
+{
+	return readCount.load();
+}
+
+double FramePipeline::GetWriteWaitSeconds() const
+{
+	return writeWaitSeconds;
+}
+
+double FramePipeline::GetReadWaitSeconds() const
+{
+	return readWaitSeconds;
+}
+
+RenderSnapshot& FramePipeline::GetSnapshot(uint64_t t_frame)
+{
+	return snapshots[t_frame % (latency + 1)];
+}
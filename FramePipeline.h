@@ -0,0 +1,77 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include "RenderSnapshot.h"
+
+// Hands RenderSnapshots from the simulation (Update) to the renderer (Draw).
+//
+// With a latency of N, Update may run up to N frames ahead of Draw, each
+// frame written into its own snapshot from a ring of N + 1. A latency of 0
+// means both run on one thread, Update then Draw, through a single snapshot.
+// Each side only ever blocks on the other's frame counter: writer and reader
+// never touch the same snapshot at once, so no locks are needed.
+class FramePipeline
+{
+public:
+	static const unsigned int MaxLatency = 2;
+
+	FramePipeline();
+
+	FramePipeline(const FramePipeline&) = delete;
+	FramePipeline& operator=(const FramePipeline&) = delete;
+
+	// Set how many frames Update may run ahead of Draw (clamped to MaxLatency).
+	// Only call while no frame is being written or read.
+	void SetLatency(unsigned int t_latency);
+
+	// Get how many frames Update may run ahead of Draw.
+	unsigned int GetLatency() const;
+
+	// Update: wait for a free snapshot and return it. Returns nullptr once stopped.
+	RenderSnapshot* BeginWrite();
+
+	// Update: hand the snapshot from BeginWrite() over to Draw.
+	void EndWrite();
+
+	// Draw: wait for the next finished snapshot and return it. Returns nullptr once stopped.
+	// The reader may take its contents (e.g. swap them out): the writer overwrites
+	// every field of a snapshot it reuses.
+	RenderSnapshot* BeginRead();
+
+	// Draw: like BeginRead(), but returns nullptr straight away if no snapshot is ready.
+	RenderSnapshot* TryBeginRead();
+
+	// Draw: give the snapshot from BeginRead() back to Update.
+	void EndRead();
+
+	// Make every current and future Begin call return nullptr.
+	void Stop();
+
+	// Clear a Stop() so the pipeline can be used again.
+	void Restart();
+
+	// Get number of frames written and read so far.
+	uint64_t GetWrittenCount() const;
+	uint64_t GetReadCount() const;
+
+	// Get total time each side has spent waiting on the other, in seconds.
+	double GetWriteWaitSeconds() const;
+	double GetReadWaitSeconds() const;
+
+private:
+	// Get the snapshot used by a frame.
+	RenderSnapshot& GetSnapshot(uint64_t t_frame);
+
+	RenderSnapshot snapshots[MaxLatency + 1];
+	unsigned int latency = 0;
+
+	// Each side's frame counter sits on its own cache line, next to the
+	// wait time only that side updates
+	std::atomic<uint64_t> writtenCount;
+	double writeWaitSeconds = 0.0;
+	char writerPadding[64];
+	std::atomic<uint64_t> readCount;
+	double readWaitSeconds = 0.0;
+	char readerPadding[64];
+	std::atomic<bool> stopping;
+};
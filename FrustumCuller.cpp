@@ -0,0 +1,242 @@
+#include "FrustumCuller.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// Bit i set for each lane i of t_outside that is all zeros
+	inline unsigned int GetInsideMask(FXMVECTOR t_outside)
+	{
+#if defined(_XM_SSE_INTRINSICS_)
+		return ~(unsigned int)_mm_movemask_ps(t_outside) & 0xF;
+#else
+		XMUINT4 lanes;
+		XMStoreUInt4(&lanes, t_outside);
+		return (lanes.x ? 0u : 1u) | (lanes.y ? 0u : 2u) | (lanes.z ? 0u : 4u) | (lanes.w ? 0u : 8u);
+#endif
+	}
+}
+
+void FrustumCuller::ExtractPlanes(const XMFLOAT4X4& t_view, const XMFLOAT4X4& t_projection, XMFLOAT4 t_planes[6])
+{
+	// Transposing (V * P) turns its columns into rows, which is
+	// what the planes are built from
+	XMMATRIX viewProjection = XMMatrixMultiply(XMMatrixTranspose(XMLoadFloat4x4(&t_view)), XMMatrixTranspose(XMLoadFloat4x4(&t_projection)));
+	XMMATRIX columns = XMMatrixTranspose(viewProjection);
+
+	XMVECTOR planes[6];
+	planes[0] = XMVectorAdd(columns.r[3], columns.r[0]);		// Left
+	planes[1] = XMVectorSubtract(columns.r[3], columns.r[0]);	// Right
+	planes[2] = XMVectorAdd(columns.r[3], columns.r[1]);		// Bottom
+	planes[3] = XMVectorSubtract(columns.r[3], columns.r[1]);	// Top
+	planes[4] = columns.r[2];									// Near (depth starts at 0 in D3D)
+	planes[5] = XMVectorSubtract(columns.r[3], columns.r[2]);	// Far
+
+	for (int i = 0; i < 6; ++i)
+	{
+		XMStoreFloat4(&t_planes[i], XMPlaneNormalize(planes[i]));
+	}
+}
+
+void FrustumCuller::Resize(size_t t_count)
+{
+	count = t_count;
+
+	size_t padded = (t_count + 3) & ~(size_t)3;
+	centerX.resize(padded, 0.0f);
+	centerY.resize(padded, 0.0f);
+	centerZ.resize(padded, 0.0f);
+	extentX.resize(padded, 0.0f);
+	extentY.resize(padded, 0.0f);
+	extentZ.resize(padded, 0.0f);
+	radius.resize(padded, 0.0f);
+}
+
+size_t FrustumCuller::GetCount() const
+{
+	return count;
+}
+
+void FrustumCuller::SetBox(size_t t_index, const XMFLOAT3& t_center, const XMFLOAT3& t_extents)
+{
+	centerX[t_index] = t_center.x;
+	centerY[t_index] = t_center.y;
+	centerZ[t_index] = t_center.z;
+	extentX[t_index] = t_extents.x;
+	extentY[t_index] = t_extents.y;
+	extentZ[t_index] = t_extents.z;
+	radius[t_index] = sqrtf(t_extents.x * t_extents.x + t_extents.y * t_extents.y + t_extents.z * t_extents.z);
+}
+
+void FrustumCuller::SetBounds(size_t t_index, const XMFLOAT3& t_local_min, const XMFLOAT3& t_local_max, const XMFLOAT4X4& t_world)
+{
+	XMMATRIX world = XMMatrixTranspose(XMLoadFloat4x4(&t_world));
+	XMVECTOR localMin = XMLoadFloat3(&t_local_min);
+	XMVECTOR localMax = XMLoadFloat3(&t_local_max);
+	XMVECTOR half = XMVectorReplicate(0.5f);
+	XMVECTOR localCenter = XMVectorMultiply(XMVectorAdd(localMin, localMax), half);
+	XMVECTOR localExtents = XMVectorMultiply(XMVectorSubtract(localMax, localMin), half);
+
+	// The world box has to hold the rotated local box, so each axis
+	// picks up the absolute contribution of every local axis
+	XMVECTOR worldCenter = XMVector3Transform(localCenter, world);
+	XMVECTOR worldExtents = XMVectorMultiply(XMVectorAbs(world.r[0]), XMVectorSplatX(localExtents));
+	worldExtents = XMVectorMultiplyAdd(XMVectorAbs(world.r[1]), XMVectorSplatY(localExtents), worldExtents);
+	worldExtents = XMVectorMultiplyAdd(XMVectorAbs(world.r[2]), XMVectorSplatZ(localExtents), worldExtents);
+
+	// The sphere only grows with the largest scale, not with rotation
+	float scale = (std::max)((std::max)(XMVectorGetX(XMVector3Length(world.r[0])), XMVectorGetX(XMVector3Length(world.r[1]))), XMVectorGetX(XMVector3Length(world.r[2])));
+
+	XMFLOAT3 center;
+	XMFLOAT3 extents;
+	XMStoreFloat3(&center, worldCenter);
+	XMStoreFloat3(&extents, worldExtents);
+
+	centerX[t_index] = center.x;
+	centerY[t_index] = center.y;
+	centerZ[t_index] = center.z;
+	extentX[t_index] = extents.x;
+	extentY[t_index] = extents.y;
+	extentZ[t_index] = extents.z;
+	radius[t_index] = XMVectorGetX(XMVector3Length(localExtents)) * scale;
+}
+
+void FrustumCuller::Cull(const XMFLOAT4 t_planes[6], BoundsType t_type, std::vector<unsigned int>& t_visible)
+{
+	// Room for everything, so each chunk can write its results in place
+	t_visible.resize(count);
+
+	if (!parallel || count <= ChunkSize)
+	{
+		visibleCount = CullRange(t_planes, t_type, 0, count, t_visible.data());
+		t_visible.resize(visibleCount);
+		return;
+	}
+
+	size_t chunkCount = (count + ChunkSize - 1) / ChunkSize;
+	std::vector<size_t> chunkVisible(chunkCount);
+	auto cullChunk = [&](size_t t_chunk)
+	{
+		size_t begin = t_chunk * ChunkSize;
+		size_t end = (std::min)(begin + ChunkSize, count);
+		chunkVisible[t_chunk] = CullRange(t_planes, t_type, begin, end, &t_visible[begin]);
+	};
+	JobSystem::GetInstance().ParallelFor(chunkCount, 1, cullChunk);
+
+	// Close the gaps between chunks
+	visibleCount = chunkVisible[0];
+	for (size_t chunk = 1; chunk < chunkCount; ++chunk)
+	{
+		std::vector<unsigned int>::iterator first = t_visible.begin() + chunk * ChunkSize;
+		std::copy(first, first + chunkVisible[chunk], t_visible.begin() + visibleCount);
+		visibleCount += chunkVisible[chunk];
+	}
+	t_visible.resize(visibleCount);
+}
+
+void FrustumCuller::CullScalar(const XMFLOAT4 t_planes[6], BoundsType t_type, std::vector<unsigned int>& t_visible)
+{
+	t_visible.clear();
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		bool inside = true;
+		for (int p = 0; p < 6 && inside; ++p)
+		{
+			const XMFLOAT4& plane = t_planes[p];
+			float distance = plane.x * centerX[i] + plane.y * centerY[i] + plane.z * centerZ[i] + plane.w;
+			float reach = t_type == Spheres ? radius[i] :
+				fabsf(plane.x) * extentX[i] + fabsf(plane.y) * extentY[i] + fabsf(plane.z) * extentZ[i];
+			inside = distance + reach >= 0.0f;
+		}
+
+		if (inside)
+		{
+			t_visible.push_back((unsigned int)i);
+		}
+	}
+
+	visibleCount = t_visible.size();
+}
+
+void FrustumCuller::SetParallel(bool t_parallel)
+{
+	parallel = t_parallel;
+}
+
+size_t FrustumCuller::GetVisibleCount() const
+{
+	return visibleCount;
+}
+
+size_t FrustumCuller::GetCulledCount() const
+{
+	return count - visibleCount;
+}
+
+size_t FrustumCuller::CullRange(const XMFLOAT4 t_planes[6], BoundsType t_type, size_t t_begin, size_t t_end, unsigned int* t_out) const
+{
+	// Splat every plane component once instead of once per group
+	XMVECTOR planeX[6], planeY[6], planeZ[6], planeW[6];
+	XMVECTOR absPlaneX[6], absPlaneY[6], absPlaneZ[6];
+	for (int p = 0; p < 6; ++p)
+	{
+		planeX[p] = XMVectorReplicate(t_planes[p].x);
+		planeY[p] = XMVectorReplicate(t_planes[p].y);
+		planeZ[p] = XMVectorReplicate(t_planes[p].z);
+		planeW[p] = XMVectorReplicate(t_planes[p].w);
+		absPlaneX[p] = XMVectorAbs(planeX[p]);
+		absPlaneY[p] = XMVectorAbs(planeY[p]);
+		absPlaneZ[p] = XMVectorAbs(planeZ[p]);
+	}
+
+	const XMVECTOR zero = XMVectorZero();
+	size_t written = 0;
+
+	// t_begin is always a multiple of four, so groups line up with the padding
+	for (size_t i = t_begin; i < t_end; i += 4)
+	{
+		XMVECTOR cx = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&centerX[i]));
+		XMVECTOR cy = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&centerY[i]));
+		XMVECTOR cz = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&centerZ[i]));
+
+		XMVECTOR outside = zero;
+		if (t_type == Spheres)
+		{
+			XMVECTOR r = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&radius[i]));
+			for (int p = 0; p < 6; ++p)
+			{
+				XMVECTOR distance = XMVectorMultiplyAdd(planeX[p], cx, XMVectorMultiplyAdd(planeY[p], cy, XMVectorMultiplyAdd(planeZ[p], cz, planeW[p])));
+				outside = XMVectorOrInt(outside, XMVectorLess(XMVectorAdd(distance, r), zero));
+			}
+		}
+		else
+		{
+			XMVECTOR ex = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&extentX[i]));
+			XMVECTOR ey = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&extentY[i]));
+			XMVECTOR ez = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&extentZ[i]));
+			for (int p = 0; p < 6; ++p)
+			{
+				// Box is outside when even its corner furthest along the normal is behind the plane
+				XMVECTOR distance = XMVectorMultiplyAdd(planeX[p], cx, XMVectorMultiplyAdd(planeY[p], cy, XMVectorMultiplyAdd(planeZ[p], cz, planeW[p])));
+				XMVECTOR reach = XMVectorMultiplyAdd(absPlaneX[p], ex, XMVectorMultiplyAdd(absPlaneY[p], ey, XMVectorMultiply(absPlaneZ[p], ez)));
+				outside = XMVectorOrInt(outside, XMVectorLess(XMVectorAdd(distance, reach), zero));
+			}
+		}
+
+		// Write every real lane and only advance past the visible ones,
+		// leaving out padding so nothing lands past this range
+		unsigned int inside = GetInsideMask(outside);
+		size_t lanes = (std::min)(t_end - i, (size_t)4);
+		for (size_t lane = 0; lane < lanes; ++lane)
+		{
+			t_out[written] = (unsigned int)(i + lane);
+			written += (inside >> lane) & 1u;
+		}
+	}
+
+	return written;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+
+// Finds which of many world-space bounding volumes touch the view frustum.
+//
+// Bounds are kept in structure-of-arrays form (centers, extents and radii in
+// separate float arrays), so each SIMD step tests four objects against a
+// plane at once. Large sets are split into chunks that run on the JobSystem.
+// The result is a compact list of indices of the visible bounds, in order.
+class FrustumCuller
+{
+public:
+	// Which of the stored volumes Cull() tests.
+	enum BoundsType
+	{
+		Spheres,	// Cheapest, and unaffected by rotation
+		Boxes		// World-space AABBs, tighter for long thin objects
+	};
+
+	// Objects per chunk when culling in parallel. Sets no larger than this run on the calling thread.
+	static const size_t ChunkSize = 16384;
+
+	// Build the six normalized frustum planes (left, right, bottom, top, near, far)
+	// from a view and projection matrix. Both are transposed, as Camera stores them.
+	// A point p is inside a plane when dot(plane.xyz, p) + plane.w >= 0.
+	static void ExtractPlanes(const DirectX::XMFLOAT4X4& t_view, const DirectX::XMFLOAT4X4& t_projection, DirectX::XMFLOAT4 t_planes[6]);
+
+	// Set number of bounds, keeping the first ones already set.
+	void Resize(size_t t_count);
+	size_t GetCount() const;
+
+	// Set bounds t_index from an AABB in world space. Its sphere is the one around the box.
+	void SetBox(size_t t_index, const DirectX::XMFLOAT3& t_center, const DirectX::XMFLOAT3& t_extents);
+
+	// Set bounds t_index from a local AABB and the (transposed) world matrix that places it.
+	void SetBounds(size_t t_index, const DirectX::XMFLOAT3& t_local_min, const DirectX::XMFLOAT3& t_local_max, const DirectX::XMFLOAT4X4& t_world);
+
+	// Replace t_visible with the indices of all bounds inside or crossing the frustum.
+	void Cull(const DirectX::XMFLOAT4 t_planes[6], BoundsType t_type, std::vector<unsigned int>& t_visible);
+
+	// Same as Cull() one object at a time on the calling thread.
+	// Reference for testing and benchmarking the SIMD path.
+	void CullScalar(const DirectX::XMFLOAT4 t_planes[6], BoundsType t_type, std::vector<unsigned int>& t_visible);
+
+	// Turn the parallel path on or off (on by default).
+	void SetParallel(bool t_parallel);
+
+	// Get what the last Cull()/CullScalar() found.
+	size_t GetVisibleCount() const;
+	size_t GetCulledCount() const;
+
+private:
+	// SIMD-test bounds [t_begin, t_end) and write the indices of visible ones to t_out. Returns how many.
+	size_t CullRange(const DirectX::XMFLOAT4 t_planes[6], BoundsType t_type, size_t t_begin, size_t t_end, unsigned int* t_out) const;
+
+	size_t count = 0;
+
+	// Padded with empty bounds up to a multiple of four so every SIMD load is whole
+	std::vector<float> centerX, centerY, centerZ;
+	std::vector<float> extentX, extentY, extentZ;
+	std::vector<float> radius;
+
+	bool parallel = true;
+	size_t visibleCount = 0;
+};
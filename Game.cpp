@@ -4,6 +4,26 @@
 #include "Entity.h"
 #include "Camera.h"
 #include "Material.h"
+#include "GeometryGenerator.h"
+#include "CollisionProxy.h"
+#include "SceneGraph.h"
+#include "JobSystem.h"
+#include "TaskGraph.h"
+#include "FrustumCuller.h"
+#include "DynamicAABBTree.h"
+#include "OcclusionCuller.h"
+#include "SweepAndPrune.h"
+#include "StateCache.h"
+#include "ConstantBufferRing.h"
+#include "InstanceBatcher.h"
+#include "ObjectTable.h"
+#include "TimeSlicedScheduler.h"
+#include "Decal.h"
+#include "Benchmarks.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
 #include <string>
 
 // For the DirectX Math library
@@ -31,6 +51,11 @@ Game::Game(HINSTANCE hInstance)
 	pixelShader = 0;
 	entityCount = 0;
 	camera = new Camera();
+	sceneGraph = new SceneGraph();
+	mouseRotating = false;
+	mouseDeltaX = 0;
+	mouseDeltaY = 0;
+	projectionDirty = false;
 
 #if defined(DEBUG) || defined(_DEBUG)
 	// Do we want a console window?  Probably only in debug mode
@@ -49,12 +74,18 @@ Game::~Game()
 	// Delete our simple shader objects, which
 	// will clean up their own internal DirectX stuff
 	delete vertexShader;
+	delete instancedVertexShader;
 	delete pixelShader;
 
 	if (material)
 	{
 		delete material;
 	}
+
+	if (decalMaterial)
+	{
+		delete decalMaterial;
+	}
 	
 	if (camera)
 	{
@@ -74,9 +105,81 @@ Game::~Game()
 	{
 		sampler->Release();
 	}
+
+	if (transparentBlendState)
+	{
+		transparentBlendState->Release();
+	}
+
+	if (transparentDepthState)
+	{
+		transparentDepthState->Release();
+	}
+
+	if (instanceBuffer)
+	{
+		instanceBuffer->Release();
+	}
+
+	if (objectSRV)
+	{
+		objectSRV->Release();
+	}
+
+	if (objectBuffer)
+	{
+		objectBuffer->Release();
+	}
 	
 	// Delete Mesh objects as we created them on heap;
-	delete MeshOne;
+	for (Mesh* mesh : meshes)
+	{
+		delete mesh;
+	}
+	meshes.clear();
+
+	for (Mesh* mesh : decalMeshes)
+	{
+		delete mesh;
+	}
+	decalMeshes.clear();
+
+	delete decalBuilder;
+	decalBuilder = nullptr;
+
+	delete decalPool;
+	decalPool = nullptr;
+
+	delete updateGraph;
+	updateGraph = nullptr;
+
+	delete boundsTree;
+	boundsTree = nullptr;
+
+	delete occlusionCuller;
+	occlusionCuller = nullptr;
+
+	delete overlaps;
+	overlaps = nullptr;
+
+	delete stateCache;
+	stateCache = nullptr;
+
+	delete constantRing;
+	constantRing = nullptr;
+
+	delete instanceBatcher;
+	instanceBatcher = nullptr;
+
+	delete objectTable;
+	objectTable = nullptr;
+
+	delete backgroundWork;
+	backgroundWork = nullptr;
+
+	// The graph has to let go of the entities before they are deleted
+	delete sceneGraph;
+	sceneGraph = nullptr;
 
 	// Delete Entities
 	for (size_t i = 0; i < entityCount; ++i)
@@ -101,12 +204,13 @@ void Game::Init()
 	// Helper methods for loading shaders, creating some basic
 	// geometry to draw and some simple camera matrices.
 	//  - You'll be expanding and/or replacing these later
+	stateCache = new StateCache(context);
+	constantRing = new ConstantBufferRing(device, context, 4 * 1024 * 1024);		// A few frames of every draw's constants
+	instanceBatcher = new InstanceBatcher();
+	objectTable = new ObjectTable();
 	LoadShaders();
-	CreateMatrices();
-	CreateBasicGeometry();
-
-	InitLights();
 
+	// Materials take the textures and sampler, so these come before any geometry
 	CreateWICTextureFromFile(
 		device,
 		context,
@@ -132,10 +236,63 @@ void Game::Init()
 
 	device->CreateSamplerState(&sampler_desc, &sampler);
 
+	// The transparent pass blends by source alpha and keeps what is behind it visible
+	D3D11_BLEND_DESC blend_desc = {};
+	blend_desc.RenderTarget[0].BlendEnable = TRUE;
+	blend_desc.RenderTarget[0].SrcBlend = D3D11_BLEND_SRC_ALPHA;
+	blend_desc.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+	blend_desc.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
+	blend_desc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
+	blend_desc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_ZERO;
+	blend_desc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+	blend_desc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+	device->CreateBlendState(&blend_desc, &transparentBlendState);
+
+	D3D11_DEPTH_STENCIL_DESC depth_desc = {};
+	depth_desc.DepthEnable = TRUE;
+	depth_desc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+	depth_desc.DepthFunc = D3D11_COMPARISON_LESS;
+	device->CreateDepthStencilState(&depth_desc, &transparentDepthState);
+
+	CreateMatrices();
+	CreateBasicGeometry();
+	CreateUpdateGraph();
+	QueueBackgroundWork();
+
+	InitLights();
+
 	// Tell the input assembler stage of the pipeline what kind of
 	// geometric primitives (points, lines or triangles) we want to draw.  
 	// Essentially: "What kind of shape should the GPU draw with our data?"
-	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	stateCache->SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	// Started with -benchmark: time the engine's systems once, before the first frame
+	if (benchmarksEnabled)
+	{
+#if !defined(DEBUG) && !defined(_DEBUG)
+		// Release builds have no console otherwise, and are the ones worth timing
+		CreateConsoleWindow(500, 120, 32, 120);
+#endif
+		Benchmarks benchmarks(device, material, (float)width / height);
+		benchmarks.RunAll();
+	}
+}
+
+// --------------------------------------------------------
+// Choose whether Init runs the Benchmarks. Call it before Run().
+// --------------------------------------------------------
+void Game::SetBenchmarksEnabled(bool t_enabled)
+{
+	benchmarksEnabled = t_enabled;
+}
+
+// --------------------------------------------------------
+// Choose whether Update and Draw print their stats to the
+// console (debug builds only, as there is no console else)
+// --------------------------------------------------------
+void Game::SetStatsEnabled(bool t_enabled)
+{
+	statsEnabled = t_enabled;
 }
 
 // --------------------------------------------------------
@@ -154,6 +311,20 @@ void Game::LoadShaders()
 	if(!pixelShader->LoadShaderFile(L"Debug/PixelShader.cso"))	
 		pixelShader->LoadShaderFile(L"PixelShader.cso");
 
+	instancedVertexShader = new SimpleVertexShader(device, context);
+	if (!instancedVertexShader->LoadShaderFile(L"Debug/VertexShaderInstanced.cso"))
+		instancedVertexShader->LoadShaderFile(L"VertexShaderInstanced.cso");
+
+	// Bind through the state cache, so Draw can leave it to drop what is already set
+	vertexShader->SetStateCache(stateCache);
+	instancedVertexShader->SetStateCache(stateCache);
+	pixelShader->SetStateCache(stateCache);
+
+	// Write constants into the ring and bind them by range (ignored where unsupported)
+	vertexShader->SetConstantRing(constantRing);
+	instancedVertexShader->SetConstantRing(constantRing);
+	pixelShader->SetConstantRing(constantRing);
+
 	// You'll notice that the code above attempts to load each
 	// compiled shader file (.cso) from two different relative paths.
 
@@ -166,6 +337,205 @@ void Game::LoadShaders()
 	// scenarios work correctly, although others exist
 }
 
+// --------------------------------------------------------
+// Splits the per-frame update into systems. Each one lists the
+// data it reads and writes; TaskGraph orders them from that,
+// and runs the ones that do not touch each other's data at the
+// same time.
+// --------------------------------------------------------
+void Game::CreateUpdateGraph()
+{
+	updateGraph = new TaskGraph();
+
+	updateGraph->AddTask("camera", [this](float t_delta_time, float)
+	{
+		if (projectionDirty.exchange(false))
+		{
+			camera->updateProjectionMatrix(width, height);
+		}
+		camera->setDoRotation(mouseRotating);
+		camera->updateMouseInput((float)mouseDeltaX.exchange(0), (float)mouseDeltaY.exchange(0));
+		camera->update(t_delta_time);
+	}, { "input" }, { "camera" });
+
+	// Push any movement down to attached entities. This brings every cached
+	// World matrix up to date, so the systems after it only read them.
+	updateGraph->AddTask("transforms", [this](float, float)
+	{
+		sceneGraph->UpdateWorldMatrices();
+	}, { "transforms" }, { "worldMatrices", "changedEntities" });
+
+	// Only what the camera can see goes to Draw. The tree is only touched
+	// for new and moved entities, so this scales with what changed.
+	boundsTree = new DynamicAABBTree();
+	occlusionCuller = new OcclusionCuller();
+	updateGraph->AddTask("drawList", [this](float, float)
+	{
+		XMFLOAT3 boundsMin, boundsMax;
+		for (; boundsEntityCount < entityCount; ++boundsEntityCount)
+		{
+			Entity* entity = entities[boundsEntityCount];
+			entity->GetCachedWorldBounds(boundsMin, boundsMax);
+			entity->SetBoundsProxy(boundsTree->CreateProxy(boundsMin, boundsMax, (unsigned int)boundsEntityCount));
+		}
+		for (Entity* changedEntity : changedEntities)
+		{
+			if (changedEntity->GetBoundsProxy() != DynamicAABBTree::NullProxy)
+			{
+				changedEntity->GetCachedWorldBounds(boundsMin, boundsMax);
+				boundsTree->MoveProxy(changedEntity->GetBoundsProxy(), boundsMin, boundsMax);
+			}
+		}
+
+		// A few rotations a frame undo what many small refits do to the tree
+		boundsTree->Optimize(64);
+
+		XMFLOAT4 planes[6];
+		FrustumCuller::ExtractPlanes(camera->getViewMatrix(), camera->getProjectionMatrix(), planes);
+		visibleEntities.clear();
+		boundsTree->QueryFrustum(planes, visibleEntities);
+
+		// Occluders are always drawn; everything else has to get past them
+		drawList.clear();
+		occludees.clear();
+		for (unsigned int index : visibleEntities)
+		{
+			if (entities[index]->IsOccluder())
+			{
+				drawList.push_back(entities[index]);
+			}
+			else
+			{
+				occludees.push_back(entities[index]);
+			}
+		}
+
+		if (drawList.empty() || occludees.empty())
+		{
+			drawList.insert(drawList.end(), occludees.begin(), occludees.end());
+			return;
+		}
+
+		occlusionCuller->BeginFrame(camera->getViewMatrix(), camera->getProjectionMatrix());
+		for (Entity* occluder : drawList)
+		{
+			const Mesh* mesh = occluder->GetEntityMesh();
+			occlusionCuller->AddOccluder(&mesh->GetVertices()[0].Position, sizeof(Vertex), mesh->GetVertices().size(),
+				&mesh->GetIndices()[0], mesh->GetIndices().size(), occluder->GetCachedWorldMatrix());
+		}
+		occlusionCuller->Rasterize();
+
+		for (Entity* occludee : occludees)
+		{
+			occludee->GetCachedWorldBounds(boundsMin, boundsMax);
+			if (occlusionCuller->TestBox(boundsMin, boundsMax))
+			{
+				drawList.push_back(occludee);
+			}
+		}
+	}, { "worldMatrices", "changedEntities", "camera" }, { "drawList", "boundsTree", "occlusion" });
+
+	// Track which entities touch, for triggers and later physics
+	overlaps = new SweepAndPrune();
+	updateGraph->AddTask("overlaps", [this](float, float)
+	{
+		XMFLOAT3 boundsMin, boundsMax;
+		for (; overlapEntityCount < entityCount; ++overlapEntityCount)
+		{
+			Entity* entity = entities[overlapEntityCount];
+			entity->GetCachedWorldBounds(boundsMin, boundsMax);
+			entity->SetOverlapProxy(overlaps->CreateProxy(boundsMin, boundsMax, (unsigned int)overlapEntityCount));
+		}
+		for (Entity* changedEntity : changedEntities)
+		{
+			if (changedEntity->GetOverlapProxy() != SweepAndPrune::NullProxy)
+			{
+				changedEntity->GetCachedWorldBounds(boundsMin, boundsMax);
+				overlaps->MoveProxy(changedEntity->GetOverlapProxy(), boundsMin, boundsMax);
+			}
+		}
+		overlaps->Update();
+	}, { "worldMatrices", "changedEntities" }, { "overlaps" });
+
+	// Copy out what Draw needs, so the next Update can start while it draws
+	updateGraph->AddTask("snapshot", [this](float t_delta_time, float t_total_time)
+	{
+		snapshot->DeltaTime = t_delta_time;
+		snapshot->TotalTime = t_total_time;
+		snapshot->ViewMatrix = camera->getViewMatrix();
+		snapshot->ProjectionMatrix = camera->getProjectionMatrix();
+		snapshot->CameraPosition = camera->getCameraPosition();
+		snapshot->Lights[0] = directional_light;
+		snapshot->Lights[1] = directional_light_two;
+
+		snapshot->Items.resize(drawList.size());
+		for (size_t i = 0; i < drawList.size(); ++i)
+		{
+			RenderItem& item = snapshot->Items[i];
+			item.Source = drawList[i];
+			item.World = drawList[i]->GetCachedWorldMatrix();
+			item.WorldInverseTranspose = drawList[i]->GetCachedWorldInverseTransposeMatrix();
+			item.MeshData = drawList[i]->GetEntityMesh();
+			item.MaterialData = drawList[i]->GetEntityMaterial();
+		}
+
+		// Sort the draws by state, and by distance along the view direction
+		// scaled to [0, 1] over what is drawn this frame
+		const XMFLOAT4X4& view = snapshot->ViewMatrix;
+		float nearest = FLT_MAX;
+		float furthest = -FLT_MAX;
+		drawDepths.resize(snapshot->Items.size());
+		for (size_t i = 0; i < snapshot->Items.size(); ++i)
+		{
+			const XMFLOAT4X4& world = snapshot->Items[i].World;
+			drawDepths[i] = view._31 * world._14 + view._32 * world._24 + view._33 * world._34 + view._34;
+			nearest = (std::min)(nearest, drawDepths[i]);
+			furthest = (std::max)(furthest, drawDepths[i]);
+		}
+		float depthScale = furthest > nearest ? 1.0f / (furthest - nearest) : 0.0f;
+
+		snapshot->Queue.Clear();
+		for (size_t i = 0; i < snapshot->Items.size(); ++i)
+		{
+			const RenderItem& item = snapshot->Items[i];
+			uint64_t key = RenderQueue::MakeKey(
+				item.MaterialData->isTransparent() ? RenderQueue::Transparent : RenderQueue::Opaque,
+				item.MaterialData->getShaderSortId(),
+				item.MaterialData->getSortId(),
+				item.MeshData->GetSortId(),
+				(drawDepths[i] - nearest) * depthScale);
+			snapshot->Queue.Add(key, (unsigned int)i);
+		}
+		snapshot->Queue.Sort();
+	}, { "drawList", "worldMatrices", "camera", "lights" }, { "snapshot" });
+}
+
+// --------------------------------------------------------
+// Work nothing needs yet, but that would hitch a frame if it
+// ran on first use. Each task does one small step per call
+// and backgroundWork fits as many as it can into each Update.
+// --------------------------------------------------------
+void Game::QueueBackgroundWork()
+{
+	backgroundWork = new TimeSlicedScheduler();
+	backgroundWork->SetBudgetMilliseconds(1.0f);
+
+	// Triangle BVHs are otherwise built by the first decal projected onto a mesh
+	for (size_t i = 0; i < meshes.size(); ++i)
+	{
+		Mesh* mesh = meshes[i];
+		backgroundWork->Add("triangleBVH" + std::to_string(i), [mesh]()
+		{
+			mesh->GetTriangleBVH();
+			return true;
+		}, TimeSlicedScheduler::Low);
+	}
+
+	// Stamp a decal onto the side of the sphere facing the camera
+	Decal decal = { XMFLOAT3(-1.0f, -1.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 1.0f), XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT3(0.5f, 0.5f, 2.0f) };
+	SpawnDecal(decal);
+}
+
 void Game::InitLights()
 {
 	directional_light.AmbientColor = XMFLOAT4(0.2f, 0.2f, 0.2f, 1.0f);
@@ -206,15 +576,122 @@ void Game::CreateBasicGeometry()
 	// - But just to see how it's done...
 	UINT indices[] = { 0, 1, 2 };
 
-	MeshOne = new Mesh(device, "Assets/Models/sphere.obj");
+	// Generate the basic primitives instead of parsing their OBJ files
+	std::vector<Vertex> vertices;
+	std::vector<UINT> primitiveIndices;
+	const PrimitiveType primitives[] = { PrimitiveType::Cube, PrimitiveType::Sphere, PrimitiveType::Cylinder, PrimitiveType::Cone, PrimitiveType::Torus };
+	for (PrimitiveType primitive : primitives)
+	{
+		vertices.clear();
+		primitiveIndices.clear();
+		GeometryGenerator::CreatePrimitive(primitive, 0, vertices, primitiveIndices);
+		meshes.push_back(new Mesh(device, &vertices[0], (UINT)vertices.size(), &primitiveIndices[0], (UINT)primitiveIndices.size()));
+	}
+
+	// Generate the collision proxies up front so nothing has to build them mid-frame
+	CollisionProxyBuilder::BuildAll(meshes, CollisionProxySettings());
+
 	material = new Material(vertexShader, pixelShader, pebblesShaderResourceView, pebblesNormalShaderResourceView, sampler);
+	if (instancedVertexShader->IsShaderValid() && instancedVertexShader->GetPerInstanceCompatible())
+	{
+		material->setInstancedVertexShader(instancedVertexShader);
+	}
 
 	// Create entities based on these Meshes
-	entities.push_back(new Entity(MeshOne, material));
+	entities.push_back(new Entity(meshes[(size_t)PrimitiveType::Sphere], material));
+	entities[entityCount]->SetChangeList(&changedEntities);
+	sceneGraph->Add(entities[entityCount]);
 	++entityCount;
 
 	entities[entityCount - 1]->MoveAbsolute(-1.0f, -1.0f, 0.0f);
 
+	// Decals are tinted and blended over whatever they are stamped on
+	decalPool = new DecalMeshPool();
+	decalBuilder = new DecalBuilder(decalPool);
+	decalMaterial = new Material(vertexShader, pixelShader, pebblesShaderResourceView, pebblesNormalShaderResourceView, sampler);
+	decalMaterial->setColorTint(XMFLOAT4(0.2f, 0.1f, 0.05f, 0.75f));
+	decalMaterial->setTransparent(true);
+	if (material->getInstancedVertexShader() != nullptr)
+	{
+		decalMaterial->setInstancedVertexShader(instancedVertexShader);
+	}
+}
+
+// --------------------------------------------------------
+// Finds the entities whose bounds a decal's box overlaps, and
+// queues clipping it against each one on backgroundWork, so a
+// stamp costs a slice of the frame's budget rather than a hitch.
+// Entities in boundsTree are found through it; the few added
+// since the "drawList" system last ran are checked one by one.
+// --------------------------------------------------------
+size_t Game::SpawnDecal(const Decal& t_decal)
+{
+	XMFLOAT3 decalMin, decalMax;
+	DecalBuilder::GetWorldBounds(t_decal, decalMin, decalMax);
+
+	decalTargets.clear();
+	boundsTree->QueryAABB(decalMin, decalMax, decalTargets);
+
+	XMFLOAT3 boundsMin, boundsMax;
+	for (size_t i = boundsEntityCount; i < entityCount; ++i)
+	{
+		entities[i]->GetWorldBounds(boundsMin, boundsMax);
+		if (boundsMin.x <= decalMax.x && boundsMax.x >= decalMin.x
+			&& boundsMin.y <= decalMax.y && boundsMax.y >= decalMin.y
+			&& boundsMin.z <= decalMax.z && boundsMax.z >= decalMin.z)
+		{
+			decalTargets.push_back((unsigned int)i);
+		}
+	}
+
+	size_t queued = 0;
+	for (unsigned int index : decalTargets)
+	{
+		Entity* target = entities[index];
+		if (target->GetEntityMaterial() == decalMaterial)
+		{
+			continue;
+		}
+
+		backgroundWork->Add("decal", [this, target, t_decal]()
+		{
+			AttachDecal(target, t_decal);
+			return true;
+		}, TimeSlicedScheduler::High);
+		++queued;
+	}
+	return queued;
+}
+
+// --------------------------------------------------------
+// Clips a decal's box against an entity and adds what is left
+// as a child entity, so it follows its target around. Vertices
+// are pushed out a little along their normals, since the
+// transparent pass only draws in front of what is already there.
+// --------------------------------------------------------
+void Game::AttachDecal(Entity* t_target, const Decal& t_decal)
+{
+	const float surfaceOffset = 0.002f;
+
+	DecalMesh* decalMesh = decalBuilder->Build(t_target, t_decal);
+	if (decalMesh == nullptr)
+	{
+		return;
+	}
+
+	for (Vertex& vertex : decalMesh->Vertices)
+	{
+		XMStoreFloat3(&vertex.Position, XMLoadFloat3(&vertex.Position) + XMLoadFloat3(&vertex.Normal) * surfaceOffset);
+	}
+	Mesh* mesh = new Mesh(device, &decalMesh->Vertices[0], (UINT)decalMesh->Vertices.size(), &decalMesh->Indices[0], (UINT)decalMesh->Indices.size());
+	decalPool->Release(decalMesh);
+	decalMeshes.push_back(mesh);
+
+	// Its vertices are in the target's local space, so an identity local transform puts it in place
+	entities.push_back(new Entity(mesh, decalMaterial));
+	entities[entityCount]->SetChangeList(&changedEntities);
+	sceneGraph->Add(entities[entityCount], t_target);
+	++entityCount;
 }
 
 // --------------------------------------------------------
@@ -226,7 +703,8 @@ void Game::OnResize()
 	// Handle base-level DX resize stuff
 	DXCore::OnResize();
 
-	camera->updateProjectionMatrix(width, height);
+	// The camera belongs to Update, which may be running on another thread
+	projectionDirty = true;
 }
 
 // --------------------------------------------------------
@@ -238,14 +716,203 @@ void Game::Update(float deltaTime, float totalTime)
 	if (GetAsyncKeyState(VK_ESCAPE))
 		Quit();
 
-	camera->update(deltaTime);
+	// Wait until Draw is done with the snapshot this frame is going to reuse
+	snapshot = framePipeline.BeginWrite();
+	if (snapshot == nullptr)
+		return;
 
-	for (size_t i = 0; i < entityCount; ++i)
+	// Stamp a decal wherever the camera is looking, once per press of E
+	bool decalKey = (GetAsyncKeyState('E') & 0x8000) != 0;
+	if (decalKey && !decalKeyDown)
+	{
+		XMFLOAT3 forward = camera->getCameraForwardDirection();
+		XMFLOAT3 cameraPosition = camera->getCameraPosition();
+		const float reach = 20.0f;
+
+		// Any up will do as long as it is not along the projection
+		Decal decal;
+		XMStoreFloat3(&decal.Position, XMLoadFloat3(&cameraPosition) + XMLoadFloat3(&forward) * (0.5f * reach));
+		decal.Direction = forward;
+		decal.Up = fabsf(forward.y) > 0.99f ? XMFLOAT3(0.0f, 0.0f, 1.0f) : XMFLOAT3(0.0f, 1.0f, 0.0f);
+		decal.Size = XMFLOAT3(0.3f, 0.3f, reach);
+		SpawnDecal(decal);
+	}
+	decalKeyDown = decalKey;
+
+	// Everything else runs as systems (see CreateUpdateGraph)
+	updateGraph->Execute(JobSystem::GetInstance(), deltaTime, totalTime);
+
+	// Every changed Entity has been copied into the snapshot by now
+	for (Entity* changedEntity : changedEntities)
+	{
+		changedEntity->ClearChanged();
+	}
+	changedEntities.clear();
+
+	// Spend what is left of a small budget on deferred work
+	backgroundWork->RunFrame();
+
+#if defined(DEBUG) || defined(_DEBUG)
+	if (statsEnabled)
+	{
+		for (const TimeSlicedScheduler::CompletedTask& task : backgroundWork->GetCompleted())
+		{
+			printf("\nBackground task %s done: %u frames, %u slices, %.3f ms", task.Name.c_str(), task.Frames, task.Slices, task.Seconds * 1000.0);
+		}
+	}
+#endif
+	backgroundWork->ClearCompleted();
+
+	framePipeline.EndWrite();
+	snapshot = nullptr;
+
+#if defined(DEBUG) || defined(_DEBUG)
+	// Report how often the cached World matrices could be reused
+	if (statsEnabled && totalTime - worldMatrixStatsTime >= 1.0f)
+	{
+		unsigned int requests = Entity::GetWorldMatrixRequestCount();
+		unsigned int recomputes = Entity::GetWorldMatrixRecomputeCount();
+		printf("\nWorld matrices: %u requests, %u recomputed, %.1f%% cache hits",
+			requests, recomputes, requests > 0 ? 100.0f * (requests - recomputes) / requests : 0.0f);
+
+		Entity::ResetWorldMatrixCounters();
+		printf("\nFrustum culling: %zu visible, %zu culled, bounds tree height %d",
+			visibleEntities.size(), entityCount - visibleEntities.size(), boundsTree->GetHeight());
+		printf("\nOcclusion culling: %zu of %zu tested hidden by %zu triangles   setup %.3fms   rasterize %.3fms   hi-z %.3fms   test %.3fms",
+			occlusionCuller->GetOccludedCount(), occlusionCuller->GetTestedCount(), occlusionCuller->GetOccluderTriangleCount(),
+			occlusionCuller->GetSetupMilliseconds(), occlusionCuller->GetRasterizeMilliseconds(),
+			occlusionCuller->GetHiZMilliseconds(), occlusionCuller->GetTestMilliseconds());
+		printf("\nOverlaps: %zu pairs, %zu began and %zu ended last frame",
+			overlaps->GetPairCount(), overlaps->GetBeginPairs().size(), overlaps->GetEndPairs().size());
+		updateGraph->PrintTimings();
+		worldMatrixStatsTime = totalTime;
+	}
+#endif
+}
+
+// --------------------------------------------------------
+// Copies this frame's instances into the instance buffer,
+// growing it first if they do not fit. Returns false if
+// there is nothing to draw instanced from.
+// --------------------------------------------------------
+bool Game::UploadInstances(const std::vector<InstanceData>& instances)
+{
+	if (instances.empty())
+	{
+		return false;
+	}
+
+	if (instances.size() > instanceBufferCapacity)
+	{
+		// Double past what is needed, so a few more instances do not mean a new buffer every frame
+		size_t capacity = (std::max)(instanceBufferCapacity * 2, instances.size());
+
+		D3D11_BUFFER_DESC instance_desc = {};
+		instance_desc.ByteWidth = (UINT)(capacity * sizeof(InstanceData));
+		instance_desc.Usage = D3D11_USAGE_DYNAMIC;
+		instance_desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		instance_desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+		ID3D11Buffer* buffer = nullptr;
+		if (FAILED(device->CreateBuffer(&instance_desc, nullptr, &buffer)))
+		{
+			return false;
+		}
+		if (instanceBuffer)
+		{
+			instanceBuffer->Release();
+		}
+		instanceBuffer = buffer;
+		instanceBufferCapacity = capacity;
+	}
+
+	// Discarding hands back fresh memory, so the GPU can still be reading last frame's instances
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(context->Map(instanceBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+	{
+		return false;
+	}
+	memcpy(mapped.pData, instances.data(), instances.size() * sizeof(InstanceData));
+	context->Unmap(instanceBuffer, 0);
+	return true;
+}
+
+// --------------------------------------------------------
+// Copies the slots of the object table that changed into the
+// object buffer, making the buffer (and every slot again)
+// when there are more slots than it holds
+//
+// uploadedBytes - Gets the bytes copied
+// --------------------------------------------------------
+bool Game::UploadObjects(size_t& uploadedBytes)
+{
+	const std::vector<ObjectData>& objects = objectTable->GetObjects();
+	uploadedBytes = 0;
+	if (objects.empty())
+	{
+		return false;
+	}
+
+	if (objects.size() > objectBufferCapacity)
+	{
+		// Double past what is needed, as with the instance buffer
+		size_t capacity = (std::max)(objectBufferCapacity * 2, objects.size());
+
+		D3D11_BUFFER_DESC object_desc = {};
+		object_desc.ByteWidth = (UINT)(capacity * sizeof(ObjectData));
+		object_desc.Usage = D3D11_USAGE_DEFAULT;
+		object_desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		object_desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		object_desc.StructureByteStride = sizeof(ObjectData);
+
+		ID3D11Buffer* buffer = nullptr;
+		if (FAILED(device->CreateBuffer(&object_desc, nullptr, &buffer)))
+		{
+			return false;
+		}
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC srv_desc = {};
+		srv_desc.Format = DXGI_FORMAT_UNKNOWN;
+		srv_desc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+		srv_desc.Buffer.FirstElement = 0;
+		srv_desc.Buffer.NumElements = (UINT)capacity;
+
+		ID3D11ShaderResourceView* view = nullptr;
+		if (FAILED(device->CreateShaderResourceView(buffer, &srv_desc, &view)))
+		{
+			buffer->Release();
+			return false;
+		}
+
+		if (objectSRV)
+		{
+			objectSRV->Release();
+		}
+		if (objectBuffer)
+		{
+			objectBuffer->Release();
+		}
+		objectBuffer = buffer;
+		objectSRV = view;
+		objectBufferCapacity = capacity;
+
+		// Nothing is in the new buffer yet
+		objectTable->MarkAllChanged();
+	}
+
+	// Runs of changed slots go up as they are; the rest of the buffer stays as it was
+	for (const ObjectTable::Range& range : objectTable->GetChanges())
 	{
-		XMFLOAT4 rotation = entities[i]->GetRotation();
-		rotation.z = totalTime;
-		//entities[i]->SetRotation(rotation);
+		D3D11_BOX box = {};
+		box.left = (UINT)(range.Begin * sizeof(ObjectData));
+		box.right = (UINT)(range.End * sizeof(ObjectData));
+		box.bottom = 1;
+		box.back = 1;
+		context->UpdateSubresource(objectBuffer, 0, &box, &objects[range.Begin], 0, 0);
+		uploadedBytes += (range.End - range.Begin) * sizeof(ObjectData);
 	}
+	objectTable->ClearChanges();
+	return true;
 }
 
 // --------------------------------------------------------
@@ -253,6 +920,19 @@ void Game::Update(float deltaTime, float totalTime)
 // --------------------------------------------------------
 void Game::Draw(float deltaTime, float totalTime)
 {
+	// DXCore has already collected the newest snapshots from Update. Only those
+	// are read from here on, since Update may be busy with the next frame.
+	const RenderSnapshot& frame = currentSnapshot;
+	const RenderSnapshot& previousFrame = previousSnapshot;
+	bool interpolate = interpolationAlpha < 1.0f;
+
+	XMFLOAT4X4 viewMatrix = interpolate ? RenderSnapshot::InterpolateMatrix(previousFrame.ViewMatrix, frame.ViewMatrix, interpolationAlpha) : frame.ViewMatrix;
+	XMFLOAT3 cameraPosition = frame.CameraPosition;
+	if (interpolate)
+	{
+		XMStoreFloat3(&cameraPosition, XMVectorLerp(XMLoadFloat3(&previousFrame.CameraPosition), XMLoadFloat3(&frame.CameraPosition), interpolationAlpha));
+	}
+
 	// Background color (Cornflower Blue in this case) for clearing
 	const float color[4] = {0.4f, 0.6f, 0.75f, 0.0f};
 
@@ -266,61 +946,229 @@ void Game::Draw(float deltaTime, float totalTime)
 		1.0f,
 		0);
 
-	// Set the vertex and pixel shaders to use for the next Draw() command
-	//  - These don't technically need to be set every frame...YET
-	//  - Once you start applying different shaders to different objects,
-	//    you'll need to swap the current shaders before each draw
-	//vertexShader->SetShader();
-	//pixelShader->SetShader();
-
 	// Set buffers in the input assembler
 	//  - Do this ONCE PER OBJECT you're drawing, since each object might
 	//    have different geometry.
 	UINT stride = sizeof(Vertex);
 	UINT offset = 0;
 	
-	const Mesh* entityMesh = nullptr;
-	Entity* currentEntity = nullptr;
 	ID3D11Buffer* meshVertexBuffer = nullptr;
 	ID3D11Buffer* meshIndexBuffer = nullptr;
-	// Draw Entities
-	for (size_t i = 0; i < entityCount; ++i)
+
+	// Each object's matrices, blended towards the previous snapshot when
+	// Update runs at a fixed step, stay in a slot of the object buffer from
+	// frame to frame, and only the slots that changed are copied again
+	RenderQueue::SubmitStats stats = {};
+	objectTable->Update(frame, previousFrame, interpolate, interpolationAlpha);
+	bool objectsUploaded = UploadObjects(stats.ObjectBytes);
+	const std::vector<ObjectData>& objects = objectTable->GetObjects();
+	const std::vector<unsigned int>& itemSlots = objectTable->GetItemSlots();
+
+	// Draws only carry the slots. Items next to each other in the queue with
+	// the same mesh and material are instances of one draw, with all of their
+	// slots going up to the instance buffer at once
+	instanceBatcher->Build(frame, itemSlots);
+	bool instancesUploaded = objectsUploaded && UploadInstances(instanceBatcher->GetInstances());
+
+	// Draw everything in the snapshot. The queue has items sharing state next
+	// to each other, so state is only set where it changes.
+	RenderQueue::Pass pass = RenderQueue::Opaque;
+	SimpleVertexShader* boundVertexShader = nullptr;
+	SimplePixelShader* boundPixelShader = nullptr;
+	const Material* boundMaterial = nullptr;
+	const Mesh* boundMesh = nullptr;
+	const std::vector<RenderQueue::Item>& queue = frame.Queue.GetItems();
+
+	// What is set per material and per item is looked up once per shader
+	// change, by names hashed at compile time, so the setters skip the name
+	constexpr unsigned int worldName = SimpleHashName("world");
+	constexpr unsigned int worldInverseTransposeName = SimpleHashName("worldInverseTranspose");
+	constexpr unsigned int colorTintName = SimpleHashName("ColorTint");
+	constexpr unsigned int diffuseTextureName = SimpleHashName("DiffuseTexture");
+	constexpr unsigned int normalTextureName = SimpleHashName("NormalTexture");
+	constexpr unsigned int samplerName = SimpleHashName("BasicSampler");
+	SimpleVariableHandle worldHandle, worldInverseTransposeHandle, colorTintHandle;
+	SimpleResourceHandle diffuseTextureHandle, normalTextureHandle;
+	SimpleSamplerHandle samplerHandle;
+	for (const InstanceBatcher::Batch& batch : instanceBatcher->GetBatches())
+	{
+		// Batches only go out as one draw with a shader that reads the object
+		// and instance buffers; otherwise each item's matrices go in constants
+		SimpleVertexShader* instancedVertexShader = frame.Items[queue[batch.Begin].Index].MaterialData->getInstancedVertexShader();
+		bool instanced = instancesUploaded && instancedVertexShader != nullptr;
+		size_t drawEnd = instanced ? batch.Begin + 1 : batch.End;
+		for (size_t q = batch.Begin; q < drawEnd; ++q)
+		{
+			size_t i = queue[q].Index;
+			const RenderItem& item = frame.Items[i];
+			SimpleVertexShader* itemVertexShader = instanced ? instancedVertexShader : item.MaterialData->getVertexShader();
+			SimplePixelShader* itemPixelShader = item.MaterialData->getPixelShader();
+
+			// Transparent items blend over what is drawn and leave the depth buffer alone
+			RenderQueue::Pass itemPass = RenderQueue::GetPass(queue[q].Key);
+			if (itemPass != pass)
+			{
+				context->OMSetBlendState(itemPass == RenderQueue::Transparent ? transparentBlendState : nullptr, nullptr, 0xFFFFFFFF);
+				context->OMSetDepthStencilState(itemPass == RenderQueue::Transparent ? transparentDepthState : nullptr, 0);
+				pass = itemPass;
+				++stats.PassChanges;
+			}
+
+			// What only changes once a frame is set as the shaders are picked up
+			if (itemVertexShader != boundVertexShader || itemPixelShader != boundPixelShader)
+			{
+				itemPixelShader->SetData("light_two", &frame.Lights[1], sizeof(DirectionalLight));
+				itemPixelShader->SetData("light", &frame.Lights[0], sizeof(DirectionalLight));
+				itemPixelShader->SetFloat3("CameraPosition", cameraPosition);
+				itemVertexShader->SetMatrix4x4("view", viewMatrix);
+				itemVertexShader->SetMatrix4x4("projection", frame.ProjectionMatrix);
+
+				if (instanced)
+				{
+					itemVertexShader->SetShaderResourceView("objects", objectSRV);
+				}
+
+				worldHandle = itemVertexShader->GetVariableHandle(worldName);
+				worldInverseTransposeHandle = itemVertexShader->GetVariableHandle(worldInverseTransposeName);
+				colorTintHandle = itemPixelShader->GetVariableHandle(colorTintName);
+				diffuseTextureHandle = itemPixelShader->GetShaderResourceViewHandle(diffuseTextureName);
+				normalTextureHandle = itemPixelShader->GetShaderResourceViewHandle(normalTextureName);
+				samplerHandle = itemPixelShader->GetSamplerHandle(samplerName);
+
+				itemVertexShader->SetShader();
+				itemPixelShader->SetShader();
+				itemVertexShader->CopyBufferData(SimpleBufferFrequency::PerFrame);
+				itemPixelShader->CopyBufferData(SimpleBufferFrequency::PerFrame);
+
+				boundVertexShader = itemVertexShader;
+				boundPixelShader = itemPixelShader;
+				boundMaterial = nullptr;		// Its textures may sit in other slots of these shaders
+				++stats.ShaderChanges;
+			}
+
+			if (item.MaterialData != boundMaterial)
+			{
+				itemPixelShader->SetShaderResourceView(diffuseTextureHandle, item.MaterialData->getdiffusedSRV());
+				itemPixelShader->SetShaderResourceView(normalTextureHandle, item.MaterialData->getNormalSRV());
+				itemPixelShader->SetSamplerState(samplerHandle, item.MaterialData->getSamplerState());
+				itemPixelShader->SetFloat4(colorTintHandle, item.MaterialData->getColorTint());
+				itemPixelShader->CopyBufferData(SimpleBufferFrequency::PerMaterial);
+				boundMaterial = item.MaterialData;
+				++stats.MaterialChanges;
+			}
+
+			if (item.MeshData != boundMesh)
+			{
+				meshVertexBuffer = item.MeshData->GetVertexBuffer();
+				meshIndexBuffer = item.MeshData->GetIndexBuffer();
+
+				stateCache->SetVertexBuffer(0, meshVertexBuffer, stride, offset);
+				stateCache->SetIndexBuffer(meshIndexBuffer, DXGI_FORMAT_R32_UINT, 0);
+				boundMesh = item.MeshData;
+				++stats.MeshChanges;
+			}
+
+			// Finally do the actual drawing
+			//  - Do this ONCE PER OBJECT you intend to draw
+			//  - This will use all of the currently set DirectX "stuff" (shaders, buffers, etc)
+			//  - DrawIndexed() uses the currently set INDEX BUFFER to look up corresponding
+			//     vertices in the currently set VERTEX BUFFER
+			//  - DrawIndexedInstanced() draws the batch's instances, reading
+			//     their object slots from the instance buffer in slot 1
+			if (instanced)
+			{
+				stateCache->SetVertexBuffer(1, instanceBuffer, sizeof(InstanceData), 0);
+				stateCache->DrawIndexedInstanced(
+					item.MeshData->GetIndexCount(),
+					(UINT)(batch.End - batch.Begin),    // One instance per item in the batch
+					0,
+					0,
+					batch.FirstInstance);               // Where the batch's slots start
+			}
+			else
+			{
+				const ObjectData& object = objects[itemSlots[i]];
+				itemVertexShader->SetMatrix4x4(worldHandle, object.World);
+				itemVertexShader->SetMatrix4x4(worldInverseTransposeHandle, object.WorldInverseTranspose);
+				itemVertexShader->CopyBufferData(SimpleBufferFrequency::PerObject);
+
+				stateCache->DrawIndexed(
+					item.MeshData->GetIndexCount(),     // The number of indices to use (we could draw a subset if we wanted)
+					0,     // Offset to the first index we want to use
+					0);    // Offset to add to each index when looking up vertices
+			}
+			++stats.Draws;
+		}
+		stats.Items += batch.End - batch.Begin;
+	}
+
+	// Leave the default states set for the next frame
+	if (pass != RenderQueue::Opaque)
 	{
-		currentEntity = entities[i];
-		// Set the pixel shader before we draw each entity
-		pixelShader->SetData("light_two", &directional_light_two, sizeof(DirectionalLight));
-		pixelShader->SetData("light", &directional_light, sizeof(DirectionalLight));
-		pixelShader->SetFloat3("CameraPosition", camera->getCameraPosition());
-		pixelShader->SetShaderResourceView("DiffuseTexture", pebblesShaderResourceView);
-		pixelShader->SetShaderResourceView("NormalTexture", pebblesNormalShaderResourceView);
-		pixelShader->SetSamplerState("BasicSampler", sampler);
-		currentEntity->prepareMaterial(camera->getViewMatrix(), camera->getProjectionMatrix());
-
-		entityMesh = currentEntity->GetEntityMesh();
-		meshVertexBuffer = entityMesh->GetVertexBuffer();
-		meshIndexBuffer = entityMesh->GetIndexBuffer();
-
-		context->IASetVertexBuffers(0, 1, &meshVertexBuffer, &stride, &offset);
-		context->IASetIndexBuffer(meshIndexBuffer, DXGI_FORMAT_R32_UINT, 0);
-
-		// Finally do the actual drawing
-		//  - Do this ONCE PER OBJECT you intend to draw
-		//  - This will use all of the currently set DirectX "stuff" (shaders, buffers, etc)
-		//  - DrawIndexed() uses the currently set INDEX BUFFER to look up corresponding
-		//     vertices in the currently set VERTEX BUFFER
-		context->DrawIndexed(
-			entityMesh->GetIndexCount(),     // The number of indices to use (we could draw a subset if we wanted)
-			0,     // Offset to the first index we want to use
-			0);    // Offset to add to each index when looking up vertices
-
-		//vertexShader->CopyAllBufferData();
-
-		// Present the back buffer to the user
-		//  - Puts the final frame we're drawing into the window so the user can see it
-		//  - Do this exactly ONCE PER FRAME (always at the very end of the frame)
-		swapChain->Present(0, 0);
+		context->OMSetBlendState(nullptr, nullptr, 0xFFFFFFFF);
+		context->OMSetDepthStencilState(nullptr, 0);
+	}
+
+	// Constant data the shaders copied to the GPU this frame
+	stats.ConstantBytes = vertexShader->GetUploadedBytes() + instancedVertexShader->GetUploadedBytes() + pixelShader->GetUploadedBytes();
+	vertexShader->ResetUploadedBytes();
+	instancedVertexShader->ResetUploadedBytes();
+	pixelShader->ResetUploadedBytes();
+	drawStats = stats;
+
+	// This frame's constants stay put in the ring until the GPU is done with them
+	constantRing->EndFrame();
+
+#if defined(DEBUG) || defined(_DEBUG)
+	// Drawing in Items order used to set every state for, and make a draw of, every item
+	if (statsEnabled && totalTime - drawStatsTime >= 1.0f)
+	{
+		printf("\nRender queue: %zu items in %zu draws   %zu pass, %zu shader, %zu material, %zu mesh changes (was %zu each)   sort %.3fms in %u passes",
+			drawStats.Items, drawStats.Draws, drawStats.PassChanges, drawStats.ShaderChanges, drawStats.MaterialChanges, drawStats.MeshChanges,
+			drawStats.Items, frame.Queue.GetSortMilliseconds(), frame.Queue.GetSortPasses());
+
+		// Before constants were split by how often they change, every buffer of both shaders was copied for each item
+		size_t unsplitBytes = 0;
+		ISimpleShader* itemShaders[] = { vertexShader, pixelShader };
+		for (ISimpleShader* shader : itemShaders)
+		{
+			for (unsigned int b = 0; b < shader->GetBufferCount(); ++b)
+			{
+				unsplitBytes += shader->GetBufferSize(b);
+			}
+		}
+		printf("\nConstant buffers: %zu bytes copied last frame (was %zu)",
+			drawStats.ConstantBytes, unsplitBytes * drawStats.Items);
 
+		// Every item's matrices used to be copied for every draw
+		printf("\nObject buffer: %zu bytes copied last frame into %zu slots (was %zu)",
+			drawStats.ObjectBytes, objects.size(), drawStats.Items * 2 * sizeof(XMFLOAT4X4));
+
+		if (constantRing->IsSupported())
+		{
+			ConstantBufferRing::Stats ringStats = constantRing->GetStats();
+			printf("\nConstant ring: %zu copies, %zu bytes in the last %.1fs   %zu discards, %zu fell back to UpdateSubresource   %zu bytes over %zu frames in flight",
+				ringStats.Uploads, ringStats.Bytes, totalTime - drawStatsTime, ringStats.Discards, ringStats.Failures,
+				constantRing->GetUsedBytes(), constantRing->GetFramesInFlight());
+			constantRing->ResetStats();
+		}
+		else
+		{
+			printf("\nConstant ring: not supported by the device, constants are copied with UpdateSubresource");
+		}
+
+		StateCache::Stats cacheStats = stateCache->GetStats();
+		printf("\nState cache: %zu of %zu binding calls reached the context in the last %.1fs",
+			cacheStats.Forwarded, cacheStats.Requested, totalTime - drawStatsTime);
+		stateCache->ResetStats();
+		drawStatsTime = totalTime;
 	}
+#endif
+
+	// Present the back buffer to the user
+	//  - Puts the final frame we're drawing into the window so the user can see it
+	//  - Do this exactly ONCE PER FRAME (always at the very end of the frame)
+	swapChain->Present(0, 0);
 }
 
 
@@ -334,7 +1182,7 @@ void Game::Draw(float deltaTime, float totalTime)
 void Game::OnMouseDown(WPARAM buttonState, int x, int y)
 {
 	// Add any custom code here...
-	camera->setDoRotation(true);
+	mouseRotating = true;
 	// Save the previous mouse position, so we have it for the future
 	prevMousePos.x = x;
 	prevMousePos.y = y;
@@ -351,7 +1199,7 @@ void Game::OnMouseDown(WPARAM buttonState, int x, int y)
 void Game::OnMouseUp(WPARAM buttonState, int x, int y)
 {
 	// Add any custom code here...
-	camera->setDoRotation(false);
+	mouseRotating = false;
 	// We don't care about the tracking the cursor outside
 	// the window anymore (we're not dragging if the mouse is up)
 	ReleaseCapture();
@@ -365,7 +1213,8 @@ void Game::OnMouseUp(WPARAM buttonState, int x, int y)
 void Game::OnMouseMove(WPARAM buttonState, int x, int y)
 {
 	// Add any custom code here...
-	camera->updateMouseInput(prevMousePos.x - x, prevMousePos.y - y);
+	mouseDeltaX += prevMousePos.x - x;
+	mouseDeltaY += prevMousePos.y - y;
 	// Save the previous mouse position, so we have it for the future
 	prevMousePos.x = x;
 	prevMousePos.y = y;
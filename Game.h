@@ -3,6 +3,7 @@
 #include "DXCore.h"
 #include "SimpleShader.h"
 #include <DirectXMath.h>
+#include <atomic>
 #include <vector>
 #include "Lights.h"
 #include <DirectXTK/WICTextureLoader.h>
@@ -11,6 +12,20 @@
 class Entity;
 class Camera;
 class Material;
+class SceneGraph;
+class TaskGraph;
+class DynamicAABBTree;
+class OcclusionCuller;
+class SweepAndPrune;
+class StateCache;
+class ConstantBufferRing;
+class InstanceBatcher;
+struct InstanceData;
+class ObjectTable;
+class TimeSlicedScheduler;
+class DecalMeshPool;
+class DecalBuilder;
+struct Decal;
 
 class Game 
 	: public DXCore
@@ -33,23 +48,137 @@ public:
 	void OnMouseUp	 (WPARAM buttonState, int x, int y);
 	void OnMouseMove (WPARAM buttonState, int x, int y);
 	void OnMouseWheel(float wheelDelta,   int x, int y);
+
+	// Run the Benchmarks at the end of Init (off by default). Set it before Run().
+	void SetBenchmarksEnabled(bool t_enabled);
+
+	// Print engine stats to the debug console as it runs (off by default).
+	void SetStatsEnabled(bool t_enabled);
 private:
 
+	// Copies instances into instanceBuffer for Draw. False if there are none or it failed.
+	bool UploadInstances(const std::vector<InstanceData>& instances);
+
+	// Copies the object table's changed slots into objectBuffer for Draw. False if there are none or it failed.
+	bool UploadObjects(size_t& uploadedBytes);
+
 	// Initialization helper methods - feel free to customize, combine, etc.
 	void LoadShaders(); 
 	void CreateMatrices();
 	void CreateBasicGeometry();
 
-	// Mesh Object to use with Mesh Class to draw 3 different shapes.
-	class Mesh* MeshOne = nullptr;
+	// Registers the systems that make up Update with updateGraph.
+	void CreateUpdateGraph();
+
+	// Queues deferrable setup work for backgroundWork to finish over the first frames.
+	void QueueBackgroundWork();
+
+	// Queues projecting t_decal onto every entity whose bounds it overlaps (other decals
+	// aside) on backgroundWork. Returns how many entities it was queued for.
+	size_t SpawnDecal(const Decal& t_decal);
+
+	// Projects t_decal onto t_target, adding the result as a child entity drawn with decalMaterial.
+	void AttachDecal(Entity* t_target, const Decal& t_decal);
+
+	// Procedurally generated primitives, indexed by PrimitiveType.
+	std::vector<class Mesh*> meshes;
 
 	// List of Entities used in our game.
 	std::vector<Entity*> entities;
 
 	size_t entityCount = 0;
 
+	// Stamps decals onto entities, and the material and meshes they are drawn with.
+	// decalTargets is scratch space for the entities a decal may touch.
+	// decalKeyDown is whether the decal key was held last Update, so a press stamps once.
+	DecalMeshPool* decalPool = nullptr;
+	DecalBuilder* decalBuilder = nullptr;
+	Material* decalMaterial = nullptr;
+	std::vector<class Mesh*> decalMeshes;
+	std::vector<unsigned int> decalTargets;
+	bool decalKeyDown = false;
+
+	// Whether Init runs the Benchmarks.
+	bool benchmarksEnabled = false;
+
+	// Whether Update and Draw print their stats.
+	bool statsEnabled = false;
+
+	// Parent/child hierarchy of our entities.
+	SceneGraph* sceneGraph = nullptr;
+
+	// Entities whose transform changed this frame, so only their per-object data needs uploading.
+	std::vector<Entity*> changedEntities;
+
+	// Systems run by Update, in parallel where their data allows.
+	TaskGraph* updateGraph = nullptr;
+
+	// Work spread over frames at the end of Update, within a small budget.
+	TimeSlicedScheduler* backgroundWork = nullptr;
+
+	// Entities to hand to Draw this frame, built by the "drawList" system.
+	std::vector<Entity*> drawList;
+
+	// World bounds of entities, queried with the camera frustum by the "drawList" system.
+	// Entities from boundsEntityCount on have not been added yet.
+	DynamicAABBTree* boundsTree = nullptr;
+	size_t boundsEntityCount = 0;
+	std::vector<unsigned int> visibleEntities;
+
+	// Depth buffer of the visible occluders, to drop what they hide from drawList.
+	OcclusionCuller* occlusionCuller = nullptr;
+	std::vector<Entity*> occludees;
+
+	// World bounds of entities, checked for overlaps by the "overlaps" system.
+	// Entities from overlapEntityCount on have not been added yet.
+	SweepAndPrune* overlaps = nullptr;
+	size_t overlapEntityCount = 0;
+
+	// Snapshot being filled by the current Update, between BeginWrite and EndWrite.
+	RenderSnapshot* snapshot = nullptr;
+
+	// Distance of each snapshot item along the view direction, for its sort key.
+	std::vector<float> drawDepths;
+
+	// What Draw submitted last frame, and the time that was last printed.
+	RenderQueue::SubmitStats drawStats = {};
+	float drawStatsTime = 0.0f;
+
+	// States for the transparent pass: alpha blending, depth tested but not written.
+	ID3D11BlendState* transparentBlendState = nullptr;
+	ID3D11DepthStencilState* transparentDepthState = nullptr;
+
+	// Input gathered on the window thread, picked up by the "camera" system.
+	std::atomic<bool> mouseRotating;
+	std::atomic<int> mouseDeltaX;
+	std::atomic<int> mouseDeltaY;
+	std::atomic<bool> projectionDirty;
+
+	// Time the World matrix cache counters were last printed.
+	float worldMatrixStatsTime = 0.0f;
+
+	// Bindings made through the shaders and Draw, minus those already in place.
+	StateCache* stateCache = nullptr;
+
+	// Where the shaders write their constants each draw, when the device can bind ranges of one buffer.
+	ConstantBufferRing* constantRing = nullptr;
+
+	// Draw's batches of items to draw instanced, and the dynamic vertex buffer
+	// their object slots go up in (room for instanceBufferCapacity of them).
+	InstanceBatcher* instanceBatcher = nullptr;
+	ID3D11Buffer* instanceBuffer = nullptr;
+	size_t instanceBufferCapacity = 0;
+
+	// Every drawn object's data by slot, and the structured buffer the
+	// instanced shader reads it from (room for objectBufferCapacity slots).
+	ObjectTable* objectTable = nullptr;
+	ID3D11Buffer* objectBuffer = nullptr;
+	ID3D11ShaderResourceView* objectSRV = nullptr;
+	size_t objectBufferCapacity = 0;
+
 	// Wrappers for DirectX shaders to provide simplified functionality
 	SimpleVertexShader* vertexShader;
+	SimpleVertexShader* instancedVertexShader = nullptr;
 	SimplePixelShader* pixelShader;
 
 	// Flying Camera to be used in our game.
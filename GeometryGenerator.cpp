@@ -0,0 +1,315 @@
+#include "GeometryGenerator.h"
+#include "Vertex.h"
+#include <algorithm>
+
+using namespace DirectX;
+
+void GeometryGenerator::CreatePrimitive(PrimitiveType t_type, unsigned int t_lod, std::vector<Vertex>& t_vertices, std::vector<UINT>& t_indices)
+{
+	// Every LOD step halves the tessellation, down to a sensible minimum
+	// so the coarsest levels still look like the shape they stand for.
+	const unsigned int shift = (std::min)(t_lod, 4u);
+
+	switch (t_type)
+	{
+	case PrimitiveType::Cube:
+		CreateCube(1.0f, 1, t_vertices, t_indices);
+		break;
+	case PrimitiveType::Sphere:
+		CreateSphere(0.5f, (std::max)(64u >> shift, 8u), (std::max)(32u >> shift, 4u), t_vertices, t_indices);
+		break;
+	case PrimitiveType::Cylinder:
+		CreateCylinder(0.5f, 1.0f, (std::max)(64u >> shift, 8u), 1, t_vertices, t_indices);
+		break;
+	case PrimitiveType::Cone:
+		CreateCone(0.5f, 1.0f, (std::max)(64u >> shift, 8u), 1, t_vertices, t_indices);
+		break;
+	case PrimitiveType::Torus:
+		CreateTorus(0.5f, 0.15f, (std::max)(64u >> shift, 8u), (std::max)(32u >> shift, 4u), t_vertices, t_indices);
+		break;
+	}
+}
+
+void GeometryGenerator::CreateCube(float t_size, unsigned int t_subdivisions, std::vector<Vertex>& t_vertices, std::vector<UINT>& t_indices)
+{
+	t_subdivisions = (std::max)(t_subdivisions, 1u);
+
+	// Each face is described by its outward normal and the directions that
+	// point "right" and "down" on it when looking at it from outside.
+	const XMFLOAT3 faces[6][3] =
+	{
+		// Normal						Right						Down
+		{ XMFLOAT3( 1.0f, 0.0f, 0.0f), XMFLOAT3( 0.0f, 0.0f, 1.0f), XMFLOAT3(0.0f, -1.0f,  0.0f) },
+		{ XMFLOAT3(-1.0f, 0.0f, 0.0f), XMFLOAT3( 0.0f, 0.0f,-1.0f), XMFLOAT3(0.0f, -1.0f,  0.0f) },
+		{ XMFLOAT3( 0.0f, 1.0f, 0.0f), XMFLOAT3( 1.0f, 0.0f, 0.0f), XMFLOAT3(0.0f,  0.0f, -1.0f) },
+		{ XMFLOAT3( 0.0f,-1.0f, 0.0f), XMFLOAT3( 1.0f, 0.0f, 0.0f), XMFLOAT3(0.0f,  0.0f,  1.0f) },
+		{ XMFLOAT3( 0.0f, 0.0f, 1.0f), XMFLOAT3(-1.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, -1.0f,  0.0f) },
+		{ XMFLOAT3( 0.0f, 0.0f,-1.0f), XMFLOAT3( 1.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, -1.0f,  0.0f) },
+	};
+
+	const unsigned int faceVerts = (t_subdivisions + 1) * (t_subdivisions + 1);
+	t_vertices.reserve(t_vertices.size() + faceVerts * 6);
+	t_indices.reserve(t_indices.size() + t_subdivisions * t_subdivisions * 6 * 6);
+
+	const float halfSize = t_size * 0.5f;
+	for (const auto& face : faces)
+	{
+		XMVECTOR normal = XMLoadFloat3(&face[0]);
+		XMVECTOR right = XMLoadFloat3(&face[1]);
+		XMVECTOR down = XMLoadFloat3(&face[2]);
+		UINT baseVertex = static_cast<UINT>(t_vertices.size());
+
+		for (unsigned int row = 0; row <= t_subdivisions; ++row)
+		{
+			float v = static_cast<float>(row) / t_subdivisions;
+			for (unsigned int column = 0; column <= t_subdivisions; ++column)
+			{
+				float u = static_cast<float>(column) / t_subdivisions;
+				XMVECTOR position = normal * halfSize + right * ((u - 0.5f) * t_size) + down * ((v - 0.5f) * t_size);
+
+				Vertex vertex;
+				XMStoreFloat3(&vertex.Position, position);
+				vertex.UV = XMFLOAT2(u, v);
+				vertex.Normal = face[0];
+				vertex.Tangent = face[1];
+				t_vertices.push_back(vertex);
+			}
+		}
+
+		AppendGridIndices(baseVertex, t_subdivisions, t_subdivisions, t_indices);
+	}
+}
+
+void GeometryGenerator::CreateSphere(float t_radius, unsigned int t_slices, unsigned int t_stacks, std::vector<Vertex>& t_vertices, std::vector<UINT>& t_indices)
+{
+	t_slices = (std::max)(t_slices, 3u);
+	t_stacks = (std::max)(t_stacks, 2u);
+
+	UINT baseVertex = static_cast<UINT>(t_vertices.size());
+	t_vertices.reserve(t_vertices.size() + (t_slices + 1) * (t_stacks + 1));
+	t_indices.reserve(t_indices.size() + t_slices * t_stacks * 6);
+
+	// The seam column is duplicated so it can carry both u = 0 and u = 1,
+	// every other vertex is shared by all the triangles that touch it.
+	for (unsigned int stack = 0; stack <= t_stacks; ++stack)
+	{
+		float v = static_cast<float>(stack) / t_stacks;
+		float sinPhi, cosPhi;
+		XMScalarSinCos(&sinPhi, &cosPhi, v * XM_PI);
+
+		// Pin the poles exactly, sin(pi) is not quite zero in floats.
+		if (stack == 0 || stack == t_stacks)
+		{
+			sinPhi = 0.0f;
+		}
+
+		for (unsigned int slice = 0; slice <= t_slices; ++slice)
+		{
+			float u = static_cast<float>(slice) / t_slices;
+			float sinTheta, cosTheta;
+			XMScalarSinCos(&sinTheta, &cosTheta, u * XM_2PI);
+
+			Vertex vertex;
+			vertex.Normal = XMFLOAT3(sinPhi * cosTheta, cosPhi, sinPhi * sinTheta);
+			vertex.Position = XMFLOAT3(vertex.Normal.x * t_radius, vertex.Normal.y * t_radius, vertex.Normal.z * t_radius);
+			vertex.UV = XMFLOAT2(u, v);
+			vertex.Tangent = XMFLOAT3(-sinTheta, 0.0f, cosTheta);
+			t_vertices.push_back(vertex);
+		}
+	}
+
+	AppendGridIndices(baseVertex, t_slices, t_stacks, t_indices, true, true);
+}
+
+void GeometryGenerator::CreateCylinder(float t_radius, float t_height, unsigned int t_slices, unsigned int t_stacks, std::vector<Vertex>& t_vertices, std::vector<UINT>& t_indices)
+{
+	t_slices = (std::max)(t_slices, 3u);
+	t_stacks = (std::max)(t_stacks, 1u);
+
+	UINT baseVertex = static_cast<UINT>(t_vertices.size());
+	t_vertices.reserve(t_vertices.size() + (t_slices + 1) * (t_stacks + 1) + (t_slices + 2) * 2);
+	t_indices.reserve(t_indices.size() + t_slices * t_stacks * 6 + t_slices * 6);
+
+	const float halfHeight = t_height * 0.5f;
+	for (unsigned int stack = 0; stack <= t_stacks; ++stack)
+	{
+		float v = static_cast<float>(stack) / t_stacks;
+		float y = halfHeight - v * t_height;
+
+		for (unsigned int slice = 0; slice <= t_slices; ++slice)
+		{
+			float u = static_cast<float>(slice) / t_slices;
+			float sinTheta, cosTheta;
+			XMScalarSinCos(&sinTheta, &cosTheta, u * XM_2PI);
+
+			Vertex vertex;
+			vertex.Position = XMFLOAT3(cosTheta * t_radius, y, sinTheta * t_radius);
+			vertex.UV = XMFLOAT2(u, v);
+			vertex.Normal = XMFLOAT3(cosTheta, 0.0f, sinTheta);
+			vertex.Tangent = XMFLOAT3(-sinTheta, 0.0f, cosTheta);
+			t_vertices.push_back(vertex);
+		}
+	}
+
+	AppendGridIndices(baseVertex, t_slices, t_stacks, t_indices);
+
+	// Caps need their own vertices since their normals differ from the side's.
+	AppendCap(t_radius, halfHeight, true, t_slices, t_vertices, t_indices);
+	AppendCap(t_radius, -halfHeight, false, t_slices, t_vertices, t_indices);
+}
+
+void GeometryGenerator::CreateCone(float t_radius, float t_height, unsigned int t_slices, unsigned int t_stacks, std::vector<Vertex>& t_vertices, std::vector<UINT>& t_indices)
+{
+	t_slices = (std::max)(t_slices, 3u);
+	t_stacks = (std::max)(t_stacks, 1u);
+
+	UINT baseVertex = static_cast<UINT>(t_vertices.size());
+	t_vertices.reserve(t_vertices.size() + (t_slices + 1) * (t_stacks + 1) + (t_slices + 2));
+	t_indices.reserve(t_indices.size() + t_slices * t_stacks * 6 + t_slices * 3);
+
+	// The side normal leans up by the slope of the cone.
+	const float halfHeight = t_height * 0.5f;
+	const float slantLength = sqrtf(t_height * t_height + t_radius * t_radius);
+	const float normalRadial = t_height / slantLength;
+	const float normalUp = t_radius / slantLength;
+
+	for (unsigned int stack = 0; stack <= t_stacks; ++stack)
+	{
+		float v = static_cast<float>(stack) / t_stacks;
+		float ringRadius = v * t_radius;
+		float y = halfHeight - v * t_height;
+
+		for (unsigned int slice = 0; slice <= t_slices; ++slice)
+		{
+			float u = static_cast<float>(slice) / t_slices;
+			float sinTheta, cosTheta;
+			XMScalarSinCos(&sinTheta, &cosTheta, u * XM_2PI);
+
+			Vertex vertex;
+			vertex.Position = XMFLOAT3(cosTheta * ringRadius, y, sinTheta * ringRadius);
+			vertex.UV = XMFLOAT2(u, v);
+			vertex.Normal = XMFLOAT3(cosTheta * normalRadial, normalUp, sinTheta * normalRadial);
+			vertex.Tangent = XMFLOAT3(-sinTheta, 0.0f, cosTheta);
+			t_vertices.push_back(vertex);
+		}
+	}
+
+	// The top row collapses into the apex.
+	AppendGridIndices(baseVertex, t_slices, t_stacks, t_indices, true, false);
+
+	AppendCap(t_radius, -halfHeight, false, t_slices, t_vertices, t_indices);
+}
+
+void GeometryGenerator::CreateTorus(float t_major_radius, float t_minor_radius, unsigned int t_major_segments, unsigned int t_minor_segments, std::vector<Vertex>& t_vertices, std::vector<UINT>& t_indices)
+{
+	t_major_segments = (std::max)(t_major_segments, 3u);
+	t_minor_segments = (std::max)(t_minor_segments, 3u);
+
+	UINT baseVertex = static_cast<UINT>(t_vertices.size());
+	t_vertices.reserve(t_vertices.size() + (t_major_segments + 1) * (t_minor_segments + 1));
+	t_indices.reserve(t_indices.size() + t_major_segments * t_minor_segments * 6);
+
+	// Rows walk around the tube starting at the outer equator and heading
+	// down first, so the grid faces outwards like every other primitive.
+	for (unsigned int ring = 0; ring <= t_minor_segments; ++ring)
+	{
+		float v = static_cast<float>(ring) / t_minor_segments;
+		float sinPhi, cosPhi;
+		XMScalarSinCos(&sinPhi, &cosPhi, v * XM_2PI);
+
+		for (unsigned int segment = 0; segment <= t_major_segments; ++segment)
+		{
+			float u = static_cast<float>(segment) / t_major_segments;
+			float sinTheta, cosTheta;
+			XMScalarSinCos(&sinTheta, &cosTheta, u * XM_2PI);
+
+			float ringRadius = t_major_radius + t_minor_radius * cosPhi;
+
+			Vertex vertex;
+			vertex.Position = XMFLOAT3(cosTheta * ringRadius, -t_minor_radius * sinPhi, sinTheta * ringRadius);
+			vertex.UV = XMFLOAT2(u, v);
+			vertex.Normal = XMFLOAT3(cosPhi * cosTheta, -sinPhi, cosPhi * sinTheta);
+			vertex.Tangent = XMFLOAT3(-sinTheta, 0.0f, cosTheta);
+			t_vertices.push_back(vertex);
+		}
+	}
+
+	AppendGridIndices(baseVertex, t_major_segments, t_minor_segments, t_indices);
+}
+
+void GeometryGenerator::AppendGridIndices(UINT t_base_vertex, unsigned int t_columns, unsigned int t_rows, std::vector<UINT>& t_indices, bool t_collapsed_top, bool t_collapsed_bottom)
+{
+	// a - b
+	// | \ |   Two clockwise triangles per quad: a-b-d and a-d-c
+	// c - d
+	for (unsigned int row = 0; row < t_rows; ++row)
+	{
+		for (unsigned int column = 0; column < t_columns; ++column)
+		{
+			UINT a = t_base_vertex + row * (t_columns + 1) + column;
+			UINT b = a + 1;
+			UINT c = a + (t_columns + 1);
+			UINT d = c + 1;
+
+			if (!(t_collapsed_top && row == 0))
+			{
+				t_indices.push_back(a);
+				t_indices.push_back(b);
+				t_indices.push_back(d);
+			}
+
+			if (!(t_collapsed_bottom && row == t_rows - 1))
+			{
+				t_indices.push_back(a);
+				t_indices.push_back(d);
+				t_indices.push_back(c);
+			}
+		}
+	}
+}
+
+void GeometryGenerator::AppendCap(float t_radius, float t_y, bool t_facing_up, unsigned int t_slices, std::vector<Vertex>& t_vertices, std::vector<UINT>& t_indices)
+{
+	const XMFLOAT3 normal(0.0f, t_facing_up ? 1.0f : -1.0f, 0.0f);
+	const XMFLOAT3 tangent(1.0f, 0.0f, 0.0f);
+
+	UINT center = static_cast<UINT>(t_vertices.size());
+	Vertex centerVertex;
+	centerVertex.Position = XMFLOAT3(0.0f, t_y, 0.0f);
+	centerVertex.UV = XMFLOAT2(0.5f, 0.5f);
+	centerVertex.Normal = normal;
+	centerVertex.Tangent = tangent;
+	t_vertices.push_back(centerVertex);
+
+	// Planar mapping of the disc into the unit UV square. Looking down on
+	// the top cap +Z is "up" in the texture, looking up at the bottom it is "down".
+	const float vSign = t_facing_up ? -1.0f : 1.0f;
+	for (unsigned int slice = 0; slice <= t_slices; ++slice)
+	{
+		float sinTheta, cosTheta;
+		XMScalarSinCos(&sinTheta, &cosTheta, static_cast<float>(slice) / t_slices * XM_2PI);
+
+		Vertex vertex;
+		vertex.Position = XMFLOAT3(cosTheta * t_radius, t_y, sinTheta * t_radius);
+		vertex.UV = XMFLOAT2(0.5f + cosTheta * 0.5f, 0.5f + vSign * sinTheta * 0.5f);
+		vertex.Normal = normal;
+		vertex.Tangent = tangent;
+		t_vertices.push_back(vertex);
+	}
+
+	for (unsigned int slice = 0; slice < t_slices; ++slice)
+	{
+		UINT current = center + 1 + slice;
+		t_indices.push_back(center);
+		if (t_facing_up)
+		{
+			t_indices.push_back(current + 1);
+			t_indices.push_back(current);
+		}
+		else
+		{
+			t_indices.push_back(current);
+			t_indices.push_back(current + 1);
+		}
+	}
+}
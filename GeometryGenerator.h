@@ -0,0 +1,53 @@
+#pragma once
+#include <d3d11.h>
+#include <vector>
+
+// Forward Declaration
+struct Vertex;
+
+// Analytically defined primitives we can build without touching the disk.
+enum class PrimitiveType
+{
+	Cube,
+	Sphere,
+	Cylinder,
+	Cone,
+	Torus
+};
+
+// Builds welded, indexed and tangent-complete Vertex/index arrays for
+// the basic primitives, ready to be handed to Mesh.
+//
+// All primitives are centered on the origin, use DirectX's left-handed
+// space with clockwise front faces and put UV (0,0) at the top left,
+// matching what the OBJ loader in Mesh produces.
+class GeometryGenerator
+{
+public:
+	// Build a primitive at the tessellation used by the given LOD level (0 = finest).
+	static void CreatePrimitive(PrimitiveType t_type, unsigned int t_lod, std::vector<Vertex>& t_vertices, std::vector<UINT>& t_indices);
+
+	// Cube of side t_size, each face split into t_subdivisions x t_subdivisions quads.
+	static void CreateCube(float t_size, unsigned int t_subdivisions, std::vector<Vertex>& t_vertices, std::vector<UINT>& t_indices);
+
+	// UV sphere with t_slices around the Y axis and t_stacks from pole to pole.
+	static void CreateSphere(float t_radius, unsigned int t_slices, unsigned int t_stacks, std::vector<Vertex>& t_vertices, std::vector<UINT>& t_indices);
+
+	// Capped cylinder along the Y axis.
+	static void CreateCylinder(float t_radius, float t_height, unsigned int t_slices, unsigned int t_stacks, std::vector<Vertex>& t_vertices, std::vector<UINT>& t_indices);
+
+	// Capped cone along the Y axis with its apex pointing up.
+	static void CreateCone(float t_radius, float t_height, unsigned int t_slices, unsigned int t_stacks, std::vector<Vertex>& t_vertices, std::vector<UINT>& t_indices);
+
+	// Torus lying in the XZ plane.
+	static void CreateTorus(float t_major_radius, float t_minor_radius, unsigned int t_major_segments, unsigned int t_minor_segments, std::vector<Vertex>& t_vertices, std::vector<UINT>& t_indices);
+
+private:
+	// Append indices for a (t_columns + 1) x (t_rows + 1) row-major vertex grid whose
+	// columns run left to right and rows run top to bottom when seen from the front.
+	// Collapsed rows (poles, apexes) only get the half of each quad that has any area.
+	static void AppendGridIndices(UINT t_base_vertex, unsigned int t_columns, unsigned int t_rows, std::vector<UINT>& t_indices, bool t_collapsed_top = false, bool t_collapsed_bottom = false);
+
+	// Append a flat disc cap at height t_y, facing +Y or -Y.
+	static void AppendCap(float t_radius, float t_y, bool t_facing_up, unsigned int t_slices, std::vector<Vertex>& t_vertices, std::vector<UINT>& t_indices);
+};
@@ -0,0 +1,42 @@
+#include "InstanceBatcher.h"
+#include "RenderSnapshot.h"
+
+void InstanceBatcher::Build(const RenderSnapshot& t_frame, const std::vector<unsigned int>& t_item_slots)
+{
+	batches.clear();
+	instances.clear();
+
+	const std::vector<RenderQueue::Item>& queued = t_frame.Queue.GetItems();
+	size_t begin = 0;
+	while (begin < queued.size())
+	{
+		// Extend the batch while the next item draws the same mesh with the same material
+		const RenderItem& first = t_frame.Items[queued[begin].Index];
+		size_t end = begin + 1;
+		while (end < queued.size()
+			&& t_frame.Items[queued[end].Index].MeshData == first.MeshData
+			&& t_frame.Items[queued[end].Index].MaterialData == first.MaterialData)
+		{
+			++end;
+		}
+
+		Batch batch = { begin, end, (unsigned int)instances.size() };
+		for (size_t q = begin; q < end; ++q)
+		{
+			InstanceData instance = { t_item_slots[queued[q].Index] };
+			instances.push_back(instance);
+		}
+		batches.push_back(batch);
+		begin = end;
+	}
+}
+
+const std::vector<InstanceBatcher::Batch>& InstanceBatcher::GetBatches() const
+{
+	return batches;
+}
+
+const std::vector<InstanceData>& InstanceBatcher::GetInstances() const
+{
+	return instances;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+struct RenderSnapshot;
+
+// Per-instance vertex data, read from input slot 1 by VertexShaderInstanced.hlsl:
+// the ObjectTable slot whose data the instance is drawn with.
+struct InstanceData
+{
+	unsigned int ObjectIndex;
+};
+
+// Splits a snapshot's render queue into batches of items next to each other
+// that share a Mesh and Material, which can go out as one instanced draw.
+// The queue keeps opaque items with the same material and mesh together, so
+// these runs are what grouping by (Mesh, Material) gives without another
+// sort, and transparent items stay back to front.
+//
+// Each item's object slot is packed in queue order, ready to upload to an
+// instance buffer in one go. A batch of one item is a draw of one instance,
+// so every item is drawn by index, however many share its state.
+class InstanceBatcher
+{
+public:
+	// Items [Begin, End) of the queue, drawn together from FirstInstance.
+	struct Batch
+	{
+		size_t Begin;
+		size_t End;
+		unsigned int FirstInstance;
+	};
+
+	// Batch t_frame's queue, with t_item_slots holding the object slot of each of its items.
+	void Build(const RenderSnapshot& t_frame, const std::vector<unsigned int>& t_item_slots);
+
+	// Get the batches, in queue order.
+	const std::vector<Batch>& GetBatches() const;
+
+	// Get the packed instances of all batches.
+	const std::vector<InstanceData>& GetInstances() const;
+
+private:
+	std::vector<Batch> batches;
+	std::vector<InstanceData> instances;
+};
@@ -0,0 +1,382 @@
+#include "JobSystem.h"
+
+namespace
+{
+	// Which JobSystem a worker thread belongs to, and its index there
+	thread_local JobSystem* workerSystem = nullptr;
+	thread_local int workerIndex = -1;
+
+	// Failed attempts to find work before a worker goes to sleep
+	const int SpinsBeforeSleep = 64;
+}
+
+JobCounter::JobCounter() :
+	value(0),
+	finishing(0)
+{
+}
+
+int JobCounter::GetValue() const
+{
+	return value.load();
+}
+
+bool JobCounter::IsDone() const
+{
+	// value first: a job holds finishing up from before its decrement until after it is done releasing
+	return value.load() == 0 && finishing.load() == 0;
+}
+
+WorkStealingQueue::WorkStealingQueue() :
+	top(0),
+	bottom(0)
+{
+}
+
+bool WorkStealingQueue::Push(const Job& t_job)
+{
+	int64_t b = bottom.load(std::memory_order_relaxed);
+	int64_t t = top.load(std::memory_order_acquire);
+	if (b - t >= Capacity)
+	{
+		return false;
+	}
+
+	buffer[b & (Capacity - 1)] = t_job;
+	std::atomic_thread_fence(std::memory_order_release);
+	bottom.store(b + 1, std::memory_order_relaxed);
+	return true;
+}
+
+bool WorkStealingQueue::Pop(Job& t_job)
+{
+	int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+	bottom.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t t = top.load(std::memory_order_relaxed);
+
+	if (t > b)
+	{
+		// Empty
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return false;
+	}
+
+	t_job = buffer[b & (Capacity - 1)];
+	if (t < b)
+	{
+		return true;
+	}
+
+	// Last job: race the thieves for it
+	bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+	bottom.store(b + 1, std::memory_order_relaxed);
+	return won;
+}
+
+bool WorkStealingQueue::Steal(Job& t_job)
+{
+	int64_t t = top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t b = bottom.load(std::memory_order_acquire);
+	if (t >= b)
+	{
+		return false;
+	}
+
+	// Copy before claiming: once top moves on, the owner may reuse the slot
+	t_job = buffer[t & (Capacity - 1)];
+	return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+}
+
+JobSystem::JobSystem(unsigned int t_thread_count) :
+	threadCount(t_thread_count),
+	ownerThread(std::this_thread::get_id()),
+	externalCount(0),
+	pendingJobs(0),
+	sleepingWorkers(0),
+	stopping(false)
+{
+	if (threadCount == 0)
+	{
+		threadCount = (std::max)(std::thread::hardware_concurrency(), 1u);
+	}
+
+	threadStates = new ThreadState[threadCount];
+	for (unsigned int i = 0; i < threadCount; ++i)
+	{
+		threadStates[i].Executed = 0;
+		threadStates[i].Steals = 0;
+		threadStates[i].NextVictim = i + 1;
+	}
+
+	// Index 0 belongs to the creating thread
+	workers.reserve(threadCount - 1);
+	for (unsigned int i = 1; i < threadCount; ++i)
+	{
+		workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping = true;
+	}
+	wakeUp.notify_all();
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+	delete[] threadStates;
+}
+
+JobSystem& JobSystem::GetInstance()
+{
+	static JobSystem instance;
+	return instance;
+}
+
+void JobSystem::AdoptCallingThread()
+{
+	ownerThread = std::this_thread::get_id();
+}
+
+void JobSystem::Run(JobFunction t_function, void* t_data, size_t t_begin, size_t t_end, JobCounter* t_counter, JobCounter* t_dependency)
+{
+	Job job = { t_function, t_data, t_begin, t_end, t_counter };
+	if (t_counter != nullptr)
+	{
+		++t_counter->value;
+	}
+
+	if (t_dependency != nullptr && t_dependency->value.load() != 0)
+	{
+		// Park the job on the dependency. Check again under the lock, since the
+		// last job it was waiting for may have finished in the meantime. Only the
+		// count matters here: once it is zero, the continuations have been (or are
+		// about to be) taken, and anything parked now would never start.
+		std::unique_lock<std::mutex> lock(t_dependency->continuationMutex);
+		if (t_dependency->value.load() != 0)
+		{
+			t_dependency->continuations.push_back(job);
+			return;
+		}
+	}
+
+	Submit(job);
+}
+
+void JobSystem::Wait(const JobCounter* t_counter)
+{
+	int threadIndex = GetThreadIndex();
+	Job job;
+	while (!t_counter->IsDone())
+	{
+		if (TryGetJob(threadIndex, job))
+		{
+			Execute(threadIndex, job);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+unsigned int JobSystem::GetThreadCount() const
+{
+	return threadCount;
+}
+
+uint64_t JobSystem::GetExecutedCount() const
+{
+	uint64_t total = 0;
+	for (unsigned int i = 0; i < threadCount; ++i)
+	{
+		total += threadStates[i].Executed.load(std::memory_order_relaxed);
+	}
+	return total;
+}
+
+uint64_t JobSystem::GetStealCount() const
+{
+	uint64_t total = 0;
+	for (unsigned int i = 0; i < threadCount; ++i)
+	{
+		total += threadStates[i].Steals.load(std::memory_order_relaxed);
+	}
+	return total;
+}
+
+void JobSystem::ResetStats()
+{
+	for (unsigned int i = 0; i < threadCount; ++i)
+	{
+		threadStates[i].Executed = 0;
+		threadStates[i].Steals = 0;
+	}
+}
+
+int JobSystem::GetThreadIndex() const
+{
+	if (workerSystem == this)
+	{
+		return workerIndex;
+	}
+	return std::this_thread::get_id() == ownerThread.load(std::memory_order_relaxed) ? 0 : -1;
+}
+
+bool JobSystem::IsStarving() const
+{
+	return pendingJobs.load(std::memory_order_relaxed) < static_cast<int>(threadCount);
+}
+
+void JobSystem::Submit(const Job& t_job)
+{
+	int threadIndex = GetThreadIndex();
+	if (threadIndex >= 0)
+	{
+		if (!threadStates[threadIndex].Queue.Push(t_job))
+		{
+			// Queue is full, so there is plenty for everyone else to do already
+			Execute(threadIndex, t_job);
+			return;
+		}
+	}
+	else
+	{
+		std::lock_guard<std::mutex> lock(externalMutex);
+		externalJobs.push_back(t_job);
+		++externalCount;
+	}
+
+	++pendingJobs;
+	if (sleepingWorkers.load() > 0)
+	{
+		// Taking the lock orders this with a worker about to go to sleep
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		wakeUp.notify_one();
+	}
+}
+
+bool JobSystem::TryGetJob(int t_thread_index, Job& t_job)
+{
+	if (t_thread_index >= 0)
+	{
+		if (threadStates[t_thread_index].Queue.Pop(t_job))
+		{
+			--pendingJobs;
+			return true;
+		}
+	}
+
+	if (externalCount.load(std::memory_order_relaxed) > 0)
+	{
+		std::lock_guard<std::mutex> lock(externalMutex);
+		if (!externalJobs.empty())
+		{
+			t_job = externalJobs.front();
+			externalJobs.pop_front();
+			--externalCount;
+			--pendingJobs;
+			return true;
+		}
+	}
+
+	// Go round the other threads, starting after the last victim
+	unsigned int start = t_thread_index >= 0 ? threadStates[t_thread_index].NextVictim : 0;
+	for (unsigned int attempt = 0; attempt < threadCount; ++attempt)
+	{
+		unsigned int victim = (start + attempt) % threadCount;
+		if (static_cast<int>(victim) == t_thread_index)
+		{
+			continue;
+		}
+
+		if (threadStates[victim].Queue.Steal(t_job))
+		{
+			--pendingJobs;
+			if (t_thread_index >= 0)
+			{
+				threadStates[t_thread_index].NextVictim = victim;
+				threadStates[t_thread_index].Steals.fetch_add(1, std::memory_order_relaxed);
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+void JobSystem::Execute(int t_thread_index, const Job& t_job)
+{
+	t_job.Function(t_job);
+	if (t_thread_index >= 0)
+	{
+		threadStates[t_thread_index].Executed.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	JobCounter* counter = t_job.Counter;
+	if (counter == nullptr)
+	{
+		return;
+	}
+
+	// Keep the counter from reading as done until this job is through with it,
+	// since whoever waits on it may destroy it the moment it does
+	++counter->finishing;
+	if (--counter->value != 0)
+	{
+		--counter->finishing;
+		return;
+	}
+
+	// That was the last one: release anything waiting on this counter
+	std::vector<Job> ready;
+	{
+		std::lock_guard<std::mutex> lock(counter->continuationMutex);
+		ready.swap(counter->continuations);
+	}
+
+	// Last use of the counter; it may be gone after this
+	--counter->finishing;
+	for (const Job& job : ready)
+	{
+		Submit(job);
+	}
+}
+
+void JobSystem::WorkerLoop(unsigned int t_thread_index)
+{
+	workerSystem = this;
+	workerIndex = static_cast<int>(t_thread_index);
+
+	int idleSpins = 0;
+	Job job;
+	while (!stopping.load(std::memory_order_relaxed))
+	{
+		if (TryGetJob(workerIndex, job))
+		{
+			Execute(workerIndex, job);
+			idleSpins = 0;
+			continue;
+		}
+
+		if (++idleSpins < SpinsBeforeSleep)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		++sleepingWorkers;
+		wakeUp.wait(lock, [this]() { return stopping.load() || pendingJobs.load() > 0; });
+		--sleepingWorkers;
+		idleSpins = 0;
+	}
+
+	workerSystem = nullptr;
+	workerIndex = -1;
+}
@@ -0,0 +1,223 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Forward Declarations
+struct Job;
+class JobCounter;
+class JobSystem;
+
+typedef void (*JobFunction)(const Job& t_job);
+
+// A unit of work: t_function(job) gets called once on some thread.
+// Begin/End are free for the function to use, typically as an index range.
+struct Job
+{
+	JobFunction Function;
+	void* Data;
+	size_t Begin;
+	size_t End;
+	JobCounter* Counter;		// Decremented once the job has run (may be nullptr)
+};
+
+// Counts unfinished jobs. Run() adds one per job and each finished job
+// removes one, so waiting for zero waits for a whole batch. Jobs can also be
+// made to depend on a counter, in which case they start once it hits zero.
+// A counter must not be reused while jobs still depend on it. It is only
+// done once the job that took it to zero has also let go of it, so a waiter
+// can destroy it as soon as Wait() returns.
+class JobCounter
+{
+public:
+	JobCounter();
+
+	// Get number of jobs still outstanding.
+	int GetValue() const;
+
+	// Has every job counted by this counter finished?
+	bool IsDone() const;
+
+private:
+	friend class JobSystem;
+
+	std::atomic<int> value;
+	std::atomic<int> finishing;			// Jobs between their decrement and their last use of this counter
+	std::mutex continuationMutex;
+	std::vector<Job> continuations;		// Jobs to start when value drops to zero
+};
+
+// Fixed-size lock-free work-stealing deque (Chase-Lev, as formulated for
+// C11 atomics by Le et al.). Only the owning thread may Push and Pop, at the
+// bottom; any thread may Steal from the top.
+class WorkStealingQueue
+{
+public:
+	static const int64_t Capacity = 4096;
+
+	WorkStealingQueue();
+
+	// Push a job at the bottom. Returns false if the queue is full.
+	bool Push(const Job& t_job);
+
+	// Take the most recently pushed job. Returns false if empty.
+	bool Pop(Job& t_job);
+
+	// Take the oldest job. Returns false if empty or another thread won the race.
+	bool Steal(Job& t_job);
+
+private:
+	std::atomic<int64_t> top;
+	char padding[64];				// Keep the thieves' and the owner's ends on separate cache lines
+	std::atomic<int64_t> bottom;
+
+	// Jobs are stored by value. A slot is only overwritten once top has moved
+	// past it, so a thief that read a stale copy always loses its CAS.
+	Job buffer[Capacity];
+};
+
+// Work-stealing job scheduler.
+//
+// Every worker thread owns a WorkStealingQueue and so does the thread that
+// created the JobSystem. Idle threads steal from the others. Threads waiting
+// on a JobCounter run jobs while they wait instead of blocking. Jobs pushed
+// from any other thread go through a small locked queue instead.
+class JobSystem
+{
+public:
+	// Start t_thread_count - 1 worker threads (0 = one per hardware thread).
+	// The calling thread counts as the remaining one and works while waiting.
+	explicit JobSystem(unsigned int t_thread_count = 0);
+
+	// Destructor for JobSystem. Finishes nothing: wait on your counters first.
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	// Get the shared JobSystem, created by the first thread to ask for it.
+	static JobSystem& GetInstance();
+
+	// Give the creating thread's queue to the calling thread, for when the work
+	// that uses the jobs moves to another thread for good. No jobs may be in
+	// flight, and the old owner submits through the locked queue afterwards.
+	void AdoptCallingThread();
+
+	// Queue a job. t_counter (if any) is incremented now and decremented once the
+	// job has run. If t_dependency is given the job only starts once it reaches zero.
+	void Run(JobFunction t_function, void* t_data, size_t t_begin, size_t t_end, JobCounter* t_counter, JobCounter* t_dependency = nullptr);
+
+	// Run jobs until t_counter reaches zero.
+	void Wait(const JobCounter* t_counter);
+
+	// Call t_function(i) for every i in [0, t_count) and wait for all of them.
+	// The range is split in halves on demand, down to a grain size chosen from
+	// t_count and the thread count (never below t_min_grain), and only while
+	// there are idle threads to take the other half.
+	template<typename Function>
+	void ParallelFor(size_t t_count, size_t t_min_grain, Function& t_function)
+	{
+		if (t_count == 0)
+		{
+			return;
+		}
+
+		ParallelForData<Function> data;
+		data.System = this;
+		data.Body = &t_function;
+		data.Grain = std::max<size_t>(std::max<size_t>(t_min_grain, 1), t_count / (threadCount * 16));
+
+		JobCounter counter;
+		Run(&ParallelForRange<Function>, &data, 0, t_count, &counter);
+		Wait(&counter);
+	}
+
+	// Get number of threads doing work, including the owning thread.
+	unsigned int GetThreadCount() const;
+
+	// Get total jobs run and jobs stolen since the last ResetStats().
+	uint64_t GetExecutedCount() const;
+	uint64_t GetStealCount() const;
+	void ResetStats();
+
+private:
+	template<typename Function>
+	struct ParallelForData
+	{
+		JobSystem* System;
+		Function* Body;
+		size_t Grain;
+	};
+
+	template<typename Function>
+	static void ParallelForRange(const Job& t_job)
+	{
+		ParallelForData<Function>* data = static_cast<ParallelForData<Function>*>(t_job.Data);
+		size_t begin = t_job.Begin;
+		size_t end = t_job.End;
+
+		// Hand off the upper half for as long as someone is around to take it
+		while (end - begin > data->Grain && data->System->IsStarving())
+		{
+			size_t middle = begin + (end - begin) / 2;
+			data->System->Run(&ParallelForRange<Function>, data, middle, end, t_job.Counter);
+			end = middle;
+		}
+
+		for (size_t i = begin; i < end; ++i)
+		{
+			(*data->Body)(i);
+		}
+	}
+
+	// Per-thread bookkeeping, padded so threads do not share cache lines.
+	struct ThreadState
+	{
+		WorkStealingQueue Queue;
+		std::atomic<uint64_t> Executed;
+		std::atomic<uint64_t> Steals;
+		unsigned int NextVictim;
+		char Padding[64];
+	};
+
+	// Index of the calling thread's ThreadState, or -1 for outside threads.
+	int GetThreadIndex() const;
+
+	// Are there fewer queued jobs than threads that could run them?
+	bool IsStarving() const;
+
+	// Queue a ready job from the calling thread.
+	void Submit(const Job& t_job);
+
+	// Find a job to run: own queue, then outside submissions, then stealing.
+	bool TryGetJob(int t_thread_index, Job& t_job);
+
+	// Run a job and retire it.
+	void Execute(int t_thread_index, const Job& t_job);
+
+	// Main loop of the worker threads.
+	void WorkerLoop(unsigned int t_thread_index);
+
+	unsigned int threadCount;
+	std::atomic<std::thread::id> ownerThread;
+	ThreadState* threadStates;
+	std::vector<std::thread> workers;
+
+	// Jobs submitted from threads without a queue of their own
+	std::mutex externalMutex;
+	std::deque<Job> externalJobs;
+	std::atomic<size_t> externalCount;
+
+	// Sleeping support for idle workers
+	std::atomic<int> pendingJobs;
+	std::atomic<int> sleepingWorkers;
+	std::mutex sleepMutex;
+	std::condition_variable wakeUp;
+	std::atomic<bool> stopping;
+};
@@ -1,6 +1,19 @@
 
 #include <Windows.h>
 #include "Game.h"
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+	// Get the number following option on the command line, or
+	// defaultValue if the option isn't there
+	double GetOption(const char* commandLine, const char* option, double defaultValue)
+	{
+		const char* found = strstr(commandLine, option);
+		return found != nullptr ? strtod(found + strlen(option), nullptr) : defaultValue;
+	}
+}
 
 // --------------------------------------------------------
 // Entry point for a graphical (non-console) Windows application
@@ -22,6 +35,21 @@ int WINAPI WinMain(
 	// the app handle we got from WinMain
 	Game dxGame(hInstance);
 
+	// Time the engine's systems before playing, if asked to
+	dxGame.SetBenchmarksEnabled(strstr(lpCmdLine, "-benchmark") != nullptr);
+
+	// Print what the engine is up to, in debug builds
+	dxGame.SetStatsEnabled(strstr(lpCmdLine, "-stats") != nullptr);
+
+	// Frame loop options, e.g. "-latency 1" to run Update a frame ahead of Draw
+	// or "-tickrate 60" to simulate at a steady 60 Hz whatever the frame rate.
+	// "-fpscap 144" draws at most 144 frames a second; it knows nothing of the
+	// display's refresh rate, so pick the number to suit the monitor.
+	dxGame.SetPipelineLatency((unsigned int)GetOption(lpCmdLine, "-latency", 0));
+	double tickRate = GetOption(lpCmdLine, "-tickrate", 0);
+	dxGame.SetFixedTimeStep(tickRate > 0 ? (float)(1.0 / tickRate) : 0.0f);
+	dxGame.SetFrameRateLimit((float)GetOption(lpCmdLine, "-fpscap", 0));
+
 	// Result variable for function calls below
 	HRESULT hr = S_OK;
 
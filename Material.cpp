@@ -1,15 +1,41 @@
 #include "Material.h"
 #include "SimpleShader.h"
+#include <atomic>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	// Materials can be made on any thread, e.g. by background work
+	std::atomic<unsigned int> materialCount(0);
+
+	// Every shader pair seen so far; a pair's sort id is where it is in here
+	std::mutex shaderPairsMutex;
+	std::vector<std::pair<SimpleVertexShader*, SimplePixelShader*>> shaderPairs;
+}
 
 Material::Material(SimpleVertexShader* t_vertex_shader, SimplePixelShader* t_pixel_shader, ID3D11ShaderResourceView* t_diffused_srv, ID3D11ShaderResourceView* t_normal_srv, ID3D11SamplerState* t_sampler) :
 	vertexShader(t_vertex_shader), pixelShader(t_pixel_shader), diffused_srv(t_diffused_srv), normal_srv(t_normal_srv), sampler(t_sampler)
 {
+	sort_id = materialCount++;
+
+	std::pair<SimpleVertexShader*, SimplePixelShader*> shaders(t_vertex_shader, t_pixel_shader);
+	std::lock_guard<std::mutex> lock(shaderPairsMutex);
+	for (shader_sort_id = 0; shader_sort_id < shaderPairs.size() && shaderPairs[shader_sort_id] != shaders; ++shader_sort_id)
+	{
+	}
+	if (shader_sort_id == shaderPairs.size())
+	{
+		shaderPairs.push_back(shaders);
+	}
 }
 
 Material::~Material()
 {
 	vertexShader = nullptr;
 	pixelShader = nullptr;
+	instancedVertexShader = nullptr;
 	diffused_srv = nullptr;
 	normal_srv = nullptr;
 	sampler = nullptr;
@@ -25,6 +51,16 @@ SimplePixelShader* Material::getPixelShader() const
 	return pixelShader;
 }
 
+SimpleVertexShader* Material::getInstancedVertexShader() const
+{
+	return instancedVertexShader;
+}
+
+void Material::setInstancedVertexShader(SimpleVertexShader* t_vertex_shader)
+{
+	instancedVertexShader = t_vertex_shader;
+}
+
 ID3D11ShaderResourceView* Material::getdiffusedSRV() const
 {
 	return diffused_srv;
@@ -41,3 +77,33 @@ ID3D11SamplerState* Material::getSamplerState() const
 {
 	return sampler;
 }
+
+const DirectX::XMFLOAT4& Material::getColorTint() const
+{
+	return color_tint;
+}
+
+void Material::setColorTint(const DirectX::XMFLOAT4& t_color_tint)
+{
+	color_tint = t_color_tint;
+}
+
+bool Material::isTransparent() const
+{
+	return transparent;
+}
+
+void Material::setTransparent(bool t_transparent)
+{
+	transparent = t_transparent;
+}
+
+unsigned int Material::getSortId() const
+{
+	return sort_id;
+}
+
+unsigned int Material::getShaderSortId() const
+{
+	return shader_sort_id;
+}
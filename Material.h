@@ -1,4 +1,5 @@
 #pragma once
+#include <DirectXMath.h>
 
 // Forward Declarations
 class SimpleVertexShader;
@@ -19,6 +20,11 @@ public:
 	// Get Vertex Shader of the Material
 	SimpleVertexShader* getVertexShader() const;
 
+	// Get/Set the vertex shader to draw instances of this Material by object index. It must take the instance
+	// data of InstanceBatcher, read ObjectTable's data as "objects", and feed the same pixel shader. Null (the default) if there is none.
+	SimpleVertexShader* getInstancedVertexShader() const;
+	void setInstancedVertexShader(SimpleVertexShader* t_vertex_shader);
+
 	// Get Pixel Shader of the Material
 	SimplePixelShader* getPixelShader() const;
 
@@ -31,11 +37,29 @@ public:
 	// Get Pixel Shader of the Material
 	ID3D11SamplerState* getSamplerState() const;
 
+	// Get/Set the color the lit texture is multiplied by; its alpha is the opacity. White by default.
+	const DirectX::XMFLOAT4& getColorTint() const;
+	void setColorTint(const DirectX::XMFLOAT4& t_color_tint);
+
+	// Get/Set whether this Material blends with what is behind it, so it has to be drawn back to front.
+	bool isTransparent() const;
+	void setTransparent(bool t_transparent);
+
+	// Get small ids for sorting draws: one per Material, and one per vertex/pixel shader pair.
+	// Materials should be made on one thread, since the ids are handed out without locking.
+	unsigned int getSortId() const;
+	unsigned int getShaderSortId() const;
+
 private:
 	SimpleVertexShader* vertexShader = nullptr;
 	SimplePixelShader* pixelShader = nullptr;
+	SimpleVertexShader* instancedVertexShader = nullptr;
 	ID3D11ShaderResourceView* diffused_srv = nullptr;
 	ID3D11ShaderResourceView* normal_srv = nullptr;
 	ID3D11SamplerState* sampler = nullptr;
+	DirectX::XMFLOAT4 color_tint = DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+	bool transparent = false;
+	unsigned int sort_id = 0;
+	unsigned int shader_sort_id = 0;
 
 };
\ No newline at end of file
@@ -1,14 +1,25 @@
 #include "Mesh.h"
 #include "Vertex.h"
+#include "TriangleBVH.h"
+#include "CollisionProxy.h"
+#include <atomic>
 
 using namespace DirectX;
 
+namespace
+{
+	// Decal meshes are built by background work, which may be on the simulation thread
+	std::atomic<unsigned int> meshCount(0);
+}
+
 Mesh::Mesh(ID3D11Device* pDevice, Vertex* pVerts, UINT numVerts, UINT* pIndices, UINT numIndices)
+	: SortId(meshCount++)
 {
 	CreateBuffers(pDevice, pVerts, numVerts, pIndices, numIndices);
 }
 
-Mesh::Mesh(ID3D11Device* pDevice, char* objFile)
+Mesh::Mesh(ID3D11Device* pDevice, const char* objFile)
+	: SortId(meshCount++)
 {
 	// File input object
 	std::ifstream obj(objFile);
@@ -181,6 +192,9 @@ Mesh::Mesh(ID3D11Device* pDevice, char* objFile)
 
 Mesh::~Mesh()
 {
+	delete TriangleTree;
+	delete Proxy;
+
 	if (VertexBuffer)
 	{
 		VertexBuffer->Release();
@@ -207,8 +221,74 @@ const UINT Mesh::GetIndexCount() const
 	return IndexCount;
 }
 
+const std::vector<Vertex>& Mesh::GetVertices() const
+{
+	return Vertices;
+}
+
+const std::vector<UINT>& Mesh::GetIndices() const
+{
+	return Indices;
+}
+
+const DirectX::XMFLOAT3& Mesh::GetBoundsMin() const
+{
+	return BoundsMin;
+}
+
+const DirectX::XMFLOAT3& Mesh::GetBoundsMax() const
+{
+	return BoundsMax;
+}
+
+const TriangleBVH* Mesh::GetTriangleBVH()
+{
+	if (!TriangleTree)
+	{
+		TriangleTree = new TriangleBVH(Vertices, Indices);
+	}
+	return TriangleTree;
+}
+
+const CollisionProxy* Mesh::GetCollisionProxy() const
+{
+	return Proxy;
+}
+
+void Mesh::SetCollisionProxy(CollisionProxy* t_proxy)
+{
+	if (Proxy != t_proxy)
+	{
+		delete Proxy;
+		Proxy = t_proxy;
+	}
+}
+
+unsigned int Mesh::GetSortId() const
+{
+	return SortId;
+}
+
 void Mesh::CreateBuffers(ID3D11Device* pDevice, Vertex* pVerts, UINT numVerts, UINT* pIndices, UINT numIndices)
 {
+	// Keep a CPU-side copy around for decals, collision and other CPU work
+	Vertices.assign(pVerts, pVerts + numVerts);
+	Indices.assign(pIndices, pIndices + numIndices);
+
+	if (numVerts > 0)
+	{
+		XMVECTOR minimum = XMLoadFloat3(&pVerts[0].Position);
+		XMVECTOR maximum = minimum;
+		for (UINT i = 1; i < numVerts; ++i)
+		{
+			XMVECTOR position = XMLoadFloat3(&pVerts[i].Position);
+			minimum = XMVectorMin(minimum, position);
+			maximum = XMVectorMax(maximum, position);
+		}
+		XMStoreFloat3(&BoundsMin, minimum);
+		XMStoreFloat3(&BoundsMax, maximum);
+	}
+
 	// Create the VERTEX BUFFER description -----------------------------------
 	// - The description is created on the stack because we only need
 	//    it to create the buffer.  The description is then useless.
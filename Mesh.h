@@ -3,6 +3,11 @@
 #include <vector>
 #include <iostream>
 #include <fstream>
+#include "Vertex.h"
+
+// Forward Declaration
+class TriangleBVH;
+struct CollisionProxy;
 
 class Mesh
 {
@@ -11,7 +16,7 @@ public:
 	Mesh(ID3D11Device* pDevice, struct Vertex* pVerts, UINT numVerts, UINT* pIndices, UINT numIndices);
 
 	// Create a Mesh from object data in file.
-	Mesh(ID3D11Device* pDevice, char* objFile);
+	Mesh(ID3D11Device* pDevice, const char* objFile);
 
 	// Destructor for Mesh class. Calls Release() on both Vertex & Index buffers.
 	~Mesh();
@@ -25,6 +30,28 @@ public:
 	// Retrieve number of Vertices this Mesh contains.
 	const UINT GetIndexCount() const;
 
+	// Get the CPU-side copy of this Mesh's vertices.
+	const std::vector<Vertex>& GetVertices() const;
+
+	// Get the CPU-side copy of this Mesh's indices.
+	const std::vector<UINT>& GetIndices() const;
+
+	// Get the local space bounding box of this Mesh.
+	const DirectX::XMFLOAT3& GetBoundsMin() const;
+	const DirectX::XMFLOAT3& GetBoundsMax() const;
+
+	// Get the triangle BVH of this Mesh, building it on first use.
+	const TriangleBVH* GetTriangleBVH();
+
+	// Get the simplified collision shapes of this Mesh (nullptr until generated).
+	const CollisionProxy* GetCollisionProxy() const;
+
+	// Set the collision shapes of this Mesh. The Mesh takes ownership of t_proxy.
+	void SetCollisionProxy(CollisionProxy* t_proxy);
+
+	// Get a small id, unique to this Mesh, for sorting draws.
+	unsigned int GetSortId() const;
+
 private:
 
 	// Vertex Buffer of this Mesh
@@ -34,7 +61,24 @@ private:
 	ID3D11Buffer* VertexBuffer = nullptr;
 
 	// Specifies how many indices are there in Mesh's Index buffer.
-	UINT IndexCount;
+	UINT IndexCount = 0;
+
+	// CPU-side copies of the buffer contents, for CPU geometry queries.
+	std::vector<Vertex> Vertices;
+	std::vector<UINT> Indices;
+
+	// Local space bounding box of the vertices.
+	DirectX::XMFLOAT3 BoundsMin = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+	DirectX::XMFLOAT3 BoundsMax = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+
+	// Spatial index over this Mesh's triangles (built lazily).
+	TriangleBVH* TriangleTree = nullptr;
+
+	// Convex hull, k-DOP and oriented box generated from this Mesh.
+	CollisionProxy* Proxy = nullptr;
+
+	// Handed out in order of creation. Meshes should be made on one thread.
+	unsigned int SortId = 0;
 
 	void CreateBuffers(ID3D11Device* pDevice, Vertex* pVerts, UINT numVerts, UINT* pIndices, UINT numIndices);
 };
\ No newline at end of file
@@ -0,0 +1,147 @@
+#include "ObjectTable.h"
+#include "Material.h"
+#include "RenderSnapshot.h"
+#include <cstring>
+
+void ObjectTable::Update(const RenderSnapshot& t_frame, const RenderSnapshot& t_previous, bool t_interpolate, float t_alpha)
+{
+	++updateCount;
+
+	// Objects come and go between snapshots, and the order of the rest can
+	// change, so items are paired with the previous ones by Source
+	if (t_interpolate && t_previous.Frame != previousItemsFrame)
+	{
+		previousItems.clear();
+		for (size_t i = 0; i < t_previous.Items.size(); ++i)
+		{
+			previousItems[t_previous.Items[i].Source] = (unsigned int)i;
+		}
+		previousItemsFrame = t_previous.Frame;
+	}
+
+	itemSlots.resize(t_frame.Items.size());
+	for (size_t i = 0; i < t_frame.Items.size(); ++i)
+	{
+		// The Source check covers an index left over from a snapshot with the same Frame
+		const RenderItem* previousItem = nullptr;
+		if (t_interpolate)
+		{
+			std::unordered_map<const void*, unsigned int>::const_iterator previous = previousItems.find(t_frame.Items[i].Source);
+			if (previous != previousItems.end() && previous->second < t_previous.Items.size() &&
+				t_previous.Items[previous->second].Source == t_frame.Items[i].Source)
+			{
+				previousItem = &t_previous.Items[previous->second];
+			}
+		}
+		const RenderItem& item = previousItem
+			? RenderSnapshot::InterpolateItem(*previousItem, t_frame.Items[i], t_alpha)
+			: t_frame.Items[i];
+
+		unsigned int slot;
+		std::unordered_map<const void*, unsigned int>::iterator found = slotsBySource.find(item.Source);
+		if (found != slotsBySource.end())
+		{
+			slot = found->second;
+		}
+		else
+		{
+			if (!freeSlots.empty())
+			{
+				slot = freeSlots.back();
+				freeSlots.pop_back();
+			}
+			else
+			{
+				slot = (unsigned int)objects.size();
+				sources.push_back(nullptr);
+				lastUpdates.push_back(0);
+				objects.push_back(ObjectData());
+				changed.push_back(0);
+				memset(&objects[slot], 0, sizeof(ObjectData));
+			}
+			sources[slot] = item.Source;
+			slotsBySource[item.Source] = slot;
+		}
+
+		ObjectData data;
+		data.World = item.World;
+		data.WorldInverseTranspose = item.WorldInverseTranspose;
+		data.MaterialIndex = item.MaterialData ? item.MaterialData->getSortId() : 0;
+		memset(data.Padding, 0, sizeof(data.Padding));
+		SetObject(slot, data);
+
+		lastUpdates[slot] = updateCount;
+		itemSlots[i] = slot;
+	}
+
+	// Objects that were not drawn this time give their slots up
+	for (unsigned int slot = 0; slot < sources.size(); ++slot)
+	{
+		if (sources[slot] && lastUpdates[slot] != updateCount)
+		{
+			slotsBySource.erase(sources[slot]);
+			sources[slot] = nullptr;
+			freeSlots.push_back(slot);
+		}
+	}
+}
+
+const std::vector<unsigned int>& ObjectTable::GetItemSlots() const
+{
+	return itemSlots;
+}
+
+const std::vector<ObjectData>& ObjectTable::GetObjects() const
+{
+	return objects;
+}
+
+const std::vector<ObjectTable::Range>& ObjectTable::GetChanges()
+{
+	if (!changesCurrent)
+	{
+		changes.clear();
+		unsigned int slot = 0;
+		unsigned int slotCount = (unsigned int)changed.size();
+		while (slot < slotCount)
+		{
+			if (!changed[slot])
+			{
+				++slot;
+				continue;
+			}
+			Range range = { slot, slot + 1 };
+			while (range.End < slotCount && changed[range.End])
+			{
+				++range.End;
+			}
+			changes.push_back(range);
+			slot = range.End;
+		}
+		changesCurrent = true;
+	}
+	return changes;
+}
+
+void ObjectTable::ClearChanges()
+{
+	memset(changed.data(), 0, changed.size());
+	changes.clear();
+	changesCurrent = true;
+}
+
+void ObjectTable::MarkAllChanged()
+{
+	memset(changed.data(), 1, changed.size());
+	changesCurrent = false;
+}
+
+void ObjectTable::SetObject(unsigned int t_slot, const ObjectData& t_data)
+{
+	if (memcmp(&objects[t_slot], &t_data, sizeof(ObjectData)) != 0)
+	{
+		objects[t_slot] = t_data;
+		changed[t_slot] = 1;
+		changesCurrent = false;
+	}
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+struct RenderSnapshot;
+
+// One object's entry in the StructuredBuffer VertexShaderInstanced.hlsl reads.
+// Matrices are transposed for HLSL, as Entity stores them.
+struct ObjectData
+{
+	DirectX::XMFLOAT4X4 World;
+	DirectX::XMFLOAT4X4 WorldInverseTranspose;
+	unsigned int MaterialIndex;		// The Material's sort id
+	unsigned int Padding[3];		// Keeps the stride a multiple of 16 bytes
+};
+
+// Keeps every drawn object's data in a slot of its own from frame to frame,
+// so the GPU copy can stay where it is and draws only need slot indices.
+// Slots are written only when an object's data differs from what they hold,
+// so objects that stay put are sent once, and only the changed slots after.
+class ObjectTable
+{
+public:
+	// Slots [Begin, End), all of which changed.
+	struct Range
+	{
+		unsigned int Begin;
+		unsigned int End;
+	};
+
+	// Put each item of t_frame in the slot its Source had last time, or a free
+	// one. When t_interpolate is set, items are blended by t_alpha from the
+	// items with the same Source in t_previous, as Draw blends them; items new
+	// since t_previous are taken as they are. Slots of objects no longer in
+	// t_frame are freed.
+	void Update(const RenderSnapshot& t_frame, const RenderSnapshot& t_previous, bool t_interpolate, float t_alpha);
+
+	// Get the slot of each item of the last Update(), by item index.
+	const std::vector<unsigned int>& GetItemSlots() const;
+
+	// Get the data of every slot. Free slots keep what they last held.
+	const std::vector<ObjectData>& GetObjects() const;
+
+	// Get the runs of slots that changed since the last ClearChanges(), in order.
+	const std::vector<Range>& GetChanges();
+	void ClearChanges();
+
+	// Count every slot as changed, as when the GPU copy has to be made again.
+	void MarkAllChanged();
+
+private:
+	// Write a slot's data, noting the change if there is one
+	void SetObject(unsigned int t_slot, const ObjectData& t_data);
+
+	std::unordered_map<const void*, unsigned int> slotsBySource;
+
+	// Index of each item of the snapshot blended from, by Source. Rebuilt only
+	// when that snapshot's Frame moves on, since Draw blends from the same one
+	// for as many frames as it runs between simulation steps.
+	std::unordered_map<const void*, unsigned int> previousItems;
+	uint64_t previousItemsFrame = UINT64_MAX;
+	std::vector<const void*> sources;			// By slot, null when free
+	std::vector<uint64_t> lastUpdates;			// By slot, the Update() that last used it
+	std::vector<ObjectData> objects;
+	std::vector<unsigned int> freeSlots;
+	std::vector<unsigned int> itemSlots;
+	uint64_t updateCount = 0;
+
+	std::vector<unsigned char> changed;			// By slot
+	std::vector<Range> changes;
+	bool changesCurrent = true;			// changes matches changed
+};
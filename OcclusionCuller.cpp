@@ -0,0 +1,443 @@
+#include "OcclusionCuller.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// Pyramid texels per axis a box may cover at the level it is tested on
+	const int MaxTestTexels = 4;
+
+	// Smallest triangle area, in square pixels, still worth rasterizing
+	const float MinTriangleArea = 1e-6f;
+
+	double SecondsSince(std::chrono::steady_clock::time_point t_start)
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+	}
+
+	// Point where the edge from t_a to t_b crosses the near plane (clip z = 0)
+	XMFLOAT4 ClipToNear(const XMFLOAT4& t_a, const XMFLOAT4& t_b)
+	{
+		float t = t_a.z / (t_a.z - t_b.z);
+		return XMFLOAT4(
+			t_a.x + (t_b.x - t_a.x) * t,
+			t_a.y + (t_b.y - t_a.y) * t,
+			0.0f,
+			t_a.w + (t_b.w - t_a.w) * t);
+	}
+}
+
+OcclusionCuller::OcclusionCuller(unsigned int t_width, unsigned int t_height)
+{
+	tilesX = (std::max)((t_width + TileSize - 1) / TileSize, 1u);
+	tilesY = (std::max)((t_height + TileSize - 1) / TileSize, 1u);
+	width = tilesX * TileSize;
+	height = tilesY * TileSize;
+	tileBins.resize(tilesX * tilesY);
+
+	unsigned int levelWidth = width;
+	unsigned int levelHeight = height;
+	while (true)
+	{
+		levels.push_back(std::vector<float>(levelWidth * levelHeight, 1.0f));
+		levelWidths.push_back(levelWidth);
+		levelHeights.push_back(levelHeight);
+		if (levelWidth == 1 && levelHeight == 1)
+		{
+			break;
+		}
+		levelWidth = (levelWidth + 1) / 2;
+		levelHeight = (levelHeight + 1) / 2;
+	}
+
+	XMStoreFloat4x4(&viewProjection, XMMatrixIdentity());
+	testedCount = 0;
+	occludedCount = 0;
+	setupSeconds = 0.0;
+	rasterizeSeconds = 0.0;
+	hiZSeconds = 0.0;
+	testSeconds = 0.0;
+}
+
+void OcclusionCuller::BeginFrame(const XMFLOAT4X4& t_view, const XMFLOAT4X4& t_projection)
+{
+	XMMATRIX view = XMMatrixTranspose(XMLoadFloat4x4(&t_view));
+	XMMATRIX projection = XMMatrixTranspose(XMLoadFloat4x4(&t_projection));
+	XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(view, projection));
+
+	triangles.clear();
+	for (std::vector<unsigned int>& bin : tileBins)
+	{
+		bin.clear();
+	}
+	std::fill(levels[0].begin(), levels[0].end(), 1.0f);
+
+	testedCount = 0;
+	occludedCount = 0;
+	setupSeconds = 0.0;
+	rasterizeSeconds = 0.0;
+	hiZSeconds = 0.0;
+	testSeconds = 0.0;
+}
+
+void OcclusionCuller::AddOccluder(const XMFLOAT3* t_positions, size_t t_stride, size_t t_vertex_count,
+	const unsigned int* t_indices, size_t t_index_count, const XMFLOAT4X4& t_world)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	XMMATRIX worldViewProjection = XMMatrixMultiply(XMMatrixTranspose(XMLoadFloat4x4(&t_world)), XMLoadFloat4x4(&viewProjection));
+
+	// Every vertex once, however many triangles share it
+	clipPositions.resize(t_vertex_count);
+	const char* position = reinterpret_cast<const char*>(t_positions);
+	for (size_t i = 0; i < t_vertex_count; ++i, position += t_stride)
+	{
+		XMVECTOR local = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(position));
+		XMStoreFloat4(&clipPositions[i], XMVector3Transform(local, worldViewProjection));
+	}
+
+	for (size_t i = 0; i + 2 < t_index_count; i += 3)
+	{
+		const XMFLOAT4* corners[3] = { &clipPositions[t_indices[i]], &clipPositions[t_indices[i + 1]], &clipPositions[t_indices[i + 2]] };
+		int inFront = (corners[0]->z >= 0.0f) + (corners[1]->z >= 0.0f) + (corners[2]->z >= 0.0f);
+
+		if (inFront == 3)
+		{
+			AddScreenTriangle(*corners[0], *corners[1], *corners[2]);
+		}
+		else if (inFront > 0)
+		{
+			// Cut off the part behind the near plane, leaving a triangle or a quad
+			XMFLOAT4 polygon[4];
+			int count = 0;
+			for (int c = 0; c < 3; ++c)
+			{
+				const XMFLOAT4& current = *corners[c];
+				const XMFLOAT4& next = *corners[(c + 1) % 3];
+				if (current.z >= 0.0f)
+				{
+					polygon[count++] = current;
+				}
+				if ((current.z >= 0.0f) != (next.z >= 0.0f))
+				{
+					polygon[count++] = ClipToNear(current, next);
+				}
+			}
+
+			AddScreenTriangle(polygon[0], polygon[1], polygon[2]);
+			if (count == 4)
+			{
+				AddScreenTriangle(polygon[0], polygon[2], polygon[3]);
+			}
+		}
+	}
+
+	setupSeconds += SecondsSince(start);
+}
+
+void OcclusionCuller::Rasterize()
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	// Tiles own disjoint pixels, so they need no locking
+	auto rasterizeTile = [this](size_t t_tile)
+	{
+		RasterizeTile((unsigned int)t_tile);
+	};
+	JobSystem::GetInstance().ParallelFor(tileBins.size(), 1, rasterizeTile);
+
+	rasterizeSeconds += SecondsSince(start);
+
+	start = std::chrono::steady_clock::now();
+	BuildHiZ();
+	hiZSeconds += SecondsSince(start);
+}
+
+bool OcclusionCuller::TestBox(const XMFLOAT3& t_min, const XMFLOAT3& t_max)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	++testedCount;
+
+	XMMATRIX matrix = XMLoadFloat4x4(&viewProjection);
+	float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+	float nearest = FLT_MAX;
+	bool crossesNear = false;
+	for (int corner = 0; corner < 8; ++corner)
+	{
+		XMVECTOR point = XMVectorSet(
+			corner & 1 ? t_max.x : t_min.x,
+			corner & 2 ? t_max.y : t_min.y,
+			corner & 4 ? t_max.z : t_min.z,
+			1.0f);
+		XMFLOAT4 clip;
+		XMStoreFloat4(&clip, XMVector4Transform(point, matrix));
+		if (clip.z < 0.0f || clip.w <= 0.0f)
+		{
+			crossesNear = true;
+			break;
+		}
+
+		float inverseW = 1.0f / clip.w;
+		float x = (clip.x * inverseW * 0.5f + 0.5f) * width;
+		float y = (0.5f - clip.y * inverseW * 0.5f) * height;
+		minX = (std::min)(minX, x);
+		maxX = (std::max)(maxX, x);
+		minY = (std::min)(minY, y);
+		maxY = (std::max)(maxY, y);
+		nearest = (std::min)(nearest, clip.z * inverseW);
+	}
+
+	// Anything reaching past the near plane is right in front of the camera
+	if (crossesNear)
+	{
+		testSeconds += SecondsSince(start);
+		return true;
+	}
+
+	bool visible = false;
+	if (maxX >= 0.0f && maxY >= 0.0f && minX < (float)width && minY < (float)height)
+	{
+		int pixelMinX = (int)(std::max)(minX, 0.0f);
+		int pixelMinY = (int)(std::max)(minY, 0.0f);
+		int pixelMaxX = (int)(std::min)(maxX, (float)(width - 1));
+		int pixelMaxY = (int)(std::min)(maxY, (float)(height - 1));
+
+		// Go up the pyramid until only a few texels cover the box
+		size_t level = 0;
+		while (level + 1 < levels.size() &&
+			((pixelMaxX >> level) - (pixelMinX >> level) >= MaxTestTexels || (pixelMaxY >> level) - (pixelMinY >> level) >= MaxTestTexels))
+		{
+			++level;
+		}
+
+		const std::vector<float>& depths = levels[level];
+		unsigned int levelWidth = levelWidths[level];
+		for (int y = pixelMinY >> level; y <= (pixelMaxY >> level) && !visible; ++y)
+		{
+			for (int x = pixelMinX >> level; x <= (pixelMaxX >> level); ++x)
+			{
+				if (nearest <= depths[y * levelWidth + x])
+				{
+					visible = true;
+					break;
+				}
+			}
+		}
+	}
+
+	if (!visible)
+	{
+		++occludedCount;
+	}
+	testSeconds += SecondsSince(start);
+	return visible;
+}
+
+unsigned int OcclusionCuller::GetWidth() const
+{
+	return width;
+}
+
+unsigned int OcclusionCuller::GetHeight() const
+{
+	return height;
+}
+
+float OcclusionCuller::GetDepth(unsigned int t_x, unsigned int t_y) const
+{
+	return levels[0][t_y * width + t_x];
+}
+
+size_t OcclusionCuller::GetOccluderTriangleCount() const
+{
+	return triangles.size();
+}
+
+size_t OcclusionCuller::GetTestedCount() const
+{
+	return testedCount;
+}
+
+size_t OcclusionCuller::GetOccludedCount() const
+{
+	return occludedCount;
+}
+
+float OcclusionCuller::GetSetupMilliseconds() const
+{
+	return (float)(setupSeconds * 1000.0);
+}
+
+float OcclusionCuller::GetRasterizeMilliseconds() const
+{
+	return (float)(rasterizeSeconds * 1000.0);
+}
+
+float OcclusionCuller::GetHiZMilliseconds() const
+{
+	return (float)(hiZSeconds * 1000.0);
+}
+
+float OcclusionCuller::GetTestMilliseconds() const
+{
+	return (float)(testSeconds * 1000.0);
+}
+
+void OcclusionCuller::AddScreenTriangle(const XMFLOAT4& t_a, const XMFLOAT4& t_b, const XMFLOAT4& t_c)
+{
+	const XMFLOAT4* corners[3] = { &t_a, &t_b, &t_c };
+	float x[3], y[3], z[3];
+	for (int i = 0; i < 3; ++i)
+	{
+		if (corners[i]->w <= 0.0f)
+		{
+			return;
+		}
+		float inverseW = 1.0f / corners[i]->w;
+		x[i] = (corners[i]->x * inverseW * 0.5f + 0.5f) * width;
+		y[i] = (0.5f - corners[i]->y * inverseW * 0.5f) * height;
+		z[i] = corners[i]->z * inverseW;
+	}
+
+	// Both windings are drawn, so make every triangle counter-clockwise in these terms
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (area < 0.0f)
+	{
+		std::swap(x[1], x[2]);
+		std::swap(y[1], y[2]);
+		std::swap(z[1], z[2]);
+		area = -area;
+	}
+	if (area < MinTriangleArea)
+	{
+		return;
+	}
+
+	// Pixels whose centers fall inside the bounds, clamped to the buffer
+	float boundsMinX = (std::min)((std::min)(x[0], x[1]), x[2]) - 0.5f;
+	float boundsMaxX = (std::max)((std::max)(x[0], x[1]), x[2]) - 0.5f;
+	float boundsMinY = (std::min)((std::min)(y[0], y[1]), y[2]) - 0.5f;
+	float boundsMaxY = (std::max)((std::max)(y[0], y[1]), y[2]) - 0.5f;
+	if (boundsMaxX < 0.0f || boundsMaxY < 0.0f || boundsMinX > (float)(width - 1) || boundsMinY > (float)(height - 1))
+	{
+		return;
+	}
+
+	ScreenTriangle triangle;
+	triangle.MinX = (int)ceilf((std::max)(boundsMinX, 0.0f));
+	triangle.MinY = (int)ceilf((std::max)(boundsMinY, 0.0f));
+	triangle.MaxX = (int)floorf((std::min)(boundsMaxX, (float)(width - 1)));
+	triangle.MaxY = (int)floorf((std::min)(boundsMaxY, (float)(height - 1)));
+	if (triangle.MinX > triangle.MaxX || triangle.MinY > triangle.MaxY)
+	{
+		return;
+	}
+
+	// Edge i runs from corner i to corner i + 1 and is positive on the inside
+	for (int i = 0; i < 3; ++i)
+	{
+		int j = (i + 1) % 3;
+		triangle.EdgeA[i] = y[i] - y[j];
+		triangle.EdgeB[i] = x[j] - x[i];
+		triangle.EdgeC[i] = -(triangle.EdgeA[i] * x[i] + triangle.EdgeB[i] * y[i]);
+	}
+
+	triangle.DepthDeltaX = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+	triangle.DepthDeltaY = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) / area;
+	triangle.DepthBase = z[0] - triangle.DepthDeltaX * x[0] - triangle.DepthDeltaY * y[0];
+
+	unsigned int index = (unsigned int)triangles.size();
+	triangles.push_back(triangle);
+
+	for (unsigned int tileY = triangle.MinY / TileSize; tileY <= triangle.MaxY / TileSize; ++tileY)
+	{
+		for (unsigned int tileX = triangle.MinX / TileSize; tileX <= triangle.MaxX / TileSize; ++tileX)
+		{
+			tileBins[tileY * tilesX + tileX].push_back(index);
+		}
+	}
+}
+
+void OcclusionCuller::RasterizeTile(unsigned int t_tile)
+{
+	int tileMinX = (int)((t_tile % tilesX) * TileSize);
+	int tileMinY = (int)((t_tile / tilesX) * TileSize);
+	int tileMaxX = tileMinX + (int)TileSize - 1;
+	int tileMaxY = tileMinY + (int)TileSize - 1;
+
+	const XMVECTOR laneOffsets = XMVectorSet(0.5f, 1.5f, 2.5f, 3.5f);
+	const XMVECTOR zero = XMVectorZero();
+	std::vector<float>& depths = levels[0];
+
+	for (unsigned int index : tileBins[t_tile])
+	{
+		const ScreenTriangle& triangle = triangles[index];
+
+		// Tiles start on a multiple of four, so aligning down stays inside this one
+		int minX = (std::max)(triangle.MinX, tileMinX) & ~3;
+		int maxX = (std::min)(triangle.MaxX, tileMaxX);
+		int minY = (std::max)(triangle.MinY, tileMinY);
+		int maxY = (std::min)(triangle.MaxY, tileMaxY);
+
+		XMVECTOR edgeA0 = XMVectorReplicate(triangle.EdgeA[0]);
+		XMVECTOR edgeA1 = XMVectorReplicate(triangle.EdgeA[1]);
+		XMVECTOR edgeA2 = XMVectorReplicate(triangle.EdgeA[2]);
+		XMVECTOR depthDeltaX = XMVectorReplicate(triangle.DepthDeltaX);
+
+		for (int y = minY; y <= maxY; ++y)
+		{
+			// Everything that only depends on the row
+			float centerY = y + 0.5f;
+			XMVECTOR rowEdge0 = XMVectorReplicate(triangle.EdgeB[0] * centerY + triangle.EdgeC[0]);
+			XMVECTOR rowEdge1 = XMVectorReplicate(triangle.EdgeB[1] * centerY + triangle.EdgeC[1]);
+			XMVECTOR rowEdge2 = XMVectorReplicate(triangle.EdgeB[2] * centerY + triangle.EdgeC[2]);
+			XMVECTOR rowDepth = XMVectorReplicate(triangle.DepthBase + triangle.DepthDeltaY * centerY);
+			float* row = &depths[y * width];
+
+			for (int x = minX; x <= maxX; x += 4)
+			{
+				XMVECTOR centerX = XMVectorAdd(XMVectorReplicate((float)x), laneOffsets);
+				XMVECTOR edge0 = XMVectorMultiplyAdd(edgeA0, centerX, rowEdge0);
+				XMVECTOR edge1 = XMVectorMultiplyAdd(edgeA1, centerX, rowEdge1);
+				XMVECTOR edge2 = XMVectorMultiplyAdd(edgeA2, centerX, rowEdge2);
+				XMVECTOR inside = XMVectorAndInt(XMVectorAndInt(XMVectorGreaterOrEqual(edge0, zero), XMVectorGreaterOrEqual(edge1, zero)), XMVectorGreaterOrEqual(edge2, zero));
+
+				XMVECTOR depth = XMVectorMultiplyAdd(depthDeltaX, centerX, rowDepth);
+				XMVECTOR current = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&row[x]));
+				XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&row[x]), XMVectorSelect(current, XMVectorMin(current, depth), inside));
+			}
+		}
+	}
+}
+
+void OcclusionCuller::BuildHiZ()
+{
+	for (size_t level = 1; level < levels.size(); ++level)
+	{
+		const std::vector<float>& below = levels[level - 1];
+		std::vector<float>& above = levels[level];
+		unsigned int belowWidth = levelWidths[level - 1];
+		unsigned int belowHeight = levelHeights[level - 1];
+
+		for (unsigned int y = 0; y < levelHeights[level]; ++y)
+		{
+			// Odd sizes repeat the last row or column
+			unsigned int y0 = y * 2;
+			unsigned int y1 = (std::min)(y0 + 1, belowHeight - 1);
+			for (unsigned int x = 0; x < levelWidths[level]; ++x)
+			{
+				unsigned int x0 = x * 2;
+				unsigned int x1 = (std::min)(x0 + 1, belowWidth - 1);
+				float furthest = (std::max)(
+					(std::max)(below[y0 * belowWidth + x0], below[y0 * belowWidth + x1]),
+					(std::max)(below[y1 * belowWidth + x0], below[y1 * belowWidth + x1]));
+				above[y * levelWidths[level] + x] = furthest;
+			}
+		}
+	}
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+
+// Software occlusion culling: finds objects hidden behind others before the
+// GPU is asked to draw them.
+//
+// A frame goes in three steps. AddOccluder() transforms the triangles of a
+// few large meshes and sorts them into screen tiles. Rasterize() fills a
+// small depth buffer from them, one tile per job and four pixels per SIMD
+// step, then builds a hierarchical-Z pyramid where each texel holds the
+// furthest depth of the four below it. TestBox() then projects a world box
+// and compares its nearest depth with a handful of pyramid texels covering
+// it: if every one of them is nearer, the box is hidden.
+//
+// Everything runs on the CPU with std::chrono timing, so it behaves the
+// same without a device, window or Windows. Triangles are rasterized from
+// both sides, so single walls work as well as closed meshes.
+class OcclusionCuller
+{
+public:
+	// Width and height of a tile in pixels. Also what buffer sizes are rounded up to.
+	static const unsigned int TileSize = 32;
+
+	// Make a depth buffer of (at least) the given size.
+	OcclusionCuller(unsigned int t_width = 256, unsigned int t_height = 128);
+
+	// Start a new frame seen through the given (transposed, as Camera stores them) matrices.
+	// Clears the depth buffer, the occluders and the statistics.
+	void BeginFrame(const DirectX::XMFLOAT4X4& t_view, const DirectX::XMFLOAT4X4& t_projection);
+
+	// Add the triangles of a mesh placed by a (transposed) world matrix. Positions are
+	// t_stride bytes apart, so they can be read straight out of a vertex array.
+	void AddOccluder(const DirectX::XMFLOAT3* t_positions, size_t t_stride, size_t t_vertex_count,
+		const unsigned int* t_indices, size_t t_index_count, const DirectX::XMFLOAT4X4& t_world);
+
+	// Draw every occluder added since BeginFrame() and build the pyramid.
+	void Rasterize();
+
+	// Could any part of this world space box be seen? Only valid after Rasterize().
+	bool TestBox(const DirectX::XMFLOAT3& t_min, const DirectX::XMFLOAT3& t_max);
+
+	// Get buffer size in pixels.
+	unsigned int GetWidth() const;
+	unsigned int GetHeight() const;
+
+	// Get depth (0 near, 1 far) of a pixel of the full resolution buffer.
+	float GetDepth(unsigned int t_x, unsigned int t_y) const;
+
+	// Get counts since BeginFrame().
+	size_t GetOccluderTriangleCount() const;		// Triangles that reached the screen
+	size_t GetTestedCount() const;
+	size_t GetOccludedCount() const;
+
+	// Get milliseconds spent in each step since BeginFrame().
+	float GetSetupMilliseconds() const;				// Transforming, clipping and binning in AddOccluder()
+	float GetRasterizeMilliseconds() const;
+	float GetHiZMilliseconds() const;
+	float GetTestMilliseconds() const;
+
+private:
+	// A triangle ready to rasterize: edge functions that are positive inside,
+	// a depth plane and its pixel bounds.
+	struct ScreenTriangle
+	{
+		float EdgeA[3], EdgeB[3], EdgeC[3];
+		float DepthBase, DepthDeltaX, DepthDeltaY;		// Depth = Base + DeltaX * x + DeltaY * y
+		int MinX, MinY, MaxX, MaxY;
+	};
+
+	// Set up a triangle from clip space corners in front of the near plane and bin it.
+	void AddScreenTriangle(const DirectX::XMFLOAT4& t_a, const DirectX::XMFLOAT4& t_b, const DirectX::XMFLOAT4& t_c);
+
+	// Draw the binned triangles of one tile.
+	void RasterizeTile(unsigned int t_tile);
+
+	// Fill every level above 0 from the one below.
+	void BuildHiZ();
+
+	unsigned int width;
+	unsigned int height;
+	unsigned int tilesX;
+	unsigned int tilesY;
+
+	DirectX::XMFLOAT4X4 viewProjection;		// Not transposed
+
+	std::vector<ScreenTriangle> triangles;
+	std::vector<std::vector<unsigned int>> tileBins;
+	std::vector<DirectX::XMFLOAT4> clipPositions;	// Scratch for AddOccluder
+
+	// Level 0 is the depth buffer itself; each further level is half the size
+	std::vector<std::vector<float>> levels;
+	std::vector<unsigned int> levelWidths;
+	std::vector<unsigned int> levelHeights;
+
+	size_t testedCount;
+	size_t occludedCount;
+	double setupSeconds;
+	double rasterizeSeconds;
+	double hiZSeconds;
+	double testSeconds;
+};
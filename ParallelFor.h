@@ -0,0 +1,11 @@
+#pragma once
+#include "JobSystem.h"
+
+// Runs t_function(i) for every i in [0, t_count) on the shared JobSystem and
+// waits for all of them. The calling thread helps out while it waits, so this
+// may be nested inside another ParallelFor.
+template<typename Function>
+void ParallelFor(size_t t_count, Function t_function)
+{
+	JobSystem::GetInstance().ParallelFor(t_count, 1, t_function);
+}
@@ -5,13 +5,19 @@ struct DirectionalLight
 	float3 Direction;
 };
 
-cbuffer externalData : register(b0)
+// Split by how often they change, which the start of the name tells SimpleShader
+cbuffer perFrame : register(b0)
 {
 	DirectionalLight light;
 	DirectionalLight light_two;
 	float3 CameraPosition;
 };
 
+cbuffer perMaterial : register(b1)
+{
+	float4 ColorTint;		// Multiplies the lit texture color; alpha is the opacity
+};
+
 Texture2D DiffuseTexture : register(t0);
 Texture2D NormalTexture : register(t1);
 SamplerState BasicSampler : register(s0);
@@ -74,5 +80,5 @@ float4 main(VertexToPixel input) : SV_TARGET
 	// - This color (like most values passing through the rasterizer) is 
 	//   interpolated for each pixel between the corresponding vertices 
 	//   of the triangle we're rendering
-	return float4(lightColor* textureColor.rgb, 1);
+	return float4(lightColor* textureColor.rgb * ColorTint.rgb, ColorTint.a);
 }
\ No newline at end of file
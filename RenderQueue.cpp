@@ -0,0 +1,136 @@
+#include "RenderQueue.h"
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+	const unsigned int StateBits = RenderQueue::ShaderBits + RenderQueue::MaterialBits + RenderQueue::MeshBits;
+	const unsigned int PassShift = 64 - RenderQueue::PassBits;
+
+	inline uint64_t GetMask(unsigned int t_bits)
+	{
+		return ((uint64_t)1 << t_bits) - 1;
+	}
+}
+
+uint64_t RenderQueue::MakeKey(Pass t_pass, unsigned int t_shader, unsigned int t_material, unsigned int t_mesh, float t_depth)
+{
+	// Quantized in double: as a float, GetMask(DepthBits) rounds up to 1 << DepthBits,
+	// and a depth of 1 would carry into the fields above. NaN counts as 0.
+	double depth = t_depth > 0.0f ? (t_depth < 1.0f ? (double)t_depth : 1.0) : 0.0;
+	uint64_t quantizedDepth = (std::min)((uint64_t)(depth * (double)GetMask(DepthBits)), GetMask(DepthBits));
+
+	uint64_t state = ((uint64_t)(t_shader & GetMask(ShaderBits)) << (MaterialBits + MeshBits))
+		| ((uint64_t)(t_material & GetMask(MaterialBits)) << MeshBits)
+		| (uint64_t)(t_mesh & GetMask(MeshBits));
+
+	uint64_t key = (uint64_t)t_pass << PassShift;
+	if (t_pass == Transparent)
+	{
+		key |= ((GetMask(DepthBits) - quantizedDepth) << StateBits) | state;
+	}
+	else
+	{
+		key |= (state << DepthBits) | quantizedDepth;
+	}
+	return key;
+}
+
+RenderQueue::Pass RenderQueue::GetPass(uint64_t t_key)
+{
+	return (Pass)(t_key >> PassShift);
+}
+
+unsigned int RenderQueue::GetShader(uint64_t t_key)
+{
+	return (unsigned int)((t_key >> (GetStateShift(t_key) + MaterialBits + MeshBits)) & GetMask(ShaderBits));
+}
+
+unsigned int RenderQueue::GetMaterial(uint64_t t_key)
+{
+	return (unsigned int)((t_key >> (GetStateShift(t_key) + MeshBits)) & GetMask(MaterialBits));
+}
+
+unsigned int RenderQueue::GetMesh(uint64_t t_key)
+{
+	return (unsigned int)((t_key >> GetStateShift(t_key)) & GetMask(MeshBits));
+}
+
+void RenderQueue::Clear()
+{
+	items.clear();
+}
+
+void RenderQueue::Reserve(size_t t_count)
+{
+	items.reserve(t_count);
+}
+
+void RenderQueue::Add(uint64_t t_key, unsigned int t_index)
+{
+	Item item = { t_key, t_index };
+	items.push_back(item);
+}
+
+void RenderQueue::Sort()
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	// Count every digit of every key in one go
+	size_t counts[8][256] = {};
+	for (const Item& item : items)
+	{
+		for (unsigned int digit = 0; digit < 8; ++digit)
+		{
+			++counts[digit][(item.Key >> (digit * 8)) & 0xFF];
+		}
+	}
+
+	sortPasses = 0;
+	scratch.resize(items.size());
+	for (unsigned int digit = 0; digit < 8 && !items.empty(); ++digit)
+	{
+		// Nothing to do if every key has the same digit here
+		unsigned int shift = digit * 8;
+		if (counts[digit][(items[0].Key >> shift) & 0xFF] == items.size())
+		{
+			continue;
+		}
+
+		size_t starts[256];
+		size_t running = 0;
+		for (unsigned int value = 0; value < 256; ++value)
+		{
+			starts[value] = running;
+			running += counts[digit][value];
+		}
+		for (const Item& item : items)
+		{
+			scratch[starts[(item.Key >> shift) & 0xFF]++] = item;
+		}
+		items.swap(scratch);
+		++sortPasses;
+	}
+
+	sortMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+const std::vector<RenderQueue::Item>& RenderQueue::GetItems() const
+{
+	return items;
+}
+
+double RenderQueue::GetSortMilliseconds() const
+{
+	return sortMilliseconds;
+}
+
+unsigned int RenderQueue::GetSortPasses() const
+{
+	return sortPasses;
+}
+
+unsigned int RenderQueue::GetStateShift(uint64_t t_key)
+{
+	return GetPass(t_key) == Transparent ? 0 : DepthBits;
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Draw items ordered by a 64-bit key, so items that share state end up next
+// to each other and Draw only has to change state where the key does.
+//
+// Opaque keys hold, from the top bit down: pass, shader, material, mesh and
+// depth. Items are grouped by state first, then drawn front to back within a
+// group so the depth test throws away hidden pixels early. Transparent keys
+// move the depth (inverted, so back to front) up to just after the pass,
+// since blending needs that order more than it needs fewer state changes.
+//
+// Sort() is an LSD radix sort, 8 bits per pass, that skips every pass where
+// all keys share the same digit - usually most of the high ones.
+class RenderQueue
+{
+public:
+	enum Pass
+	{
+		Opaque = 0,
+		Transparent = 1
+	};
+
+	// Bits of each key field. Ids wrap around past these, which only costs batching.
+	static const unsigned int PassBits = 2;
+	static const unsigned int ShaderBits = 10;
+	static const unsigned int MaterialBits = 12;
+	static const unsigned int MeshBits = 14;
+	static const unsigned int DepthBits = 26;
+
+	struct Item
+	{
+		uint64_t Key;
+		unsigned int Index;		// What Add() was given, such as where the item is in the caller's list
+	};
+
+	// What submitting a queue cost, for whoever submits it to fill in.
+	struct SubmitStats
+	{
+		size_t Items;
+		size_t Draws;
+		size_t PassChanges;
+		size_t ShaderChanges;
+		size_t MaterialChanges;
+		size_t MeshChanges;
+		size_t ConstantBytes;		// Copied to constant buffers
+		size_t ObjectBytes;			// Copied to the object buffer
+	};
+
+	// Build a key. t_depth is the distance from the camera scaled to [0, 1] (it is clamped).
+	static uint64_t MakeKey(Pass t_pass, unsigned int t_shader, unsigned int t_material, unsigned int t_mesh, float t_depth);
+
+	// Get fields back out of a key.
+	static Pass GetPass(uint64_t t_key);
+	static unsigned int GetShader(uint64_t t_key);
+	static unsigned int GetMaterial(uint64_t t_key);
+	static unsigned int GetMesh(uint64_t t_key);
+
+	// Remove all items, keeping the memory.
+	void Clear();
+
+	// Make room for this many items.
+	void Reserve(size_t t_count);
+
+	// Queue an item.
+	void Add(uint64_t t_key, unsigned int t_index);
+
+	// Put the items in key order. Items with equal keys keep the order they were added in.
+	void Sort();
+
+	// Get the items, in key order after Sort().
+	const std::vector<Item>& GetItems() const;
+
+	// Get what the last Sort() took, and how many of its 8 radix passes it needed.
+	double GetSortMilliseconds() const;
+	unsigned int GetSortPasses() const;
+
+private:
+	// Where a field sits in the key of each pass
+	static unsigned int GetStateShift(uint64_t t_key);
+
+	std::vector<Item> items;
+	std::vector<Item> scratch;
+	double sortMilliseconds = 0.0;
+	unsigned int sortPasses = 0;
+};
@@ -0,0 +1,33 @@
+#include "RenderSnapshot.h"
+
+using namespace DirectX;
+
+XMFLOAT4X4 RenderSnapshot::InterpolateMatrix(const XMFLOAT4X4& t_previous, const XMFLOAT4X4& t_current, float t_alpha)
+{
+	XMVECTOR previousScale, previousRotation, previousTranslation;
+	XMVECTOR currentScale, currentRotation, currentTranslation;
+	if (!XMMatrixDecompose(&previousScale, &previousRotation, &previousTranslation, XMMatrixTranspose(XMLoadFloat4x4(&t_previous))) ||
+		!XMMatrixDecompose(&currentScale, &currentRotation, &currentTranslation, XMMatrixTranspose(XMLoadFloat4x4(&t_current))))
+	{
+		return t_current;
+	}
+
+	XMMATRIX blended =
+		XMMatrixScalingFromVector(XMVectorLerp(previousScale, currentScale, t_alpha)) *
+		XMMatrixRotationQuaternion(XMQuaternionSlerp(previousRotation, currentRotation, t_alpha)) *
+		XMMatrixTranslationFromVector(XMVectorLerp(previousTranslation, currentTranslation, t_alpha));
+
+	XMFLOAT4X4 result;
+	XMStoreFloat4x4(&result, XMMatrixTranspose(blended));
+	return result;
+}
+
+RenderItem RenderSnapshot::InterpolateItem(const RenderItem& t_previous, const RenderItem& t_current, float t_alpha)
+{
+	RenderItem result = t_current;
+	result.World = InterpolateMatrix(t_previous.World, t_current.World, t_alpha);
+
+	// Same convention as Entity: the inverse of the untransposed World
+	XMStoreFloat4x4(&result.WorldInverseTranspose, XMMatrixInverse(nullptr, XMMatrixTranspose(XMLoadFloat4x4(&result.World))));
+	return result;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+#include "Lights.h"
+#include "RenderQueue.h"
+
+// Forward Declarations
+class Mesh;
+class Material;
+
+// Everything Draw needs to submit one object. Matrices are already
+// transposed for HLSL, as Entity stores them.
+struct RenderItem
+{
+	const void* Source;					// Object the item was made from, to pair items across snapshots
+	DirectX::XMFLOAT4X4 World;
+	DirectX::XMFLOAT4X4 WorldInverseTranspose;
+	const Mesh* MeshData;
+	const Material* MaterialData;
+};
+
+// A copy of the simulation state Draw renders from, so Update can move on to
+// the next frame while this one is being submitted. Meshes and materials are
+// shared, not copied: they must not change while the pipeline is running.
+struct RenderSnapshot
+{
+	uint64_t Frame = 0;
+	float DeltaTime = 0.0f;
+	float TotalTime = 0.0f;
+
+	DirectX::XMFLOAT4X4 ViewMatrix;
+	DirectX::XMFLOAT4X4 ProjectionMatrix;
+	DirectX::XMFLOAT3 CameraPosition;
+
+	DirectionalLight Lights[2];
+
+	std::vector<RenderItem> Items;		// Keeps its capacity between frames
+	RenderQueue Queue;					// Order to draw Items in
+
+	// Blend two HLSL (transposed) affine matrices: scale and translation
+	// linearly, rotation along the shortest arc. Gives t_current back if
+	// either one cannot be decomposed.
+	static DirectX::XMFLOAT4X4 InterpolateMatrix(const DirectX::XMFLOAT4X4& t_previous, const DirectX::XMFLOAT4X4& t_current, float t_alpha);
+
+	// Blend an item's matrices between two snapshots. Both must have the same Source.
+	static RenderItem InterpolateItem(const RenderItem& t_previous, const RenderItem& t_current, float t_alpha);
+};
@@ -0,0 +1,111 @@
+#include "RingAllocator.h"
+
+RingAllocator::RingAllocator(size_t t_capacity, size_t t_alignment)
+	: capacity(t_capacity & ~(t_alignment - 1)), alignment(t_alignment)
+{
+}
+
+size_t RingAllocator::Allocate(size_t t_size)
+{
+	size_t size = (t_size + alignment - 1) & ~(alignment - 1);
+	if (size == 0 || size > capacity)
+	{
+		return InvalidOffset;
+	}
+
+	// Nothing in use: start again from the front rather than splitting the ring
+	size_t used = GetUsedBytes();
+	if (used == 0)
+	{
+		head = 0;
+		tail = 0;
+	}
+
+	if (used > 0 && head == tail)
+	{
+		return InvalidOffset;
+	}
+
+	size_t offset;
+	if (head >= tail)
+	{
+		// Free space runs from head to the end, then from the start to tail.
+		// Wrapping skips whatever is left at the end.
+		if (head + size <= capacity)
+		{
+			offset = head;
+			wrapped = false;
+			allocated += size;
+		}
+		else if (size <= tail)
+		{
+			offset = 0;
+			wrapped = true;
+			allocated += (capacity - head) + size;
+		}
+		else
+		{
+			return InvalidOffset;
+		}
+	}
+	else
+	{
+		// Already wrapped; free space runs from head to tail
+		if (head + size > tail)
+		{
+			return InvalidOffset;
+		}
+		offset = head;
+		wrapped = false;
+		allocated += size;
+	}
+
+	head = offset + size;
+	return offset;
+}
+
+bool RingAllocator::DidWrap() const
+{
+	return wrapped;
+}
+
+uint64_t RingAllocator::EndFrame()
+{
+	FrameEnd end = { nextFrame, head, allocated };
+	framesInFlight.push_back(end);
+	return nextFrame++;
+}
+
+void RingAllocator::Retire(uint64_t t_frame)
+{
+	while (!framesInFlight.empty() && framesInFlight.front().Frame <= t_frame)
+	{
+		tail = framesInFlight.front().Head;
+		retired = framesInFlight.front().Allocated;
+		framesInFlight.pop_front();
+	}
+}
+
+void RingAllocator::Reset()
+{
+	framesInFlight.clear();
+	head = 0;
+	tail = 0;
+	retired = allocated;
+	wrapped = false;
+}
+
+size_t RingAllocator::GetCapacity() const
+{
+	return capacity;
+}
+
+size_t RingAllocator::GetUsedBytes() const
+{
+	return (size_t)(allocated - retired);
+}
+
+size_t RingAllocator::GetFramesInFlight() const
+{
+	return framesInFlight.size();
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+// Hands out aligned ranges of a fixed-size ring, front to back, for data the
+// GPU reads a frame or more after it is written. Nothing is freed one range
+// at a time: EndFrame() closes off everything handed out since the last one,
+// and once the GPU is known to be done with that frame, Retire() makes its
+// ranges available again.
+//
+// Only offsets are tracked, so the same bookkeeping works for any buffer.
+// When the frames still in flight fill the ring, Allocate() fails; the
+// caller can get fresh memory some other way (such as discarding the buffer)
+// and Reset().
+class RingAllocator
+{
+public:
+	static const size_t InvalidOffset = SIZE_MAX;
+
+	// Manage t_capacity bytes, handing out offsets that are multiples of t_alignment (a power of two).
+	RingAllocator(size_t t_capacity, size_t t_alignment);
+
+	// Get the offset of t_size bytes, rounded up to the alignment, or InvalidOffset
+	// if they do not fit around the frames still in flight.
+	size_t Allocate(size_t t_size);
+
+	// Did the last successful Allocate() go back round to the start of the ring?
+	bool DidWrap() const;
+
+	// Close the frame that is being allocated for and get its id for Retire().
+	uint64_t EndFrame();
+
+	// The GPU is done with every frame up to and including t_frame.
+	void Retire(uint64_t t_frame);
+
+	// Forget every range, including those of frames in flight.
+	void Reset();
+
+	// Get size of the ring, and how much of it is in use by the open frame and those in flight.
+	size_t GetCapacity() const;
+	size_t GetUsedBytes() const;
+
+	// Get number of frames ended but not retired.
+	size_t GetFramesInFlight() const;
+
+private:
+	// Where the ring stood when a frame was ended
+	struct FrameEnd
+	{
+		uint64_t Frame;
+		size_t Head;
+		uint64_t Allocated;
+	};
+
+	size_t capacity;
+	size_t alignment;
+
+	// Next offset to hand out, and start of the oldest range still in use
+	size_t head = 0;
+	size_t tail = 0;
+
+	// Bytes ever taken (including what is skipped at the end of the ring when
+	// wrapping) and ever given back, so their difference is what is in use
+	uint64_t allocated = 0;
+	uint64_t retired = 0;
+
+	uint64_t nextFrame = 1;
+	std::deque<FrameEnd> framesInFlight;
+	bool wrapped = false;
+};
@@ -0,0 +1,270 @@
+#include "SceneGraph.h"
+#include "Entity.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <mutex>
+
+using namespace DirectX;
+
+SceneGraph::~SceneGraph()
+{
+	for (Node& node : nodes)
+	{
+		if (node.Owner != nullptr)
+		{
+			node.Owner->scene_node = UINT_MAX;
+			node.Owner->parent = nullptr;
+		}
+	}
+}
+
+void SceneGraph::Add(Entity* t_entity, Entity* t_parent)
+{
+	if (t_entity == nullptr || t_entity->scene_node != UINT_MAX)
+	{
+		return;
+	}
+
+	unsigned int index;
+	if (freeNodes.empty())
+	{
+		index = static_cast<unsigned int>(nodes.size());
+		nodes.push_back(Node());
+	}
+	else
+	{
+		index = freeNodes.back();
+		freeNodes.pop_back();
+	}
+
+	unsigned int parentIndex = t_parent != nullptr ? GetNode(t_parent) : UINT_MAX;
+
+	Node& node = nodes[index];
+	node.Owner = t_entity;
+	node.Parent = parentIndex;
+	node.Depth = parentIndex != UINT_MAX ? nodes[parentIndex].Depth + 1 : 0;
+	node.Children.clear();
+	node.Recomputed = false;
+	LinkToLevel(index);
+
+	if (parentIndex != UINT_MAX)
+	{
+		nodes[parentIndex].Children.push_back(index);
+	}
+
+	t_entity->scene_node = index;
+	t_entity->parent = t_parent;
+	t_entity->MarkDirty();
+	++count;
+}
+
+void SceneGraph::Remove(Entity* t_entity)
+{
+	unsigned int index = GetNode(t_entity);
+	if (nodes[index].Parent != UINT_MAX)
+	{
+		UnlinkFromParent(nodes[index].Parent, index);
+	}
+
+	subtree.clear();
+	CollectSubtree(index, subtree);
+	for (unsigned int removed : subtree)
+	{
+		UnlinkFromLevel(removed);
+
+		Node& node = nodes[removed];
+		node.Owner->scene_node = UINT_MAX;
+		node.Owner->parent = nullptr;
+		node.Owner->MarkDirty();
+		node.Owner = nullptr;
+		node.Children.clear();
+		freeNodes.push_back(removed);
+	}
+	count -= subtree.size();
+
+	while (!levels.empty() && levels.back().empty())
+	{
+		levels.pop_back();
+	}
+}
+
+bool SceneGraph::SetParent(Entity* t_entity, Entity* t_parent)
+{
+	unsigned int index = GetNode(t_entity);
+	unsigned int newParent = t_parent != nullptr ? GetNode(t_parent) : UINT_MAX;
+	unsigned int oldParent = nodes[index].Parent;
+	if (newParent == oldParent)
+	{
+		return true;
+	}
+
+	// Refuse to attach a node below itself
+	for (unsigned int ancestor = newParent; ancestor != UINT_MAX; ancestor = nodes[ancestor].Parent)
+	{
+		if (ancestor == index)
+		{
+			return false;
+		}
+	}
+
+	if (oldParent != UINT_MAX)
+	{
+		UnlinkFromParent(oldParent, index);
+	}
+	if (newParent != UINT_MAX)
+	{
+		nodes[newParent].Children.push_back(index);
+	}
+	nodes[index].Parent = newParent;
+
+	// Shift the whole subtree to its new depth. Only these nodes move between
+	// levels; everything else stays where it is.
+	unsigned int oldDepth = nodes[index].Depth;
+	unsigned int newDepth = newParent != UINT_MAX ? nodes[newParent].Depth + 1 : 0;
+	if (oldDepth != newDepth)
+	{
+		subtree.clear();
+		CollectSubtree(index, subtree);
+		for (unsigned int moved : subtree)
+		{
+			UnlinkFromLevel(moved);
+			nodes[moved].Depth = nodes[moved].Depth - oldDepth + newDepth;
+			LinkToLevel(moved);
+		}
+
+		while (!levels.empty() && levels.back().empty())
+		{
+			levels.pop_back();
+		}
+	}
+
+	t_entity->parent = t_parent;
+	t_entity->MarkDirty();
+	return true;
+}
+
+void SceneGraph::UpdateWorldMatrices()
+{
+	visitedCount = 0;
+	recomputedCount = 0;
+	recomputedEntities.clear();
+
+	std::mutex resultMutex;
+	for (std::vector<unsigned int>& level : levels)
+	{
+		// Parents are all final by now, so every node of this level is independent
+		size_t chunkCount = (level.size() + ChunkSize - 1) / ChunkSize;
+		ParallelFor(chunkCount, [&](size_t t_chunk)
+		{
+			size_t first = t_chunk * ChunkSize;
+			size_t last = (std::min)(first + ChunkSize, level.size());
+			std::vector<Entity*> recomputed;
+
+			for (size_t i = first; i < last; ++i)
+			{
+				Node& node = nodes[level[i]];
+				Entity* entity = node.Owner;
+				bool parentRecomputed = node.Parent != UINT_MAX && nodes[node.Parent].Recomputed;
+
+				node.Recomputed = entity->graph_dirty || parentRecomputed;
+				if (!node.Recomputed)
+				{
+					continue;
+				}
+
+				if (node.Parent != UINT_MAX)
+				{
+					// The parent's cached matrix is transposed for HLSL
+					XMMATRIX parentWorld = XMMatrixTranspose(XMLoadFloat4x4(&nodes[node.Parent].Owner->world_matrix));
+					XMStoreFloat4x4(&entity->parent_world_matrix, parentWorld);
+				}
+
+				entity->ComputeWorldMatrix();
+				entity->graph_dirty = false;
+				recomputed.push_back(entity);
+			}
+
+			std::lock_guard<std::mutex> lock(resultMutex);
+			visitedCount += last - first;
+			recomputedCount += recomputed.size();
+			recomputedEntities.insert(recomputedEntities.end(), recomputed.begin(), recomputed.end());
+		});
+	}
+
+	// Entities moved by their parents changed too. The change lists are not
+	// thread safe, so they get told here rather than from the workers.
+	for (Entity* entity : recomputedEntities)
+	{
+		entity->MarkChanged();
+	}
+}
+
+size_t SceneGraph::GetCount() const
+{
+	return count;
+}
+
+size_t SceneGraph::GetDepth() const
+{
+	return levels.size();
+}
+
+size_t SceneGraph::GetVisitedCount() const
+{
+	return visitedCount;
+}
+
+size_t SceneGraph::GetRecomputedCount() const
+{
+	return recomputedCount;
+}
+
+unsigned int SceneGraph::GetNode(Entity* t_entity) const
+{
+	return t_entity->scene_node;
+}
+
+void SceneGraph::LinkToLevel(unsigned int t_node)
+{
+	Node& node = nodes[t_node];
+	if (levels.size() <= node.Depth)
+	{
+		levels.resize(node.Depth + 1);
+	}
+
+	node.Slot = static_cast<unsigned int>(levels[node.Depth].size());
+	levels[node.Depth].push_back(t_node);
+}
+
+void SceneGraph::UnlinkFromLevel(unsigned int t_node)
+{
+	Node& node = nodes[t_node];
+	std::vector<unsigned int>& level = levels[node.Depth];
+
+	unsigned int moved = level.back();
+	level[node.Slot] = moved;
+	nodes[moved].Slot = node.Slot;
+	level.pop_back();
+}
+
+void SceneGraph::UnlinkFromParent(unsigned int t_parent, unsigned int t_child)
+{
+	std::vector<unsigned int>& children = nodes[t_parent].Children;
+	auto child = std::find(children.begin(), children.end(), t_child);
+	if (child != children.end())
+	{
+		*child = children.back();
+		children.pop_back();
+	}
+}
+
+void SceneGraph::CollectSubtree(unsigned int t_node, std::vector<unsigned int>& t_subtree) const
+{
+	size_t first = t_subtree.size();
+	t_subtree.push_back(t_node);
+	for (size_t i = first; i < t_subtree.size(); ++i)
+	{
+		const std::vector<unsigned int>& children = nodes[t_subtree[i]].Children;
+		t_subtree.insert(t_subtree.end(), children.begin(), children.end());
+	}
+}
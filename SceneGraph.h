@@ -0,0 +1,81 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// Forward Declaration
+class Entity;
+
+// Parent/child hierarchy of entities.
+//
+// Nodes are kept in one array per depth, so world matrices can be pushed down
+// a level at a time: every parent is final before any of its children are
+// looked at, and all nodes of a level can be processed in parallel. Moving a
+// subtree only touches the nodes in that subtree, since each level is an
+// unordered array with swap-remove.
+class SceneGraph
+{
+public:
+	// Number of nodes of one level handed to a thread at a time.
+	static const unsigned int ChunkSize = 1024;
+
+	// Destructor for SceneGraph. Detaches every Entity but does not delete them.
+	~SceneGraph();
+
+	// Add an Entity (not yet in a graph) as a child of t_parent, or as a root if t_parent is nullptr.
+	void Add(Entity* t_entity, Entity* t_parent = nullptr);
+
+	// Remove an Entity and its whole subtree from the graph. Nothing is deleted.
+	void Remove(Entity* t_entity);
+
+	// Move an Entity (and its subtree) under a new parent, or make it a root if t_parent is nullptr.
+	// Its local transform is kept. Returns false if t_parent is inside t_entity's subtree.
+	bool SetParent(Entity* t_entity, Entity* t_parent);
+
+	// Recompute world matrices for every dirty Entity and everything below it, level by level.
+	void UpdateWorldMatrices();
+
+	// Get number of entities in the graph.
+	size_t GetCount() const;
+
+	// Get number of levels (the deepest node's depth + 1).
+	size_t GetDepth() const;
+
+	// Get how many nodes were visited and recomputed by the last UpdateWorldMatrices().
+	size_t GetVisitedCount() const;
+	size_t GetRecomputedCount() const;
+
+private:
+	struct Node
+	{
+		Entity* Owner;
+		unsigned int Parent;
+		unsigned int Depth;
+		unsigned int Slot;						// Position in levels[Depth]
+		std::vector<unsigned int> Children;
+		bool Recomputed;						// Set during UpdateWorldMatrices if this node's world changed
+	};
+
+	// Get node index of an Entity, which must be in this graph.
+	unsigned int GetNode(Entity* t_entity) const;
+
+	// Put a node at the end of the array for its level.
+	void LinkToLevel(unsigned int t_node);
+
+	// Swap-remove a node from the array of its level.
+	void UnlinkFromLevel(unsigned int t_node);
+
+	// Remove t_child from t_parent's child list.
+	void UnlinkFromParent(unsigned int t_parent, unsigned int t_child);
+
+	// Append t_node and all of its descendants to t_subtree.
+	void CollectSubtree(unsigned int t_node, std::vector<unsigned int>& t_subtree) const;
+
+	std::vector<Node> nodes;
+	std::vector<unsigned int> freeNodes;
+	std::vector<std::vector<unsigned int>> levels;
+	std::vector<unsigned int> subtree;			// Scratch space for subtree operations
+	std::vector<Entity*> recomputedEntities;	// Scratch space for UpdateWorldMatrices
+	size_t count = 0;
+	size_t visitedCount = 0;
+	size_t recomputedCount = 0;
+};
@@ -1,4 +1,26 @@
 #include "SimpleShader.h"
+#include "ConstantBufferRing.h"
+
+// --------------------------------------------------------
+// Adds a name's hash to one of the hash tables, marking it
+// with -1 if another name already has the same hash
+// --------------------------------------------------------
+static void AddNameHash(std::unordered_map<unsigned int, int>& table, const char* name, int index)
+{
+	std::pair<std::unordered_map<unsigned int, int>::iterator, bool> result =
+		table.insert(std::pair<unsigned int, int>(SimpleHashName(name), index));
+	if (!result.second && result.first->second != index)
+		result.first->second = -1;
+}
+
+// --------------------------------------------------------
+// Looks up a hash in one of the hash tables
+// --------------------------------------------------------
+static int FindNameHash(const std::unordered_map<unsigned int, int>& table, unsigned int nameHash)
+{
+	std::unordered_map<unsigned int, int>::const_iterator result = table.find(nameHash);
+	return result == table.end() ? -1 : result->second;
+}
 
 ///////////////////////////////////////////////////////////////////////////////
 // ------ BASE SIMPLE SHADER --------------------------------------------------
@@ -17,6 +39,10 @@ ISimpleShader::ISimpleShader(ID3D11Device* device, ID3D11DeviceContext* context)
 	constantBufferCount = 0;
 	constantBuffers = 0;
 	shaderBlob = 0;
+	stateCache = 0;
+	constantRing = 0;
+	shaderValid = false;
+	uploadedBytes = 0;
 }
 
 // --------------------------------------------------------
@@ -50,15 +76,22 @@ void ISimpleShader::CleanUp()
 
 	for (unsigned int i = 0; i < shaderResourceViews.size(); i++)
 		delete shaderResourceViews[i];
+	shaderResourceViews.clear();
 	
 	for (unsigned int i = 0; i < samplerStates.size(); i++)
 		delete samplerStates[i];
+	samplerStates.clear();
 
 	// Clean up tables
+	variables.clear();
 	varTable.clear();
 	cbTable.clear();
 	samplerTable.clear();
 	textureTable.clear();
+	varHashTable.clear();
+	cbHashTable.clear();
+	samplerHashTable.clear();
+	textureHashTable.clear();
 }
 
 // --------------------------------------------------------
@@ -100,9 +133,10 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 	D3D11_SHADER_DESC shaderDesc;
 	refl->GetDesc(&shaderDesc);
 
-	// Create resource arrays
-	constantBufferCount = shaderDesc.ConstantBuffers;
-	constantBuffers = new SimpleConstantBuffer[constantBufferCount];
+	// Create resource arrays (constantBufferCount is filled in
+	// below, as not everything reflected as a buffer is one)
+	constantBufferCount = 0;
+	constantBuffers = new SimpleConstantBuffer[shaderDesc.ConstantBuffers];
 	
 	// Handle bound resources (like shaders and samplers)
 	unsigned int resourceCount = shaderDesc.BoundResources;
@@ -116,6 +150,7 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		switch (resourceDesc.Type)
 		{
 		case D3D_SIT_TEXTURE: // A texture resource
+		case D3D_SIT_STRUCTURED: // A structured buffer, also read through an SRV
 		{
 			// Create the SRV wrapper
 			SimpleSRV* srv = new SimpleSRV();
@@ -123,6 +158,7 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 			srv->Index = shaderResourceViews.size();	// Raw index
 
 			textureTable.insert(std::pair<std::string, SimpleSRV*>(resourceDesc.Name, srv));
+			AddNameHash(textureHashTable, resourceDesc.Name, srv->Index);
 			shaderResourceViews.push_back(srv);
 		}
 			break;
@@ -135,6 +171,7 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 			samp->Index = samplerStates.size();			// Raw index
 
 			samplerTable.insert(std::pair<std::string, SimpleSampler*>(resourceDesc.Name, samp));
+			AddNameHash(samplerHashTable, resourceDesc.Name, samp->Index);
 			samplerStates.push_back(samp);
 		}
 			break;
@@ -142,15 +179,21 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 	}
 
 	// Loop through all constant buffers
-	for (unsigned int b = 0; b < constantBufferCount; b++)
+	for (unsigned int i = 0; i < shaderDesc.ConstantBuffers; i++)
 	{
 		// Get this buffer
 		ID3D11ShaderReflectionConstantBuffer* cb =
-			refl->GetConstantBufferByIndex(b);
+			refl->GetConstantBufferByIndex(i);
 		
 		// Get the description of this buffer
 		D3D11_SHADER_BUFFER_DESC bufferDesc;
 		cb->GetDesc(&bufferDesc);
+
+		// Structured buffers show up here too, for their element
+		// type, but are bound as SRVs (handled above)
+		if (bufferDesc.Type != D3D_CT_CBUFFER)
+			continue;
+		unsigned int b = constantBufferCount++;
 		
 		// Get the description of the resource binding, so
 		// we know exactly how it's bound in the shader
@@ -160,7 +203,17 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		// Set up the buffer and put its pointer in the table
 		constantBuffers[b].BindIndex = bindDesc.BindPoint;
 		constantBuffers[b].Name = bufferDesc.Name;
+		constantBuffers[b].Dirty = true;
+
+		// The name says how often the data changes
+		if (constantBuffers[b].Name.compare(0, 8, "perFrame") == 0)
+			constantBuffers[b].Frequency = SimpleBufferFrequency::PerFrame;
+		else if (constantBuffers[b].Name.compare(0, 11, "perMaterial") == 0)
+			constantBuffers[b].Frequency = SimpleBufferFrequency::PerMaterial;
+		else
+			constantBuffers[b].Frequency = SimpleBufferFrequency::PerObject;
 		cbTable.insert(std::pair<std::string, SimpleConstantBuffer*>(bufferDesc.Name, &constantBuffers[b]));
+		AddNameHash(cbHashTable, bufferDesc.Name, (int)b);
 
 		// Create this constant buffer
 		D3D11_BUFFER_DESC newBuffDesc;
@@ -171,6 +224,10 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		newBuffDesc.MiscFlags = 0;
 		newBuffDesc.StructureByteStride = 0;
 		device->CreateBuffer(&newBuffDesc, 0, &constantBuffers[b].ConstantBuffer);
+		constantBuffers[b].BoundBuffer = constantBuffers[b].ConstantBuffer;
+		constantBuffers[b].FirstConstant = 0;
+		constantBuffers[b].ConstantCount = 0;
+		constantBuffers[b].RingFrame = 0;
 
 		// Set up the data buffer for this constant buffer
 		constantBuffers[b].Size = bufferDesc.Size;
@@ -197,8 +254,13 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 			// Get a string version
 			std::string varName(varDesc.Name);
 
-			// Add this variable to the table and the constant buffer
-			varTable.insert(std::pair<std::string, SimpleShaderVariable>(varName, varStruct));
+			// Add this variable to the table and the constant buffer (the
+			// first of any with the same name is the one set by name)
+			if (varTable.insert(std::pair<std::string, unsigned int>(varName, variables.size())).second)
+			{
+				AddNameHash(varHashTable, varDesc.Name, (int)variables.size());
+				variables.push_back(varStruct);
+			}
 			constantBuffers[b].Variables.push_back(varStruct);
 		}
 	}
@@ -215,18 +277,35 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 // name - the name of the variable to look for
 // size - the size of the variable (for verification), or -1 to bypass
 // --------------------------------------------------------
-SimpleShaderVariable* ISimpleShader::FindVariable(std::string name, int size)
+SimpleShaderVariable* ISimpleShader::FindVariable(const std::string& name, int size)
 {
 	// Look for the key
-	std::unordered_map<std::string, SimpleShaderVariable>::iterator result =
+	std::unordered_map<std::string, unsigned int>::iterator result =
 		varTable.find(name);
 
 	// Did we find the key?
 	if (result == varTable.end())
 		return 0;
 
-	// Grab the result from the iterator
-	SimpleShaderVariable* var = &(result->second);
+	// Check the size with the handle
+	return FindVariable(SimpleVariableHandle(result->second), size);
+}
+
+// --------------------------------------------------------
+// Helper for getting a variable from a handle and also
+// verifying that it is the requested size
+// 
+// variable - the handle of the variable
+// size - the size of the variable (for verification), or -1 to bypass
+// --------------------------------------------------------
+SimpleShaderVariable* ISimpleShader::FindVariable(SimpleVariableHandle variable, int size)
+{
+	// Is the handle valid? (Invalid ones wrap around to large indices)
+	if ((unsigned int)variable.Index >= variables.size())
+		return 0;
+
+	// Grab the variable
+	SimpleShaderVariable* var = &variables[variable.Index];
 
 	// Is the data size correct ?
 	if (size > 0 && var->Size != size)
@@ -280,9 +359,7 @@ void ISimpleShader::CopyAllBufferData()
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
 		// Copy the entire local data buffer
-		deviceContext->UpdateSubresource(
-			constantBuffers[i].ConstantBuffer, 0, 0,
-			constantBuffers[i].LocalDataBuffer, 0, 0);
+		UploadBuffer(&constantBuffers[i]);
 	}
 }
 
@@ -311,9 +388,7 @@ void ISimpleShader::CopyBufferData(unsigned int index)
 	if (!cb) return;
 
 	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer, 0, 0, 
-		cb->LocalDataBuffer, 0, 0);
+	UploadBuffer(cb);
 }
 
 // --------------------------------------------------------
@@ -333,11 +408,221 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 	if (!cb) return;
 
 	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer, 0, 0, 
-		cb->LocalDataBuffer, 0, 0);
+	UploadBuffer(cb);
 }
 
+// --------------------------------------------------------
+// Copies local data to the shader's specified constant buffer
+//
+// buffer - The handle of the buffer to copy, from GetBufferHandle()
+// --------------------------------------------------------
+void ISimpleShader::CopyBufferData(SimpleBufferHandle buffer)
+{
+	// An invalid handle wraps around to an index that is skipped
+	CopyBufferData((unsigned int)buffer.Index);
+}
+
+// --------------------------------------------------------
+// Copies local data to the shader's constant buffers of
+// one update frequency, skipping those that have not
+// changed since they were last copied
+//
+// frequency - Which buffers to copy, such as PerFrame
+//             once the frame's camera and lights are set
+// --------------------------------------------------------
+void ISimpleShader::CopyBufferData(SimpleBufferFrequency frequency)
+{
+	// Ensure the shader is valid
+	if (!shaderValid) return;
+
+	for (unsigned int i = 0; i < constantBufferCount; i++)
+	{
+		if (constantBuffers[i].Frequency == frequency && constantBuffers[i].Dirty)
+			UploadBuffer(&constantBuffers[i]);
+	}
+}
+
+// --------------------------------------------------------
+// Copies a buffer's local data to the GPU and counts the
+// bytes it took
+//
+// With a constant ring, the data goes into a new range of
+// the ring, which is bound in place of the buffer. If the
+// ring has no room, the buffer is updated and bound as usual
+// --------------------------------------------------------
+void ISimpleShader::UploadBuffer(SimpleConstantBuffer* cb)
+{
+	if (constantRing && stateCache &&
+		constantRing->Upload(cb->LocalDataBuffer, cb->Size, cb->BoundBuffer, cb->FirstConstant, cb->ConstantCount))
+	{
+		cb->RingFrame = constantRing->GetFrame();
+		stateCache->SetConstantBuffer(GetCacheStage(), cb->BindIndex, cb->BoundBuffer, cb->FirstConstant, cb->ConstantCount);
+	}
+	else
+	{
+		deviceContext->UpdateSubresource(
+			cb->ConstantBuffer, 0, 0,
+			cb->LocalDataBuffer, 0, 0);
+
+		// Go back to the buffer itself if it was last in the ring
+		if (cb->BoundBuffer != cb->ConstantBuffer)
+		{
+			cb->BoundBuffer = cb->ConstantBuffer;
+			cb->FirstConstant = 0;
+			cb->ConstantCount = 0;
+			if (stateCache)
+				stateCache->SetConstantBuffer(GetCacheStage(), cb->BindIndex, cb->ConstantBuffer);
+		}
+	}
+
+	cb->Dirty = false;
+	uploadedBytes += cb->Size;
+}
+
+// --------------------------------------------------------
+// Sends each constant buffer's binding to the state cache.
+// A ring range is only good for the frame it was handed
+// out in, so older ones are copied again first
+// --------------------------------------------------------
+void ISimpleShader::SetCachedConstantBuffers()
+{
+	StateCache::Stage stage = GetCacheStage();
+	for (unsigned int i = 0; i < constantBufferCount; i++)
+	{
+		SimpleConstantBuffer* cb = &constantBuffers[i];
+		if (constantRing && cb->BoundBuffer != cb->ConstantBuffer && cb->RingFrame != constantRing->GetFrame())
+			UploadBuffer(cb);
+		stateCache->SetConstantBuffer(stage, cb->BindIndex, cb->BoundBuffer, cb->FirstConstant, cb->ConstantCount);
+	}
+}
+
+// --------------------------------------------------------
+// Sets the ring that constant data is copied into, or
+// 0 to go back to each buffer being updated in place
+//
+// ring - The ring, which must outlive its use here
+// --------------------------------------------------------
+void ISimpleShader::SetConstantRing(ConstantBufferRing* ring)
+{
+	constantRing = (ring && ring->IsSupported()) ? ring : 0;
+
+	// Ranges of the old ring are no longer looked after, so
+	// bind the buffers themselves once they are copied again
+	for (unsigned int i = 0; i < constantBufferCount; i++)
+	{
+		constantBuffers[i].BoundBuffer = constantBuffers[i].ConstantBuffer;
+		constantBuffers[i].FirstConstant = 0;
+		constantBuffers[i].ConstantCount = 0;
+		constantBuffers[i].Dirty = true;
+	}
+}
+
+
+// --------------------------------------------------------
+// Gets a handle to a variable, which is invalid if the
+// variable doesn't exist
+//
+// name - The name of the shader variable
+// --------------------------------------------------------
+SimpleVariableHandle ISimpleShader::GetVariableHandle(const std::string& name)
+{
+	std::unordered_map<std::string, unsigned int>::iterator result = varTable.find(name);
+	return SimpleVariableHandle(result == varTable.end() ? -1 : (int)result->second);
+}
+
+// --------------------------------------------------------
+// Gets a handle to a variable, which is invalid if no
+// variable, or more than one, has a name with this hash
+//
+// nameHash - SimpleHashName() of the variable's name
+// --------------------------------------------------------
+SimpleVariableHandle ISimpleShader::GetVariableHandle(unsigned int nameHash)
+{
+	return SimpleVariableHandle(FindNameHash(varHashTable, nameHash));
+}
+
+// --------------------------------------------------------
+// Gets a handle to a constant buffer, which is invalid if
+// the buffer doesn't exist
+//
+// name - The name of the constant buffer
+// --------------------------------------------------------
+SimpleBufferHandle ISimpleShader::GetBufferHandle(const std::string& name)
+{
+	SimpleConstantBuffer* cb = FindConstantBuffer(name);
+	return SimpleBufferHandle(cb == 0 ? -1 : (int)(cb - constantBuffers));
+}
+
+// --------------------------------------------------------
+// Gets a handle to a constant buffer, which is invalid if
+// no buffer, or more than one, has a name with this hash
+//
+// nameHash - SimpleHashName() of the buffer's name
+// --------------------------------------------------------
+SimpleBufferHandle ISimpleShader::GetBufferHandle(unsigned int nameHash)
+{
+	return SimpleBufferHandle(FindNameHash(cbHashTable, nameHash));
+}
+
+// --------------------------------------------------------
+// Gets a handle to an SRV, which is invalid if the SRV
+// doesn't exist
+//
+// name - The name of the SRV
+// --------------------------------------------------------
+SimpleResourceHandle ISimpleShader::GetShaderResourceViewHandle(const std::string& name)
+{
+	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
+	return SimpleResourceHandle(srvInfo == 0 ? -1 : (int)srvInfo->Index);
+}
+
+// --------------------------------------------------------
+// Gets a handle to an SRV, which is invalid if no SRV, or
+// more than one, has a name with this hash
+//
+// nameHash - SimpleHashName() of the SRV's name
+// --------------------------------------------------------
+SimpleResourceHandle ISimpleShader::GetShaderResourceViewHandle(unsigned int nameHash)
+{
+	return SimpleResourceHandle(FindNameHash(textureHashTable, nameHash));
+}
+
+// --------------------------------------------------------
+// Gets a handle to a sampler, which is invalid if the
+// sampler doesn't exist
+//
+// name - The name of the sampler
+// --------------------------------------------------------
+SimpleSamplerHandle ISimpleShader::GetSamplerHandle(const std::string& name)
+{
+	const SimpleSampler* sampInfo = GetSamplerInfo(name);
+	return SimpleSamplerHandle(sampInfo == 0 ? -1 : (int)sampInfo->Index);
+}
+
+// --------------------------------------------------------
+// Gets a handle to a sampler, which is invalid if no
+// sampler, or more than one, has a name with this hash
+//
+// nameHash - SimpleHashName() of the sampler's name
+// --------------------------------------------------------
+SimpleSamplerHandle ISimpleShader::GetSamplerHandle(unsigned int nameHash)
+{
+	return SimpleSamplerHandle(FindNameHash(samplerHashTable, nameHash));
+}
+
+// --------------------------------------------------------
+// Copies data into a variable's spot in its buffer's local
+// data, noting if that changes what the GPU has
+// --------------------------------------------------------
+void ISimpleShader::WriteVariable(const SimpleShaderVariable* var, const void* data, unsigned int size)
+{
+	unsigned char* local = constantBuffers[var->ConstantBufferIndex].LocalDataBuffer + var->ByteOffset;
+	if (memcmp(local, data, size) != 0)
+	{
+		memcpy(local, data, size);
+		constantBuffers[var->ConstantBufferIndex].Dirty = true;
+	}
+}
 
 // --------------------------------------------------------
 // Sets a variable by name with arbitrary data of the specified size
@@ -349,7 +634,7 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 // Returns true if data is copied, false if variable doesn't 
 // exist or sizes don't match
 // --------------------------------------------------------
-bool ISimpleShader::SetData(std::string name, const void* data, unsigned int size)
+bool ISimpleShader::SetData(const std::string& name, const void* data, unsigned int size)
 {
 	// Look for the variable and verify
 	SimpleShaderVariable* var = FindVariable(name, size);
@@ -357,10 +642,31 @@ bool ISimpleShader::SetData(std::string name, const void* data, unsigned int siz
 		return false;
 
 	// Set the data in the local data buffer
-	memcpy(
-		constantBuffers[var->ConstantBufferIndex].LocalDataBuffer + var->ByteOffset,
-		data,
-		size);
+	WriteVariable(var, data, size);
+
+	// Success
+	return true;
+}
+
+// --------------------------------------------------------
+// Sets a variable by handle with arbitrary data of the specified size
+//
+// variable - The handle of the shader variable, from GetVariableHandle()
+// data - The data to set in the buffer
+// size - The size of the data (this must match the variable's size)
+//
+// Returns true if data is copied, false if the handle is
+// invalid or sizes don't match
+// --------------------------------------------------------
+bool ISimpleShader::SetData(SimpleVariableHandle variable, const void* data, unsigned int size)
+{
+	// Check the handle and verify
+	SimpleShaderVariable* var = FindVariable(variable, size);
+	if (var == 0)
+		return false;
+
+	// Set the data in the local data buffer
+	WriteVariable(var, data, size);
 
 	// Success
 	return true;
@@ -369,7 +675,7 @@ bool ISimpleShader::SetData(std::string name, const void* data, unsigned int siz
 // --------------------------------------------------------
 // Sets INTEGER data
 // --------------------------------------------------------
-bool ISimpleShader::SetInt(std::string name, int data)
+bool ISimpleShader::SetInt(const std::string& name, int data)
 {
 	return this->SetData(name, (void*)(&data), sizeof(int));
 }
@@ -377,7 +683,7 @@ bool ISimpleShader::SetInt(std::string name, int data)
 // --------------------------------------------------------
 // Sets a FLOAT variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat(std::string name, float data)
+bool ISimpleShader::SetFloat(const std::string& name, float data)
 {
 	return this->SetData(name, (void*)(&data), sizeof(float));
 }
@@ -385,7 +691,7 @@ bool ISimpleShader::SetFloat(std::string name, float data)
 // --------------------------------------------------------
 // Sets a FLOAT2 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat2(std::string name, const float data[2])
+bool ISimpleShader::SetFloat2(const std::string& name, const float data[2])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 2);
 }
@@ -393,7 +699,7 @@ bool ISimpleShader::SetFloat2(std::string name, const float data[2])
 // --------------------------------------------------------
 // Sets a FLOAT2 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat2(std::string name, const DirectX::XMFLOAT2 data)
+bool ISimpleShader::SetFloat2(const std::string& name, const DirectX::XMFLOAT2 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 2);
 }
@@ -401,7 +707,7 @@ bool ISimpleShader::SetFloat2(std::string name, const DirectX::XMFLOAT2 data)
 // --------------------------------------------------------
 // Sets a FLOAT3 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat3(std::string name, const float data[3])
+bool ISimpleShader::SetFloat3(const std::string& name, const float data[3])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 3);
 }
@@ -409,7 +715,7 @@ bool ISimpleShader::SetFloat3(std::string name, const float data[3])
 // --------------------------------------------------------
 // Sets a FLOAT3 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat3(std::string name, const DirectX::XMFLOAT3 data)
+bool ISimpleShader::SetFloat3(const std::string& name, const DirectX::XMFLOAT3 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 3);
 }
@@ -417,7 +723,7 @@ bool ISimpleShader::SetFloat3(std::string name, const DirectX::XMFLOAT3 data)
 // --------------------------------------------------------
 // Sets a FLOAT4 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat4(std::string name, const float data[4])
+bool ISimpleShader::SetFloat4(const std::string& name, const float data[4])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 4);
 }
@@ -425,7 +731,7 @@ bool ISimpleShader::SetFloat4(std::string name, const float data[4])
 // --------------------------------------------------------
 // Sets a FLOAT4 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat4(std::string name, const DirectX::XMFLOAT4 data)
+bool ISimpleShader::SetFloat4(const std::string& name, const DirectX::XMFLOAT4 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 4);
 }
@@ -433,7 +739,7 @@ bool ISimpleShader::SetFloat4(std::string name, const DirectX::XMFLOAT4 data)
 // --------------------------------------------------------
 // Sets a MATRIX (4x4) variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetMatrix4x4(std::string name, const float data[16])
+bool ISimpleShader::SetMatrix4x4(const std::string& name, const float data[16])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 16);
 }
@@ -441,15 +747,181 @@ bool ISimpleShader::SetMatrix4x4(std::string name, const float data[16])
 // --------------------------------------------------------
 // Sets a MATRIX (4x4) variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data)
+bool ISimpleShader::SetMatrix4x4(const std::string& name, const DirectX::XMFLOAT4X4 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 16);
 }
 
+// --------------------------------------------------------
+// Sets INTEGER data by handle
+// --------------------------------------------------------
+bool ISimpleShader::SetInt(SimpleVariableHandle variable, int data)
+{
+	return this->SetData(variable, (void*)(&data), sizeof(int));
+}
+
+// --------------------------------------------------------
+// Sets a FLOAT variable by handle in the local data buffer
+// --------------------------------------------------------
+bool ISimpleShader::SetFloat(SimpleVariableHandle variable, float data)
+{
+	return this->SetData(variable, (void*)(&data), sizeof(float));
+}
+
+// --------------------------------------------------------
+// Sets a FLOAT2 variable by handle in the local data buffer
+// --------------------------------------------------------
+bool ISimpleShader::SetFloat2(SimpleVariableHandle variable, const float data[2])
+{
+	return this->SetData(variable, (void*)data, sizeof(float) * 2);
+}
+
+// --------------------------------------------------------
+// Sets a FLOAT2 variable by handle in the local data buffer
+// --------------------------------------------------------
+bool ISimpleShader::SetFloat2(SimpleVariableHandle variable, const DirectX::XMFLOAT2& data)
+{
+	return this->SetData(variable, &data, sizeof(float) * 2);
+}
+
+// --------------------------------------------------------
+// Sets a FLOAT3 variable by handle in the local data buffer
+// --------------------------------------------------------
+bool ISimpleShader::SetFloat3(SimpleVariableHandle variable, const float data[3])
+{
+	return this->SetData(variable, (void*)data, sizeof(float) * 3);
+}
+
+// --------------------------------------------------------
+// Sets a FLOAT3 variable by handle in the local data buffer
+// --------------------------------------------------------
+bool ISimpleShader::SetFloat3(SimpleVariableHandle variable, const DirectX::XMFLOAT3& data)
+{
+	return this->SetData(variable, &data, sizeof(float) * 3);
+}
+
+// --------------------------------------------------------
+// Sets a FLOAT4 variable by handle in the local data buffer
+// --------------------------------------------------------
+bool ISimpleShader::SetFloat4(SimpleVariableHandle variable, const float data[4])
+{
+	return this->SetData(variable, (void*)data, sizeof(float) * 4);
+}
+
+// --------------------------------------------------------
+// Sets a FLOAT4 variable by handle in the local data buffer
+// --------------------------------------------------------
+bool ISimpleShader::SetFloat4(SimpleVariableHandle variable, const DirectX::XMFLOAT4& data)
+{
+	return this->SetData(variable, &data, sizeof(float) * 4);
+}
+
+// --------------------------------------------------------
+// Sets a MATRIX (4x4) variable by handle in the local data buffer
+// --------------------------------------------------------
+bool ISimpleShader::SetMatrix4x4(SimpleVariableHandle variable, const float data[16])
+{
+	return this->SetData(variable, (void*)data, sizeof(float) * 16);
+}
+
+// --------------------------------------------------------
+// Sets a MATRIX (4x4) variable by handle in the local data buffer
+// --------------------------------------------------------
+bool ISimpleShader::SetMatrix4x4(SimpleVariableHandle variable, const DirectX::XMFLOAT4X4& data)
+{
+	return this->SetData(variable, &data, sizeof(float) * 16);
+}
+
+// --------------------------------------------------------
+// Sets a shader resource view in this shader's stage
+//
+// name - The name of the texture resource in the shader
+// srv - The shader resource view of the texture in GPU memory
+//
+// Returns true if a texture of the given name was found, false otherwise
+// --------------------------------------------------------
+bool ISimpleShader::SetShaderResourceView(const std::string& name, ID3D11ShaderResourceView* srv)
+{
+	// Look for the variable and verify
+	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
+	if (srvInfo == 0)
+		return false;
+
+	// Set the shader resource view
+	BindShaderResourceView(srvInfo->BindIndex, srv);
+
+	// Success
+	return true;
+}
+
+// --------------------------------------------------------
+// Sets a shader resource view in this shader's stage
+//
+// resource - The handle of the texture resource, from GetShaderResourceViewHandle()
+// srv - The shader resource view of the texture in GPU memory
+//
+// Returns true if the handle is valid, false otherwise
+// --------------------------------------------------------
+bool ISimpleShader::SetShaderResourceView(SimpleResourceHandle resource, ID3D11ShaderResourceView* srv)
+{
+	// Check the handle (invalid ones wrap around to large indices)
+	if ((unsigned int)resource.Index >= shaderResourceViews.size())
+		return false;
+
+	// Set the shader resource view
+	BindShaderResourceView(shaderResourceViews[resource.Index]->BindIndex, srv);
+
+	// Success
+	return true;
+}
+
+// --------------------------------------------------------
+// Sets a sampler state in this shader's stage
+//
+// name - The name of the sampler state in the shader
+// samplerState - The sampler state in GPU memory
+//
+// Returns true if a sampler of the given name was found, false otherwise
+// --------------------------------------------------------
+bool ISimpleShader::SetSamplerState(const std::string& name, ID3D11SamplerState* samplerState)
+{
+	// Look for the variable and verify
+	const SimpleSampler* sampInfo = GetSamplerInfo(name);
+	if (sampInfo == 0)
+		return false;
+
+	// Set the sampler state
+	BindSamplerState(sampInfo->BindIndex, samplerState);
+
+	// Success
+	return true;
+}
+
+// --------------------------------------------------------
+// Sets a sampler state in this shader's stage
+//
+// sampler - The handle of the sampler state, from GetSamplerHandle()
+// samplerState - The sampler state in GPU memory
+//
+// Returns true if the handle is valid, false otherwise
+// --------------------------------------------------------
+bool ISimpleShader::SetSamplerState(SimpleSamplerHandle sampler, ID3D11SamplerState* samplerState)
+{
+	// Check the handle (invalid ones wrap around to large indices)
+	if ((unsigned int)sampler.Index >= samplerStates.size())
+		return false;
+
+	// Set the sampler state
+	BindSamplerState(samplerStates[sampler.Index]->BindIndex, samplerState);
+
+	// Success
+	return true;
+}
+
 // --------------------------------------------------------
 // Gets info about a shader variable, if it exists
 // --------------------------------------------------------
-const SimpleShaderVariable* ISimpleShader::GetVariableInfo(std::string name)
+const SimpleShaderVariable* ISimpleShader::GetVariableInfo(const std::string& name)
 {
 	return FindVariable(name, -1);
 }
@@ -459,7 +931,7 @@ const SimpleShaderVariable* ISimpleShader::GetVariableInfo(std::string name)
 //
 // name - the name of the SRV
 // --------------------------------------------------------
-const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(std::string name)
+const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(const std::string& name)
 {
 	// Look for the key
 	std::unordered_map<std::string, SimpleSRV*>::iterator result =
@@ -494,7 +966,7 @@ const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(unsigned int index)
 // 
 // name - the name of the sampler
 // --------------------------------------------------------
-const SimpleSampler* ISimpleShader::GetSamplerInfo(std::string name)
+const SimpleSampler* ISimpleShader::GetSamplerInfo(const std::string& name)
 {
 	// Look for the key
 	std::unordered_map<std::string, SimpleSampler*>::iterator result =
@@ -754,6 +1226,15 @@ void SimpleVertexShader::SetShaderAndCBs()
 	// Is shader valid?
 	if (!shaderValid) return;
 
+	// Go through the state cache if there is one, so what is already bound is skipped
+	if (stateCache)
+	{
+		stateCache->SetInputLayout(inputLayout);
+		stateCache->SetShader(StateCache::Vertex, shader);
+		SetCachedConstantBuffers();
+		return;
+	}
+
 	// Set the shader and input layout
 	deviceContext->IASetInputLayout(inputLayout);
 	deviceContext->VSSetShader(shader, 0, 0);
@@ -769,47 +1250,31 @@ void SimpleVertexShader::SetShaderAndCBs()
 }
 
 // --------------------------------------------------------
-// Sets a shader resource view in the vertex shader stage
+// Binds a shader resource view in the vertex shader stage
 //
-// name - The name of the texture resource in the shader
+// bindIndex - The register to bind it to
 // srv - The shader resource view of the texture in GPU memory
-//
-// Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleVertexShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+void SimpleVertexShader::BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv)
 {
-	// Look for the variable and verify
-	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
-	if (srvInfo == 0)
-		return false;
-
-	// Set the shader resource view
-	deviceContext->VSSetShaderResources(srvInfo->BindIndex, 1, &srv);
-
-	// Success
-	return true;
+	if (stateCache)
+		stateCache->SetShaderResource(StateCache::Vertex, bindIndex, srv);
+	else
+		deviceContext->VSSetShaderResources(bindIndex, 1, &srv);
 }
 
 // --------------------------------------------------------
-// Sets a sampler state in the vertex shader stage
+// Binds a sampler state in the vertex shader stage
 //
-// name - The name of the sampler state in the shader
+// bindIndex - The register to bind it to
 // samplerState - The sampler state in GPU memory
-//
-// Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleVertexShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
+void SimpleVertexShader::BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState)
 {
-	// Look for the variable and verify
-	const SimpleSampler* sampInfo = GetSamplerInfo(name);
-	if (sampInfo == 0)
-		return false;
-
-	// Set the shader resource view
-	deviceContext->VSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
-
-	// Success
-	return true;
+	if (stateCache)
+		stateCache->SetSampler(StateCache::Vertex, bindIndex, samplerState);
+	else
+		deviceContext->VSSetSamplers(bindIndex, 1, &samplerState);
 }
 
 
@@ -876,6 +1341,14 @@ void SimplePixelShader::SetShaderAndCBs()
 	// Is shader valid?
 	if (!shaderValid) return;
 	
+	// Go through the state cache if there is one, so what is already bound is skipped
+	if (stateCache)
+	{
+		stateCache->SetShader(StateCache::Pixel, shader);
+		SetCachedConstantBuffers();
+		return;
+	}
+
 	// Set the shader
 	deviceContext->PSSetShader(shader, 0, 0);
 
@@ -890,47 +1363,31 @@ void SimplePixelShader::SetShaderAndCBs()
 }
 
 // --------------------------------------------------------
-// Sets a shader resource view in the pixel shader stage
+// Binds a shader resource view in the pixel shader stage
 //
-// name - The name of the texture resource in the shader
+// bindIndex - The register to bind it to
 // srv - The shader resource view of the texture in GPU memory
-//
-// Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimplePixelShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+void SimplePixelShader::BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv)
 {
-	// Look for the variable and verify
-	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
-	if (srvInfo == 0)
-		return false;
-
-	// Set the shader resource view
-	deviceContext->PSSetShaderResources(srvInfo->BindIndex, 1, &srv);
-
-	// Success
-	return true;
+	if (stateCache)
+		stateCache->SetShaderResource(StateCache::Pixel, bindIndex, srv);
+	else
+		deviceContext->PSSetShaderResources(bindIndex, 1, &srv);
 }
 
 // --------------------------------------------------------
-// Sets a sampler state in the pixel shader stage
+// Binds a sampler state in the pixel shader stage
 //
-// name - The name of the sampler state in the shader
+// bindIndex - The register to bind it to
 // samplerState - The sampler state in GPU memory
-//
-// Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimplePixelShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
+void SimplePixelShader::BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState)
 {
-	// Look for the variable and verify
-	const SimpleSampler* sampInfo = GetSamplerInfo(name);
-	if (sampInfo == 0)
-		return false;
-
-	// Set the shader resource view
-	deviceContext->PSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
-
-	// Success
-	return true;
+	if (stateCache)
+		stateCache->SetSampler(StateCache::Pixel, bindIndex, samplerState);
+	else
+		deviceContext->PSSetSamplers(bindIndex, 1, &samplerState);
 }
 
 
@@ -999,6 +1456,14 @@ void SimpleDomainShader::SetShaderAndCBs()
 	// Is shader valid?
 	if (!shaderValid) return;
 
+	// Go through the state cache if there is one, so what is already bound is skipped
+	if (stateCache)
+	{
+		stateCache->SetShader(StateCache::Domain, shader);
+		SetCachedConstantBuffers();
+		return;
+	}
+
 	// Set the shader
 	deviceContext->DSSetShader(shader, 0, 0);
 
@@ -1013,47 +1478,31 @@ void SimpleDomainShader::SetShaderAndCBs()
 }
 
 // --------------------------------------------------------
-// Sets a shader resource view in the domain shader stage
+// Binds a shader resource view in the domain shader stage
 //
-// name - The name of the texture resource in the shader
+// bindIndex - The register to bind it to
 // srv - The shader resource view of the texture in GPU memory
-//
-// Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleDomainShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+void SimpleDomainShader::BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv)
 {
-	// Look for the variable and verify
-	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
-	if (srvInfo == 0)
-		return false;
-
-	// Set the shader resource view
-	deviceContext->DSSetShaderResources(srvInfo->BindIndex, 1, &srv);
-
-	// Success
-	return true;
+	if (stateCache)
+		stateCache->SetShaderResource(StateCache::Domain, bindIndex, srv);
+	else
+		deviceContext->DSSetShaderResources(bindIndex, 1, &srv);
 }
 
 // --------------------------------------------------------
-// Sets a sampler state in the domain shader stage
+// Binds a sampler state in the domain shader stage
 //
-// name - The name of the sampler state in the shader
+// bindIndex - The register to bind it to
 // samplerState - The sampler state in GPU memory
-//
-// Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleDomainShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
+void SimpleDomainShader::BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState)
 {
-	// Look for the variable and verify
-	const SimpleSampler* sampInfo = GetSamplerInfo(name);
-	if (sampInfo == 0)
-		return false;
-
-	// Set the shader resource view
-	deviceContext->DSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
-
-	// Success
-	return true;
+	if (stateCache)
+		stateCache->SetSampler(StateCache::Domain, bindIndex, samplerState);
+	else
+		deviceContext->DSSetSamplers(bindIndex, 1, &samplerState);
 }
 
 
@@ -1121,6 +1570,14 @@ void SimpleHullShader::SetShaderAndCBs()
 	// Is shader valid?
 	if (!shaderValid) return;
 
+	// Go through the state cache if there is one, so what is already bound is skipped
+	if (stateCache)
+	{
+		stateCache->SetShader(StateCache::Hull, shader);
+		SetCachedConstantBuffers();
+		return;
+	}
+
 	// Set the shader
 	deviceContext->HSSetShader(shader, 0, 0);
 
@@ -1135,47 +1592,31 @@ void SimpleHullShader::SetShaderAndCBs()
 }
 
 // --------------------------------------------------------
-// Sets a shader resource view in the hull shader stage
+// Binds a shader resource view in the hull shader stage
 //
-// name - The name of the texture resource in the shader
+// bindIndex - The register to bind it to
 // srv - The shader resource view of the texture in GPU memory
-//
-// Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleHullShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+void SimpleHullShader::BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv)
 {
-	// Look for the variable and verify
-	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
-	if (srvInfo == 0)
-		return false;
-
-	// Set the shader resource view
-	deviceContext->HSSetShaderResources(srvInfo->BindIndex, 1, &srv);
-
-	// Success
-	return true;
+	if (stateCache)
+		stateCache->SetShaderResource(StateCache::Hull, bindIndex, srv);
+	else
+		deviceContext->HSSetShaderResources(bindIndex, 1, &srv);
 }
 
 // --------------------------------------------------------
-// Sets a sampler state in the hull shader stage
+// Binds a sampler state in the hull shader stage
 //
-// name - The name of the sampler state in the shader
+// bindIndex - The register to bind it to
 // samplerState - The sampler state in GPU memory
-//
-// Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleHullShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
+void SimpleHullShader::BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState)
 {
-	// Look for the variable and verify
-	const SimpleSampler* sampInfo = GetSamplerInfo(name);
-	if (sampInfo == 0)
-		return false;
-
-	// Set the shader resource view
-	deviceContext->HSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
-
-	// Success
-	return true;
+	if (stateCache)
+		stateCache->SetSampler(StateCache::Hull, bindIndex, samplerState);
+	else
+		deviceContext->HSSetSamplers(bindIndex, 1, &samplerState);
 }
 
 
@@ -1365,6 +1806,14 @@ void SimpleGeometryShader::SetShaderAndCBs()
 	// Is shader valid?
 	if (!shaderValid) return;
 
+	// Go through the state cache if there is one, so what is already bound is skipped
+	if (stateCache)
+	{
+		stateCache->SetShader(StateCache::Geometry, shader);
+		SetCachedConstantBuffers();
+		return;
+	}
+
 	// Set the shader
 	deviceContext->GSSetShader(shader, 0, 0);
 
@@ -1379,47 +1828,31 @@ void SimpleGeometryShader::SetShaderAndCBs()
 }
 
 // --------------------------------------------------------
-// Sets a shader resource view in the Geometry shader stage
+// Binds a shader resource view in the geometry shader stage
 //
-// name - The name of the texture resource in the shader
+// bindIndex - The register to bind it to
 // srv - The shader resource view of the texture in GPU memory
-//
-// Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleGeometryShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+void SimpleGeometryShader::BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv)
 {
-	// Look for the variable and verify
-	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
-	if (srvInfo == 0)
-		return false;
-
-	// Set the shader resource view
-	deviceContext->GSSetShaderResources(srvInfo->BindIndex, 1, &srv);
-
-	// Success
-	return true;
+	if (stateCache)
+		stateCache->SetShaderResource(StateCache::Geometry, bindIndex, srv);
+	else
+		deviceContext->GSSetShaderResources(bindIndex, 1, &srv);
 }
 
 // --------------------------------------------------------
-// Sets a sampler state in the Geometry shader stage
+// Binds a sampler state in the geometry shader stage
 //
-// name - The name of the sampler state in the shader
+// bindIndex - The register to bind it to
 // samplerState - The sampler state in GPU memory
-//
-// Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleGeometryShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
+void SimpleGeometryShader::BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState)
 {
-	// Look for the variable and verify
-	const SimpleSampler* sampInfo = GetSamplerInfo(name);
-	if (sampInfo == 0)
-		return false;
-
-	// Set the shader resource view
-	deviceContext->GSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
-
-	// Success
-	return true;
+	if (stateCache)
+		stateCache->SetSampler(StateCache::Geometry, bindIndex, samplerState);
+	else
+		deviceContext->GSSetSamplers(bindIndex, 1, &samplerState);
 }
 
 // --------------------------------------------------------
@@ -1550,6 +1983,14 @@ void SimpleComputeShader::SetShaderAndCBs()
 	// Is shader valid?
 	if (!shaderValid) return;
 
+	// Go through the state cache if there is one, so what is already bound is skipped
+	if (stateCache)
+	{
+		stateCache->SetShader(StateCache::Compute, shader);
+		SetCachedConstantBuffers();
+		return;
+	}
+
 	// Set the shader
 	deviceContext->CSSetShader(shader, 0, 0);
 
@@ -1585,6 +2026,10 @@ void SimpleComputeShader::SetShaderAndCBs()
 // --------------------------------------------------------
 void SimpleComputeShader::DispatchByGroups(unsigned int groupsX, unsigned int groupsY, unsigned int groupsZ)
 {
+	// Bindings held by the state cache have to reach the context first
+	if (stateCache)
+		stateCache->Apply();
+
 	deviceContext->Dispatch(groupsX, groupsY, groupsZ);
 }
 
@@ -1610,6 +2055,10 @@ void SimpleComputeShader::DispatchByGroups(unsigned int groupsX, unsigned int gr
 // --------------------------------------------------------
 void SimpleComputeShader::DispatchByThreads(unsigned int threadsX, unsigned int threadsY, unsigned int threadsZ)
 {
+	// Bindings held by the state cache have to reach the context first
+	if (stateCache)
+		stateCache->Apply();
+
 	deviceContext->Dispatch(
 		max((unsigned int)ceil((float)threadsX / this->threadsX), 1),
 		max((unsigned int)ceil((float)threadsY / this->threadsY), 1),
@@ -1617,47 +2066,31 @@ void SimpleComputeShader::DispatchByThreads(unsigned int threadsX, unsigned int
 }
 
 // --------------------------------------------------------
-// Sets a shader resource view in the Compute shader stage
+// Binds a shader resource view in the compute shader stage
 //
-// name - The name of the texture resource in the shader
+// bindIndex - The register to bind it to
 // srv - The shader resource view of the texture in GPU memory
-//
-// Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleComputeShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+void SimpleComputeShader::BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv)
 {
-	// Look for the variable and verify
-	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
-	if (srvInfo == 0)
-		return false;
-
-	// Set the shader resource view
-	deviceContext->CSSetShaderResources(srvInfo->BindIndex, 1, &srv);
-
-	// Success
-	return true;
+	if (stateCache)
+		stateCache->SetShaderResource(StateCache::Compute, bindIndex, srv);
+	else
+		deviceContext->CSSetShaderResources(bindIndex, 1, &srv);
 }
 
 // --------------------------------------------------------
-// Sets a sampler state in the Compute shader stage
+// Binds a sampler state in the compute shader stage
 //
-// name - The name of the sampler state in the shader
+// bindIndex - The register to bind it to
 // samplerState - The sampler state in GPU memory
-//
-// Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleComputeShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
+void SimpleComputeShader::BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState)
 {
-	// Look for the variable and verify
-	const SimpleSampler* sampInfo = GetSamplerInfo(name);
-	if (sampInfo == 0)
-		return false;
-
-	// Set the shader resource view
-	deviceContext->CSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
-
-	// Success
-	return true;
+	if (stateCache)
+		stateCache->SetSampler(StateCache::Compute, bindIndex, samplerState);
+	else
+		deviceContext->CSSetSamplers(bindIndex, 1, &samplerState);
 }
 
 // --------------------------------------------------------
@@ -10,6 +10,10 @@
 #include <vector>
 #include <string>
 
+#include "StateCache.h"
+
+class ConstantBufferRing;
+
 // --------------------------------------------------------
 // Used by simple shaders to store information about
 // specific variables in constant buffers
@@ -21,6 +25,18 @@ struct SimpleShaderVariable
 	unsigned int ConstantBufferIndex;
 };
 
+// --------------------------------------------------------
+// How often the data in a constant buffer changes, taken
+// from the start of its name in the shader: "perFrame",
+// "perMaterial", or anything else for per object
+// --------------------------------------------------------
+enum class SimpleBufferFrequency
+{
+	PerFrame,
+	PerMaterial,
+	PerObject
+};
+
 // --------------------------------------------------------
 // Contains information about a specific
 // constant buffer in a shader, as well as
@@ -31,7 +47,13 @@ struct SimpleConstantBuffer
 	std::string Name;
 	unsigned int Size;
 	unsigned int BindIndex;
+	SimpleBufferFrequency Frequency;
+	bool Dirty;				// Local data changed since it was last copied
 	ID3D11Buffer* ConstantBuffer;
+	ID3D11Buffer* BoundBuffer;		// What gets bound: ConstantBuffer, or a
+	unsigned int FirstConstant;		// ring's buffer and the range the data
+	unsigned int ConstantCount;		// was last copied to (0 constants for all)
+	unsigned long long RingFrame;	// Ring frame the range is from
 	unsigned char* LocalDataBuffer;
 	std::vector<SimpleShaderVariable> Variables;
 };
@@ -54,6 +76,42 @@ struct SimpleSampler
 	unsigned int BindIndex; // The register of the Sampler
 };
 
+// --------------------------------------------------------
+// Hashes a variable or resource name with FNV-1a, so names
+// known up front can be hashed by the compiler:
+//   constexpr unsigned int World = SimpleHashName("world");
+// --------------------------------------------------------
+constexpr unsigned int SimpleHashName(const char* name)
+{
+	unsigned int hash = 2166136261u;
+	while (*name)
+	{
+		hash ^= (unsigned char)*name++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+// --------------------------------------------------------
+// A variable, constant buffer, SRV or sampler of a shader,
+// looked up once so later calls can skip the name. Only
+// good for the shader it came from, until that shader is
+// loaded again. Invalid if the name was not found
+// --------------------------------------------------------
+template <typename T>
+struct SimpleHandle
+{
+	int Index;
+
+	explicit SimpleHandle(int index = -1) : Index(index) {}
+	bool IsValid() const { return Index >= 0; }
+};
+
+typedef SimpleHandle<SimpleShaderVariable> SimpleVariableHandle;
+typedef SimpleHandle<SimpleConstantBuffer> SimpleBufferHandle;
+typedef SimpleHandle<SimpleSRV> SimpleResourceHandle;
+typedef SimpleHandle<SimpleSampler> SimpleSamplerHandle;
+
 // --------------------------------------------------------
 // Base abstract class for simplifying shader handling
 // --------------------------------------------------------
@@ -70,38 +128,83 @@ public:
 	// Simple helpers
 	bool IsShaderValid() { return shaderValid; }
 
+	// Send bindings through a StateCache instead of straight to the context
+	// (0 to go straight there again). Draws and dispatches then need the
+	// cache's Apply() first; the compute Dispatch methods call it themselves.
+	void SetStateCache(StateCache* cache) { stateCache = cache; }
+
+	// Copy constant data into ranges of a ConstantBufferRing and bind
+	// those, instead of updating this shader's own buffers (0 to stop).
+	// Only used along with a StateCache, and when the ring is supported.
+	// Copies bind what they copy, so make them after SetShader().
+	void SetConstantRing(ConstantBufferRing* ring);
+
 	// Activating the shader and copying data
 	void SetShader();
 	void CopyAllBufferData();
 	void CopyBufferData(unsigned int index);
 	void CopyBufferData(std::string bufferName);
+	void CopyBufferData(SimpleBufferHandle buffer);
+
+	// Copies the buffers of one update frequency whose data
+	// changed since they were last copied
+	void CopyBufferData(SimpleBufferFrequency frequency);
+
+	// Bytes copied to constant buffers since the last reset
+	size_t GetUploadedBytes() { return uploadedBytes; }
+	void ResetUploadedBytes() { uploadedBytes = 0; }
+
+	// Looking up handles by name or by SimpleHashName() of it, for
+	// the setters below that skip the lookup on every call
+	SimpleVariableHandle GetVariableHandle(const std::string& name);
+	SimpleVariableHandle GetVariableHandle(unsigned int nameHash);
+	SimpleBufferHandle GetBufferHandle(const std::string& name);
+	SimpleBufferHandle GetBufferHandle(unsigned int nameHash);
+	SimpleResourceHandle GetShaderResourceViewHandle(const std::string& name);
+	SimpleResourceHandle GetShaderResourceViewHandle(unsigned int nameHash);
+	SimpleSamplerHandle GetSamplerHandle(const std::string& name);
+	SimpleSamplerHandle GetSamplerHandle(unsigned int nameHash);
 
 	// Sets arbitrary shader data
-	bool SetData(std::string name, const void* data, unsigned int size);
-
-	bool SetInt(std::string name, int data);
-	bool SetFloat(std::string name, float data);
-	bool SetFloat2(std::string name, const float data[2]);
-	bool SetFloat2(std::string name, const DirectX::XMFLOAT2 data);
-	bool SetFloat3(std::string name, const float data[3]);
-	bool SetFloat3(std::string name, const DirectX::XMFLOAT3 data);
-	bool SetFloat4(std::string name, const float data[4]);
-	bool SetFloat4(std::string name, const DirectX::XMFLOAT4 data);
-	bool SetMatrix4x4(std::string name, const float data[16]);
-	bool SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data);
+	bool SetData(const std::string& name, const void* data, unsigned int size);
+	bool SetData(SimpleVariableHandle variable, const void* data, unsigned int size);
+
+	bool SetInt(const std::string& name, int data);
+	bool SetFloat(const std::string& name, float data);
+	bool SetFloat2(const std::string& name, const float data[2]);
+	bool SetFloat2(const std::string& name, const DirectX::XMFLOAT2 data);
+	bool SetFloat3(const std::string& name, const float data[3]);
+	bool SetFloat3(const std::string& name, const DirectX::XMFLOAT3 data);
+	bool SetFloat4(const std::string& name, const float data[4]);
+	bool SetFloat4(const std::string& name, const DirectX::XMFLOAT4 data);
+	bool SetMatrix4x4(const std::string& name, const float data[16]);
+	bool SetMatrix4x4(const std::string& name, const DirectX::XMFLOAT4X4 data);
+
+	bool SetInt(SimpleVariableHandle variable, int data);
+	bool SetFloat(SimpleVariableHandle variable, float data);
+	bool SetFloat2(SimpleVariableHandle variable, const float data[2]);
+	bool SetFloat2(SimpleVariableHandle variable, const DirectX::XMFLOAT2& data);
+	bool SetFloat3(SimpleVariableHandle variable, const float data[3]);
+	bool SetFloat3(SimpleVariableHandle variable, const DirectX::XMFLOAT3& data);
+	bool SetFloat4(SimpleVariableHandle variable, const float data[4]);
+	bool SetFloat4(SimpleVariableHandle variable, const DirectX::XMFLOAT4& data);
+	bool SetMatrix4x4(SimpleVariableHandle variable, const float data[16]);
+	bool SetMatrix4x4(SimpleVariableHandle variable, const DirectX::XMFLOAT4X4& data);
 
 	// Setting shader resources
-	virtual bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv) = 0;
-	virtual bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState) = 0;
+	bool SetShaderResourceView(const std::string& name, ID3D11ShaderResourceView* srv);
+	bool SetShaderResourceView(SimpleResourceHandle resource, ID3D11ShaderResourceView* srv);
+	bool SetSamplerState(const std::string& name, ID3D11SamplerState* samplerState);
+	bool SetSamplerState(SimpleSamplerHandle sampler, ID3D11SamplerState* samplerState);
 
 	// Getting data about variables and resources
-	const SimpleShaderVariable* GetVariableInfo(std::string name);
+	const SimpleShaderVariable* GetVariableInfo(const std::string& name);
 	
-	const SimpleSRV* GetShaderResourceViewInfo(std::string name);
+	const SimpleSRV* GetShaderResourceViewInfo(const std::string& name);
 	const SimpleSRV* GetShaderResourceViewInfo(unsigned int index);
 	unsigned int GetShaderResourceViewCount() { return textureTable.size(); }
 	
-	const SimpleSampler* GetSamplerInfo(std::string name);
+	const SimpleSampler* GetSamplerInfo(const std::string& name);
 	const SimpleSampler* GetSamplerInfo(unsigned int index);
 	unsigned int GetSamplerCount() { return samplerTable.size(); }
 
@@ -120,28 +223,52 @@ protected:
 	ID3DBlob* shaderBlob;
 	ID3D11Device* device;
 	ID3D11DeviceContext* deviceContext;
+	StateCache* stateCache;
+	ConstantBufferRing* constantRing;
 
 	// Resource counts
 	unsigned int constantBufferCount;
+	size_t uploadedBytes;
 	
 	// Maps for variables and buffers
 	SimpleConstantBuffer*		constantBuffers; // For index-based lookup
 	std::vector<SimpleSRV*>		shaderResourceViews;
 	std::vector<SimpleSampler*>	samplerStates;
+	std::vector<SimpleShaderVariable> variables;	// For handle-based lookup
 	std::unordered_map<std::string, SimpleConstantBuffer*> cbTable;
-	std::unordered_map<std::string, SimpleShaderVariable> varTable;
+	std::unordered_map<std::string, unsigned int> varTable;
 	std::unordered_map<std::string, SimpleSRV*> textureTable;
 	std::unordered_map<std::string, SimpleSampler*> samplerTable;
 
+	// Name hashes to handle indices, -1 where two names share a hash
+	std::unordered_map<unsigned int, int> cbHashTable;
+	std::unordered_map<unsigned int, int> varHashTable;
+	std::unordered_map<unsigned int, int> textureHashTable;
+	std::unordered_map<unsigned int, int> samplerHashTable;
+
 	// Pure virtual functions for dealing with shader types
 	virtual bool CreateShader(ID3DBlob* shaderBlob) = 0;
 	virtual void SetShaderAndCBs() = 0;
+	virtual StateCache::Stage GetCacheStage() = 0;
+	virtual void BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv) = 0;
+	virtual void BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState) = 0;
 
 	virtual void CleanUp();
 
 	// Helpers for finding data by name
-	SimpleShaderVariable* FindVariable(std::string name, int size);
+	SimpleShaderVariable* FindVariable(const std::string& name, int size);
+	SimpleShaderVariable* FindVariable(SimpleVariableHandle variable, int size);
 	SimpleConstantBuffer* FindConstantBuffer(std::string name);
+
+	// Copies one buffer's local data to the GPU
+	void UploadBuffer(SimpleConstantBuffer* cb);
+
+	// Copies data into a variable's spot in the local data buffer
+	void WriteVariable(const SimpleShaderVariable* var, const void* data, unsigned int size);
+
+	// Binds every constant buffer through the state cache, copying
+	// again those whose ring range is from an earlier frame
+	void SetCachedConstantBuffers();
 };
 
 // --------------------------------------------------------
@@ -157,15 +284,15 @@ public:
 	ID3D11InputLayout* GetInputLayout() { return inputLayout; }
 	bool GetPerInstanceCompatible() { return perInstanceCompatible; }
 
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
-
 protected:
 	bool perInstanceCompatible;
 	ID3D11InputLayout* inputLayout;
 	ID3D11VertexShader* shader;
 	bool CreateShader(ID3DBlob* shaderBlob);
 	void SetShaderAndCBs();
+	StateCache::Stage GetCacheStage() { return StateCache::Vertex; }
+	void BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv);
+	void BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState);
 	void CleanUp();
 };
 
@@ -180,13 +307,13 @@ public:
 	~SimplePixelShader();
 	ID3D11PixelShader* GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
-
 protected:
 	ID3D11PixelShader* shader;
 	bool CreateShader(ID3DBlob* shaderBlob);
 	void SetShaderAndCBs();
+	StateCache::Stage GetCacheStage() { return StateCache::Pixel; }
+	void BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv);
+	void BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState);
 	void CleanUp();
 };
 
@@ -200,13 +327,13 @@ public:
 	~SimpleDomainShader();
 	ID3D11DomainShader* GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
-
 protected:
 	ID3D11DomainShader* shader;
 	bool CreateShader(ID3DBlob* shaderBlob);
 	void SetShaderAndCBs();
+	StateCache::Stage GetCacheStage() { return StateCache::Domain; }
+	void BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv);
+	void BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState);
 	void CleanUp();
 };
 
@@ -220,13 +347,13 @@ public:
 	~SimpleHullShader();
 	ID3D11HullShader* GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
-
 protected:
 	ID3D11HullShader* shader;
 	bool CreateShader(ID3DBlob* shaderBlob);
 	void SetShaderAndCBs();
+	StateCache::Stage GetCacheStage() { return StateCache::Hull; }
+	void BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv);
+	void BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState);
 	void CleanUp();
 };
 
@@ -240,9 +367,6 @@ public:
 	~SimpleGeometryShader();
 	ID3D11GeometryShader* GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
-
 	bool CreateCompatibleStreamOutBuffer(ID3D11Buffer** buffer, int vertexCount);
 
 	static void UnbindStreamOutStage(ID3D11DeviceContext* deviceContext);
@@ -259,6 +383,9 @@ protected:
 	bool CreateShader(ID3DBlob* shaderBlob);
 	bool CreateShaderWithStreamOut(ID3DBlob* shaderBlob);
 	void SetShaderAndCBs();
+	StateCache::Stage GetCacheStage() { return StateCache::Geometry; }
+	void BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv);
+	void BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState);
 	void CleanUp();
 
 	// Helpers
@@ -279,8 +406,6 @@ public:
 	void DispatchByGroups(unsigned int groupsX, unsigned int groupsY, unsigned int groupsZ);
 	void DispatchByThreads(unsigned int threadsX, unsigned int threadsY, unsigned int threadsZ);
 
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
 	bool SetUnorderedAccessView(std::string name, ID3D11UnorderedAccessView* uav, unsigned int appendConsumeOffset = -1);
 
 	int GetUnorderedAccessViewIndex(std::string name);
@@ -296,5 +421,8 @@ protected:
 
 	bool CreateShader(ID3DBlob* shaderBlob);
 	void SetShaderAndCBs();
+	StateCache::Stage GetCacheStage() { return StateCache::Compute; }
+	void BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv);
+	void BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState);
 	void CleanUp();
 };
\ No newline at end of file
@@ -0,0 +1,422 @@
+#include "SpatialHashGrid.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <utility>
+
+using namespace DirectX;
+
+namespace
+{
+	// Cell coordinates are kept to 21 bits each in a cell key
+	const int CellKeyBias = 1 << 20;
+	const uint64_t CellKeyMask = (1u << 21) - 1u;
+
+	// Candidate for a nearest search: squared distance and sorted index
+	typedef std::pair<float, unsigned int> Candidate;
+}
+
+void SpatialHashGrid::Build(const XMFLOAT3* t_positions, size_t t_count, float t_cell_size)
+{
+	count = t_count;
+	cellSize = t_cell_size;
+	inverseCellSize = 1.0f / t_cell_size;
+
+	// Twice as many buckets as points keeps most buckets to one cell
+	size_t bucketCount = 1;
+	unsigned int bucketBits = 0;
+	while (bucketCount < 2 * t_count)
+	{
+		bucketCount *= 2;
+		++bucketBits;
+	}
+	bucketMask = (unsigned int)(bucketCount - 1);
+
+	entries.resize(t_count);
+	entryScratch.resize(t_count);
+	pointKeys.resize(t_count);
+	sortedX.resize(t_count);
+	sortedY.resize(t_count);
+	sortedZ.resize(t_count);
+	sortedIndices.resize(t_count);
+	sortedKeys.resize(t_count);
+	bucketStarts.resize(bucketCount + 1);
+
+	JobSystem& jobSystem = JobSystem::GetInstance();
+	size_t pointChunks = (t_count + ChunkSize - 1) / ChunkSize;
+	chunkDigitStarts.resize(pointChunks * RadixSize);
+
+	// Hash every point
+	std::vector<int> chunkBounds(pointChunks * 6);
+	auto hashPoints = [this, t_positions, t_count, &chunkBounds](size_t t_chunk)
+	{
+		int* bounds = &chunkBounds[t_chunk * 6];
+		bounds[0] = bounds[1] = bounds[2] = INT_MAX;
+		bounds[3] = bounds[4] = bounds[5] = INT_MIN;
+
+		size_t end = (std::min)((t_chunk + 1) * ChunkSize, t_count);
+		for (size_t i = t_chunk * ChunkSize; i < end; ++i)
+		{
+			int cellX, cellY, cellZ;
+			GetCell(t_positions[i].x, t_positions[i].y, t_positions[i].z, cellX, cellY, cellZ);
+			pointKeys[i] = GetCellKey(cellX, cellY, cellZ);
+			entries[i].Bucket = GetBucket(cellX, cellY, cellZ);
+			entries[i].Index = (unsigned int)i;
+
+			bounds[0] = (std::min)(bounds[0], cellX);
+			bounds[1] = (std::min)(bounds[1], cellY);
+			bounds[2] = (std::min)(bounds[2], cellZ);
+			bounds[3] = (std::max)(bounds[3], cellX);
+			bounds[4] = (std::max)(bounds[4], cellY);
+			bounds[5] = (std::max)(bounds[5], cellZ);
+		}
+	};
+	jobSystem.ParallelFor(pointChunks, 1, hashPoints);
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		minCell[axis] = INT_MAX;
+		maxCell[axis] = INT_MIN;
+		for (size_t chunk = 0; chunk < pointChunks; ++chunk)
+		{
+			minCell[axis] = (std::min)(minCell[axis], chunkBounds[chunk * 6 + axis]);
+			maxCell[axis] = (std::max)(maxCell[axis], chunkBounds[chunk * 6 + 3 + axis]);
+		}
+	}
+
+	// Sort by bucket a digit at a time, lowest first. Each pass is a counting
+	// sort: every chunk counts its own digits, a prefix sum over (digit, chunk)
+	// gives each chunk its own range to write every digit to, and each chunk
+	// then writes its points in order. That keeps every pass stable, so points
+	// end up in index order within a bucket without any atomics.
+	for (unsigned int shift = 0; shift < bucketBits; shift += RadixBits)
+	{
+		auto countDigits = [this, t_count, shift](size_t t_chunk)
+		{
+			unsigned int* counts = &chunkDigitStarts[t_chunk * RadixSize];
+			std::fill(counts, counts + RadixSize, 0u);
+
+			size_t end = (std::min)((t_chunk + 1) * ChunkSize, t_count);
+			for (size_t i = t_chunk * ChunkSize; i < end; ++i)
+			{
+				++counts[(entries[i].Bucket >> shift) & (RadixSize - 1)];
+			}
+		};
+		jobSystem.ParallelFor(pointChunks, 1, countDigits);
+
+		unsigned int running = 0;
+		for (unsigned int digit = 0; digit < RadixSize; ++digit)
+		{
+			for (size_t chunk = 0; chunk < pointChunks; ++chunk)
+			{
+				unsigned int digitCount = chunkDigitStarts[chunk * RadixSize + digit];
+				chunkDigitStarts[chunk * RadixSize + digit] = running;
+				running += digitCount;
+			}
+		}
+
+		auto scatterPoints = [this, t_count, shift](size_t t_chunk)
+		{
+			unsigned int* starts = &chunkDigitStarts[t_chunk * RadixSize];
+			size_t end = (std::min)((t_chunk + 1) * ChunkSize, t_count);
+			for (size_t i = t_chunk * ChunkSize; i < end; ++i)
+			{
+				entryScratch[starts[(entries[i].Bucket >> shift) & (RadixSize - 1)]++] = entries[i];
+			}
+		};
+		jobSystem.ParallelFor(pointChunks, 1, scatterPoints);
+		entries.swap(entryScratch);
+	}
+
+	// Copy the points into sorted order. Each slot also starts every bucket
+	// from the one before it up to its own, so every bucket start is written
+	// by exactly one slot (or, past the last point, by the last slot).
+	auto gatherPoints = [this, t_positions, t_count, bucketCount](size_t t_chunk)
+	{
+		size_t end = (std::min)((t_chunk + 1) * ChunkSize, t_count);
+		for (size_t slot = t_chunk * ChunkSize; slot < end; ++slot)
+		{
+			unsigned int i = entries[slot].Index;
+			sortedX[slot] = t_positions[i].x;
+			sortedY[slot] = t_positions[i].y;
+			sortedZ[slot] = t_positions[i].z;
+			sortedIndices[slot] = i;
+			sortedKeys[slot] = pointKeys[i];
+
+			size_t firstBucket = slot > 0 ? entries[slot - 1].Bucket + 1 : 0;
+			for (size_t b = firstBucket; b <= entries[slot].Bucket; ++b)
+			{
+				bucketStarts[b] = (unsigned int)slot;
+			}
+			if (slot + 1 == t_count)
+			{
+				for (size_t b = entries[slot].Bucket + 1; b <= bucketCount; ++b)
+				{
+					bucketStarts[b] = (unsigned int)t_count;
+				}
+			}
+		}
+	};
+	jobSystem.ParallelFor(pointChunks, 1, gatherPoints);
+
+	if (t_count == 0)
+	{
+		std::fill(bucketStarts.begin(), bucketStarts.end(), 0u);
+	}
+}
+
+void SpatialHashGrid::QueryRadius(const XMFLOAT3& t_center, float t_radius, std::vector<unsigned int>& t_results) const
+{
+	float radiusSquared = t_radius * t_radius;
+	auto visit = [&](unsigned int t_slot)
+	{
+		float dx = sortedX[t_slot] - t_center.x;
+		float dy = sortedY[t_slot] - t_center.y;
+		float dz = sortedZ[t_slot] - t_center.z;
+		if (dx * dx + dy * dy + dz * dz <= radiusSquared)
+		{
+			t_results.push_back(sortedIndices[t_slot]);
+		}
+	};
+
+	XMFLOAT3 queryMin(t_center.x - t_radius, t_center.y - t_radius, t_center.z - t_radius);
+	XMFLOAT3 queryMax(t_center.x + t_radius, t_center.y + t_radius, t_center.z + t_radius);
+	ForEachPointInCells(queryMin, queryMax, visit);
+}
+
+void SpatialHashGrid::QueryBox(const XMFLOAT3& t_min, const XMFLOAT3& t_max, std::vector<unsigned int>& t_results) const
+{
+	auto visit = [&](unsigned int t_slot)
+	{
+		if (sortedX[t_slot] >= t_min.x && sortedX[t_slot] <= t_max.x &&
+			sortedY[t_slot] >= t_min.y && sortedY[t_slot] <= t_max.y &&
+			sortedZ[t_slot] >= t_min.z && sortedZ[t_slot] <= t_max.z)
+		{
+			t_results.push_back(sortedIndices[t_slot]);
+		}
+	};
+	ForEachPointInCells(t_min, t_max, visit);
+}
+
+void SpatialHashGrid::QueryNearest(const XMFLOAT3& t_center, unsigned int t_k, std::vector<unsigned int>& t_results) const
+{
+	t_results.clear();
+	if (count == 0 || t_k == 0)
+	{
+		return;
+	}
+
+	// Largest of the best t_k so far on top
+	std::priority_queue<Candidate> best;
+
+	int centerX, centerY, centerZ;
+	GetCell(t_center.x, t_center.y, t_center.z, centerX, centerY, centerZ);
+
+	// How far the center is from the nearest face of its own cell
+	float margin = (std::min)((std::min)(
+		(std::min)(t_center.x - centerX * cellSize, (centerX + 1) * cellSize - t_center.x),
+		(std::min)(t_center.y - centerY * cellSize, (centerY + 1) * cellSize - t_center.y)),
+		(std::min)(t_center.z - centerZ * cellSize, (centerZ + 1) * cellSize - t_center.z));
+	margin = (std::max)(margin, 0.0f);
+
+	// Search shells of cells around the center's cell, one ring wider each time
+	for (int ring = 0; ; ++ring)
+	{
+		for (int z = centerZ - ring; z <= centerZ + ring; ++z)
+		{
+			for (int y = centerY - ring; y <= centerY + ring; ++y)
+			{
+				// Inside the shell only the first and last cell of a row are new
+				bool onShell = z == centerZ - ring || z == centerZ + ring || y == centerY - ring || y == centerY + ring;
+				int step = onShell || ring == 0 ? 1 : 2 * ring;
+				for (int x = centerX - ring; x <= centerX + ring; x += step)
+				{
+					uint64_t key = GetCellKey(x, y, z);
+					unsigned int bucket = GetBucket(x, y, z);
+					for (unsigned int slot = bucketStarts[bucket]; slot < bucketStarts[bucket + 1]; ++slot)
+					{
+						if (sortedKeys[slot] != key)
+						{
+							continue;
+						}
+
+						float dx = sortedX[slot] - t_center.x;
+						float dy = sortedY[slot] - t_center.y;
+						float dz = sortedZ[slot] - t_center.z;
+						Candidate candidate(dx * dx + dy * dy + dz * dz, slot);
+						if (best.size() < t_k)
+						{
+							best.push(candidate);
+						}
+						else if (candidate < best.top())
+						{
+							best.pop();
+							best.push(candidate);
+						}
+					}
+				}
+			}
+		}
+
+		// Everything within this distance of the center has been seen
+		float covered = ring * cellSize + margin;
+		if (best.size() == t_k && best.top().first <= covered * covered)
+		{
+			break;
+		}
+
+		// Or there is nothing left to find
+		if (centerX - ring <= minCell[0] && centerY - ring <= minCell[1] && centerZ - ring <= minCell[2] &&
+			centerX + ring >= maxCell[0] && centerY + ring >= maxCell[1] && centerZ + ring >= maxCell[2])
+		{
+			break;
+		}
+	}
+
+	t_results.resize(best.size());
+	for (size_t i = best.size(); i > 0; --i)
+	{
+		t_results[i - 1] = sortedIndices[best.top().second];
+		best.pop();
+	}
+}
+
+void SpatialHashGrid::QueryRadiusBatch(const XMFLOAT3* t_centers, size_t t_count, float t_radius,
+	std::vector<unsigned int>& t_offsets, std::vector<unsigned int>& t_results) const
+{
+	// Each job collects its own results; they are joined in query order afterwards
+	size_t chunkCount = (t_count + QueryChunkSize - 1) / QueryChunkSize;
+	std::vector<std::vector<unsigned int>> chunkResults(chunkCount);
+	t_offsets.assign(t_count + 1, 0);
+
+	auto queryChunk = [&](size_t t_chunk)
+	{
+		std::vector<unsigned int>& results = chunkResults[t_chunk];
+		size_t end = (std::min)((t_chunk + 1) * QueryChunkSize, t_count);
+		for (size_t q = t_chunk * QueryChunkSize; q < end; ++q)
+		{
+			size_t before = results.size();
+			QueryRadius(t_centers[q], t_radius, results);
+			t_offsets[q + 1] = (unsigned int)(results.size() - before);
+		}
+	};
+	JobSystem::GetInstance().ParallelFor(chunkCount, 1, queryChunk);
+
+	for (size_t q = 0; q < t_count; ++q)
+	{
+		t_offsets[q + 1] += t_offsets[q];
+	}
+
+	t_results.clear();
+	t_results.reserve(t_offsets[t_count]);
+	for (const std::vector<unsigned int>& results : chunkResults)
+	{
+		t_results.insert(t_results.end(), results.begin(), results.end());
+	}
+}
+
+void SpatialHashGrid::QueryNearestBatch(const XMFLOAT3* t_centers, size_t t_count, unsigned int t_k, std::vector<unsigned int>& t_results) const
+{
+	t_results.assign(t_count * t_k, (unsigned int)NullIndex);
+
+	size_t chunkCount = (t_count + QueryChunkSize - 1) / QueryChunkSize;
+	auto queryChunk = [&](size_t t_chunk)
+	{
+		std::vector<unsigned int> nearest;
+		size_t end = (std::min)((t_chunk + 1) * QueryChunkSize, t_count);
+		for (size_t q = t_chunk * QueryChunkSize; q < end; ++q)
+		{
+			QueryNearest(t_centers[q], t_k, nearest);
+			std::copy(nearest.begin(), nearest.end(), t_results.begin() + q * t_k);
+		}
+	};
+	JobSystem::GetInstance().ParallelFor(chunkCount, 1, queryChunk);
+}
+
+size_t SpatialHashGrid::GetCount() const
+{
+	return count;
+}
+
+float SpatialHashGrid::GetCellSize() const
+{
+	return cellSize;
+}
+
+void SpatialHashGrid::GetCell(float t_x, float t_y, float t_z, int& t_cell_x, int& t_cell_y, int& t_cell_z) const
+{
+	t_cell_x = (int)floorf(t_x * inverseCellSize);
+	t_cell_y = (int)floorf(t_y * inverseCellSize);
+	t_cell_z = (int)floorf(t_z * inverseCellSize);
+}
+
+uint64_t SpatialHashGrid::GetCellKey(int t_cell_x, int t_cell_y, int t_cell_z)
+{
+	return (((uint64_t)(t_cell_x + CellKeyBias) & CellKeyMask) << 42) |
+		(((uint64_t)(t_cell_y + CellKeyBias) & CellKeyMask) << 21) |
+		((uint64_t)(t_cell_z + CellKeyBias) & CellKeyMask);
+}
+
+unsigned int SpatialHashGrid::GetBucket(int t_cell_x, int t_cell_y, int t_cell_z) const
+{
+	unsigned int hash = ((unsigned int)t_cell_x * 73856093u) ^ ((unsigned int)t_cell_y * 19349663u) ^ ((unsigned int)t_cell_z * 83492791u);
+	hash ^= hash >> 16;
+	return hash & bucketMask;
+}
+
+template<typename Visitor>
+void SpatialHashGrid::ForEachPointInCells(const XMFLOAT3& t_min, const XMFLOAT3& t_max, Visitor& t_visit) const
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	int minX, minY, minZ, maxX, maxY, maxZ;
+	GetCell(t_min.x, t_min.y, t_min.z, minX, minY, minZ);
+	GetCell(t_max.x, t_max.y, t_max.z, maxX, maxY, maxZ);
+
+	// No need to look past the cells that hold anything
+	minX = (std::max)(minX, minCell[0]);
+	minY = (std::max)(minY, minCell[1]);
+	minZ = (std::max)(minZ, minCell[2]);
+	maxX = (std::min)(maxX, maxCell[0]);
+	maxY = (std::min)(maxY, maxCell[1]);
+	maxZ = (std::min)(maxZ, maxCell[2]);
+	if (minX > maxX || minY > maxY || minZ > maxZ)
+	{
+		return;
+	}
+
+	// A query bigger than the whole set is cheaper as a plain scan
+	double cellCount = (double)(maxX - minX + 1) * (maxY - minY + 1) * (maxZ - minZ + 1);
+	if (cellCount >= (double)count)
+	{
+		for (unsigned int slot = 0; slot < count; ++slot)
+		{
+			t_visit(slot);
+		}
+		return;
+	}
+
+	for (int z = minZ; z <= maxZ; ++z)
+	{
+		for (int y = minY; y <= maxY; ++y)
+		{
+			for (int x = minX; x <= maxX; ++x)
+			{
+				// Buckets can hold other cells too; skip their points
+				uint64_t key = GetCellKey(x, y, z);
+				unsigned int bucket = GetBucket(x, y, z);
+				for (unsigned int slot = bucketStarts[bucket]; slot < bucketStarts[bucket + 1]; ++slot)
+				{
+					if (sortedKeys[slot] == key)
+					{
+						t_visit(slot);
+					}
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <DirectXMath.h>
+#include <climits>
+#include <cstdint>
+#include <vector>
+
+// Uniform grid of cubic cells over points, for proximity queries that would
+// otherwise scan every entity.
+//
+// Cells are hashed into a table with twice as many buckets as points, so the
+// grid needs no bounds and empty space costs nothing. Build() radix-sorts the
+// points by bucket on the JobSystem, a byte of the bucket at a time, leaving
+// each bucket's points next to each other (in index order) in
+// structure-of-arrays form. It is cheap enough to redo every frame, so moving
+// points need no incremental updates.
+class SpatialHashGrid
+{
+public:
+	// Fills unused slots of QueryNearestBatch() results.
+	static const unsigned int NullIndex = UINT_MAX;
+
+	// Points handed to one job while building.
+	static const size_t ChunkSize = 4096;
+
+	// Bits of the bucket sorted by each pass of Build().
+	static const unsigned int RadixBits = 8;
+	static const unsigned int RadixSize = 1 << RadixBits;
+
+	// Queries handed to one job by the batch queries.
+	static const size_t QueryChunkSize = 64;
+
+	// Replace the contents with t_count points, cut into cells t_cell_size wide.
+	// Queries report a point by its index in t_positions.
+	void Build(const DirectX::XMFLOAT3* t_positions, size_t t_count, float t_cell_size);
+
+	// Append every point within t_radius of t_center, in no particular order.
+	void QueryRadius(const DirectX::XMFLOAT3& t_center, float t_radius, std::vector<unsigned int>& t_results) const;
+
+	// Append every point inside the box, in no particular order.
+	void QueryBox(const DirectX::XMFLOAT3& t_min, const DirectX::XMFLOAT3& t_max, std::vector<unsigned int>& t_results) const;
+
+	// Replace t_results with the (up to) t_k points nearest to t_center, nearest first.
+	void QueryNearest(const DirectX::XMFLOAT3& t_center, unsigned int t_k, std::vector<unsigned int>& t_results) const;
+
+	// Run QueryRadius for many centers in parallel. Results for query i are
+	// t_results[t_offsets[i]] up to t_results[t_offsets[i + 1]].
+	void QueryRadiusBatch(const DirectX::XMFLOAT3* t_centers, size_t t_count, float t_radius,
+		std::vector<unsigned int>& t_offsets, std::vector<unsigned int>& t_results) const;
+
+	// Run QueryNearest for many centers in parallel. Results for query i are
+	// t_results[i * t_k] up to t_results[(i + 1) * t_k], padded with NullIndex.
+	void QueryNearestBatch(const DirectX::XMFLOAT3* t_centers, size_t t_count, unsigned int t_k, std::vector<unsigned int>& t_results) const;
+
+	// Get number of points and cell size from the last Build().
+	size_t GetCount() const;
+	float GetCellSize() const;
+
+private:
+	// Integer coordinates of the cell holding a point.
+	void GetCell(float t_x, float t_y, float t_z, int& t_cell_x, int& t_cell_y, int& t_cell_z) const;
+
+	// Unique key for a cell, to tell apart cells that share a bucket.
+	static uint64_t GetCellKey(int t_cell_x, int t_cell_y, int t_cell_z);
+
+	// Bucket a cell hashes to.
+	unsigned int GetBucket(int t_cell_x, int t_cell_y, int t_cell_z) const;
+
+	// Visit the points of every cell overlapping [t_min, t_max] (or of all
+	// points, if that is fewer cells than buckets to look at), calling
+	// t_visit(sorted index) for each.
+	template<typename Visitor>
+	void ForEachPointInCells(const DirectX::XMFLOAT3& t_min, const DirectX::XMFLOAT3& t_max, Visitor& t_visit) const;
+
+	size_t count = 0;
+	float cellSize = 1.0f;
+	float inverseCellSize = 1.0f;
+	unsigned int bucketMask = 0;
+
+	// Range of cells holding any point, so nearest searches know when to give up
+	int minCell[3];
+	int maxCell[3];
+
+	// Points sorted by bucket
+	std::vector<float> sortedX, sortedY, sortedZ;
+	std::vector<unsigned int> sortedIndices;
+	std::vector<uint64_t> sortedKeys;
+
+	// Points of bucket b are [bucketStarts[b], bucketStarts[b + 1]) of the sorted arrays
+	std::vector<unsigned int> bucketStarts;
+
+	// Build() scratch: a point's bucket and index, as sorted
+	struct BucketEntry
+	{
+		unsigned int Bucket;
+		unsigned int Index;
+	};
+	std::vector<BucketEntry> entries;
+	std::vector<BucketEntry> entryScratch;
+	std::vector<uint64_t> pointKeys;
+	std::vector<unsigned int> chunkDigitStarts;		// RadixSize per chunk: counts, then where the chunk writes each digit
+};
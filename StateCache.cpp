@@ -0,0 +1,513 @@
+#include "StateCache.h"
+#include <d3d11_1.h>
+#include <cstring>
+
+namespace
+{
+	// Forwards to the matching calls of a device context, and its
+	// ID3D11DeviceContext1 calls for constant buffer ranges when it has them.
+	class ContextTarget : public StateCache::Target
+	{
+	public:
+		explicit ContextTarget(ID3D11DeviceContext* t_context) : context(t_context)
+		{
+			if (FAILED(context->QueryInterface(__uuidof(ID3D11DeviceContext1), reinterpret_cast<void**>(&context1))))
+			{
+				context1 = nullptr;
+			}
+		}
+
+		~ContextTarget()
+		{
+			if (context1)
+			{
+				context1->Release();
+			}
+		}
+
+		void SetShader(StateCache::Stage t_stage, ID3D11DeviceChild* t_shader)
+		{
+			switch (t_stage)
+			{
+			case StateCache::Vertex: context->VSSetShader(static_cast<ID3D11VertexShader*>(t_shader), 0, 0); break;
+			case StateCache::Hull: context->HSSetShader(static_cast<ID3D11HullShader*>(t_shader), 0, 0); break;
+			case StateCache::Domain: context->DSSetShader(static_cast<ID3D11DomainShader*>(t_shader), 0, 0); break;
+			case StateCache::Geometry: context->GSSetShader(static_cast<ID3D11GeometryShader*>(t_shader), 0, 0); break;
+			case StateCache::Pixel: context->PSSetShader(static_cast<ID3D11PixelShader*>(t_shader), 0, 0); break;
+			case StateCache::Compute: context->CSSetShader(static_cast<ID3D11ComputeShader*>(t_shader), 0, 0); break;
+			default: break;
+			}
+		}
+
+		void SetConstantBuffers(StateCache::Stage t_stage, UINT t_start, UINT t_count, ID3D11Buffer* const* t_buffers, const UINT* t_first_constants, const UINT* t_constant_counts)
+		{
+			if (t_first_constants && context1)
+			{
+				switch (t_stage)
+				{
+				case StateCache::Vertex: context1->VSSetConstantBuffers1(t_start, t_count, t_buffers, t_first_constants, t_constant_counts); break;
+				case StateCache::Hull: context1->HSSetConstantBuffers1(t_start, t_count, t_buffers, t_first_constants, t_constant_counts); break;
+				case StateCache::Domain: context1->DSSetConstantBuffers1(t_start, t_count, t_buffers, t_first_constants, t_constant_counts); break;
+				case StateCache::Geometry: context1->GSSetConstantBuffers1(t_start, t_count, t_buffers, t_first_constants, t_constant_counts); break;
+				case StateCache::Pixel: context1->PSSetConstantBuffers1(t_start, t_count, t_buffers, t_first_constants, t_constant_counts); break;
+				case StateCache::Compute: context1->CSSetConstantBuffers1(t_start, t_count, t_buffers, t_first_constants, t_constant_counts); break;
+				default: break;
+				}
+				return;
+			}
+
+			switch (t_stage)
+			{
+			case StateCache::Vertex: context->VSSetConstantBuffers(t_start, t_count, t_buffers); break;
+			case StateCache::Hull: context->HSSetConstantBuffers(t_start, t_count, t_buffers); break;
+			case StateCache::Domain: context->DSSetConstantBuffers(t_start, t_count, t_buffers); break;
+			case StateCache::Geometry: context->GSSetConstantBuffers(t_start, t_count, t_buffers); break;
+			case StateCache::Pixel: context->PSSetConstantBuffers(t_start, t_count, t_buffers); break;
+			case StateCache::Compute: context->CSSetConstantBuffers(t_start, t_count, t_buffers); break;
+			default: break;
+			}
+		}
+
+		void SetShaderResources(StateCache::Stage t_stage, UINT t_start, UINT t_count, ID3D11ShaderResourceView* const* t_views)
+		{
+			switch (t_stage)
+			{
+			case StateCache::Vertex: context->VSSetShaderResources(t_start, t_count, t_views); break;
+			case StateCache::Hull: context->HSSetShaderResources(t_start, t_count, t_views); break;
+			case StateCache::Domain: context->DSSetShaderResources(t_start, t_count, t_views); break;
+			case StateCache::Geometry: context->GSSetShaderResources(t_start, t_count, t_views); break;
+			case StateCache::Pixel: context->PSSetShaderResources(t_start, t_count, t_views); break;
+			case StateCache::Compute: context->CSSetShaderResources(t_start, t_count, t_views); break;
+			default: break;
+			}
+		}
+
+		void SetSamplers(StateCache::Stage t_stage, UINT t_start, UINT t_count, ID3D11SamplerState* const* t_samplers)
+		{
+			switch (t_stage)
+			{
+			case StateCache::Vertex: context->VSSetSamplers(t_start, t_count, t_samplers); break;
+			case StateCache::Hull: context->HSSetSamplers(t_start, t_count, t_samplers); break;
+			case StateCache::Domain: context->DSSetSamplers(t_start, t_count, t_samplers); break;
+			case StateCache::Geometry: context->GSSetSamplers(t_start, t_count, t_samplers); break;
+			case StateCache::Pixel: context->PSSetSamplers(t_start, t_count, t_samplers); break;
+			case StateCache::Compute: context->CSSetSamplers(t_start, t_count, t_samplers); break;
+			default: break;
+			}
+		}
+
+		void SetInputLayout(ID3D11InputLayout* t_layout)
+		{
+			context->IASetInputLayout(t_layout);
+		}
+
+		void SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY t_topology)
+		{
+			context->IASetPrimitiveTopology(t_topology);
+		}
+
+		void SetVertexBuffers(UINT t_start, UINT t_count, ID3D11Buffer* const* t_buffers, const UINT* t_strides, const UINT* t_offsets)
+		{
+			context->IASetVertexBuffers(t_start, t_count, t_buffers, t_strides, t_offsets);
+		}
+
+		void SetIndexBuffer(ID3D11Buffer* t_buffer, DXGI_FORMAT t_format, UINT t_offset)
+		{
+			context->IASetIndexBuffer(t_buffer, t_format, t_offset);
+		}
+
+		void DrawIndexed(UINT t_index_count, UINT t_start_index, INT t_base_vertex)
+		{
+			context->DrawIndexed(t_index_count, t_start_index, t_base_vertex);
+		}
+
+		void DrawIndexedInstanced(UINT t_index_count, UINT t_instance_count, UINT t_start_index, INT t_base_vertex, UINT t_start_instance)
+		{
+			context->DrawIndexedInstanced(t_index_count, t_instance_count, t_start_index, t_base_vertex, t_start_instance);
+		}
+
+	private:
+		ID3D11DeviceContext* context;
+		ID3D11DeviceContext1* context1;
+	};
+}
+
+StateCache::RecordingTarget::RecordingTarget()
+{
+	Reset();
+}
+
+void StateCache::RecordingTarget::SetShader(Stage t_stage, ID3D11DeviceChild* t_shader)
+{
+	bindings.Shaders[t_stage] = t_shader;
+	++callCount;
+	++slotCount;
+}
+
+void StateCache::RecordingTarget::SetConstantBuffers(Stage t_stage, UINT t_start, UINT t_count, ID3D11Buffer* const* t_buffers, const UINT* t_first_constants, const UINT* t_constant_counts)
+{
+	memcpy(&bindings.ConstantBuffers[t_stage][t_start], t_buffers, t_count * sizeof(ID3D11Buffer*));
+	for (UINT i = 0; i < t_count; ++i)
+	{
+		bindings.FirstConstants[t_stage][t_start + i] = t_first_constants ? t_first_constants[i] : 0;
+		bindings.ConstantCounts[t_stage][t_start + i] = t_constant_counts ? t_constant_counts[i] : 0;
+	}
+	++callCount;
+	slotCount += t_count;
+}
+
+void StateCache::RecordingTarget::SetShaderResources(Stage t_stage, UINT t_start, UINT t_count, ID3D11ShaderResourceView* const* t_views)
+{
+	memcpy(&bindings.ShaderResources[t_stage][t_start], t_views, t_count * sizeof(ID3D11ShaderResourceView*));
+	++callCount;
+	slotCount += t_count;
+}
+
+void StateCache::RecordingTarget::SetSamplers(Stage t_stage, UINT t_start, UINT t_count, ID3D11SamplerState* const* t_samplers)
+{
+	memcpy(&bindings.Samplers[t_stage][t_start], t_samplers, t_count * sizeof(ID3D11SamplerState*));
+	++callCount;
+	slotCount += t_count;
+}
+
+void StateCache::RecordingTarget::SetInputLayout(ID3D11InputLayout* t_layout)
+{
+	bindings.InputLayout = t_layout;
+	++callCount;
+	++slotCount;
+}
+
+void StateCache::RecordingTarget::SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY t_topology)
+{
+	bindings.Topology = t_topology;
+	++callCount;
+	++slotCount;
+}
+
+void StateCache::RecordingTarget::SetVertexBuffers(UINT t_start, UINT t_count, ID3D11Buffer* const* t_buffers, const UINT* t_strides, const UINT* t_offsets)
+{
+	memcpy(&bindings.VertexBuffers[t_start], t_buffers, t_count * sizeof(ID3D11Buffer*));
+	memcpy(&bindings.Strides[t_start], t_strides, t_count * sizeof(UINT));
+	memcpy(&bindings.Offsets[t_start], t_offsets, t_count * sizeof(UINT));
+	++callCount;
+	slotCount += t_count;
+}
+
+void StateCache::RecordingTarget::SetIndexBuffer(ID3D11Buffer* t_buffer, DXGI_FORMAT t_format, UINT t_offset)
+{
+	bindings.IndexBuffer = t_buffer;
+	bindings.IndexFormat = t_format;
+	bindings.IndexOffset = t_offset;
+	++callCount;
+	++slotCount;
+}
+
+void StateCache::RecordingTarget::DrawIndexed(UINT t_index_count, UINT t_start_index, INT t_base_vertex)
+{
+	++drawCount;
+	++instanceCount;
+}
+
+void StateCache::RecordingTarget::DrawIndexedInstanced(UINT t_index_count, UINT t_instance_count, UINT t_start_index, INT t_base_vertex, UINT t_start_instance)
+{
+	++drawCount;
+	instanceCount += t_instance_count;
+}
+
+const StateCache::Bindings& StateCache::RecordingTarget::GetBindings() const
+{
+	return bindings;
+}
+
+size_t StateCache::RecordingTarget::GetCallCount() const
+{
+	return callCount;
+}
+
+size_t StateCache::RecordingTarget::GetSlotCount() const
+{
+	return slotCount;
+}
+
+size_t StateCache::RecordingTarget::GetDrawCount() const
+{
+	return drawCount;
+}
+
+size_t StateCache::RecordingTarget::GetInstanceCount() const
+{
+	return instanceCount;
+}
+
+void StateCache::RecordingTarget::Reset()
+{
+	memset(&bindings, 0, sizeof(bindings));
+	bindings.Topology = D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED;
+	bindings.IndexFormat = DXGI_FORMAT_UNKNOWN;
+	callCount = 0;
+	slotCount = 0;
+	drawCount = 0;
+	instanceCount = 0;
+}
+
+StateCache::StateCache(ID3D11DeviceContext* t_context)
+{
+	ownedTarget = new ContextTarget(t_context);
+	target = ownedTarget;
+	Reset();
+}
+
+StateCache::StateCache(Target* t_target)
+{
+	target = t_target;
+	Reset();
+}
+
+StateCache::~StateCache()
+{
+	delete ownedTarget;
+}
+
+void StateCache::SetShader(Stage t_stage, ID3D11DeviceChild* t_shader)
+{
+	++stats.Requested;
+	if (shaders[t_stage] != t_shader)
+	{
+		shaders[t_stage] = t_shader;
+		target->SetShader(t_stage, t_shader);
+		++stats.Forwarded;
+	}
+}
+
+void StateCache::SetConstantBuffer(Stage t_stage, UINT t_slot, ID3D11Buffer* t_buffer)
+{
+	SetConstantBuffer(t_stage, t_slot, t_buffer, 0, 0);
+}
+
+void StateCache::SetConstantBuffer(Stage t_stage, UINT t_slot, ID3D11Buffer* t_buffer, UINT t_first_constant, UINT t_constant_count)
+{
+	ConstantBuffer constantBuffer = { t_buffer, t_first_constant, t_constant_count };
+	SetSlot(constantBuffers[t_stage], t_slot, constantBuffer);
+}
+
+void StateCache::SetShaderResource(Stage t_stage, UINT t_slot, ID3D11ShaderResourceView* t_view)
+{
+	SetSlot(shaderResources[t_stage], t_slot, t_view);
+}
+
+void StateCache::SetSampler(Stage t_stage, UINT t_slot, ID3D11SamplerState* t_sampler)
+{
+	SetSlot(samplers[t_stage], t_slot, t_sampler);
+}
+
+void StateCache::SetInputLayout(ID3D11InputLayout* t_layout)
+{
+	++stats.Requested;
+	if (inputLayout != t_layout)
+	{
+		inputLayout = t_layout;
+		target->SetInputLayout(t_layout);
+		++stats.Forwarded;
+	}
+}
+
+void StateCache::SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY t_topology)
+{
+	++stats.Requested;
+	if (topology != t_topology)
+	{
+		topology = t_topology;
+		target->SetPrimitiveTopology(t_topology);
+		++stats.Forwarded;
+	}
+}
+
+void StateCache::SetVertexBuffer(UINT t_slot, ID3D11Buffer* t_buffer, UINT t_stride, UINT t_offset)
+{
+	VertexBuffer vertexBuffer = { t_buffer, t_stride, t_offset };
+	SetSlot(vertexBuffers, t_slot, vertexBuffer);
+}
+
+void StateCache::SetIndexBuffer(ID3D11Buffer* t_buffer, DXGI_FORMAT t_format, UINT t_offset)
+{
+	++stats.Requested;
+	if (indexBuffer != t_buffer || indexFormat != t_format || indexOffset != t_offset)
+	{
+		indexBuffer = t_buffer;
+		indexFormat = t_format;
+		indexOffset = t_offset;
+		target->SetIndexBuffer(t_buffer, t_format, t_offset);
+		++stats.Forwarded;
+	}
+}
+
+void StateCache::Apply()
+{
+	UINT start;
+	UINT count;
+	for (int stage = 0; stage < StageCount; ++stage)
+	{
+		if (TakeChanges(constantBuffers[stage], start, count))
+		{
+			ApplyConstantBuffers((Stage)stage, start, count);
+		}
+		if (TakeChanges(shaderResources[stage], start, count))
+		{
+			target->SetShaderResources((Stage)stage, start, count, &shaderResources[stage].Bound[start]);
+			++stats.Forwarded;
+		}
+		if (TakeChanges(samplers[stage], start, count))
+		{
+			target->SetSamplers((Stage)stage, start, count, &samplers[stage].Bound[start]);
+			++stats.Forwarded;
+		}
+	}
+
+	if (TakeChanges(vertexBuffers, start, count))
+	{
+		// The context takes buffers, strides and offsets as separate arrays
+		ID3D11Buffer* buffers[VertexBufferSlots];
+		UINT strides[VertexBufferSlots];
+		UINT offsets[VertexBufferSlots];
+		for (UINT i = 0; i < count; ++i)
+		{
+			const VertexBuffer& vertexBuffer = vertexBuffers.Bound[start + i];
+			buffers[i] = vertexBuffer.Buffer;
+			strides[i] = vertexBuffer.Stride;
+			offsets[i] = vertexBuffer.Offset;
+		}
+		target->SetVertexBuffers(start, count, buffers, strides, offsets);
+		++stats.Forwarded;
+	}
+}
+
+void StateCache::ApplyConstantBuffers(Stage t_stage, UINT t_start, UINT t_count)
+{
+	ID3D11Buffer* buffers[ConstantBufferSlots];
+	UINT firstConstants[ConstantBufferSlots];
+	UINT constantCounts[ConstantBufferSlots];
+	for (UINT i = 0; i < t_count; ++i)
+	{
+		const ConstantBuffer& constantBuffer = constantBuffers[t_stage].Bound[t_start + i];
+		buffers[i] = constantBuffer.Buffer;
+		firstConstants[i] = constantBuffer.FirstConstant;
+		constantCounts[i] = constantBuffer.ConstantCount;
+	}
+
+	// A range call cannot bind a buffer whole, so slots bound whole and ones
+	// bound by range go out as separate calls, one per run of either
+	UINT begin = 0;
+	while (begin < t_count)
+	{
+		bool ranged = constantCounts[begin] != 0;
+		UINT end = begin + 1;
+		while (end < t_count && (constantCounts[end] != 0) == ranged)
+		{
+			++end;
+		}
+		target->SetConstantBuffers(t_stage, t_start + begin, end - begin, &buffers[begin],
+			ranged ? &firstConstants[begin] : nullptr, ranged ? &constantCounts[begin] : nullptr);
+		++stats.Forwarded;
+		begin = end;
+	}
+}
+
+void StateCache::DrawIndexed(UINT t_index_count, UINT t_start_index, INT t_base_vertex)
+{
+	Apply();
+	target->DrawIndexed(t_index_count, t_start_index, t_base_vertex);
+}
+
+void StateCache::DrawIndexedInstanced(UINT t_index_count, UINT t_instance_count, UINT t_start_index, INT t_base_vertex, UINT t_start_instance)
+{
+	Apply();
+	target->DrawIndexedInstanced(t_index_count, t_instance_count, t_start_index, t_base_vertex, t_start_instance);
+}
+
+void StateCache::Reset()
+{
+	// What a new context has bound is all zero, apart from the topology
+	memset(shaders, 0, sizeof(shaders));
+	memset(constantBuffers, 0, sizeof(constantBuffers));
+	memset(shaderResources, 0, sizeof(shaderResources));
+	memset(samplers, 0, sizeof(samplers));
+	memset(&vertexBuffers, 0, sizeof(vertexBuffers));
+	for (int stage = 0; stage < StageCount; ++stage)
+	{
+		constantBuffers[stage].Low = ConstantBufferSlots;
+		shaderResources[stage].Low = ShaderResourceSlots;
+		samplers[stage].Low = SamplerSlots;
+	}
+	vertexBuffers.Low = VertexBufferSlots;
+
+	inputLayout = nullptr;
+	topology = D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED;
+	indexBuffer = nullptr;
+	indexFormat = DXGI_FORMAT_UNKNOWN;
+	indexOffset = 0;
+}
+
+StateCache::Stats StateCache::GetStats() const
+{
+	return stats;
+}
+
+void StateCache::ResetStats()
+{
+	stats = {};
+}
+
+template <typename T, unsigned int N>
+bool StateCache::SetSlot(Slots<T, N>& t_slots, UINT t_slot, const T& t_value)
+{
+	++stats.Requested;
+	if (t_slot >= N)
+	{
+		return false;
+	}
+
+	// Only slots that might differ from what is bound widen the range Apply() looks through
+	if (!(t_slots.Pending[t_slot] == t_value))
+	{
+		t_slots.Pending[t_slot] = t_value;
+		t_slots.Low = t_slot < t_slots.Low ? t_slot : t_slots.Low;
+		t_slots.High = t_slot > t_slots.High ? t_slot : t_slots.High;
+	}
+	return true;
+}
+
+template <typename T, unsigned int N>
+bool StateCache::TakeChanges(Slots<T, N>& t_slots, UINT& t_start, UINT& t_count)
+{
+	if (t_slots.Low > t_slots.High)
+	{
+		return false;
+	}
+
+	// Slots set back to what is bound drop out at the ends; ones in between
+	// are sent again along with the rest, which is cheaper than another call
+	UINT first = t_slots.Low;
+	UINT last = t_slots.High;
+	while (first <= last && t_slots.Pending[first] == t_slots.Bound[first])
+	{
+		++first;
+	}
+	while (last > first && t_slots.Pending[last] == t_slots.Bound[last])
+	{
+		--last;
+	}
+	t_slots.Low = N;
+	t_slots.High = 0;
+	if (first > last)
+	{
+		return false;
+	}
+
+	for (UINT slot = first; slot <= last; ++slot)
+	{
+		t_slots.Bound[slot] = t_slots.Pending[slot];
+	}
+	t_start = first;
+	t_count = last - first + 1;
+	return true;
+}
@@ -0,0 +1,230 @@
+#pragma once
+#include <d3d11.h>
+#include <cstddef>
+
+// Sits in front of an ID3D11DeviceContext and keeps a copy of what is bound
+// to each stage: shaders, constant buffers, shader resources and samplers,
+// and the input assembler's layout, topology and buffers. Setting something
+// that is already bound is dropped instead of reaching the context.
+//
+// Slot bindings (constant buffers, resources, samplers, vertex buffers) are
+// held until Apply(), which sends every stage's changes to each kind of slot
+// as one ranged call covering the first to the last changed slot. Shaders,
+// the input layout, topology and index buffer go through as they are set.
+//
+// Constant buffers can be bound whole or as a range of constants, as
+// ID3D11DeviceContext1's *SetConstantBuffers1 take them. Ranges only reach
+// the shader on a D3D11.1 context; on an older one the whole buffer is bound.
+//
+// Everything set around the cache is invisible to it, so once the context is
+// used directly for any of this state (or ClearState() is called), Reset().
+// Draws made through the cache apply it first.
+class StateCache
+{
+public:
+	enum Stage
+	{
+		Vertex = 0,
+		Hull,
+		Domain,
+		Geometry,
+		Pixel,
+		Compute,
+		StageCount
+	};
+
+	static const unsigned int ConstantBufferSlots = D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT;
+	static const unsigned int ShaderResourceSlots = D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT;
+	static const unsigned int SamplerSlots = D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT;
+	static const unsigned int VertexBufferSlots = D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT;
+
+	// Where the calls the cache does not drop go. The shader is an
+	// ID3D11VertexShader, ID3D11PixelShader etc. depending on the stage.
+	// Constant buffer ranges are null when every buffer in the call is bound whole.
+	class Target
+	{
+	public:
+		virtual ~Target() {}
+		virtual void SetShader(Stage t_stage, ID3D11DeviceChild* t_shader) = 0;
+		virtual void SetConstantBuffers(Stage t_stage, UINT t_start, UINT t_count, ID3D11Buffer* const* t_buffers, const UINT* t_first_constants, const UINT* t_constant_counts) = 0;
+		virtual void SetShaderResources(Stage t_stage, UINT t_start, UINT t_count, ID3D11ShaderResourceView* const* t_views) = 0;
+		virtual void SetSamplers(Stage t_stage, UINT t_start, UINT t_count, ID3D11SamplerState* const* t_samplers) = 0;
+		virtual void SetInputLayout(ID3D11InputLayout* t_layout) = 0;
+		virtual void SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY t_topology) = 0;
+		virtual void SetVertexBuffers(UINT t_start, UINT t_count, ID3D11Buffer* const* t_buffers, const UINT* t_strides, const UINT* t_offsets) = 0;
+		virtual void SetIndexBuffer(ID3D11Buffer* t_buffer, DXGI_FORMAT t_format, UINT t_offset) = 0;
+		virtual void DrawIndexed(UINT t_index_count, UINT t_start_index, INT t_base_vertex) = 0;
+		virtual void DrawIndexedInstanced(UINT t_index_count, UINT t_instance_count, UINT t_start_index, INT t_base_vertex, UINT t_start_instance) = 0;
+	};
+
+	// Everything the cache tracks, as a Target would have it bound.
+	struct Bindings
+	{
+		ID3D11DeviceChild* Shaders[StageCount];
+		ID3D11Buffer* ConstantBuffers[StageCount][ConstantBufferSlots];
+		UINT FirstConstants[StageCount][ConstantBufferSlots];
+		UINT ConstantCounts[StageCount][ConstantBufferSlots];
+		ID3D11ShaderResourceView* ShaderResources[StageCount][ShaderResourceSlots];
+		ID3D11SamplerState* Samplers[StageCount][SamplerSlots];
+		ID3D11InputLayout* InputLayout;
+		D3D11_PRIMITIVE_TOPOLOGY Topology;
+		ID3D11Buffer* VertexBuffers[VertexBufferSlots];
+		UINT Strides[VertexBufferSlots];
+		UINT Offsets[VertexBufferSlots];
+		ID3D11Buffer* IndexBuffer;
+		DXGI_FORMAT IndexFormat;
+		UINT IndexOffset;
+	};
+
+	// A Target that only keeps what it is sent and counts the calls, for
+	// checking what the cache forwards without a device.
+	class RecordingTarget : public Target
+	{
+	public:
+		RecordingTarget();
+
+		void SetShader(Stage t_stage, ID3D11DeviceChild* t_shader);
+		void SetConstantBuffers(Stage t_stage, UINT t_start, UINT t_count, ID3D11Buffer* const* t_buffers, const UINT* t_first_constants, const UINT* t_constant_counts);
+		void SetShaderResources(Stage t_stage, UINT t_start, UINT t_count, ID3D11ShaderResourceView* const* t_views);
+		void SetSamplers(Stage t_stage, UINT t_start, UINT t_count, ID3D11SamplerState* const* t_samplers);
+		void SetInputLayout(ID3D11InputLayout* t_layout);
+		void SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY t_topology);
+		void SetVertexBuffers(UINT t_start, UINT t_count, ID3D11Buffer* const* t_buffers, const UINT* t_strides, const UINT* t_offsets);
+		void SetIndexBuffer(ID3D11Buffer* t_buffer, DXGI_FORMAT t_format, UINT t_offset);
+		void DrawIndexed(UINT t_index_count, UINT t_start_index, INT t_base_vertex);
+		void DrawIndexedInstanced(UINT t_index_count, UINT t_instance_count, UINT t_start_index, INT t_base_vertex, UINT t_start_instance);
+
+		// Get what is bound after the calls so far.
+		const Bindings& GetBindings() const;
+
+		// Get number of calls received, and of slots they covered (1 for the non-slot calls).
+		size_t GetCallCount() const;
+		size_t GetSlotCount() const;
+
+		// Get number of draws received, and of instances they drew (1 for each DrawIndexed).
+		size_t GetDrawCount() const;
+		size_t GetInstanceCount() const;
+
+		// Forget the calls and bindings.
+		void Reset();
+
+	private:
+		Bindings bindings;
+		size_t callCount;
+		size_t slotCount;
+		size_t drawCount;
+		size_t instanceCount;
+	};
+
+	// Calls made to the cache, and how many of them reached the target.
+	struct Stats
+	{
+		size_t Requested;
+		size_t Forwarded;
+	};
+
+	// Cache the state of a device context.
+	explicit StateCache(ID3D11DeviceContext* t_context);
+
+	// Cache the state of a Target, such as a RecordingTarget. The target is not owned.
+	explicit StateCache(Target* t_target);
+
+	~StateCache();
+
+	// Bind a shader to a stage.
+	void SetShader(Stage t_stage, ID3D11DeviceChild* t_shader);
+
+	// Bind to a slot of a stage. Sent by the next Apply().
+	void SetConstantBuffer(Stage t_stage, UINT t_slot, ID3D11Buffer* t_buffer);
+	void SetConstantBuffer(Stage t_stage, UINT t_slot, ID3D11Buffer* t_buffer, UINT t_first_constant, UINT t_constant_count);
+	void SetShaderResource(Stage t_stage, UINT t_slot, ID3D11ShaderResourceView* t_view);
+	void SetSampler(Stage t_stage, UINT t_slot, ID3D11SamplerState* t_sampler);
+
+	// Set input assembler state. Vertex buffers are sent by the next Apply().
+	void SetInputLayout(ID3D11InputLayout* t_layout);
+	void SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY t_topology);
+	void SetVertexBuffer(UINT t_slot, ID3D11Buffer* t_buffer, UINT t_stride, UINT t_offset);
+	void SetIndexBuffer(ID3D11Buffer* t_buffer, DXGI_FORMAT t_format, UINT t_offset);
+
+	// Send the slot bindings changed since the last Apply(). Draws through the
+	// cache do this themselves; call it before a dispatch or a draw made on the context.
+	void Apply();
+
+	// Apply() and draw.
+	void DrawIndexed(UINT t_index_count, UINT t_start_index, INT t_base_vertex);
+	void DrawIndexedInstanced(UINT t_index_count, UINT t_instance_count, UINT t_start_index, INT t_base_vertex, UINT t_start_instance);
+
+	// Go back to assuming nothing is bound, as on a new context or after ClearState().
+	// Slot bindings not yet applied are dropped.
+	void Reset();
+
+	// Get calls made since the last ResetStats().
+	Stats GetStats() const;
+	void ResetStats();
+
+private:
+	// Pending and bound values of one kind of slot on one stage, and the
+	// range of slots set since the last Apply() (empty when Low > High).
+	template <typename T, unsigned int N>
+	struct Slots
+	{
+		T Pending[N];
+		T Bound[N];
+		UINT Low;
+		UINT High;
+	};
+
+	// A constant buffer, bound whole when ConstantCount is 0
+	struct ConstantBuffer
+	{
+		ID3D11Buffer* Buffer;
+		UINT FirstConstant;
+		UINT ConstantCount;
+
+		bool operator==(const ConstantBuffer& t_other) const
+		{
+			return Buffer == t_other.Buffer && FirstConstant == t_other.FirstConstant && ConstantCount == t_other.ConstantCount;
+		}
+	};
+
+	struct VertexBuffer
+	{
+		ID3D11Buffer* Buffer;
+		UINT Stride;
+		UINT Offset;
+
+		bool operator==(const VertexBuffer& t_other) const
+		{
+			return Buffer == t_other.Buffer && Stride == t_other.Stride && Offset == t_other.Offset;
+		}
+	};
+
+	// Set a slot's pending value. False if it is out of range.
+	template <typename T, unsigned int N>
+	bool SetSlot(Slots<T, N>& t_slots, UINT t_slot, const T& t_value);
+
+	// Send a stage's constant buffers from t_start, as taken by TakeChanges().
+	void ApplyConstantBuffers(Stage t_stage, UINT t_start, UINT t_count);
+
+	// Take the range from the first to the last slot that changed, making it
+	// the bound values. False if nothing changed.
+	template <typename T, unsigned int N>
+	bool TakeChanges(Slots<T, N>& t_slots, UINT& t_start, UINT& t_count);
+
+	Target* target;
+	Target* ownedTarget = nullptr;
+
+	ID3D11DeviceChild* shaders[StageCount];
+	Slots<ConstantBuffer, ConstantBufferSlots> constantBuffers[StageCount];
+	Slots<ID3D11ShaderResourceView*, ShaderResourceSlots> shaderResources[StageCount];
+	Slots<ID3D11SamplerState*, SamplerSlots> samplers[StageCount];
+
+	ID3D11InputLayout* inputLayout;
+	D3D11_PRIMITIVE_TOPOLOGY topology;
+	Slots<VertexBuffer, VertexBufferSlots> vertexBuffers;
+	ID3D11Buffer* indexBuffer;
+	DXGI_FORMAT indexFormat;
+	UINT indexOffset;
+
+	Stats stats = {};
+};
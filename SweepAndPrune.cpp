@@ -0,0 +1,509 @@
+#include "SweepAndPrune.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cfloat>
+
+using namespace DirectX;
+
+namespace
+{
+	// Radix sort digit size for pair keys
+	const unsigned int DigitBits = 11;
+
+	// Bit i set for each lane i of t_mask that is all ones
+	inline unsigned int GetLaneMask(FXMVECTOR t_mask)
+	{
+#if defined(_XM_SSE_INTRINSICS_)
+		return (unsigned int)_mm_movemask_ps(t_mask);
+#else
+		XMUINT4 lanes;
+		XMStoreUInt4(&lanes, t_mask);
+		return (lanes.x ? 1u : 0u) | (lanes.y ? 2u : 0u) | (lanes.z ? 4u : 0u) | (lanes.w ? 8u : 0u);
+#endif
+	}
+
+	inline XMVECTOR LoadFour(const std::vector<float>& t_values, size_t t_index)
+	{
+		return XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&t_values[t_index]));
+	}
+
+	inline float GetAxis(const XMFLOAT3& t_vector, int t_axis)
+	{
+		return (&t_vector.x)[t_axis];
+	}
+}
+
+unsigned int SweepAndPrune::CreateProxy(const XMFLOAT3& t_min, const XMFLOAT3& t_max, unsigned int t_user_data)
+{
+	unsigned int proxy;
+	if (freeProxies.empty())
+	{
+		proxy = (unsigned int)proxies.size();
+		proxies.push_back(Proxy());
+	}
+	else
+	{
+		proxy = freeProxies.back();
+		freeProxies.pop_back();
+	}
+
+	proxies[proxy].Min = t_min;
+	proxies[proxy].Max = t_max;
+	proxies[proxy].UserData = t_user_data;
+	proxies[proxy].State = Added;
+	addedProxies.push_back(proxy);
+	++proxyCount;
+	return proxy;
+}
+
+void SweepAndPrune::DestroyProxy(unsigned int t_proxy)
+{
+	// Freed at the end of the next Update, once its pairs have been ended
+	proxies[t_proxy].State = Removed;
+	removedProxies.push_back(t_proxy);
+	--proxyCount;
+}
+
+void SweepAndPrune::MoveProxy(unsigned int t_proxy, const XMFLOAT3& t_min, const XMFLOAT3& t_max)
+{
+	proxies[t_proxy].Min = t_min;
+	proxies[t_proxy].Max = t_max;
+}
+
+unsigned int SweepAndPrune::GetUserData(unsigned int t_proxy) const
+{
+	return proxies[t_proxy].UserData;
+}
+
+void SweepAndPrune::Update()
+{
+	int newSweepAxis, newSlabAxis;
+	ChooseAxes(newSweepAxis, newSlabAxis);
+	bool axisChanged = newSweepAxis != sweepAxis;
+	sweepAxis = newSweepAxis;
+	slabAxis = newSlabAxis;
+	SortEndpoints(axisChanged);
+	FillSlabs();
+
+	newPairKeys.clear();
+	if (sweepJobs.size() <= 1)
+	{
+		for (const SweepJob& job : sweepJobs)
+		{
+			SweepRange(job.Begin, job.End, job.Slab, newPairKeys);
+		}
+	}
+	else
+	{
+		chunkKeys.resize(sweepJobs.size());
+		auto sweepJob = [this](size_t t_job)
+		{
+			const SweepJob& job = sweepJobs[t_job];
+			chunkKeys[t_job].clear();
+			SweepRange(job.Begin, job.End, job.Slab, chunkKeys[t_job]);
+		};
+		JobSystem::GetInstance().ParallelFor(sweepJobs.size(), 1, sweepJob);
+
+		for (size_t job = 0; job < sweepJobs.size(); ++job)
+		{
+			newPairKeys.insert(newPairKeys.end(), chunkKeys[job].begin(), chunkKeys[job].end());
+		}
+	}
+	SortKeys(newPairKeys);
+
+	// Both lists are sorted, so one pass over them finds what is only in one
+	beginPairs.clear();
+	endPairs.clear();
+	size_t oldIndex = 0;
+	size_t newIndex = 0;
+	while (oldIndex < pairKeys.size() || newIndex < newPairKeys.size())
+	{
+		if (newIndex == newPairKeys.size() || (oldIndex < pairKeys.size() && pairKeys[oldIndex] < newPairKeys[newIndex]))
+		{
+			endPairs.push_back(GetPair(pairKeys[oldIndex++]));
+		}
+		else if (oldIndex == pairKeys.size() || newPairKeys[newIndex] < pairKeys[oldIndex])
+		{
+			beginPairs.push_back(GetPair(newPairKeys[newIndex++]));
+		}
+		else
+		{
+			++oldIndex;
+			++newIndex;
+		}
+	}
+	pairKeys.swap(newPairKeys);
+
+	for (unsigned int proxy : removedProxies)
+	{
+		proxies[proxy].State = Free;
+		freeProxies.push_back(proxy);
+	}
+	removedProxies.clear();
+}
+
+const std::vector<SweepAndPrune::Pair>& SweepAndPrune::GetBeginPairs() const
+{
+	return beginPairs;
+}
+
+const std::vector<SweepAndPrune::Pair>& SweepAndPrune::GetEndPairs() const
+{
+	return endPairs;
+}
+
+size_t SweepAndPrune::GetPairCount() const
+{
+	return pairKeys.size();
+}
+
+bool SweepAndPrune::IsOverlapping(unsigned int t_proxy_a, unsigned int t_proxy_b) const
+{
+	return std::binary_search(pairKeys.begin(), pairKeys.end(), GetPairKey(t_proxy_a, t_proxy_b));
+}
+
+void SweepAndPrune::SetAxis(int t_axis)
+{
+	fixedAxis = t_axis;
+}
+
+void SweepAndPrune::SetMaxSlabCount(unsigned int t_count)
+{
+	maxSlabCount = (std::max)(t_count, 1u);
+}
+
+int SweepAndPrune::GetSweepAxis() const
+{
+	return sweepAxis;
+}
+
+unsigned int SweepAndPrune::GetSlabCount() const
+{
+	return slabCount;
+}
+
+size_t SweepAndPrune::GetProxyCount() const
+{
+	return proxyCount;
+}
+
+size_t SweepAndPrune::GetSortWork() const
+{
+	return sortWork;
+}
+
+void SweepAndPrune::ChooseAxes(int& t_sweep_axis, int& t_slab_axis) const
+{
+	// Variance of the box centers along each axis
+	double sum[3] = { 0.0, 0.0, 0.0 };
+	double sumSquares[3] = { 0.0, 0.0, 0.0 };
+	size_t count = 0;
+	for (const Proxy& proxy : proxies)
+	{
+		if (proxy.State == Added || proxy.State == Active)
+		{
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				double center = 0.5 * ((double)GetAxis(proxy.Min, axis) + GetAxis(proxy.Max, axis));
+				sum[axis] += center;
+				sumSquares[axis] += center * center;
+			}
+			++count;
+		}
+	}
+
+	double variance[3] = { 0.0, 0.0, 0.0 };
+	for (int axis = 0; axis < 3 && count > 0; ++axis)
+	{
+		double mean = sum[axis] / count;
+		variance[axis] = sumSquares[axis] / count - mean * mean;
+	}
+
+	// Switching the sweep axis means sorting from scratch, so only do it for a clear win
+	t_sweep_axis = sweepAxis;
+	if (fixedAxis >= 0)
+	{
+		t_sweep_axis = fixedAxis;
+	}
+	else
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			if (variance[axis] > 1.5 * variance[sweepAxis] && variance[axis] > variance[t_sweep_axis])
+			{
+				t_sweep_axis = axis;
+			}
+		}
+	}
+
+	// Slabs cost nothing to move to another axis
+	int first = (t_sweep_axis + 1) % 3;
+	int second = (t_sweep_axis + 2) % 3;
+	t_slab_axis = variance[first] >= variance[second] ? first : second;
+}
+
+void SweepAndPrune::SortEndpoints(bool t_axis_changed)
+{
+	auto endpointLess = [](const Endpoint& t_a, const Endpoint& t_b)
+	{
+		return t_a.Value < t_b.Value || (t_a.Value == t_b.Value && t_a.Proxy < t_b.Proxy);
+	};
+
+	if (!removedProxies.empty())
+	{
+		endpoints.erase(std::remove_if(endpoints.begin(), endpoints.end(),
+			[this](const Endpoint& t_endpoint) { return proxies[t_endpoint.Proxy].State == Removed; }),
+			endpoints.end());
+	}
+	for (Endpoint& endpoint : endpoints)
+	{
+		const Proxy& proxy = proxies[endpoint.Proxy];
+		endpoint.Value = GetAxis(proxy.Min, sweepAxis);
+		endpoint.Min = proxy.Min;
+		endpoint.Max = proxy.Max;
+	}
+	size_t existing = endpoints.size();
+
+	sortWork = 0;
+	if (t_axis_changed)
+	{
+		sortWork = existing;
+		std::sort(endpoints.begin(), endpoints.end(), endpointLess);
+	}
+	else
+	{
+		// Last frame's order is nearly right, so each box moves only a few
+		// places. If the boxes jumped around too much for that, give up and
+		// sort from scratch.
+		size_t budget = 8 * existing;
+		for (size_t i = 1; i < existing && sortWork <= budget; ++i)
+		{
+			Endpoint endpoint = endpoints[i];
+			size_t j = i;
+			for (; j > 0 && endpoints[j - 1].Value > endpoint.Value; --j)
+			{
+				endpoints[j] = endpoints[j - 1];
+			}
+			endpoints[j] = endpoint;
+			sortWork += i - j;
+		}
+		if (sortWork > budget)
+		{
+			sortWork = existing;
+			std::sort(endpoints.begin(), endpoints.end(), endpointLess);
+		}
+	}
+
+	// New boxes are sorted among themselves, then merged in
+	for (unsigned int proxy : addedProxies)
+	{
+		if (proxies[proxy].State == Added)
+		{
+			proxies[proxy].State = Active;
+			Endpoint endpoint = { GetAxis(proxies[proxy].Min, sweepAxis), proxy, proxies[proxy].Min, proxies[proxy].Max };
+			endpoints.push_back(endpoint);
+		}
+	}
+	addedProxies.clear();
+	if (endpoints.size() > existing)
+	{
+		sortWork += endpoints.size() - existing;
+		std::sort(endpoints.begin() + existing, endpoints.end(), endpointLess);
+		std::inplace_merge(endpoints.begin(), endpoints.begin() + existing, endpoints.end(), endpointLess);
+	}
+}
+
+void SweepAndPrune::FillSlabs()
+{
+	size_t count = endpoints.size();
+	int otherAxis = 3 - sweepAxis - slabAxis;
+
+	// Slabs wide enough that few boxes cross into the next one, but no more than maxSlabCount of them
+	float low = FLT_MAX;
+	float high = -FLT_MAX;
+	double sizeSum = 0.0;
+	for (const Endpoint& endpoint : endpoints)
+	{
+		low = (std::min)(low, GetAxis(endpoint.Min, slabAxis));
+		high = (std::max)(high, GetAxis(endpoint.Max, slabAxis));
+		sizeSum += GetAxis(endpoint.Max, slabAxis) - GetAxis(endpoint.Min, slabAxis);
+	}
+
+	slabCount = 1;
+	slabLow = 0.0f;
+	inverseSlabWidth = 0.0f;
+	if (count > 0 && high > low)
+	{
+		float width = (std::max)((float)(sizeSum / count) * SlabBoxWidths, (high - low) / maxSlabCount);
+		slabCount = (std::min)((unsigned int)((high - low) / width) + 1, maxSlabCount);
+		slabLow = low;
+		inverseSlabWidth = 1.0f / width;
+	}
+
+	// Count the boxes of each slab, then lay the slabs out one after the other with their padding
+	slabCursors.assign(slabCount, 0);
+	for (const Endpoint& endpoint : endpoints)
+	{
+		unsigned int lastSlab = GetSlab(GetAxis(endpoint.Max, slabAxis));
+		for (unsigned int slab = GetSlab(GetAxis(endpoint.Min, slabAxis)); slab <= lastSlab; ++slab)
+		{
+			++slabCursors[slab];
+		}
+	}
+
+	slabStarts.resize(slabCount + 1);
+	slabStarts[0] = 0;
+	for (unsigned int slab = 0; slab < slabCount; ++slab)
+	{
+		slabStarts[slab + 1] = slabStarts[slab] + slabCursors[slab] + 4;
+		slabCursors[slab] = slabStarts[slab];
+	}
+
+	size_t total = slabStarts[slabCount];
+	sweepMin.resize(total);
+	sweepMax.resize(total);
+	slabMin.resize(total);
+	slabMax.resize(total);
+	otherMin.resize(total);
+	otherMax.resize(total);
+	sortedProxies.resize(total);
+
+	// Going through the boxes in order keeps each slab in order
+	for (const Endpoint& endpoint : endpoints)
+	{
+		unsigned int lastSlab = GetSlab(GetAxis(endpoint.Max, slabAxis));
+		for (unsigned int slab = GetSlab(GetAxis(endpoint.Min, slabAxis)); slab <= lastSlab; ++slab)
+		{
+			size_t i = slabCursors[slab]++;
+			sweepMin[i] = endpoint.Value;
+			sweepMax[i] = GetAxis(endpoint.Max, sweepAxis);
+			slabMin[i] = GetAxis(endpoint.Min, slabAxis);
+			slabMax[i] = GetAxis(endpoint.Max, slabAxis);
+			otherMin[i] = GetAxis(endpoint.Min, otherAxis);
+			otherMax[i] = GetAxis(endpoint.Max, otherAxis);
+			sortedProxies[i] = endpoint.Proxy;
+		}
+	}
+
+	// The padding starts past every box, so sweeps stop on it without a bounds check.
+	// Slabs too big for one job are cut up; their sweeps still run on to the padding.
+	sweepJobs.clear();
+	for (unsigned int slab = 0; slab < slabCount; ++slab)
+	{
+		for (size_t i = slabCursors[slab]; i < slabStarts[slab + 1]; ++i)
+		{
+			sweepMin[i] = slabMin[i] = otherMin[i] = FLT_MAX;
+			sweepMax[i] = slabMax[i] = otherMax[i] = -FLT_MAX;
+			sortedProxies[i] = NullProxy;
+		}
+
+		for (size_t begin = slabStarts[slab]; begin < slabCursors[slab]; begin += ChunkSize)
+		{
+			SweepJob job = { begin, (std::min)(begin + ChunkSize, slabCursors[slab]), slab };
+			sweepJobs.push_back(job);
+		}
+	}
+}
+
+unsigned int SweepAndPrune::GetSlab(float t_value) const
+{
+	float slab = (t_value - slabLow) * inverseSlabWidth;
+	if (!(slab > 0.0f))
+	{
+		return 0;
+	}
+	return slab >= (float)slabCount ? slabCount - 1 : (unsigned int)slab;
+}
+
+void SweepAndPrune::SweepRange(size_t t_begin, size_t t_end, unsigned int t_slab, std::vector<uint64_t>& t_keys) const
+{
+	for (size_t i = t_begin; i < t_end; ++i)
+	{
+		XMVECTOR reach = XMVectorReplicate(sweepMax[i]);
+		XMVECTOR boxSlabMin = XMVectorReplicate(slabMin[i]);
+		XMVECTOR boxSlabMax = XMVectorReplicate(slabMax[i]);
+		XMVECTOR boxOtherMin = XMVectorReplicate(otherMin[i]);
+		XMVECTOR boxOtherMax = XMVectorReplicate(otherMax[i]);
+
+		// Boxes after this one are sorted by minimum, so the ones in reach come
+		// first, four at a time, until one is not
+		for (size_t j = i + 1; ; j += 4)
+		{
+			unsigned int inReach = GetLaneMask(XMVectorLessOrEqual(LoadFour(sweepMin, j), reach));
+			if (inReach == 0)
+			{
+				break;
+			}
+
+			XMVECTOR overlap = XMVectorAndInt(
+				XMVectorLessOrEqual(LoadFour(slabMin, j), boxSlabMax),
+				XMVectorGreaterOrEqual(LoadFour(slabMax, j), boxSlabMin));
+			overlap = XMVectorAndInt(overlap, XMVectorLessOrEqual(LoadFour(otherMin, j), boxOtherMax));
+			overlap = XMVectorAndInt(overlap, XMVectorGreaterOrEqual(LoadFour(otherMax, j), boxOtherMin));
+
+			unsigned int overlapping = inReach & GetLaneMask(overlap);
+			for (unsigned int lane = 0; overlapping != 0; ++lane, overlapping >>= 1)
+			{
+				// Boxes that both cross into another slab meet there too
+				if ((overlapping & 1) && GetSlab((std::max)(slabMin[i], slabMin[j + lane])) == t_slab)
+				{
+					t_keys.push_back(GetPairKey(sortedProxies[i], sortedProxies[j + lane]));
+				}
+			}
+
+			if (inReach != 0xF)
+			{
+				break;
+			}
+		}
+	}
+}
+
+void SweepAndPrune::SortKeys(std::vector<uint64_t>& t_keys)
+{
+	// Only the low idBits of each half of a key can be set
+	unsigned int idBits = 1;
+	while (idBits < 32 && ((size_t)1 << idBits) < proxies.size())
+	{
+		++idBits;
+	}
+
+	keyScratch.resize(t_keys.size());
+	std::vector<unsigned int> digitStarts;
+	for (unsigned int half = 0; half < 2; ++half)
+	{
+		for (unsigned int bit = 0; bit < idBits; bit += DigitBits)
+		{
+			unsigned int shift = half * 32 + bit;
+			uint64_t digitMask = ((uint64_t)1 << (std::min)(DigitBits, idBits - bit)) - 1;
+
+			digitStarts.assign((size_t)digitMask + 2, 0);
+			for (uint64_t key : t_keys)
+			{
+				++digitStarts[(size_t)((key >> shift) & digitMask) + 1];
+			}
+			for (size_t digit = 1; digit < digitStarts.size(); ++digit)
+			{
+				digitStarts[digit] += digitStarts[digit - 1];
+			}
+			for (uint64_t key : t_keys)
+			{
+				keyScratch[digitStarts[(size_t)((key >> shift) & digitMask)]++] = key;
+			}
+			t_keys.swap(keyScratch);
+		}
+	}
+}
+
+uint64_t SweepAndPrune::GetPairKey(unsigned int t_proxy_a, unsigned int t_proxy_b)
+{
+	return t_proxy_a < t_proxy_b ?
+		((uint64_t)t_proxy_a << 32) | t_proxy_b :
+		((uint64_t)t_proxy_b << 32) | t_proxy_a;
+}
+
+SweepAndPrune::Pair SweepAndPrune::GetPair(uint64_t t_key)
+{
+	Pair pair = { (unsigned int)(t_key >> 32), (unsigned int)t_key };
+	return pair;
+}
@@ -0,0 +1,182 @@
+#pragma once
+#include <DirectXMath.h>
+#include <climits>
+#include <cstdint>
+#include <vector>
+
+// Broadphase that finds every pair of overlapping world boxes, and which
+// pairs started or stopped overlapping since the last Update().
+//
+// Boxes are kept sorted by their minimum along one sweep axis, so a box can
+// only overlap those after it up to where their minimums pass its maximum.
+// Objects barely move between frames, so the order from the last frame is
+// nearly right and an insertion sort fixes it in about linear time.
+//
+// Sweeping one axis alone still leaves every box within reach of all boxes
+// level with it, which adds up in large scenes. So the boxes are also split
+// into slabs along a second axis, keeping their order, and each slab is
+// swept on its own as a JobSystem job, testing the remaining axes for four
+// boxes per SIMD step. A box crossing slabs goes in each of them; a pair is
+// only reported by the slab where the overlap starts.
+//
+// The sweep and slab axes are the ones the boxes are most spread out along,
+// picked again every Update(), so scenes stacked along one axis do not end
+// up with every box in reach of every other.
+class SweepAndPrune
+{
+public:
+	static const unsigned int NullProxy = UINT_MAX;
+
+	// Most sorted boxes swept by one job.
+	static const size_t ChunkSize = 2048;
+
+	// Slabs are at least this many average boxes wide.
+	static const unsigned int SlabBoxWidths = 8;
+
+	// Two overlapping objects, ProxyA < ProxyB.
+	struct Pair
+	{
+		unsigned int ProxyA;
+		unsigned int ProxyB;
+	};
+
+	// Add an object and get the proxy to refer to it by. It takes part from the next Update().
+	unsigned int CreateProxy(const DirectX::XMFLOAT3& t_min, const DirectX::XMFLOAT3& t_max, unsigned int t_user_data);
+
+	// Remove an object. Its pairs are reported as ended by the next Update(),
+	// and the proxy is not handed out again before then.
+	void DestroyProxy(unsigned int t_proxy);
+
+	// Give an object new bounds.
+	void MoveProxy(unsigned int t_proxy, const DirectX::XMFLOAT3& t_min, const DirectX::XMFLOAT3& t_max);
+
+	// Get what was passed to CreateProxy for an object.
+	unsigned int GetUserData(unsigned int t_proxy) const;
+
+	// Find the overlapping pairs for the current bounds.
+	void Update();
+
+	// Get pairs that overlap now but did not at the previous Update(), and the other way around.
+	const std::vector<Pair>& GetBeginPairs() const;
+	const std::vector<Pair>& GetEndPairs() const;
+
+	// Get number of pairs overlapping at the last Update().
+	size_t GetPairCount() const;
+
+	// Did these two objects overlap at the last Update()?
+	bool IsOverlapping(unsigned int t_proxy_a, unsigned int t_proxy_b) const;
+
+	// Sweep along this axis (0 to 2) every time, or pick one each Update() with -1 (the default).
+	void SetAxis(int t_axis);
+
+	// Set most slabs to split boxes into (256 by default). 1 sweeps every box in one list.
+	void SetMaxSlabCount(unsigned int t_count);
+
+	// Get axis the last Update() swept along, and how many slabs it used.
+	int GetSweepAxis() const;
+	unsigned int GetSlabCount() const;
+
+	// Get number of objects.
+	size_t GetProxyCount() const;
+
+	// Get how many places boxes moved in the sorted order at the last Update(),
+	// or the number of boxes if it had to sort from scratch.
+	size_t GetSortWork() const;
+
+private:
+	enum ProxyState
+	{
+		Free,		// On the free list
+		Added,		// Created since the last Update()
+		Active,		// In the sorted order
+		Removed		// Destroyed since the last Update()
+	};
+
+	struct Proxy
+	{
+		DirectX::XMFLOAT3 Min;
+		unsigned int UserData;
+		DirectX::XMFLOAT3 Max;
+		ProxyState State;
+	};
+
+	// A box's place in the sorted order: its minimum on the sweep axis and which box it is.
+	// The box is copied along, so what follows the sort reads boxes in order.
+	struct Endpoint
+	{
+		float Value;
+		unsigned int Proxy;
+		DirectX::XMFLOAT3 Min;
+		DirectX::XMFLOAT3 Max;
+	};
+
+	// Part of a slab swept by one job.
+	struct SweepJob
+	{
+		size_t Begin;
+		size_t End;
+		unsigned int Slab;
+	};
+
+	// Pick the sweep axis, where box centers are most spread out (sticking with
+	// the current one unless another is clearly better), and the slab axis,
+	// the most spread out of the other two.
+	void ChooseAxes(int& t_sweep_axis, int& t_slab_axis) const;
+
+	// Bring the sorted order up to date with added, removed and moved boxes.
+	void SortEndpoints(bool t_axis_changed);
+
+	// Copy the sorted boxes into their slabs and cut the slabs into jobs.
+	void FillSlabs();
+
+	// Slab a position along the slab axis falls in.
+	unsigned int GetSlab(float t_value) const;
+
+	// Sweep boxes [t_begin, t_end) of slab t_slab and append their pairs as keys.
+	void SweepRange(size_t t_begin, size_t t_end, unsigned int t_slab, std::vector<uint64_t>& t_keys) const;
+
+	// Sort pair keys with an LSD radix sort over only the bits proxies use.
+	void SortKeys(std::vector<uint64_t>& t_keys);
+
+	static uint64_t GetPairKey(unsigned int t_proxy_a, unsigned int t_proxy_b);
+	static Pair GetPair(uint64_t t_key);
+
+	std::vector<Proxy> proxies;
+	std::vector<unsigned int> freeProxies;
+	std::vector<unsigned int> addedProxies;
+	std::vector<unsigned int> removedProxies;
+	size_t proxyCount = 0;
+
+	int fixedAxis = -1;
+	int sweepAxis = 0;
+	int slabAxis = 1;
+	size_t sortWork = 0;
+
+	// Active boxes in sweep order
+	std::vector<Endpoint> endpoints;
+
+	unsigned int maxSlabCount = 256;
+	unsigned int slabCount = 1;
+	float slabLow = 0.0f;
+	float inverseSlabWidth = 0.0f;
+
+	// Boxes by slab as structure of arrays, in sweep order within each slab and followed
+	// by four boxes that touch nothing. "slab" is the slab axis, "other" the third axis.
+	// Slab s starts at slabStarts[s].
+	std::vector<float> sweepMin, sweepMax;
+	std::vector<float> slabMin, slabMax;
+	std::vector<float> otherMin, otherMax;
+	std::vector<unsigned int> sortedProxies;
+	std::vector<size_t> slabStarts;
+	std::vector<size_t> slabCursors;
+	std::vector<SweepJob> sweepJobs;
+
+	// Overlapping pairs as sorted keys (ProxyA in the high bits), from this Update() and the last
+	std::vector<uint64_t> pairKeys;
+	std::vector<uint64_t> newPairKeys;
+	std::vector<uint64_t> keyScratch;
+	std::vector<std::vector<uint64_t>> chunkKeys;
+
+	std::vector<Pair> beginPairs;
+	std::vector<Pair> endPairs;
+};
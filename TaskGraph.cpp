@@ -0,0 +1,203 @@
+#include "TaskGraph.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+namespace
+{
+	// Weight of the newest sample in the running averages
+	const float AverageWeight = 0.05f;
+
+	float MillisecondsBetween(std::chrono::high_resolution_clock::time_point t_start, std::chrono::high_resolution_clock::time_point t_end)
+	{
+		return std::chrono::duration<float, std::milli>(t_end - t_start).count();
+	}
+}
+
+TaskGraph::~TaskGraph()
+{
+	for (Task* task : tasks)
+	{
+		delete task;
+	}
+}
+
+size_t TaskGraph::AddTask(const std::string& t_name, TaskFunction t_function, std::initializer_list<const char*> t_reads, std::initializer_list<const char*> t_writes)
+{
+	size_t index = tasks.size();
+	Task* task = new Task();
+	task->Name = t_name;
+	task->Function = t_function;
+	task->Remaining = 0;
+	tasks.push_back(task);
+
+	for (const char* name : t_reads)
+	{
+		task->Reads.push_back(GetResource(name));
+	}
+	for (const char* name : t_writes)
+	{
+		task->Writes.push_back(GetResource(name));
+	}
+
+	// Readers wait for the last writer
+	for (size_t resource : task->Reads)
+	{
+		ResourceState& state = resources[resource];
+		if (state.LastWriter != SIZE_MAX)
+		{
+			AddDependency(index, state.LastWriter);
+		}
+	}
+
+	// Writers wait for the last writer and for everyone who read since
+	for (size_t resource : task->Writes)
+	{
+		ResourceState& state = resources[resource];
+		if (state.LastWriter != SIZE_MAX)
+		{
+			AddDependency(index, state.LastWriter);
+		}
+		for (size_t reader : state.ReadersSinceWrite)
+		{
+			AddDependency(index, reader);
+		}
+	}
+
+	// Only now update the resource states, so a system that reads and writes
+	// the same resource does not end up waiting for itself
+	for (size_t resource : task->Reads)
+	{
+		resources[resource].ReadersSinceWrite.push_back(index);
+	}
+	for (size_t resource : task->Writes)
+	{
+		resources[resource].LastWriter = index;
+		resources[resource].ReadersSinceWrite.clear();
+	}
+
+	return index;
+}
+
+void TaskGraph::Execute(JobSystem& t_job_system, float t_delta_time, float t_total_time)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	jobSystem = &t_job_system;
+	deltaTime = t_delta_time;
+	totalTime = t_total_time;
+
+	// Arm every counter before anything starts, since finished systems release the next ones
+	for (Task* task : tasks)
+	{
+		task->Remaining = task->Dependencies.size();
+	}
+
+	JobCounter frameCounter;
+	for (size_t i = 0; i < tasks.size(); ++i)
+	{
+		if (tasks[i]->Dependencies.empty())
+		{
+			t_job_system.Run(&TaskGraph::RunTask, this, i, i + 1, &frameCounter);
+		}
+	}
+	t_job_system.Wait(&frameCounter);
+
+	jobSystem = nullptr;
+	frameMilliseconds = MillisecondsBetween(start, std::chrono::high_resolution_clock::now());
+}
+
+size_t TaskGraph::GetTaskCount() const
+{
+	return tasks.size();
+}
+
+const std::string& TaskGraph::GetTaskName(size_t t_task) const
+{
+	return tasks[t_task]->Name;
+}
+
+const std::string& TaskGraph::GetResourceName(size_t t_resource) const
+{
+	return resources[t_resource].Name;
+}
+
+const std::vector<size_t>& TaskGraph::GetDependencies(size_t t_task) const
+{
+	return tasks[t_task]->Dependencies;
+}
+
+float TaskGraph::GetTaskMilliseconds(size_t t_task) const
+{
+	return tasks[t_task]->Milliseconds;
+}
+
+float TaskGraph::GetTaskAverageMilliseconds(size_t t_task) const
+{
+	return tasks[t_task]->AverageMilliseconds;
+}
+
+float TaskGraph::GetFrameMilliseconds() const
+{
+	return frameMilliseconds;
+}
+
+void TaskGraph::PrintTimings() const
+{
+	printf("\nTaskGraph: %zu systems, %.3fms last frame", tasks.size(), frameMilliseconds);
+	for (const Task* task : tasks)
+	{
+		printf("\n  %-16s %.3fms (avg %.3fms)", task->Name.c_str(), task->Milliseconds, task->AverageMilliseconds);
+	}
+}
+
+size_t TaskGraph::GetResource(const char* t_name)
+{
+	for (size_t i = 0; i < resources.size(); ++i)
+	{
+		if (resources[i].Name == t_name)
+		{
+			return i;
+		}
+	}
+
+	ResourceState state;
+	state.Name = t_name;
+	state.LastWriter = SIZE_MAX;
+	resources.push_back(state);
+	return resources.size() - 1;
+}
+
+void TaskGraph::AddDependency(size_t t_task, size_t t_dependency)
+{
+	std::vector<size_t>& dependencies = tasks[t_task]->Dependencies;
+	if (t_dependency == t_task || std::find(dependencies.begin(), dependencies.end(), t_dependency) != dependencies.end())
+	{
+		return;
+	}
+
+	dependencies.push_back(t_dependency);
+	tasks[t_dependency]->Dependents.push_back(t_task);
+}
+
+void TaskGraph::RunTask(const Job& t_job)
+{
+	TaskGraph* graph = static_cast<TaskGraph*>(t_job.Data);
+	Task* task = graph->tasks[t_job.Begin];
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	task->Function(graph->deltaTime, graph->totalTime);
+	task->Milliseconds = MillisecondsBetween(start, std::chrono::high_resolution_clock::now());
+	task->AverageMilliseconds += (task->Milliseconds - task->AverageMilliseconds) * AverageWeight;
+
+	// The frame counter cannot reach zero here: this job is still counted in it
+	for (size_t dependent : task->Dependents)
+	{
+		if (--graph->tasks[dependent]->Remaining == 0)
+		{
+			graph->jobSystem->Run(&TaskGraph::RunTask, graph, dependent, dependent + 1, t_job.Counter);
+		}
+	}
+}
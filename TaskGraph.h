@@ -0,0 +1,101 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+// Forward Declarations
+struct Job;
+class JobSystem;
+
+// Per-frame work split into named systems, run in parallel on the JobSystem.
+//
+// Every system declares the resources (plain names such as "transforms" or
+// "camera") it reads and writes. Registration order counts as program order:
+// a system runs after every earlier system it shares a resource with, unless
+// both only read it. The edges are worked out once, as systems are added, so
+// Execute() only has to walk a fixed DAG. Two systems writing the same
+// resource simply run in the order they were added in.
+class TaskGraph
+{
+public:
+	typedef std::function<void(float t_delta_time, float t_total_time)> TaskFunction;
+
+	TaskGraph() = default;
+
+	// Destructor for TaskGraph
+	~TaskGraph();
+
+	TaskGraph(const TaskGraph&) = delete;
+	TaskGraph& operator=(const TaskGraph&) = delete;
+
+	// Add a system that runs after every earlier system it conflicts with.
+	// Returns the index of the new system. Must not be called during Execute().
+	size_t AddTask(const std::string& t_name, TaskFunction t_function, std::initializer_list<const char*> t_reads, std::initializer_list<const char*> t_writes);
+
+	// Run every system once, spread over t_job_system, and wait for all of them.
+	void Execute(JobSystem& t_job_system, float t_delta_time, float t_total_time);
+
+	// Get number of systems.
+	size_t GetTaskCount() const;
+
+	// Get the name of a system or resource.
+	const std::string& GetTaskName(size_t t_task) const;
+	const std::string& GetResourceName(size_t t_resource) const;
+
+	// Get the systems t_task has to wait for.
+	const std::vector<size_t>& GetDependencies(size_t t_task) const;
+
+	// Get how long a system took in the last Execute(), and a running average.
+	float GetTaskMilliseconds(size_t t_task) const;
+	float GetTaskAverageMilliseconds(size_t t_task) const;
+
+	// Get wall time of the last Execute().
+	float GetFrameMilliseconds() const;
+
+	// Print per-system timings to the console.
+	void PrintTimings() const;
+
+private:
+	struct Task
+	{
+		std::string Name;
+		TaskFunction Function;
+		std::vector<size_t> Reads;
+		std::vector<size_t> Writes;
+		std::vector<size_t> Dependencies;
+		std::vector<size_t> Dependents;
+		std::atomic<size_t> Remaining;		// Dependencies not yet finished this frame
+		float Milliseconds = 0.0f;
+		float AverageMilliseconds = 0.0f;
+	};
+
+	// Who touched a resource last, so new systems know what to wait for.
+	struct ResourceState
+	{
+		std::string Name;
+		size_t LastWriter;					// SIZE_MAX if never written
+		std::vector<size_t> ReadersSinceWrite;
+	};
+
+	// Find or add a resource by name.
+	size_t GetResource(const char* t_name);
+
+	// Make t_task wait for t_dependency (duplicates are ignored).
+	void AddDependency(size_t t_task, size_t t_dependency);
+
+	// Job entry point: run one system and release the systems waiting on it.
+	static void RunTask(const Job& t_job);
+
+	// Tasks are never moved once added, since Task holds an atomic
+	std::vector<Task*> tasks;
+	std::vector<ResourceState> resources;
+
+	// Set for the duration of Execute()
+	JobSystem* jobSystem = nullptr;
+	float deltaTime = 0.0f;
+	float totalTime = 0.0f;
+	float frameMilliseconds = 0.0f;
+};
@@ -0,0 +1,120 @@
+#include "Tests.h"
+#include "InstanceBatcher.h"
+#include "RenderSnapshot.h"
+#include "StateCache.h"
+#include <cstdint>
+
+namespace
+{
+	// Stand-ins for meshes and materials; the batcher only compares the pointers
+	const Mesh* const MeshA = reinterpret_cast<const Mesh*>(uintptr_t(16));
+	const Mesh* const MeshB = reinterpret_cast<const Mesh*>(uintptr_t(32));
+	const Material* const MaterialA = reinterpret_cast<const Material*>(uintptr_t(48));
+	const Material* const MaterialB = reinterpret_cast<const Material*>(uintptr_t(64));
+
+	void AddItem(RenderSnapshot& t_frame, const Mesh* t_mesh, const Material* t_material, RenderQueue::Pass t_pass, float t_depth)
+	{
+		RenderItem item = {};
+		item.Source = &t_frame.Items + t_frame.Items.size();
+		item.MeshData = t_mesh;
+		item.MaterialData = t_material;
+
+		unsigned int meshId = t_mesh == MeshA ? 1 : 2;
+		unsigned int materialId = t_material == MaterialA ? 1 : 2;
+		t_frame.Queue.Add(RenderQueue::MakeKey(t_pass, 0, materialId, meshId, t_depth), (unsigned int)t_frame.Items.size());
+		t_frame.Items.push_back(item);
+	}
+
+	// Draw every batch through a StateCache, one instanced draw each, as Game::Draw does
+	void DrawBatches(const InstanceBatcher& t_batcher, StateCache::RecordingTarget& t_target)
+	{
+		StateCache cache(&t_target);
+		for (const InstanceBatcher::Batch& batch : t_batcher.GetBatches())
+		{
+			cache.DrawIndexedInstanced(36, (UINT)(batch.End - batch.Begin), 0, 0, batch.FirstInstance);
+		}
+	}
+
+	void TestOpaqueBatches()
+	{
+		RenderSnapshot frame;
+		AddItem(frame, MeshA, MaterialA, RenderQueue::Opaque, 0.1f);
+		AddItem(frame, MeshB, MaterialA, RenderQueue::Opaque, 0.2f);
+		AddItem(frame, MeshA, MaterialA, RenderQueue::Opaque, 0.3f);
+		AddItem(frame, MeshA, MaterialB, RenderQueue::Opaque, 0.4f);
+		AddItem(frame, MeshB, MaterialA, RenderQueue::Opaque, 0.5f);
+		frame.Queue.Sort();
+
+		std::vector<unsigned int> slots = { 10, 11, 12, 13, 14 };
+		InstanceBatcher batcher;
+		batcher.Build(frame, slots);
+
+		// Grouped by material, then mesh, then front to back
+		const std::vector<InstanceBatcher::Batch>& batches = batcher.GetBatches();
+		CHECK(batches.size() == 3);
+		if (batches.size() == 3)
+		{
+			CHECK(batches[0].Begin == 0 && batches[0].End == 2 && batches[0].FirstInstance == 0);
+			CHECK(batches[1].Begin == 2 && batches[1].End == 4 && batches[1].FirstInstance == 2);
+			CHECK(batches[2].Begin == 4 && batches[2].End == 5 && batches[2].FirstInstance == 4);
+		}
+
+		const std::vector<InstanceData>& instances = batcher.GetInstances();
+		unsigned int expected[] = { 10, 12, 11, 14, 13 };
+		CHECK(instances.size() == 5);
+		for (size_t i = 0; i < instances.size() && i < 5; ++i)
+		{
+			CHECK(instances[i].ObjectIndex == expected[i]);
+		}
+
+		// Five items go out as three draws
+		StateCache::RecordingTarget target;
+		DrawBatches(batcher, target);
+		CHECK(target.GetDrawCount() == 3);
+		CHECK(target.GetInstanceCount() == 5);
+	}
+
+	void TestTransparentOrder()
+	{
+		RenderSnapshot frame;
+		AddItem(frame, MeshA, MaterialA, RenderQueue::Transparent, 0.1f);
+		AddItem(frame, MeshB, MaterialA, RenderQueue::Transparent, 0.5f);
+		AddItem(frame, MeshA, MaterialA, RenderQueue::Transparent, 0.9f);
+		frame.Queue.Sort();
+
+		std::vector<unsigned int> slots = { 0, 1, 2 };
+		InstanceBatcher batcher;
+		batcher.Build(frame, slots);
+
+		// Back to front puts B between the two As, so nothing can be merged
+		CHECK(batcher.GetBatches().size() == 3);
+		CHECK(batcher.GetInstances().size() == 3);
+		if (batcher.GetInstances().size() == 3)
+		{
+			CHECK(batcher.GetInstances()[0].ObjectIndex == 2);
+			CHECK(batcher.GetInstances()[1].ObjectIndex == 1);
+			CHECK(batcher.GetInstances()[2].ObjectIndex == 0);
+		}
+
+		StateCache::RecordingTarget target;
+		DrawBatches(batcher, target);
+		CHECK(target.GetDrawCount() == 3);
+		CHECK(target.GetInstanceCount() == 3);
+	}
+
+	void TestEmpty()
+	{
+		RenderSnapshot frame;
+		InstanceBatcher batcher;
+		batcher.Build(frame, std::vector<unsigned int>());
+		CHECK(batcher.GetBatches().empty());
+		CHECK(batcher.GetInstances().empty());
+	}
+}
+
+void RunInstanceBatcherTests()
+{
+	TestOpaqueBatches();
+	TestTransparentOrder();
+	TestEmpty();
+}
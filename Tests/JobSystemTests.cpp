@@ -0,0 +1,191 @@
+#include "Tests.h"
+#include "JobSystem.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	void CountJob(const Job& t_job)
+	{
+		++*static_cast<std::atomic<int>*>(t_job.Data);
+	}
+
+	// Shared by the jobs of TestWaitHelps
+	struct HelpData
+	{
+		std::atomic<bool> blockerStarted;
+		std::atomic<bool> released;
+		std::thread::id releaserThread;
+	};
+
+	void BlockerJob(const Job& t_job)
+	{
+		HelpData* data = static_cast<HelpData*>(t_job.Data);
+		data->blockerStarted = true;
+		while (!data->released.load())
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	void ReleaserJob(const Job& t_job)
+	{
+		HelpData* data = static_cast<HelpData*>(t_job.Data);
+		data->releaserThread = std::this_thread::get_id();
+		data->released = true;
+	}
+
+	// Shared by the jobs of TestDependencyChain
+	struct ChainData
+	{
+		std::atomic<int> next;
+		std::vector<int> order;
+	};
+
+	void ChainJob(const Job& t_job)
+	{
+		ChainData* data = static_cast<ChainData*>(t_job.Data);
+		data->order.push_back(static_cast<int>(t_job.Begin));
+		++data->next;
+	}
+
+	void TestNestedParallelFor()
+	{
+		JobSystem jobs(4);
+		const size_t outer = 64;
+		const size_t inner = 64;
+		std::vector<std::atomic<int>> hits(outer * inner);
+		for (std::atomic<int>& hit : hits)
+		{
+			hit = 0;
+		}
+
+		auto outerBody = [&](size_t i)
+		{
+			auto innerBody = [&](size_t j)
+			{
+				++hits[i * inner + j];
+			};
+			jobs.ParallelFor(inner, 1, innerBody);
+		};
+		jobs.ParallelFor(outer, 1, outerBody);
+
+		bool once = true;
+		for (std::atomic<int>& hit : hits)
+		{
+			once = once && hit.load() == 1;
+		}
+		CHECK(once);
+	}
+
+	void TestWaitRunsJobs()
+	{
+		// With no workers, nothing but the waiting thread can run the jobs
+		JobSystem jobs(1);
+		std::atomic<int> count(0);
+		JobCounter counter;
+		for (size_t i = 0; i < 16; ++i)
+		{
+			jobs.Run(&CountJob, &count, i, i + 1, &counter);
+		}
+		CHECK(counter.GetValue() == 16);
+		CHECK(count.load() == 0);
+
+		jobs.Wait(&counter);
+		CHECK(counter.IsDone());
+		CHECK(count.load() == 16);
+		CHECK(jobs.GetExecutedCount() == 16);
+	}
+
+	void TestWaitHelps()
+	{
+		// Keep the only worker busy until a job queued behind it has run, so
+		// the wait can only finish if the waiting thread runs that job itself
+		JobSystem jobs(2);
+		HelpData data;
+		data.blockerStarted = false;
+		data.released = false;
+
+		JobCounter blocker;
+		jobs.Run(&BlockerJob, &data, 0, 1, &blocker);
+		while (!data.blockerStarted.load())
+		{
+			std::this_thread::yield();
+		}
+
+		JobCounter releaser;
+		jobs.Run(&ReleaserJob, &data, 0, 1, &releaser);
+		jobs.Wait(&releaser);
+		CHECK(data.released.load());
+		CHECK(data.releaserThread == std::this_thread::get_id());
+
+		jobs.Wait(&blocker);
+		CHECK(blocker.IsDone());
+	}
+
+	void TestDependencyChain()
+	{
+		JobSystem jobs(4);
+		const int length = 32;
+		ChainData data;
+		data.next = 0;
+
+		// Each job waits for the counter of the one before it
+		std::vector<JobCounter> counters(length);
+		for (int i = 0; i < length; ++i)
+		{
+			jobs.Run(&ChainJob, &data, i, i + 1, &counters[i], i > 0 ? &counters[i - 1] : nullptr);
+		}
+		jobs.Wait(&counters[length - 1]);
+		CHECK(data.next.load() == length);
+
+		bool inOrder = static_cast<int>(data.order.size()) == length;
+		for (int i = 0; inOrder && i < length; ++i)
+		{
+			inOrder = data.order[i] == i;
+		}
+		CHECK(inOrder);
+
+		// Depending on a counter that is already done starts the job straight away
+		JobCounter done;
+		JobCounter after;
+		std::atomic<int> count(0);
+		jobs.Run(&CountJob, &count, 0, 1, &after, &done);
+		jobs.Wait(&after);
+		CHECK(count.load() == 1);
+	}
+
+	void TestQueueOverflow()
+	{
+		// One thread and nobody to steal: the queue fills up and the next
+		// job runs inline in Run() instead of being lost
+		JobSystem jobs(1);
+		std::atomic<int> count(0);
+		JobCounter counter;
+		for (int64_t i = 0; i < WorkStealingQueue::Capacity; ++i)
+		{
+			jobs.Run(&CountJob, &count, 0, 1, &counter);
+		}
+		CHECK(count.load() == 0);
+		CHECK(jobs.GetExecutedCount() == 0);
+
+		jobs.Run(&CountJob, &count, 0, 1, &counter);
+		CHECK(count.load() == 1);
+		CHECK(jobs.GetExecutedCount() == 1);
+		CHECK(counter.GetValue() == WorkStealingQueue::Capacity);
+
+		jobs.Wait(&counter);
+		CHECK(count.load() == WorkStealingQueue::Capacity + 1);
+		CHECK(counter.IsDone());
+	}
+}
+
+void RunJobSystemTests()
+{
+	TestNestedParallelFor();
+	TestWaitRunsJobs();
+	TestWaitHelps();
+	TestDependencyChain();
+	TestQueueOverflow();
+}
@@ -0,0 +1,67 @@
+#include "Tests.h"
+#include "RenderQueue.h"
+#include <limits>
+
+namespace
+{
+	void TestKeyFields()
+	{
+		uint64_t key = RenderQueue::MakeKey(RenderQueue::Transparent, 5, 6, 7, 0.5f);
+		CHECK(RenderQueue::GetPass(key) == RenderQueue::Transparent);
+		CHECK(RenderQueue::GetShader(key) == 5);
+		CHECK(RenderQueue::GetMaterial(key) == 6);
+		CHECK(RenderQueue::GetMesh(key) == 7);
+	}
+
+	void TestDepthRange()
+	{
+		// Depth stays inside its own field, right up to 1
+		uint64_t nearKey = RenderQueue::MakeKey(RenderQueue::Opaque, 1, 2, 3, 0.0f);
+		uint64_t farKey = RenderQueue::MakeKey(RenderQueue::Opaque, 1, 2, 3, 1.0f);
+		CHECK(RenderQueue::GetMesh(farKey) == 3);
+		CHECK(RenderQueue::GetMaterial(farKey) == 2);
+		CHECK(nearKey < farKey);
+		CHECK(farKey < RenderQueue::MakeKey(RenderQueue::Opaque, 1, 2, 4, 0.0f));
+
+		// Out of range depths are clamped, and NaN counts as 0
+		CHECK(RenderQueue::MakeKey(RenderQueue::Opaque, 1, 2, 3, 2.0f) == farKey);
+		CHECK(RenderQueue::MakeKey(RenderQueue::Opaque, 1, 2, 3, -1.0f) == nearKey);
+		CHECK(RenderQueue::MakeKey(RenderQueue::Opaque, 1, 2, 3, std::numeric_limits<float>::quiet_NaN()) == nearKey);
+
+		uint64_t transparentFar = RenderQueue::MakeKey(RenderQueue::Transparent, 1, 2, 3, 1.0f);
+		CHECK(RenderQueue::GetPass(transparentFar) == RenderQueue::Transparent);
+		CHECK(transparentFar < RenderQueue::MakeKey(RenderQueue::Transparent, 1, 2, 3, 0.0f));
+	}
+
+	void TestStableSort()
+	{
+		RenderQueue queue;
+		uint64_t low = RenderQueue::MakeKey(RenderQueue::Opaque, 0, 0, 1, 0.5f);
+		uint64_t high = RenderQueue::MakeKey(RenderQueue::Transparent, 0, 0, 1, 0.5f);
+		queue.Add(high, 0);
+		queue.Add(low, 1);
+		queue.Add(high, 2);
+		queue.Add(low, 3);
+		queue.Sort();
+
+		const std::vector<RenderQueue::Item>& items = queue.GetItems();
+		CHECK(items.size() == 4);
+		if (items.size() == 4)
+		{
+			CHECK(items[0].Index == 1);
+			CHECK(items[1].Index == 3);
+			CHECK(items[2].Index == 0);
+			CHECK(items[3].Index == 2);
+		}
+
+		queue.Clear();
+		CHECK(queue.GetItems().empty());
+	}
+}
+
+void RunRenderQueueTests()
+{
+	TestKeyFields();
+	TestDepthRange();
+	TestStableSort();
+}
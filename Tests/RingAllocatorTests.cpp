@@ -0,0 +1,116 @@
+#include "Tests.h"
+#include "RingAllocator.h"
+
+namespace
+{
+	void TestAlignment()
+	{
+		RingAllocator ring(1024, 256);
+		CHECK(ring.GetCapacity() == 1024);
+		CHECK(ring.Allocate(100) == 0);
+		CHECK(ring.Allocate(1) == 256);
+		CHECK(ring.GetUsedBytes() == 512);
+		CHECK(!ring.DidWrap());
+	}
+
+	void TestInvalidSizes()
+	{
+		RingAllocator ring(1024, 256);
+		CHECK(ring.Allocate(0) == RingAllocator::InvalidOffset);
+		CHECK(ring.Allocate(1025) == RingAllocator::InvalidOffset);
+		CHECK(ring.GetUsedBytes() == 0);
+	}
+
+	void TestFull()
+	{
+		RingAllocator ring(1024, 256);
+		for (size_t i = 0; i < 4; ++i)
+		{
+			CHECK(ring.Allocate(256) == i * 256);
+		}
+		CHECK(ring.Allocate(1) == RingAllocator::InvalidOffset);
+		CHECK(ring.GetUsedBytes() == 1024);
+
+		// Ending the frame does not free anything until the GPU is done with it
+		uint64_t frame = ring.EndFrame();
+		CHECK(ring.GetFramesInFlight() == 1);
+		CHECK(ring.Allocate(1) == RingAllocator::InvalidOffset);
+
+		ring.Retire(frame);
+		CHECK(ring.GetFramesInFlight() == 0);
+		CHECK(ring.GetUsedBytes() == 0);
+		CHECK(ring.Allocate(1024) == 0);
+	}
+
+	void TestRetireInOrder()
+	{
+		RingAllocator ring(1024, 256);
+		ring.Allocate(256);
+		uint64_t first = ring.EndFrame();
+		ring.Allocate(256);
+		uint64_t second = ring.EndFrame();
+		ring.Allocate(256);
+		uint64_t third = ring.EndFrame();
+		CHECK(first < second && second < third);
+		CHECK(ring.GetFramesInFlight() == 3);
+
+		ring.Retire(first);
+		CHECK(ring.GetFramesInFlight() == 2);
+		CHECK(ring.GetUsedBytes() == 512);
+
+		// Retiring a frame retires every one before it
+		ring.Retire(third);
+		CHECK(ring.GetFramesInFlight() == 0);
+		CHECK(ring.GetUsedBytes() == 0);
+	}
+
+	void TestWrap()
+	{
+		RingAllocator ring(1024, 256);
+		CHECK(ring.Allocate(512) == 0);
+		uint64_t first = ring.EndFrame();
+		CHECK(ring.Allocate(256) == 512);
+		uint64_t second = ring.EndFrame();
+		ring.Retire(first);
+
+		// 256 bytes left at the end are too few, so the range goes back to the start
+		CHECK(ring.Allocate(512) == 0);
+		CHECK(ring.DidWrap());
+		CHECK(ring.GetUsedBytes() == 1024);
+
+		// Head has caught up with the second frame
+		CHECK(ring.Allocate(1) == RingAllocator::InvalidOffset);
+
+		// The skipped end stays in use until the frame that wrapped is retired
+		ring.Retire(second);
+		CHECK(ring.GetUsedBytes() == 768);
+		CHECK(ring.Allocate(256) == 512);
+		CHECK(!ring.DidWrap());
+		ring.Retire(ring.EndFrame());
+		CHECK(ring.GetUsedBytes() == 0);
+	}
+
+	void TestReset()
+	{
+		RingAllocator ring(1024, 256);
+		ring.Allocate(512);
+		ring.EndFrame();
+		ring.Allocate(512);
+
+		ring.Reset();
+		CHECK(ring.GetUsedBytes() == 0);
+		CHECK(ring.GetFramesInFlight() == 0);
+		CHECK(!ring.DidWrap());
+		CHECK(ring.Allocate(1024) == 0);
+	}
+}
+
+void RunRingAllocatorTests()
+{
+	TestAlignment();
+	TestInvalidSizes();
+	TestFull();
+	TestRetireInOrder();
+	TestWrap();
+	TestReset();
+}
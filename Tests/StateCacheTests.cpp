@@ -0,0 +1,141 @@
+#include "Tests.h"
+#include "StateCache.h"
+#include <cstdint>
+
+namespace
+{
+	// Stand-ins for device objects; the cache only compares the pointers
+	template <typename T>
+	T* MakeFake(uintptr_t t_id)
+	{
+		return reinterpret_cast<T*>(t_id * 16);
+	}
+
+	void TestRedundantShaders()
+	{
+		StateCache::RecordingTarget target;
+		StateCache cache(&target);
+		ID3D11DeviceChild* shader = MakeFake<ID3D11DeviceChild>(1);
+
+		cache.SetShader(StateCache::Vertex, shader);
+		cache.SetShader(StateCache::Vertex, shader);
+		cache.SetShader(StateCache::Pixel, shader);
+		CHECK(target.GetCallCount() == 2);
+		CHECK(target.GetBindings().Shaders[StateCache::Vertex] == shader);
+		CHECK(target.GetBindings().Shaders[StateCache::Pixel] == shader);
+
+		StateCache::Stats stats = cache.GetStats();
+		CHECK(stats.Requested == 3);
+		CHECK(stats.Forwarded == 2);
+
+		// After a Reset the cache assumes nothing is bound, so the shader goes out again
+		cache.Reset();
+		cache.SetShader(StateCache::Vertex, shader);
+		CHECK(target.GetCallCount() == 3);
+
+		cache.ResetStats();
+		CHECK(cache.GetStats().Requested == 0);
+	}
+
+	void TestSlotRanges()
+	{
+		StateCache::RecordingTarget target;
+		StateCache cache(&target);
+		ID3D11Buffer* first = MakeFake<ID3D11Buffer>(1);
+		ID3D11Buffer* second = MakeFake<ID3D11Buffer>(2);
+
+		// Slots are held until Apply(), then go out as one call from the lowest to the highest
+		cache.SetConstantBuffer(StateCache::Vertex, 0, first);
+		cache.SetConstantBuffer(StateCache::Vertex, 2, second);
+		CHECK(target.GetCallCount() == 0);
+		cache.Apply();
+		CHECK(target.GetCallCount() == 1);
+		CHECK(target.GetSlotCount() == 3);
+		CHECK(target.GetBindings().ConstantBuffers[StateCache::Vertex][0] == first);
+		CHECK(target.GetBindings().ConstantBuffers[StateCache::Vertex][1] == nullptr);
+		CHECK(target.GetBindings().ConstantBuffers[StateCache::Vertex][2] == second);
+
+		// Setting what is bound sends nothing
+		cache.SetConstantBuffer(StateCache::Vertex, 0, first);
+		cache.Apply();
+		CHECK(target.GetCallCount() == 1);
+
+		// Neither does changing a slot and changing it back before Apply()
+		cache.SetShaderResource(StateCache::Pixel, 3, MakeFake<ID3D11ShaderResourceView>(3));
+		cache.SetShaderResource(StateCache::Pixel, 3, nullptr);
+		cache.Apply();
+		CHECK(target.GetCallCount() == 1);
+
+		// Out of range slots are dropped
+		cache.SetSampler(StateCache::Pixel, StateCache::SamplerSlots, MakeFake<ID3D11SamplerState>(4));
+		cache.Apply();
+		CHECK(target.GetCallCount() == 1);
+	}
+
+	void TestConstantBufferRanges()
+	{
+		StateCache::RecordingTarget target;
+		StateCache cache(&target);
+		ID3D11Buffer* buffer = MakeFake<ID3D11Buffer>(1);
+
+		// Whole and ranged bindings cannot share a call
+		cache.SetConstantBuffer(StateCache::Vertex, 0, buffer);
+		cache.SetConstantBuffer(StateCache::Vertex, 1, buffer, 16, 16);
+		cache.Apply();
+		CHECK(target.GetCallCount() == 2);
+		CHECK(target.GetBindings().FirstConstants[StateCache::Vertex][1] == 16);
+		CHECK(target.GetBindings().ConstantCounts[StateCache::Vertex][1] == 16);
+
+		// Another range of the same buffer is a change
+		cache.SetConstantBuffer(StateCache::Vertex, 1, buffer, 32, 16);
+		cache.Apply();
+		CHECK(target.GetCallCount() == 3);
+		CHECK(target.GetBindings().FirstConstants[StateCache::Vertex][1] == 32);
+	}
+
+	void TestDraws()
+	{
+		StateCache::RecordingTarget target;
+		StateCache cache(&target);
+		ID3D11Buffer* vertices = MakeFake<ID3D11Buffer>(1);
+		ID3D11Buffer* instances = MakeFake<ID3D11Buffer>(2);
+		ID3D11Buffer* indices = MakeFake<ID3D11Buffer>(3);
+
+		cache.SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		cache.SetIndexBuffer(indices, DXGI_FORMAT_R32_UINT, 0);
+		cache.SetVertexBuffer(0, vertices, 32, 0);
+		cache.SetVertexBuffer(1, instances, 4, 0);
+		CHECK(target.GetCallCount() == 2);
+
+		// Draws apply what is pending first
+		cache.DrawIndexed(36, 0, 0);
+		CHECK(target.GetCallCount() == 3);
+		CHECK(target.GetBindings().VertexBuffers[0] == vertices);
+		CHECK(target.GetBindings().VertexBuffers[1] == instances);
+		CHECK(target.GetBindings().Strides[0] == 32);
+		CHECK(target.GetBindings().Strides[1] == 4);
+		CHECK(target.GetBindings().IndexBuffer == indices);
+
+		// Moving the instance buffer's offset is one more call; the rest stays
+		cache.SetVertexBuffer(0, vertices, 32, 0);
+		cache.SetVertexBuffer(1, instances, 4, 64);
+		cache.DrawIndexedInstanced(36, 10, 0, 0, 0);
+		CHECK(target.GetCallCount() == 4);
+		CHECK(target.GetBindings().Offsets[1] == 64);
+
+		CHECK(target.GetDrawCount() == 2);
+		CHECK(target.GetInstanceCount() == 11);
+
+		target.Reset();
+		CHECK(target.GetCallCount() == 0);
+		CHECK(target.GetDrawCount() == 0);
+	}
+}
+
+void RunStateCacheTests()
+{
+	TestRedundantShaders();
+	TestSlotRanges();
+	TestConstantBufferRanges();
+	TestDraws();
+}
@@ -0,0 +1,37 @@
+#include "Tests.h"
+#include <cstdio>
+
+namespace
+{
+	int checkCount = 0;
+	int failureCount = 0;
+}
+
+bool Check(bool t_passed, const char* t_condition, const char* t_file, int t_line)
+{
+	++checkCount;
+	if (!t_passed)
+	{
+		++failureCount;
+		printf("%s(%d): CHECK(%s) failed\n", t_file, t_line, t_condition);
+	}
+	return t_passed;
+}
+
+int GetFailureCount()
+{
+	return failureCount;
+}
+
+int main()
+{
+	RunJobSystemTests();
+	RunTimeSlicedSchedulerTests();
+	RunRenderQueueTests();
+	RunStateCacheTests();
+	RunInstanceBatcherTests();
+	RunRingAllocatorTests();
+
+	printf("%d checks, %d failed\n", checkCount, failureCount);
+	return failureCount == 0 ? 0 : 1;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+// Checks for the parts of the engine that run without a device. Each
+// Run*Tests() reports failed CHECKs as it goes; main() returns how many
+// there were, so the test project fails the build step that runs it.
+#define CHECK(t_condition) Check((t_condition), #t_condition, __FILE__, __LINE__)
+
+// Record a CHECK, printing it if it failed.
+bool Check(bool t_passed, const char* t_condition, const char* t_file, int t_line);
+
+// Get number of CHECKs failed so far.
+int GetFailureCount();
+
+// One per class under test.
+void RunJobSystemTests();
+void RunTimeSlicedSchedulerTests();
+void RunRenderQueueTests();
+void RunStateCacheTests();
+void RunInstanceBatcherTests();
+void RunRingAllocatorTests();
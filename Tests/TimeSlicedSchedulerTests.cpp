@@ -0,0 +1,128 @@
+#include "Tests.h"
+#include "TimeSlicedScheduler.h"
+
+namespace
+{
+	// A clock that only moves when a task says it spent time
+	struct FakeClock
+	{
+		double Now = 0.0;
+
+		TimeSlicedScheduler::ClockFunction GetFunction()
+		{
+			return [this]() { return Now; };
+		}
+
+		// A task that takes t_milliseconds a slice and is done after t_slices of them
+		TimeSlicedScheduler::TaskFunction MakeTask(double t_milliseconds, unsigned int t_slices)
+		{
+			unsigned int slices = 0;
+			return [this, t_milliseconds, t_slices, slices]() mutable
+			{
+				Now += t_milliseconds / 1000.0;
+				return ++slices >= t_slices;
+			};
+		}
+	};
+
+	void TestBudget()
+	{
+		FakeClock clock;
+		TimeSlicedScheduler scheduler(clock.GetFunction());
+		scheduler.SetBudgetMilliseconds(2.5f);
+		unsigned int id = scheduler.Add("work", clock.MakeTask(1.0, 5));
+
+		// Two 1 ms slices fit in 2.5 ms; a third is expected to run over
+		scheduler.RunFrame();
+		CHECK(scheduler.GetLastFrameSlices() == 2);
+		CHECK(scheduler.IsPending(id));
+
+		scheduler.RunFrame();
+		CHECK(scheduler.GetLastFrameSlices() == 2);
+
+		scheduler.RunFrame();
+		CHECK(scheduler.GetLastFrameSlices() == 1);
+		CHECK(!scheduler.IsPending(id));
+		CHECK(scheduler.GetPendingCount() == 0);
+		CHECK(scheduler.GetFrameCount() == 3);
+
+		const std::vector<TimeSlicedScheduler::CompletedTask>& completed = scheduler.GetCompleted();
+		CHECK(completed.size() == 1);
+		if (!completed.empty())
+		{
+			CHECK(completed[0].Id == id);
+			CHECK(completed[0].Name == "work");
+			CHECK(completed[0].Frames == 3);
+			CHECK(completed[0].Slices == 5);
+			CHECK(completed[0].Seconds > 0.0049 && completed[0].Seconds < 0.0051);
+		}
+
+		scheduler.ClearCompleted();
+		CHECK(scheduler.GetCompleted().empty());
+	}
+
+	void TestFirstSliceOverBudget()
+	{
+		FakeClock clock;
+		TimeSlicedScheduler scheduler(clock.GetFunction());
+		scheduler.SetBudgetMilliseconds(2.0f);
+		scheduler.Add("slow", clock.MakeTask(10.0, 3));
+
+		// Every frame makes progress, even when a slice takes longer than the budget
+		for (int frame = 0; frame < 3; ++frame)
+		{
+			scheduler.RunFrame();
+			CHECK(scheduler.GetLastFrameSlices() == 1);
+			CHECK(scheduler.GetLastFrameMilliseconds() > 9.9f);
+		}
+		CHECK(scheduler.GetPendingCount() == 0);
+	}
+
+	void TestPriority()
+	{
+		FakeClock clock;
+		TimeSlicedScheduler scheduler(clock.GetFunction());
+		scheduler.SetBudgetMilliseconds(1.0f);
+		scheduler.SetAgingFrames(0);
+		unsigned int low = scheduler.Add("low", clock.MakeTask(1.0, 1), TimeSlicedScheduler::Low);
+		unsigned int high = scheduler.Add("high", clock.MakeTask(1.0, 100), TimeSlicedScheduler::High);
+
+		// Without aging, the low task never gets a slice while the high one has work
+		for (int frame = 0; frame < 10; ++frame)
+		{
+			scheduler.RunFrame();
+			CHECK(scheduler.GetLastFrameSlices() == 1);
+		}
+		CHECK(scheduler.IsPending(low));
+		CHECK(scheduler.IsPending(high));
+	}
+
+	void TestAging()
+	{
+		FakeClock clock;
+		TimeSlicedScheduler scheduler(clock.GetFunction());
+		scheduler.SetBudgetMilliseconds(1.0f);
+		scheduler.SetAgingFrames(2);
+		unsigned int low = scheduler.Add("low", clock.MakeTask(1.0, 1), TimeSlicedScheduler::Low);
+		scheduler.Add("high", clock.MakeTask(1.0, 100), TimeSlicedScheduler::High);
+
+		// Low climbs a level every 2 frames without a slice, so it draws level
+		// with High after 4 and wins the tie for having waited longer
+		unsigned int finishedFrame = 0;
+		for (unsigned int frame = 0; frame < 10 && scheduler.IsPending(low); ++frame)
+		{
+			scheduler.RunFrame();
+			finishedFrame = frame;
+		}
+		CHECK(!scheduler.IsPending(low));
+		CHECK(finishedFrame == 4);
+	}
+}
+
+void RunTimeSlicedSchedulerTests()
+{
+	TestBudget();
+	TestFirstSliceOverBudget();
+	TestPriority();
+	TestAging();
+}
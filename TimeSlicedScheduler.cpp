@@ -0,0 +1,173 @@
+#include "TimeSlicedScheduler.h"
+#include <chrono>
+#include <climits>
+
+TimeSlicedScheduler::TimeSlicedScheduler(ClockFunction t_clock) :
+	clock(t_clock)
+{
+	if (!clock)
+	{
+		clock = []()
+		{
+			return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		};
+	}
+}
+
+unsigned int TimeSlicedScheduler::Add(const std::string& t_name, TaskFunction t_function, int t_priority)
+{
+	Task task;
+	task.Id = nextId++;
+	task.Name = t_name;
+	task.Function = t_function;
+	task.Priority = t_priority;
+	task.AddedFrame = frameCount;
+	task.WaitingFrames = 0;
+	task.LastFrame = UINT_MAX;
+	task.LastSlice = 0;
+	task.Slices = 0;
+	task.Seconds = 0.0;
+	tasks.push_back(task);
+	return task.Id;
+}
+
+void TimeSlicedScheduler::SetBudgetMilliseconds(float t_budget)
+{
+	budget = t_budget / 1000.0;
+}
+
+float TimeSlicedScheduler::GetBudgetMilliseconds() const
+{
+	return (float)(budget * 1000.0);
+}
+
+void TimeSlicedScheduler::SetAgingFrames(unsigned int t_frames)
+{
+	agingFrames = t_frames;
+}
+
+unsigned int TimeSlicedScheduler::GetAgingFrames() const
+{
+	return agingFrames;
+}
+
+void TimeSlicedScheduler::RunFrame()
+{
+	double frameStart = clock();
+	double frameEnd = frameStart;
+	lastFrameSlices = 0;
+
+	while (!tasks.empty())
+	{
+		size_t index = PickTask();
+		Task& task = tasks[index];
+
+		// Stop once the next slice is not expected to fit any more
+		double remaining = budget - (frameEnd - frameStart);
+		double expected = task.Slices > 0 ? task.Seconds / task.Slices : 0.0;
+		if (lastFrameSlices > 0 && (remaining <= 0.0 || expected > remaining))
+		{
+			break;
+		}
+
+		double sliceStart = frameEnd;
+		bool finished = task.Function();
+		frameEnd = clock();
+
+		task.Seconds += frameEnd - sliceStart;
+		task.Slices++;
+		task.WaitingFrames = 0;
+		task.LastFrame = frameCount;
+		task.LastSlice = ++sliceCount;
+		++lastFrameSlices;
+
+		if (finished)
+		{
+			CompletedTask result = { task.Id, task.Name, task.Priority, frameCount - task.AddedFrame + 1, task.Slices, task.Seconds };
+			completed.push_back(result);
+
+			// Keep the queue in the order tasks were added
+			tasks.erase(tasks.begin() + index);
+		}
+	}
+
+	// Whatever did not get a slice this frame ages
+	for (Task& task : tasks)
+	{
+		if (task.LastFrame != frameCount)
+		{
+			task.WaitingFrames++;
+		}
+	}
+
+	lastFrameSeconds = frameEnd - frameStart;
+	++frameCount;
+}
+
+bool TimeSlicedScheduler::IsPending(unsigned int t_id) const
+{
+	for (const Task& task : tasks)
+	{
+		if (task.Id == t_id)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+size_t TimeSlicedScheduler::GetPendingCount() const
+{
+	return tasks.size();
+}
+
+const std::vector<TimeSlicedScheduler::CompletedTask>& TimeSlicedScheduler::GetCompleted() const
+{
+	return completed;
+}
+
+void TimeSlicedScheduler::ClearCompleted()
+{
+	completed.clear();
+}
+
+unsigned int TimeSlicedScheduler::GetLastFrameSlices() const
+{
+	return lastFrameSlices;
+}
+
+float TimeSlicedScheduler::GetLastFrameMilliseconds() const
+{
+	return (float)(lastFrameSeconds * 1000.0);
+}
+
+unsigned int TimeSlicedScheduler::GetFrameCount() const
+{
+	return frameCount;
+}
+
+size_t TimeSlicedScheduler::PickTask() const
+{
+	// Highest effective priority first, then whoever has waited longest for a slice
+	size_t best = 0;
+	int bestPriority = GetEffectivePriority(tasks[0]);
+	for (size_t i = 1; i < tasks.size(); ++i)
+	{
+		int priority = GetEffectivePriority(tasks[i]);
+		if (priority > bestPriority || (priority == bestPriority && tasks[i].LastSlice < tasks[best].LastSlice))
+		{
+			best = i;
+			bestPriority = priority;
+		}
+	}
+	return best;
+}
+
+int TimeSlicedScheduler::GetEffectivePriority(const Task& t_task) const
+{
+	if (agingFrames == 0)
+	{
+		return t_task.Priority;
+	}
+	return t_task.Priority + (int)(t_task.WaitingFrames / agingFrames);
+}
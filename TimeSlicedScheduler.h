@@ -0,0 +1,109 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Spreads deferrable work (LOD rebuilds, BVH refits, cache writes...) over
+// many frames so it never causes a hitch.
+//
+// A task is a function that does one small slice of its work per call and
+// returns true once it is finished. RunFrame() keeps handing out slices until
+// the frame's budget is spent, always to the task with the highest effective
+// priority: its own priority plus one level for every AgingFrames frames it
+// has gone without a slice, so low priority work cannot starve.
+//
+// All timing goes through a clock function, so a test can drive the
+// scheduler with a fake clock and get the same decisions every run.
+class TimeSlicedScheduler
+{
+public:
+	typedef std::function<bool()> TaskFunction;
+	typedef std::function<double()> ClockFunction;		// Seconds, from any fixed origin
+
+	enum Priority
+	{
+		Low = 0,
+		Normal = 1,
+		High = 2
+	};
+
+	// What happened to a finished task.
+	struct CompletedTask
+	{
+		unsigned int Id;
+		std::string Name;
+		int Priority;
+		unsigned int Frames;			// Frames from the one it was added in to the one it finished in, inclusive
+		unsigned int Slices;
+		double Seconds;					// Time spent inside its slices
+	};
+
+	// Use t_clock for all timing, or a steady wall clock if it is empty.
+	explicit TimeSlicedScheduler(ClockFunction t_clock = ClockFunction());
+
+	// Queue a task. Returns an id for IsPending().
+	unsigned int Add(const std::string& t_name, TaskFunction t_function, int t_priority = Normal);
+
+	// Set milliseconds RunFrame() may spend per call.
+	void SetBudgetMilliseconds(float t_budget);
+	float GetBudgetMilliseconds() const;
+
+	// Set how many frames without a slice raise a task's priority by one level (0 = never).
+	void SetAgingFrames(unsigned int t_frames);
+	unsigned int GetAgingFrames() const;
+
+	// Run slices until the budget is spent or nothing is left. A slice is only
+	// started if the task's average slice so far fits in what remains, except
+	// for the first slice of a frame, so every frame makes some progress.
+	void RunFrame();
+
+	// Is a task still queued?
+	bool IsPending(unsigned int t_id) const;
+
+	// Get number of queued tasks.
+	size_t GetPendingCount() const;
+
+	// Get finished tasks, oldest first, since the last ClearCompleted().
+	const std::vector<CompletedTask>& GetCompleted() const;
+	void ClearCompleted();
+
+	// Get slices run and milliseconds used by the last RunFrame().
+	unsigned int GetLastFrameSlices() const;
+	float GetLastFrameMilliseconds() const;
+
+	// Get number of RunFrame() calls so far.
+	unsigned int GetFrameCount() const;
+
+private:
+	struct Task
+	{
+		unsigned int Id;
+		std::string Name;
+		TaskFunction Function;
+		int Priority;
+		unsigned int AddedFrame;
+		unsigned int WaitingFrames;		// Frames since it last got a slice
+		unsigned int LastFrame;			// Frame of its last slice (UINT_MAX if none yet)
+		uint64_t LastSlice;				// Order of its last slice, to rotate between equals
+		unsigned int Slices;
+		double Seconds;
+	};
+
+	// Index in tasks of the one to run next.
+	size_t PickTask() const;
+
+	// Priority including aging.
+	int GetEffectivePriority(const Task& t_task) const;
+
+	ClockFunction clock;
+	std::vector<Task> tasks;
+	std::vector<CompletedTask> completed;
+	double budget = 0.002;
+	unsigned int agingFrames = 30;
+	unsigned int nextId = 0;
+	unsigned int frameCount = 0;
+	uint64_t sliceCount = 0;
+	unsigned int lastFrameSlices = 0;
+	double lastFrameSeconds = 0.0;
+};
@@ -0,0 +1,227 @@
+#include "TransformSystem.h"
+
+using namespace DirectX;
+
+void TransformSystem::Reserve(size_t t_count)
+{
+	positionX.reserve(t_count);
+	positionY.reserve(t_count);
+	positionZ.reserve(t_count);
+	rotationX.reserve(t_count);
+	rotationY.reserve(t_count);
+	rotationZ.reserve(t_count);
+	scaleX.reserve(t_count);
+	scaleY.reserve(t_count);
+	scaleZ.reserve(t_count);
+	worldMatrices.reserve(t_count);
+	indexToHandle.reserve(t_count);
+	handleToIndex.reserve(t_count);
+}
+
+TransformHandle TransformSystem::Create(const DirectX::XMFLOAT3& t_position, const DirectX::XMFLOAT3& t_rotation, const DirectX::XMFLOAT3& t_scale)
+{
+	unsigned int index = static_cast<unsigned int>(positionX.size());
+
+	TransformHandle handle;
+	if (freeHandles.empty())
+	{
+		handle = static_cast<TransformHandle>(handleToIndex.size());
+		handleToIndex.push_back(index);
+	}
+	else
+	{
+		handle = freeHandles.back();
+		freeHandles.pop_back();
+		handleToIndex[handle] = index;
+	}
+	indexToHandle.push_back(handle);
+
+	positionX.push_back(t_position.x);
+	positionY.push_back(t_position.y);
+	positionZ.push_back(t_position.z);
+	rotationX.push_back(t_rotation.x);
+	rotationY.push_back(t_rotation.y);
+	rotationZ.push_back(t_rotation.z);
+	scaleX.push_back(t_scale.x);
+	scaleY.push_back(t_scale.y);
+	scaleZ.push_back(t_scale.z);
+	worldMatrices.push_back(XMFLOAT4X4());
+	ComputeWorldMatrix(index);
+
+	return handle;
+}
+
+void TransformSystem::Destroy(TransformHandle t_handle)
+{
+	unsigned int index = handleToIndex[t_handle];
+	unsigned int last = static_cast<unsigned int>(positionX.size() - 1);
+
+	// Swap-remove to keep the arrays packed
+	if (index != last)
+	{
+		positionX[index] = positionX[last];
+		positionY[index] = positionY[last];
+		positionZ[index] = positionZ[last];
+		rotationX[index] = rotationX[last];
+		rotationY[index] = rotationY[last];
+		rotationZ[index] = rotationZ[last];
+		scaleX[index] = scaleX[last];
+		scaleY[index] = scaleY[last];
+		scaleZ[index] = scaleZ[last];
+		worldMatrices[index] = worldMatrices[last];
+
+		TransformHandle moved = indexToHandle[last];
+		indexToHandle[index] = moved;
+		handleToIndex[moved] = index;
+	}
+
+	positionX.pop_back();
+	positionY.pop_back();
+	positionZ.pop_back();
+	rotationX.pop_back();
+	rotationY.pop_back();
+	rotationZ.pop_back();
+	scaleX.pop_back();
+	scaleY.pop_back();
+	scaleZ.pop_back();
+	worldMatrices.pop_back();
+	indexToHandle.pop_back();
+
+	handleToIndex[t_handle] = UINT_MAX;
+	freeHandles.push_back(t_handle);
+}
+
+DirectX::XMFLOAT3 TransformSystem::GetPosition(TransformHandle t_handle) const
+{
+	unsigned int index = handleToIndex[t_handle];
+	return XMFLOAT3(positionX[index], positionY[index], positionZ[index]);
+}
+
+void TransformSystem::SetPosition(TransformHandle t_handle, const DirectX::XMFLOAT3& t_position)
+{
+	unsigned int index = handleToIndex[t_handle];
+	positionX[index] = t_position.x;
+	positionY[index] = t_position.y;
+	positionZ[index] = t_position.z;
+}
+
+DirectX::XMFLOAT3 TransformSystem::GetRotation(TransformHandle t_handle) const
+{
+	unsigned int index = handleToIndex[t_handle];
+	return XMFLOAT3(rotationX[index], rotationY[index], rotationZ[index]);
+}
+
+void TransformSystem::SetRotation(TransformHandle t_handle, const DirectX::XMFLOAT3& t_rotation)
+{
+	unsigned int index = handleToIndex[t_handle];
+	rotationX[index] = t_rotation.x;
+	rotationY[index] = t_rotation.y;
+	rotationZ[index] = t_rotation.z;
+}
+
+DirectX::XMFLOAT3 TransformSystem::GetScale(TransformHandle t_handle) const
+{
+	unsigned int index = handleToIndex[t_handle];
+	return XMFLOAT3(scaleX[index], scaleY[index], scaleZ[index]);
+}
+
+void TransformSystem::SetScale(TransformHandle t_handle, const DirectX::XMFLOAT3& t_scale)
+{
+	unsigned int index = handleToIndex[t_handle];
+	scaleX[index] = t_scale.x;
+	scaleY[index] = t_scale.y;
+	scaleZ[index] = t_scale.z;
+}
+
+void TransformSystem::UpdateWorldMatrices()
+{
+	const size_t count = positionX.size();
+	const size_t batchEnd = count & ~static_cast<size_t>(3);
+	const XMVECTOR lastRow = g_XMIdentityR3;
+
+	for (size_t i = 0; i < batchEnd; i += 4)
+	{
+		// Each vector holds one component of four consecutive transforms
+		XMVECTOR sinPitch, cosPitch, sinYaw, cosYaw, sinRoll, cosRoll;
+		XMVectorSinCos(&sinPitch, &cosPitch, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&rotationX[i])));
+		XMVectorSinCos(&sinYaw, &cosYaw, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&rotationY[i])));
+		XMVectorSinCos(&sinRoll, &cosRoll, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&rotationZ[i])));
+
+		XMVECTOR sx = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&scaleX[i]));
+		XMVECTOR sy = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&scaleY[i]));
+		XMVECTOR sz = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&scaleZ[i]));
+
+		// Rotation matrix elements, expanded from XMMatrixRotationRollPitchYaw
+		// (roll about Z, then pitch about X, then yaw about Y)
+		XMVECTOR sinPitchSinYaw = sinPitch * sinYaw;
+		XMVECTOR sinPitchCosYaw = sinPitch * cosYaw;
+		XMVECTOR r00 = XMVectorMultiplyAdd(sinRoll, sinPitchSinYaw, cosRoll * cosYaw);
+		XMVECTOR r01 = sinRoll * cosPitch;
+		XMVECTOR r02 = XMVectorNegativeMultiplySubtract(cosRoll, sinYaw, sinRoll * sinPitchCosYaw);
+		XMVECTOR r10 = XMVectorNegativeMultiplySubtract(sinRoll, cosYaw, cosRoll * sinPitchSinYaw);
+		XMVECTOR r11 = cosRoll * cosPitch;
+		XMVECTOR r12 = XMVectorMultiplyAdd(sinRoll, sinYaw, cosRoll * sinPitchCosYaw);
+		XMVECTOR r20 = cosPitch * sinYaw;
+		XMVECTOR r21 = XMVectorNegate(sinPitch);
+		XMVECTOR r22 = cosPitch * cosYaw;
+
+		// World = S * R * T, so row n of the world matrix is row n of R scaled by
+		// the nth scale component and the last row is the translation. The
+		// transposed matrix we want has those as columns instead, so each of its
+		// first three rows is one 4x4 transpose of the SoA data away.
+		XMMATRIX row0 = XMMatrixTranspose(XMMATRIX(r00 * sx, r10 * sy, r20 * sz, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&positionX[i]))));
+		XMMATRIX row1 = XMMatrixTranspose(XMMATRIX(r01 * sx, r11 * sy, r21 * sz, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&positionY[i]))));
+		XMMATRIX row2 = XMMatrixTranspose(XMMATRIX(r02 * sx, r12 * sy, r22 * sz, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&positionZ[i]))));
+
+		for (size_t lane = 0; lane < 4; ++lane)
+		{
+			XMFLOAT4X4& world = worldMatrices[i + lane];
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&world._11), row0.r[lane]);
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&world._21), row1.r[lane]);
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&world._31), row2.r[lane]);
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&world._41), lastRow);
+		}
+	}
+
+	for (size_t i = batchEnd; i < count; ++i)
+	{
+		ComputeWorldMatrix(i);
+	}
+}
+
+void TransformSystem::UpdateWorldMatricesScalar()
+{
+	for (size_t i = 0; i < positionX.size(); ++i)
+	{
+		ComputeWorldMatrix(i);
+	}
+}
+
+const DirectX::XMFLOAT4X4& TransformSystem::GetWorldMatrix(TransformHandle t_handle) const
+{
+	return worldMatrices[handleToIndex[t_handle]];
+}
+
+const DirectX::XMFLOAT4X4* TransformSystem::GetWorldMatrices() const
+{
+	return worldMatrices.empty() ? nullptr : &worldMatrices[0];
+}
+
+unsigned int TransformSystem::GetIndex(TransformHandle t_handle) const
+{
+	return handleToIndex[t_handle];
+}
+
+size_t TransformSystem::GetCount() const
+{
+	return positionX.size();
+}
+
+void TransformSystem::ComputeWorldMatrix(size_t t_index)
+{
+	XMMATRIX scaleMatrix = XMMatrixScaling(scaleX[t_index], scaleY[t_index], scaleZ[t_index]);
+	XMMATRIX rotationMatrix = XMMatrixRotationRollPitchYaw(rotationX[t_index], rotationY[t_index], rotationZ[t_index]);
+	XMMATRIX positionMatrix = XMMatrixTranslation(positionX[t_index], positionY[t_index], positionZ[t_index]);
+
+	XMStoreFloat4x4(&worldMatrices[t_index], XMMatrixTranspose(scaleMatrix * rotationMatrix * positionMatrix));
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <DirectXMath.h>
+#include <climits>
+#include <vector>
+
+// Stable reference to a transform owned by a TransformSystem.
+typedef unsigned int TransformHandle;
+
+// Owns position/rotation/scale for many objects in structure-of-arrays form,
+// so world matrices can be computed several transforms at a time with SIMD.
+//
+// Rotations are Euler angles in radians, (x, y, z) = (pitch, yaw, roll), the
+// same convention Entity passes to XMMatrixRotationRollPitchYaw. World matrices
+// are written transposed, ready to be copied straight into a constant buffer.
+class TransformSystem
+{
+public:
+	static const TransformHandle InvalidHandle = UINT_MAX;
+
+	// Reserve room for t_count transforms.
+	void Reserve(size_t t_count);
+
+	// Add a transform and get the handle to refer to it by.
+	TransformHandle Create(const DirectX::XMFLOAT3& t_position, const DirectX::XMFLOAT3& t_rotation, const DirectX::XMFLOAT3& t_scale);
+
+	// Remove a transform. The last transform is moved into its slot, so the
+	// index of at most one other transform changes; handles stay valid.
+	void Destroy(TransformHandle t_handle);
+
+	// Get/Set the components of a transform.
+	DirectX::XMFLOAT3 GetPosition(TransformHandle t_handle) const;
+	void SetPosition(TransformHandle t_handle, const DirectX::XMFLOAT3& t_position);
+	DirectX::XMFLOAT3 GetRotation(TransformHandle t_handle) const;
+	void SetRotation(TransformHandle t_handle, const DirectX::XMFLOAT3& t_rotation);
+	DirectX::XMFLOAT3 GetScale(TransformHandle t_handle) const;
+	void SetScale(TransformHandle t_handle, const DirectX::XMFLOAT3& t_scale);
+
+	// Recompute every world matrix, four transforms per SIMD step.
+	void UpdateWorldMatrices();
+
+	// Recompute every world matrix one at a time the way Entity does.
+	// Reference for testing and benchmarking the batch path.
+	void UpdateWorldMatricesScalar();
+
+	// Get the (transposed) world matrix computed by the last update.
+	const DirectX::XMFLOAT4X4& GetWorldMatrix(TransformHandle t_handle) const;
+
+	// Get all world matrices, in the same order as GetIndex().
+	const DirectX::XMFLOAT4X4* GetWorldMatrices() const;
+
+	// Get the current slot of a transform in the contiguous arrays.
+	unsigned int GetIndex(TransformHandle t_handle) const;
+
+	// Get number of live transforms.
+	size_t GetCount() const;
+
+private:
+	// Compute the world matrix of the transform in slot t_index without SIMD batching.
+	void ComputeWorldMatrix(size_t t_index);
+
+	std::vector<float> positionX, positionY, positionZ;
+	std::vector<float> rotationX, rotationY, rotationZ;
+	std::vector<float> scaleX, scaleY, scaleZ;
+	std::vector<DirectX::XMFLOAT4X4> worldMatrices;
+
+	// Handle <-> slot indirection so slots can stay densely packed
+	std::vector<unsigned int> handleToIndex;
+	std::vector<TransformHandle> indexToHandle;
+	std::vector<TransformHandle> freeHandles;
+};
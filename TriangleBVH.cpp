@@ -0,0 +1,156 @@
+#include "TriangleBVH.h"
+#include "Vertex.h"
+#include <algorithm>
+
+using namespace DirectX;
+
+TriangleBVH::TriangleBVH(const std::vector<Vertex>& t_vertices, const std::vector<unsigned int>& t_indices) :
+	boundsMin(XMFLOAT3(0.0f, 0.0f, 0.0f)),
+	boundsMax(XMFLOAT3(0.0f, 0.0f, 0.0f))
+{
+	const unsigned int triangleCount = static_cast<unsigned int>(t_indices.size() / 3);
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// Per-triangle bounds and centroids, which is all the build needs
+	std::vector<XMFLOAT3> triangleMin(triangleCount);
+	std::vector<XMFLOAT3> triangleMax(triangleCount);
+	std::vector<XMFLOAT3> centroids(triangleCount);
+	triangles.resize(triangleCount);
+
+	for (unsigned int t = 0; t < triangleCount; ++t)
+	{
+		XMVECTOR a = XMLoadFloat3(&t_vertices[t_indices[t * 3 + 0]].Position);
+		XMVECTOR b = XMLoadFloat3(&t_vertices[t_indices[t * 3 + 1]].Position);
+		XMVECTOR c = XMLoadFloat3(&t_vertices[t_indices[t * 3 + 2]].Position);
+
+		XMVECTOR minimum = XMVectorMin(XMVectorMin(a, b), c);
+		XMVECTOR maximum = XMVectorMax(XMVectorMax(a, b), c);
+		XMStoreFloat3(&triangleMin[t], minimum);
+		XMStoreFloat3(&triangleMax[t], maximum);
+		XMStoreFloat3(&centroids[t], (minimum + maximum) * 0.5f);
+		triangles[t] = t;
+	}
+
+	// Top-down build: split each node at the centroid median of its longest axis.
+	// An explicit stack keeps deep (badly shaped) meshes from blowing the call stack.
+	struct BuildTask
+	{
+		unsigned int Node;
+		unsigned int First;
+		unsigned int Count;
+	};
+
+	nodes.reserve(triangleCount * 2 / MaxLeafTriangles + 1);
+	nodes.push_back(Node());
+
+	std::vector<BuildTask> stack;
+	stack.push_back({ 0, 0, triangleCount });
+	while (!stack.empty())
+	{
+		BuildTask task = stack.back();
+		stack.pop_back();
+
+		XMVECTOR minimum = XMLoadFloat3(&triangleMin[triangles[task.First]]);
+		XMVECTOR maximum = XMLoadFloat3(&triangleMax[triangles[task.First]]);
+		XMVECTOR centroidMin = XMLoadFloat3(&centroids[triangles[task.First]]);
+		XMVECTOR centroidMax = centroidMin;
+		for (unsigned int i = task.First + 1; i < task.First + task.Count; ++i)
+		{
+			minimum = XMVectorMin(minimum, XMLoadFloat3(&triangleMin[triangles[i]]));
+			maximum = XMVectorMax(maximum, XMLoadFloat3(&triangleMax[triangles[i]]));
+			XMVECTOR centroid = XMLoadFloat3(&centroids[triangles[i]]);
+			centroidMin = XMVectorMin(centroidMin, centroid);
+			centroidMax = XMVectorMax(centroidMax, centroid);
+		}
+
+		Node& node = nodes[task.Node];
+		XMStoreFloat3(&node.Min, minimum);
+		XMStoreFloat3(&node.Max, maximum);
+
+		XMFLOAT3 extent;
+		XMStoreFloat3(&extent, centroidMax - centroidMin);
+
+		// Small enough, or every centroid sits on the same spot: make a leaf
+		if (task.Count <= MaxLeafTriangles || (extent.x <= 0.0f && extent.y <= 0.0f && extent.z <= 0.0f))
+		{
+			node.FirstIndex = task.First;
+			node.TriangleCount = task.Count;
+			continue;
+		}
+
+		int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+		unsigned int half = task.Count / 2;
+		std::nth_element(
+			triangles.begin() + task.First,
+			triangles.begin() + task.First + half,
+			triangles.begin() + task.First + task.Count,
+			[&centroids, axis](unsigned int t_lhs, unsigned int t_rhs)
+			{
+				return (&centroids[t_lhs].x)[axis] < (&centroids[t_rhs].x)[axis];
+			});
+
+		unsigned int firstChild = static_cast<unsigned int>(nodes.size());
+		node.FirstIndex = firstChild;
+		node.TriangleCount = 0;
+
+		// Note: "node" is dangling after this point since nodes may reallocate
+		nodes.push_back(Node());
+		nodes.push_back(Node());
+		stack.push_back({ firstChild, task.First, half });
+		stack.push_back({ firstChild + 1, task.First + half, task.Count - half });
+	}
+
+	boundsMin = nodes[0].Min;
+	boundsMax = nodes[0].Max;
+}
+
+void TriangleBVH::Query(const DirectX::XMFLOAT3& t_min, const DirectX::XMFLOAT3& t_max, std::vector<unsigned int>& t_triangles) const
+{
+	if (nodes.empty())
+	{
+		return;
+	}
+
+	XMVECTOR queryMin = XMLoadFloat3(&t_min);
+	XMVECTOR queryMax = XMLoadFloat3(&t_max);
+
+	const unsigned int MaxStackSize = 64;
+	unsigned int stack[MaxStackSize];
+	unsigned int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const Node& node = nodes[stack[--stackSize]];
+
+		// Boxes overlap unless they are separated on at least one axis
+		if (!XMVector3LessOrEqual(XMLoadFloat3(&node.Min), queryMax) ||
+			!XMVector3GreaterOrEqual(XMLoadFloat3(&node.Max), queryMin))
+		{
+			continue;
+		}
+
+		if (node.TriangleCount > 0)
+		{
+			t_triangles.insert(t_triangles.end(), triangles.begin() + node.FirstIndex, triangles.begin() + node.FirstIndex + node.TriangleCount);
+		}
+		else if (stackSize + 2 <= MaxStackSize)
+		{
+			stack[stackSize++] = node.FirstIndex;
+			stack[stackSize++] = node.FirstIndex + 1;
+		}
+	}
+}
+
+const DirectX::XMFLOAT3& TriangleBVH::GetBoundsMin() const
+{
+	return boundsMin;
+}
+
+const DirectX::XMFLOAT3& TriangleBVH::GetBoundsMax() const
+{
+	return boundsMax;
+}
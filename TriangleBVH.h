@@ -0,0 +1,41 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+
+// Forward Declaration
+struct Vertex;
+
+// Static bounding volume hierarchy over the triangles of an indexed mesh,
+// used to find the handful of triangles a CPU-side query actually touches
+// without walking the whole index buffer.
+class TriangleBVH
+{
+public:
+	// Build the hierarchy over every triangle of the given (local space) geometry.
+	TriangleBVH(const std::vector<Vertex>& t_vertices, const std::vector<unsigned int>& t_indices);
+
+	// Append the number of every triangle whose bounds overlap the given box.
+	// Triangle n uses indices 3n, 3n + 1 and 3n + 2 of the mesh's index buffer.
+	void Query(const DirectX::XMFLOAT3& t_min, const DirectX::XMFLOAT3& t_max, std::vector<unsigned int>& t_triangles) const;
+
+	// Get the bounds of the whole mesh.
+	const DirectX::XMFLOAT3& GetBoundsMin() const;
+	const DirectX::XMFLOAT3& GetBoundsMax() const;
+
+private:
+	// Maximum number of triangles kept in a single leaf.
+	static const unsigned int MaxLeafTriangles = 4;
+
+	struct Node
+	{
+		DirectX::XMFLOAT3 Min;
+		unsigned int FirstIndex;		// First triangle for leaves, first child for interior nodes
+		DirectX::XMFLOAT3 Max;
+		unsigned int TriangleCount;		// Zero for interior nodes
+	};
+
+	std::vector<Node> nodes;
+	std::vector<unsigned int> triangles;
+	DirectX::XMFLOAT3 boundsMin;
+	DirectX::XMFLOAT3 boundsMax;
+};
@@ -4,14 +4,20 @@
 //    which will (eventually) hold data from our C++ code
 // - All non-pipeline variables that get their values from 
 //    our C++ code must be defined inside a Constant Buffer
-// - The name of the cbuffer itself is unimportant
-cbuffer externalData : register(b0)
+// - The start of a cbuffer's name tells SimpleShader how often
+//    it changes, so each is only copied to the GPU when it has to be
+cbuffer perFrame : register(b0)
 {
-	matrix world;
 	matrix view;
 	matrix projection;
 };
 
+cbuffer perObject : register(b1)
+{
+	matrix world;
+	matrix worldInverseTranspose;
+};
+
 // Struct representing a single vertex worth of data
 // - This should match the vertex definition in our C++ code
 // - By "match", I mean the size, order and number of members
@@ -65,7 +71,7 @@ VertexToPixel main( VertexShaderInput input )
 	matrix worldViewProj = mul(mul(world, view), projection);
 	output.position = mul(float4(input.position, 1.0f), worldViewProj);
 	output.worldPosition = mul(float4(input.position, 1.0f), worldViewProj);
-	output.normal = mul(input.normal, (float3x3)world);
+	output.normal = mul(input.normal, (float3x3)worldInverseTranspose);
 	output.normal = normalize(output.normal);
 	
 	// Make sure Tangent is also in world space.
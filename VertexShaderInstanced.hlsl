@@ -0,0 +1,87 @@
+
+// Constant Buffer
+// - Only what is the same for every instance; each instance's
+//    matrices are looked up in the object buffer instead
+cbuffer perFrame : register(b0)
+{
+	matrix view;
+	matrix projection;
+};
+
+// Every object's data, as ObjectTable keeps it in C++
+// - Matrices are the transposed ones Entity keeps, laid out like
+//    those of a constant buffer, so they multiply the same way
+struct ObjectData
+{
+	matrix world;
+	matrix worldInverseTranspose;
+	uint materialIndex;
+	uint3 padding;
+};
+
+StructuredBuffer<ObjectData> objects : register(t0);
+
+// Struct representing a single vertex worth of data
+// - The first four members match the vertex definition in our C++ code
+//    and come from input slot 0
+// - Semantics ending in _PER_INSTANCE come from input slot 1, stepping
+//    once per instance (SimpleVertexShader sets the input layout up so)
+// - Each instance only carries the index of its object's data
+struct VertexShaderInput
+{
+	// Data type
+	//  |
+	//  |   Name          Semantic
+	//  |    |                |
+	//  v    v                v
+	float3 position		: POSITION;     // XYZ position
+	float2 uv			: TEXCOORD;
+	float3 normal		: NORMAL;
+	float3 tangent		: TANGENT;
+	uint objectIndex	: OBJECT_INDEX_PER_INSTANCE;
+};
+
+// Struct representing the data we're sending down the pipeline
+// - Must match VertexShader.hlsl's output, since both feed the same pixel shader
+struct VertexToPixel
+{
+	// Data type
+	//  |
+	//  |   Name          Semantic
+	//  |    |                |
+	//  v    v                v
+	float4 position		 : SV_POSITION;	// XYZW position (System Value Position)
+	float2 uv			 : TEXCOORD;
+	float3 normal		 : NORMAL;
+	float3 tangent		 : TANGENT;
+	float3 worldPosition : POSITION;
+};
+
+
+// --------------------------------------------------------
+// The entry point (main method) for the instanced vertex shader
+//
+// - Does what VertexShader.hlsl does, with the matrices of the
+//    object the instance stands for
+// --------------------------------------------------------
+VertexToPixel main( VertexShaderInput input )
+{
+	// Set up output struct
+	VertexToPixel output;
+
+	ObjectData object = objects[input.objectIndex];
+	matrix worldViewProj = mul(mul(object.world, view), projection);
+	output.position = mul(float4(input.position, 1.0f), worldViewProj);
+	output.worldPosition = output.position.xyz;		// What VertexShader.hlsl passes on too
+	output.normal = mul(input.normal, (float3x3)object.worldInverseTranspose);
+	output.normal = normalize(output.normal);
+
+	// Make sure Tangent is also in world space.
+	output.tangent = mul(input.tangent, (float3x3)object.world);
+	output.tangent = normalize(output.tangent);
+
+	// Copy UV Co-ordinates to Pixel Shader
+	output.uv = input.uv;
+
+	return output;
+}